@@ -0,0 +1,523 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#if defined _WIN32
+	#include <Windows.h>
+#elif defined __linux
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+#include "VulkanFunctions.h"
+#include "Logger.hpp"
+#include "TraceRecorder.hpp"
+
+using std::string;
+
+// Summary statistics of a benchmark's samples - all in nanoseconds
+struct BenchmarkStats
+{
+	size_t Samples   = 0;
+	double Min       = 0.0;
+	double Median    = 0.0;
+	double Mean      = 0.0;
+	double P90       = 0.0;
+	double P99       = 0.0;
+	double Max       = 0.0;
+	double StdDev    = 0.0;
+
+	// Method to calculate stats from a set of samples. Percentiles are linearly interpolated between the closest ranks.
+	static BenchmarkStats fromSamples(std::vector<double> samples)
+	{
+		BenchmarkStats stats;
+		stats.Samples = samples.size();
+		if (samples.empty()) { return stats; }
+
+		std::sort(samples.begin(), samples.end());
+		auto percentile = [&samples](double p)
+		{
+			const double rank = p * static_cast<double>(samples.size() - 1);
+			const size_t lower = static_cast<size_t>(rank);
+			const size_t upper = std::min(lower + 1, samples.size() - 1);
+			return samples[lower] + (samples[upper] - samples[lower]) * (rank - static_cast<double>(lower));
+		};
+
+		double sum = 0.0;
+		for (double sample : samples) { sum += sample; }
+		stats.Mean = sum / static_cast<double>(samples.size());
+
+		double squaredDifferences = 0.0;
+		for (double sample : samples) { squaredDifferences += (sample - stats.Mean) * (sample - stats.Mean); }
+		stats.StdDev = std::sqrt(squaredDifferences / static_cast<double>(samples.size()));
+
+		stats.Min = samples.front();
+		stats.Max = samples.back();
+		stats.Median = percentile(0.5);
+		stats.P90 = percentile(0.9);
+		stats.P99 = percentile(0.99);
+		return stats;
+	}
+};
+
+// The result of one benchmark (or one named timing of a macro benchmark)
+struct BenchmarkResult
+{
+	string Name;
+	string Kind;                      // "micro" or "macro"
+	uint64_t IterationsPerSample = 1; // Micro benchmarks are timed in batches - each sample is the batch time divided by this
+	BenchmarkStats Stats;
+};
+
+// Settings that apply to every benchmark in a run
+struct BenchmarkSettings
+{
+	uint32_t WarmupRepetitions = 3;       // Untimed repetitions before we start sampling (first-touch page faults, driver caches etc.)
+	uint32_t Repetitions       = 30;      // Number of samples per benchmark
+	double MinSampleNanoseconds = 1.0e6;  // Micro benchmarks repeat their body until each sample takes at least this long
+	string Filter;                        // Only run benchmarks whose name contains this (empty = run them all)
+};
+
+// The named timings a macro benchmark reports from a single repetition - e.g., one per phase of startup
+class BenchmarkTimings
+{
+public:
+	void add(const string& name, double nanoseconds) { timings.emplace_back(name, nanoseconds); }
+	const std::vector<std::pair<string, double>>& get() const { return timings; }
+	void clear() { timings.clear(); }
+
+private:
+	std::vector<std::pair<string, double>> timings;
+};
+
+// How much slower than the baseline (as a percentage of the baseline median) a benchmark may get before we call it a regression
+struct RegressionThresholds
+{
+	double DefaultPercent = 10.0;
+	std::map<string, double> PerBenchmarkPercent; // Overrides for noisy (or especially important) benchmarks
+
+	double getPercent(const string& name) const
+	{
+		const auto found = PerBenchmarkPercent.find(name);
+		return found != PerBenchmarkPercent.end() ? found->second : DefaultPercent;
+	}
+};
+
+// Details of the machine we ran on, written alongside the results so that we only compare like with like
+struct BenchmarkEnvironment
+{
+	string DeviceName;
+	uint32_t DriverVersion = 0;
+	uint32_t ApiVersion    = 0;
+	string CpuGovernor     = "unknown"; // Linux `scaling_governor` of the core we're pinned to
+	int PinnedCore         = -1;        // -1 if we couldn't pin ourselves to a core
+
+	BenchmarkEnvironment() = default;
+	BenchmarkEnvironment(const BenchmarkEnvironment&) = delete; // We own the governor we changed (if any) - see `restoreCpu`
+	BenchmarkEnvironment& operator=(const BenchmarkEnvironment&) = delete;
+	~BenchmarkEnvironment() { restoreCpu(); }
+
+	// Method to make timings as repeatable as we can from user mode: pin this thread to the core it's on (so we don't migrate between
+	// cores with different clocks / caches), raise its priority and - on Linux - ask for the `performance` cpufreq governor.
+	// Note: Setting the governor needs root, so usually all we can do is record it. If it isn't `performance` expect noisier results.
+	// If we did change it, `restoreCpu` (which our destructor calls) puts the original back.
+	void pinCpu()
+	{
+#if defined _WIN32
+		PinnedCore = static_cast<int>(GetCurrentProcessorNumber());
+		if (SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << PinnedCore) == 0) { PinnedCore = -1; }
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+		CpuGovernor = "windows";
+#elif defined __linux
+		const int core = sched_getcpu();
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(core, &cpuSet);
+		PinnedCore = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0 ? core : -1;
+
+		const string governorPath = "/sys/devices/system/cpu/cpu" + std::to_string(core) + "/cpufreq/scaling_governor";
+		std::ifstream governorIn(governorPath);
+		if (governorIn >> CpuGovernor && CpuGovernor != "performance")
+		{
+			governorIn.close();
+			std::ofstream governorOut(governorPath);
+			if (governorOut << "performance" << std::flush)
+			{
+				changedGovernorPath = governorPath;
+				originalGovernor = CpuGovernor;
+				CpuGovernor = "performance";
+			}
+		}
+#endif
+		if (PinnedCore < 0) { LOG_WARNING("[WARNING] Could not pin the benchmark thread to a CPU core - results may be noisier."); }
+		else                { LOG_VERBOSE("[OK] Benchmark thread pinned to CPU core: {} (cpufreq governor: {})", PinnedCore, CpuGovernor); }
+		if (CpuGovernor != "performance" && CpuGovernor != "windows")
+		{
+			LOG_WARNING("[WARNING] CPU frequency governor is: {} - run as root (or set `performance` yourself) for stable clocks.", CpuGovernor);
+		}
+	}
+
+	// Method to put back the cpufreq governor `pinCpu` changed, so a benchmark run doesn't leave the machine in `performance` mode.
+	// Safe to call more than once (or when we never changed anything).
+	void restoreCpu()
+	{
+		if (changedGovernorPath.empty()) { return; }
+		std::ofstream governorOut(changedGovernorPath);
+		if (governorOut << originalGovernor << std::flush)
+		{
+			LOG_VERBOSE("[OK] Restored cpufreq governor of CPU core {} to: {}", PinnedCore, originalGovernor);
+		}
+		else
+		{
+			LOG_WARNING("[WARNING] Could not restore cpufreq governor to: {} (via: {})", originalGovernor, changedGovernorPath);
+		}
+		changedGovernorPath.clear();
+	}
+
+private:
+	string changedGovernorPath; // Empty unless `pinCpu` changed the governor
+	string originalGovernor;
+};
+
+// Class to run micro & macro benchmarks, summarise their timings and compare them against a baseline.
+//
+// - Micro benchmarks are small bodies of code we run many times back-to-back: each sample times a batch of iterations (sized so a batch
+//   takes at least `MinSampleNanoseconds`, which swamps the cost of reading the clock) and divides by the batch size.
+// - Macro benchmarks are bigger operations that time themselves and report one or more named timings per repetition (e.g., startup
+//   reports each of its phases). Each named timing becomes its own result, called "<benchmark name>/<timing name>".
+class BenchmarkSuite
+{
+public:
+
+	void addMicro(const string& name, std::function<void()> body) { benchmarks.push_back({ name, std::move(body), nullptr, 0 }); }
+
+	// Note: `repetitions` overrides `BenchmarkSettings::Repetitions` for expensive benchmarks (0 = use the setting)
+	void addMacro(const string& name, std::function<bool(BenchmarkTimings&)> body, uint32_t repetitions = 0)
+	{
+		benchmarks.push_back({ name, nullptr, std::move(body), repetitions });
+	}
+
+	// Method to add results from another suite (e.g., one that had to run before this suite's benchmarks could be set up)
+	void addResults(const std::vector<BenchmarkResult>& otherResults) { results.insert(results.end(), otherResults.begin(), otherResults.end()); }
+
+	// Method to run every benchmark that matches `settings.Filter`, adding to our results. Returns false if any macro benchmark reported a failure.
+	bool run(const BenchmarkSettings& settings)
+	{
+		bool allSucceeded = true;
+		for (auto& benchmark : benchmarks)
+		{
+			if (!settings.Filter.empty() && benchmark.Name.find(settings.Filter) == string::npos) { continue; }
+			LOG_VERBOSE("Running benchmark: {}", benchmark.Name);
+			const bool succeeded = benchmark.Micro ? runMicro(benchmark, settings) : runMacro(benchmark, settings);
+			if (!succeeded)
+			{
+				LOG_ERROR("[FAIL] Benchmark failed: {}", benchmark.Name);
+				allSucceeded = false;
+			}
+		}
+		return allSucceeded;
+	}
+
+	const std::vector<BenchmarkResult>& getResults() const { return results; }
+
+	// Method to print a one-line summary of each result
+	void logResults() const
+	{
+		LOG_INFO("----- Benchmark results (microseconds): median / p90 / p99 / min / max (samples) -----");
+		for (auto& result : results)
+		{
+			const BenchmarkStats& s = result.Stats;
+			LOG_INFO("  {}: {} / {} / {} / {} / {} ({})", result.Name, s.Median / 1000.0, s.P90 / 1000.0, s.P99 / 1000.0, s.Min / 1000.0, s.Max / 1000.0, s.Samples);
+		}
+	}
+
+	// Method to write our results (and the environment they came from) out as JSON. Returns false if we couldn't write the file.
+	bool writeJson(const string& path, const BenchmarkEnvironment& environment, const BenchmarkSettings& settings) const
+	{
+		std::ofstream out(path, std::ios::binary);
+		if (!out)
+		{
+			LOG_ERROR("[FAIL] Could not open benchmark results file for writing: {}", path);
+			return false;
+		}
+
+		out.precision(10);
+		out << "{\n  \"schema\": 1,\n";
+		out << "  \"environment\": { \"device\": \"" << escapeJson(environment.DeviceName) << "\", \"driverVersion\": " << environment.DriverVersion
+			<< ", \"apiVersion\": \"" << formatApiVersion(environment.ApiVersion) << "\", \"cpuGovernor\": \"" << escapeJson(environment.CpuGovernor) << "\", \"pinnedCore\": " << environment.PinnedCore << " },\n";
+		out << "  \"settings\": { \"warmupRepetitions\": " << settings.WarmupRepetitions << ", \"repetitions\": " << settings.Repetitions
+			<< ", \"minSampleNanoseconds\": " << settings.MinSampleNanoseconds << " },\n";
+		out << "  \"benchmarks\": [";
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const BenchmarkResult& result = results[i];
+			const BenchmarkStats& s = result.Stats;
+			out << (i == 0 ? "\n" : ",\n");
+			out << "    { \"name\": \"" << escapeJson(result.Name) << "\", \"kind\": \"" << result.Kind << "\", \"iterationsPerSample\": " << result.IterationsPerSample
+				<< ", \"samples\": " << s.Samples << ", \"median_ns\": " << s.Median << ", \"mean_ns\": " << s.Mean << ", \"p90_ns\": " << s.P90
+				<< ", \"p99_ns\": " << s.P99 << ", \"min_ns\": " << s.Min << ", \"max_ns\": " << s.Max << ", \"stddev_ns\": " << s.StdDev << " }";
+		}
+		out << "\n  ]\n}\n";
+
+		// Note: A full disk (say) only shows up once the buffered output actually gets written
+		out.flush();
+		if (!out.good())
+		{
+			LOG_ERROR("[FAIL] Could not write benchmark results to: {}", path);
+			return false;
+		}
+		LOG_INFO("[OK] Wrote {} benchmark results to: {}", results.size(), path);
+		return true;
+	}
+
+	// Method to compare our medians against those in a results file from an earlier run. Returns false if we couldn't read the
+	// baseline or if any benchmark got slower by more than its threshold. Benchmarks missing from either side are reported but ignored.
+	// Note: If the baseline came from a different environment (device, driver, governor or pinning) we warn about each difference,
+	// but still compare - it's up to whoever reads the results whether the numbers are meaningful.
+	bool compareWithBaseline(const string& baselinePath, const BenchmarkEnvironment& environment, const RegressionThresholds& thresholds) const
+	{
+		std::ifstream in(baselinePath, std::ios::binary);
+		if (!in)
+		{
+			LOG_ERROR("[FAIL] Could not open baseline file: {}", baselinePath);
+			return false;
+		}
+		const string baseline((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+		std::map<string, double> baselineMedians;
+		if (!readBaselineMedians(baseline, baselinePath, baselineMedians)) { return false; }
+
+		LOG_INFO("----- Comparison against baseline: {} -----", baselinePath);
+		const uint32_t environmentDifferences = compareBaselineEnvironment(baseline, environment);
+
+		uint32_t regressions = 0;
+		for (auto& result : results)
+		{
+			const auto found = baselineMedians.find(result.Name);
+			if (found == baselineMedians.end() || found->second <= 0.0)
+			{
+				LOG_INFO("  [NEW]  {} - not in baseline", result.Name);
+				continue;
+			}
+
+			const double changePercent = (result.Stats.Median - found->second) / found->second * 100.0;
+			const double thresholdPercent = thresholds.getPercent(result.Name);
+			if (changePercent > thresholdPercent)
+			{
+				++regressions;
+				LOG_ERROR("  [FAIL] {}: {}% slower than baseline (threshold: {}%)", result.Name, changePercent, thresholdPercent);
+			}
+			else
+			{
+				LOG_INFO("  [OK]   {}: {}% vs baseline", result.Name, changePercent);
+			}
+		}
+
+		if (environmentDifferences > 0)
+		{
+			LOG_WARNING("[WARNING] The baseline ran in a different environment ({} difference(s) above) - treat this comparison with suspicion.", environmentDifferences);
+		}
+		if (regressions > 0)
+		{
+			LOG_ERROR("[FAIL] {} benchmark(s) regressed beyond their thresholds.", regressions);
+			return false;
+		}
+		LOG_INFO("[OK] No benchmark regressed beyond its threshold.");
+		return true;
+	}
+
+private:
+
+	struct Benchmark
+	{
+		string Name;
+		std::function<void()> Micro;
+		std::function<bool(BenchmarkTimings&)> Macro;
+		uint32_t Repetitions;
+	};
+
+	bool runMicro(const Benchmark& benchmark, const BenchmarkSettings& settings)
+	{
+		// Double the batch size until one batch takes long enough to time accurately - which doubles as our first bit of warmup
+		uint64_t iterations = 1;
+		for (;;)
+		{
+			const double batchNanoseconds = timeBatch(benchmark.Micro, iterations);
+			if (batchNanoseconds >= settings.MinSampleNanoseconds || iterations >= (uint64_t(1) << 30)) { break; }
+			iterations *= 2;
+		}
+
+		for (uint32_t i = 0; i < settings.WarmupRepetitions; ++i) { timeBatch(benchmark.Micro, iterations); }
+
+		std::vector<double> samples;
+		samples.reserve(settings.Repetitions);
+		for (uint32_t i = 0; i < settings.Repetitions; ++i)
+		{
+			samples.push_back(timeBatch(benchmark.Micro, iterations) / static_cast<double>(iterations));
+		}
+
+		results.push_back({ benchmark.Name, "micro", iterations, BenchmarkStats::fromSamples(std::move(samples)) });
+		return true;
+	}
+
+	bool runMacro(const Benchmark& benchmark, const BenchmarkSettings& settings)
+	{
+		BenchmarkTimings timings;
+		for (uint32_t i = 0; i < settings.WarmupRepetitions; ++i)
+		{
+			timings.clear();
+			if (!benchmark.Macro(timings)) { return false; }
+		}
+
+		// Note: Keep the timings in the order the benchmark first reports them, so related results stay together in the output
+		std::vector<string> order;
+		std::map<string, std::vector<double>> samplesByName;
+		const uint32_t repetitions = benchmark.Repetitions > 0 ? benchmark.Repetitions : settings.Repetitions;
+		for (uint32_t i = 0; i < repetitions; ++i)
+		{
+			timings.clear();
+			if (!benchmark.Macro(timings)) { return false; }
+			for (auto& [name, nanoseconds] : timings.get())
+			{
+				auto& samples = samplesByName[name];
+				if (samples.empty()) { order.push_back(name); }
+				samples.push_back(nanoseconds);
+			}
+		}
+
+		for (auto& name : order)
+		{
+			results.push_back({ benchmark.Name + "/" + name, "macro", 1, BenchmarkStats::fromSamples(std::move(samplesByName[name])) });
+		}
+		return true;
+	}
+
+	static double timeBatch(const std::function<void()>& body, uint64_t iterations)
+	{
+		const uint64_t start = TraceRecorder::nowNanoseconds();
+		for (uint64_t i = 0; i < iterations; ++i) { body(); }
+		return static_cast<double>(TraceRecorder::nowNanoseconds() - start);
+	}
+
+	static string formatApiVersion(uint32_t version)
+	{
+		return std::to_string(VK_VERSION_MAJOR(version)) + '.' + std::to_string(VK_VERSION_MINOR(version)) + '.' + std::to_string(VK_VERSION_PATCH(version));
+	}
+
+	// Note: JSON doesn't allow raw control characters in strings, so those (anything below 0x20) become `\u00XX`
+	static string escapeJson(const string& text)
+	{
+		static const char hexDigits[] = "0123456789abcdef";
+		string escaped;
+		for (char c : text)
+		{
+			const unsigned char byte = static_cast<unsigned char>(c);
+			if (byte < 0x20)
+			{
+				escaped += "\\u00";
+				escaped += hexDigits[byte >> 4];
+				escaped += hexDigits[byte & 0xF];
+				continue;
+			}
+			if (c == '"' || c == '\\') { escaped += '\\'; }
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	// Note: This only reads files written by `writeJson` - it looks for each `"name"` and the `"median_ns"` that follows it in the same
+	// object, rather than being a general JSON parser.
+	static bool readBaselineMedians(const string& text, const string& path, std::map<string, double>& medians)
+	{
+		const string nameKey = "\"name\": \"";
+		const string medianKey = "\"median_ns\": ";
+		for (size_t position = text.find(nameKey); position != string::npos; position = text.find(nameKey, position))
+		{
+			position += nameKey.size();
+			const size_t nameEnd = text.find('"', position);
+			const size_t objectEnd = text.find('}', position);
+			const size_t median = text.find(medianKey, position);
+			if (nameEnd == string::npos || median == string::npos || median > objectEnd) { continue; }
+			medians[text.substr(position, nameEnd - position)] = std::strtod(text.c_str() + median + medianKey.size(), nullptr);
+		}
+
+		if (medians.empty())
+		{
+			LOG_ERROR("[FAIL] Baseline file has no benchmark results in it: {}", path);
+			return false;
+		}
+		return true;
+	}
+
+	// Method to find the raw (still escaped, for strings) value of `key` in the baseline's `"environment"` object. Like
+	// `readBaselineMedians` this only understands what `writeJson` writes. Returns false if the key isn't there (e.g., an older file).
+	static bool findBaselineEnvironmentValue(const string& text, const string& key, string& value)
+	{
+		const size_t environmentStart = text.find("\"environment\": {");
+		if (environmentStart == string::npos) { return false; }
+		const size_t environmentEnd = text.find('}', environmentStart);
+		const string keyPrefix = "\"" + key + "\": ";
+		size_t position = text.find(keyPrefix, environmentStart);
+		if (position == string::npos || position > environmentEnd) { return false; }
+
+		position += keyPrefix.size();
+		if (text[position] == '"')
+		{
+			// Note: Skip over escaped characters, so an escaped quote doesn't end the string early
+			size_t end = ++position;
+			while (end < environmentEnd && text[end] != '"') { end += text[end] == '\\' ? 2 : 1; }
+			value = text.substr(position, end - position);
+		}
+		else
+		{
+			value = text.substr(position, text.find_first_of(",}", position) - position);
+			value.erase(value.find_last_not_of(' ') + 1);
+		}
+		return true;
+	}
+
+	// Method to warn about each way the baseline's environment differs from ours. Returns how many differences there were.
+	// Note: We compare whether each run was pinned, not the core number - `pinCpu` pins to whichever core we happen to start on.
+	static uint32_t compareBaselineEnvironment(const string& text, const BenchmarkEnvironment& environment)
+	{
+		const std::pair<string, string> ours[] =
+		{
+			{ "device",        escapeJson(environment.DeviceName) },
+			{ "driverVersion", std::to_string(environment.DriverVersion) },
+			{ "apiVersion",    formatApiVersion(environment.ApiVersion) },
+			{ "cpuGovernor",   escapeJson(environment.CpuGovernor) },
+			{ "pinnedCore",    environment.PinnedCore >= 0 ? "pinned" : "not pinned" },
+		};
+
+		uint32_t differences = 0;
+		for (auto& [key, ourValue] : ours)
+		{
+			string baselineValue;
+			if (!findBaselineEnvironmentValue(text, key, baselineValue))
+			{
+				LOG_WARNING("[WARNING] Baseline doesn't record its environment's: {}", key);
+				++differences;
+				continue;
+			}
+			if (key == "pinnedCore") { baselineValue = std::atoi(baselineValue.c_str()) >= 0 ? "pinned" : "not pinned"; }
+			if (baselineValue != ourValue)
+			{
+				LOG_WARNING("[WARNING] Baseline environment differs - {}: {} (baseline) vs {} (this run)", key, baselineValue, ourValue);
+				++differences;
+			}
+		}
+		return differences;
+	}
+
+	std::vector<Benchmark> benchmarks;
+	std::vector<BenchmarkResult> results;
+};
@@ -0,0 +1,449 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "GpuBuffer.hpp"
+#include "ComputeKernels.hpp"
+#include "GpuProfiler.hpp"
+#include "QueryManager.hpp"
+#include "RenderGraph.hpp"
+#include "TransientResourcePool.hpp"
+#include "TraceRecorder.hpp"
+
+// A named unit of GPU work that we record into its own command buffer and run to completion. This is what we run in headless
+// mode, where there is no window, no surface and no swapchain - just a queue with `VK_QUEUE_COMPUTE_BIT` set and a list of jobs.
+struct BatchWorkload
+{
+	string Name;
+	std::function<bool(VkCommandBuffer)> Record; // Records the work into the given (already begun) command buffer - return false to abort the batch
+	std::function<bool()> Verify;                // Optional: Checks the results once the GPU has finished with the batch
+};
+
+// Class to run a batch of `BatchWorkload`s on a single queue. Every workload gets recorded into its own primary command buffer, then
+// the whole lot goes to the GPU in a single `vkQueueSubmit` and we block on a fence until it's done.
+// If we've been given a `GpuProfiler` then each workload is wrapped in a GPU timing zone named after the workload - and likewise, if
+// we've been given a `QueryManager`, in a query pass (so we get each workload's pipeline statistics).
+class ComputeBatchRunner
+{
+public:
+
+	// Optional: Time each workload on the GPU. The profiler must outlive this runner (or be unset with nullptr first).
+	void setProfiler(GpuProfiler* gpuProfiler) { profiler = gpuProfiler; }
+
+	// Optional: Collect each workload's queries (pipeline statistics etc.). Again, the manager must outlive this runner.
+	void setQueryManager(QueryManager* manager) { queryManager = manager; }
+
+	bool create(VkDevice logicalDevice, uint32_t queueFamilyIndex, VkQueue queue)
+	{
+		device = logicalDevice;
+		activeQueue = queue;
+
+		// Note: `TRANSIENT` hints to the driver that our command buffers are short-lived, and `RESET_COMMAND_BUFFER` lets us re-record them.
+		VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+		commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		commandPoolCreateInfo.pNext = nullptr;
+		commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+		VkResult result = VulkanFunctionLoaders::vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create batch command pool. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+
+		VkFenceCreateInfo fenceCreateInfo = {};
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceCreateInfo.pNext = nullptr;
+		fenceCreateInfo.flags = 0;
+
+		result = VulkanFunctionLoaders::vkCreateFence(device, &fenceCreateInfo, nullptr, &batchFence);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create batch fence. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+
+		return true;
+	}
+
+	// Method to record, submit and wait for all the given workloads, then run their `Verify` checks. Returns true only if every step
+	// (and every verification) succeeded.
+	bool run(const std::vector<BatchWorkload>& workloads)
+	{
+		if (workloads.empty())
+		{
+			LOG_WARNING("[WARNING] Asked to run an empty batch - nothing to do.");
+			return true;
+		}
+
+		// Grow our set of command buffers if this batch is bigger than any batch we've run before
+		if (commandBuffers.size() < workloads.size())
+		{
+			const auto numExtraBuffers = static_cast<uint32_t>(workloads.size() - commandBuffers.size());
+			std::vector<VkCommandBuffer> extraBuffers(numExtraBuffers);
+
+			VkCommandBufferAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocateInfo.pNext = nullptr;
+			allocateInfo.commandPool = commandPool;
+			allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocateInfo.commandBufferCount = numExtraBuffers;
+
+			const VkResult result = VulkanFunctionLoaders::vkAllocateCommandBuffers(device, &allocateInfo, extraBuffers.data());
+			if (result != VK_SUCCESS)
+			{
+				LOG_ERROR("[FAIL] Could not allocate batch command buffers. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+				return false;
+			}
+			commandBuffers.insert(commandBuffers.end(), extraBuffers.begin(), extraBuffers.end());
+		}
+
+		// Resetting the pool resets every command buffer allocated from it in one go (cheaper than resetting them one at a time)
+		VulkanFunctionLoaders::vkResetCommandPool(device, commandPool, 0);
+
+		TraceScope recordZone("Record batch");
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.pNext = nullptr;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = nullptr;
+
+		for (size_t i = 0; i < workloads.size(); ++i)
+		{
+			VkCommandBuffer commandBuffer = commandBuffers[i];
+			VulkanFunctionLoaders::vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+			// Note: The profiler's per-frame query reset must come before any of this batch's zones - so it goes first in the first command buffer
+			if (profiler != nullptr && i == 0) { profiler->beginFrame(commandBuffer); }
+			if (queryManager != nullptr && i == 0) { queryManager->beginFrame(commandBuffer); }
+
+			const uint32_t zone = profiler != nullptr ? profiler->beginZone(commandBuffer, workloads[i].Name.c_str()) : UINT32_MAX;
+			const uint32_t pass = queryManager != nullptr ? queryManager->beginPass(commandBuffer, workloads[i].Name.c_str()) : UINT32_MAX;
+			const bool recorded = workloads[i].Record(commandBuffer);
+			if (queryManager != nullptr) { queryManager->endPass(commandBuffer, pass); }
+			if (profiler != nullptr) { profiler->endZone(commandBuffer, zone); }
+
+			if (!recorded)
+			{
+				LOG_ERROR("[FAIL] Could not record batch workload: {}", workloads[i].Name);
+				VulkanFunctionLoaders::vkEndCommandBuffer(commandBuffer);
+				return false;
+			}
+			const VkResult result = VulkanFunctionLoaders::vkEndCommandBuffer(commandBuffer);
+			if (result != VK_SUCCESS)
+			{
+				LOG_ERROR("[FAIL] Could not end command buffer for batch workload: {}. VkResult is: {}", workloads[i].Name, VulkanHelpers::getFriendlyResultString(result));
+				return false;
+			}
+		}
+
+		recordZone.end();
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = nullptr;
+		submitInfo.waitSemaphoreCount = 0;
+		submitInfo.pWaitSemaphores = nullptr;
+		submitInfo.pWaitDstStageMask = nullptr;
+		submitInfo.commandBufferCount = static_cast<uint32_t>(workloads.size());
+		submitInfo.pCommandBuffers = commandBuffers.data();
+		submitInfo.signalSemaphoreCount = 0;
+		submitInfo.pSignalSemaphores = nullptr;
+
+		lastSubmitNanoseconds = TraceRecorder::nowNanoseconds();
+		TraceScope submitZone("Submit batch");
+		VkResult result = VulkanFunctionLoaders::vkQueueSubmit(activeQueue, 1, &submitInfo, batchFence);
+		submitZone.end();
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not submit batch. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+
+		TraceScope waitZone("Wait for batch");
+		result = VulkanFunctionLoaders::vkWaitForFences(device, 1, &batchFence, VK_TRUE, UINT64_MAX);
+		VulkanFunctionLoaders::vkResetFences(device, 1, &batchFence);
+		waitZone.end();
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Failed waiting for batch to complete. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+
+		// The GPU's finished with the batch so all of its timestamps are available - grab them now rather than next time around
+		if (profiler != nullptr) { profiler->resolve(); }
+		if (queryManager != nullptr) { queryManager->resolve(); }
+
+		bool allVerified = true;
+		for (auto& workload : workloads)
+		{
+			if (!workload.Verify) { continue; }
+
+			const bool verified = workload.Verify();
+			if (verified) { LOG_VERBOSE("[OK] Batch workload: {} verified.", workload.Name); }
+			else          { LOG_ERROR("[FAIL] Batch workload: {} produced incorrect results.", workload.Name); }
+			allVerified = allVerified && verified;
+		}
+		return allVerified;
+	}
+
+	// The CPU time (on `TraceRecorder::nowNanoseconds`'s clock) at which we last submitted a batch
+	uint64_t getLastSubmitNanoseconds() const { return lastSubmitNanoseconds; }
+
+	// CAREFUL: Only call this once the GPU is done with everything we've submitted (`run` always waits, so that's true between runs).
+	void destroy()
+	{
+		if (batchFence != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyFence(device, batchFence, nullptr);
+			batchFence = VK_NULL_HANDLE;
+		}
+		if (commandPool != VK_NULL_HANDLE)
+		{
+			// Note: Destroying the pool frees all the command buffers that were allocated from it
+			VulkanFunctionLoaders::vkDestroyCommandPool(device, commandPool, nullptr);
+			commandPool = VK_NULL_HANDLE;
+		}
+		commandBuffers.clear();
+	}
+
+private:
+	GpuProfiler* profiler = nullptr;
+	QueryManager* queryManager = nullptr;
+	uint64_t lastSubmitNanoseconds = 0;
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueue activeQueue = VK_NULL_HANDLE;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkFence batchFence = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> commandBuffers;
+};
+
+// A simple self-checking workload: fill a device-local buffer with a known pattern using `vkCmdFillBuffer`, copy it back to a
+// host-visible buffer and check every word made the round trip. Useful as a smoke test that a headless device actually runs work.
+inline BatchWorkload makeBufferFillWorkload(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, VkDeviceSize sizeInBytes, uint32_t pattern)
+{
+	// The buffers need to outlive the recording (they're used when the batch executes & when we verify), so the workload's lambdas share ownership of them
+	struct FillState
+	{
+		VkDevice Device = VK_NULL_HANDLE;
+		GpuBuffer DeviceBuffer;
+		GpuBuffer ReadbackBuffer;
+		~FillState() { DeviceBuffer.destroy(Device); ReadbackBuffer.destroy(Device); }
+	};
+	auto state = std::make_shared<FillState>();
+	state->Device = device;
+
+	const VkDeviceSize size = sizeInBytes & ~VkDeviceSize(3); // `vkCmdFillBuffer` writes whole 32-bit words only
+
+	BatchWorkload workload;
+	workload.Name = "buffer-fill";
+	workload.Record = [state, memoryProperties, size, pattern](VkCommandBuffer commandBuffer)
+	{
+		// Note: Only made the first time we're recorded - re-recording reuses them (the runner waited for the last batch to finish)
+		if (state->DeviceBuffer.Buffer == VK_NULL_HANDLE &&
+			!state->DeviceBuffer.create(state->Device, memoryProperties, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+		{
+			return false;
+		}
+		if (state->ReadbackBuffer.Buffer == VK_NULL_HANDLE &&
+			!state->ReadbackBuffer.create(state->Device, memoryProperties, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true))
+		{
+			return false;
+		}
+
+		// Fill, then copy back - the graph works out that the copy has to wait for the fill, and the host for the copy
+		RenderGraph graph;
+		const RenderGraphResource deviceBuffer = graph.importBuffer("Device buffer", state->DeviceBuffer.Buffer);
+		const RenderGraphResource readbackBuffer = graph.importBuffer("Readback buffer", state->ReadbackBuffer.Buffer);
+		graph.addPass("Fill", [state, size, pattern](VkCommandBuffer cb)
+		{
+			VulkanFunctionLoaders::vkCmdFillBuffer(cb, state->DeviceBuffer.Buffer, 0, size, pattern);
+		}).write(deviceBuffer, ResourceUsage::TransferWrite);
+		graph.addPass("Copy", [state, size](VkCommandBuffer cb)
+		{
+			VkBufferCopy region = { 0, 0, size };
+			VulkanFunctionLoaders::vkCmdCopyBuffer(cb, state->DeviceBuffer.Buffer, state->ReadbackBuffer.Buffer, 1, &region);
+		}).read(deviceBuffer, ResourceUsage::TransferRead).write(readbackBuffer, ResourceUsage::TransferWrite);
+		graph.markOutput(readbackBuffer, ResourceUsage::HostRead);
+		if (!graph.compile()) { return false; }
+		graph.execute(commandBuffer);
+		return true;
+	};
+	workload.Verify = [state, size, pattern]()
+	{
+		const auto* words = static_cast<const uint32_t*>(state->ReadbackBuffer.Mapped);
+		for (VkDeviceSize i = 0; i < size / sizeof(uint32_t); ++i)
+		{
+			if (words[i] != pattern) { return false; }
+		}
+		return true;
+	};
+	return workload;
+}
+
+// A self-checking workload for the render graph's transient aliasing: fill a transient buffer with a known pattern, pass it down a chain
+// of `stages` transient buffers one copy at a time, then copy the last one back to a host-visible buffer and check it. Only two links of
+// the chain are ever alive at once, so the graph should fit the whole chain in two buffers' worth of memory - and if its aliasing
+// barriers were wrong, the pattern would get trampled on the way down.
+inline BatchWorkload makeTransientChainWorkload(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, VkDeviceSize bufferImageGranularity,
+	VkDeviceSize sizeInBytes, uint32_t stages, uint32_t pattern)
+{
+	struct ChainState
+	{
+		VkDevice Device = VK_NULL_HANDLE;
+		TransientResourcePool Pool;
+		GpuBuffer ReadbackBuffer;
+		RenderGraph Graph;
+		~ChainState() { Pool.destroy(); ReadbackBuffer.destroy(Device); }
+	};
+	auto state = std::make_shared<ChainState>();
+	state->Device = device;
+	state->Pool.create(device, memoryProperties, bufferImageGranularity);
+
+	const VkDeviceSize size = sizeInBytes & ~VkDeviceSize(3); // `vkCmdFillBuffer` writes whole 32-bit words only
+	stages = std::max(stages, 1u);
+
+	BatchWorkload workload;
+	workload.Name = "transient-chain";
+	workload.Record = [state, memoryProperties, size, stages, pattern](VkCommandBuffer commandBuffer)
+	{
+		// Note: Unlike the transients, the readback buffer is ours - so we only make it the first time we're recorded
+		if (state->ReadbackBuffer.Buffer == VK_NULL_HANDLE &&
+			!state->ReadbackBuffer.create(state->Device, memoryProperties, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true))
+		{
+			return false;
+		}
+
+		RenderGraph& graph = state->Graph;
+		graph.reset();
+		std::vector<RenderGraphResource> links;
+		for (uint32_t i = 0; i < stages; ++i)
+		{
+			links.push_back(graph.createBuffer("Link", size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT));
+		}
+		const RenderGraphResource readback = graph.importBuffer("Readback buffer", state->ReadbackBuffer.Buffer);
+
+		// Note: The passes look their buffers up when they run, as transients don't have a `VkBuffer` until the graph's compiled
+		graph.addPass("Fill", [&graph, link = links[0], size, pattern](VkCommandBuffer cb)
+		{
+			VulkanFunctionLoaders::vkCmdFillBuffer(cb, graph.getBuffer(link), 0, size, pattern);
+		}).write(links[0], ResourceUsage::TransferWrite);
+		for (uint32_t i = 1; i <= stages; ++i)
+		{
+			const RenderGraphResource destination = i < stages ? links[i] : readback;
+			graph.addPass("Copy", [&graph, source = links[i - 1], destination, size](VkCommandBuffer cb)
+			{
+				VkBufferCopy region = { 0, 0, size };
+				VulkanFunctionLoaders::vkCmdCopyBuffer(cb, graph.getBuffer(source), graph.getBuffer(destination), 1, &region);
+			}).read(links[i - 1], ResourceUsage::TransferRead).write(destination, ResourceUsage::TransferWrite);
+		}
+		graph.markOutput(readback, ResourceUsage::HostRead);
+
+		if (!graph.compile(&state->Pool)) { return false; }
+		graph.execute(commandBuffer);
+
+		const RenderGraphStats& stats = graph.getStats();
+		LOG_VERBOSE("[OK] Transient memory for '{}': {} KiB aliased vs {} KiB naive ({} transients, {} aliased).", "transient-chain",
+			stats.TransientAliasedBytes / 1024, stats.TransientNaiveBytes / 1024, stats.TransientResources, stats.AliasedTransients);
+		return true;
+	};
+	workload.Verify = [state, size, pattern]()
+	{
+		const auto* words = static_cast<const uint32_t*>(state->ReadbackBuffer.Mapped);
+		for (VkDeviceSize i = 0; i < size / sizeof(uint32_t); ++i)
+		{
+			if (words[i] != pattern) { return false; }
+		}
+		return true;
+	};
+	return workload;
+}
+
+// A self-checking workload for our compute kernels: `result = 0.5 * x + y` over `count` elements, in whatever precision `kernels` was
+// created with. The inputs are all multiples of 1/8 in [-1, 1] - so x, y AND the answer are exact in fp16 as well as fp32, and we can
+// check every element for an exact match whichever precision we ran in. The library must outlive the batch.
+inline BatchWorkload makeAxpyWorkload(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, ComputeKernelLibrary& kernels, uint32_t count)
+{
+	struct AxpyState
+	{
+		VkDevice Device = VK_NULL_HANDLE;
+		GpuBuffer X;
+		GpuBuffer Y;
+		GpuBuffer Result;
+		~AxpyState() { X.destroy(Device); Y.destroy(Device); Result.destroy(Device); }
+	};
+	auto state = std::make_shared<AxpyState>();
+	state->Device = device;
+
+	const float alpha = 0.5f;
+	auto xValue = [](uint32_t i) { return static_cast<float>(static_cast<int32_t>(i % 17) - 8) / 8.0f; };
+	auto yValue = [](uint32_t i) { return static_cast<float>(static_cast<int32_t>(i % 13) - 6) / 8.0f; };
+
+	BatchWorkload workload;
+	workload.Name = string("axpy-") + getComputePrecisionName(kernels.getPrecision());
+	workload.Record = [state, memoryProperties, &kernels, count, alpha, xValue, yValue](VkCommandBuffer commandBuffer)
+	{
+		const VkDeviceSize size = static_cast<VkDeviceSize>(count) * kernels.getElementSize();
+		if (state->X.Buffer == VK_NULL_HANDLE)
+		{
+			const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			if (!state->X.create(state->Device, memoryProperties, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->Y.create(state->Device, memoryProperties, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->Result.create(state->Device, memoryProperties, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true))
+			{
+				return false;
+			}
+
+			// Note: Host writes made before the batch is submitted are visible to it without any barrier
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				if (kernels.getPrecision() == ComputePrecision::Fp32)
+				{
+					static_cast<float*>(state->X.Mapped)[i] = xValue(i);
+					static_cast<float*>(state->Y.Mapped)[i] = yValue(i);
+				}
+				else
+				{
+					static_cast<uint16_t*>(state->X.Mapped)[i] = floatToHalf(xValue(i));
+					static_cast<uint16_t*>(state->Y.Mapped)[i] = floatToHalf(yValue(i));
+				}
+			}
+		}
+
+		RenderGraph graph;
+		const RenderGraphResource x = graph.importBuffer("X", state->X.Buffer);
+		const RenderGraphResource y = graph.importBuffer("Y", state->Y.Buffer);
+		const RenderGraphResource result = graph.importBuffer("Result", state->Result.Buffer);
+		bool recorded = false;
+		graph.addPass("Axpy", [state, &kernels, &recorded, size, count, alpha](VkCommandBuffer cb)
+		{
+			recorded = kernels.recordElementwise(cb, ElementwiseOperation::Axpy, { state->X.Buffer, 0, size }, { state->Y.Buffer, 0, size },
+				{ state->Result.Buffer, 0, size }, count, alpha);
+		}).read(x, ResourceUsage::ComputeShaderRead).read(y, ResourceUsage::ComputeShaderRead).write(result, ResourceUsage::ComputeShaderWrite);
+		graph.markOutput(result, ResourceUsage::HostRead);
+		if (!graph.compile()) { return false; }
+		graph.execute(commandBuffer);
+		return recorded;
+	};
+	workload.Verify = [state, &kernels, count, alpha, xValue, yValue]()
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const float expected = alpha * xValue(i) + yValue(i);
+			const float actual = kernels.getPrecision() == ComputePrecision::Fp32 ? static_cast<const float*>(state->Result.Mapped)[i]
+				: halfToFloat(static_cast<const uint16_t*>(state->Result.Mapped)[i]);
+			if (actual != expected) { return false; }
+		}
+		return true;
+	};
+	return workload;
+}
@@ -0,0 +1,394 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "ObjectCache.hpp"
+#include "DescriptorTemplate.hpp"
+#include "ComputePipeline.hpp"
+
+// What a `ComputeKernelLibrary`'s buffers hold, and what its kernels do their maths in
+enum class ComputePrecision : uint32_t
+{
+	Fp32,          // float storage & maths - works everywhere
+	Fp16Storage,   // float16_t storage (half the memory traffic), float maths - needs `storageBuffer16BitAccess` (VK_KHR_16bit_storage)
+	Fp16Arithmetic // As above, but element-wise kernels do their maths in float16_t too - also needs `shaderFloat16` (VK_KHR_shader_float16_int8)
+};
+
+// Method to pick the cheapest precision the device can do, given which of the fp16 features we managed to enable
+inline ComputePrecision selectComputePrecision(bool storageBuffer16BitAccess, bool shaderFloat16)
+{
+	if (!storageBuffer16BitAccess) { return ComputePrecision::Fp32; }
+	return shaderFloat16 ? ComputePrecision::Fp16Arithmetic : ComputePrecision::Fp16Storage;
+}
+
+inline const char* getComputePrecisionName(ComputePrecision precision)
+{
+	switch (precision)
+	{
+	case ComputePrecision::Fp16Storage:    return "fp16_storage";
+	case ComputePrecision::Fp16Arithmetic: return "fp16_arithmetic";
+	default:                               return "fp32";
+	}
+}
+
+// Size of one element of a buffer holding data of the given precision
+inline uint32_t getComputePrecisionElementSize(ComputePrecision precision) { return precision == ComputePrecision::Fp32 ? 4 : 2; }
+
+// Method to convert a float to IEEE 754 half precision, rounding to the nearest (ties to even) like the GPU does
+inline uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const uint32_t exponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	if (exponent == 0xFF) { return static_cast<uint16_t>(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0)); } // Infinity or NaN
+	const int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+	if (halfExponent >= 31) { return static_cast<uint16_t>(sign | 0x7C00); } // Too big - infinity
+
+	if (halfExponent <= 0)
+	{
+		// Too small for a normal half - make it a denormal (or zero), shifting the implicit leading 1 in with the rest of the mantissa
+		if (halfExponent < -10) { return static_cast<uint16_t>(sign); }
+		mantissa |= 0x800000;
+		const uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+		uint32_t half = mantissa >> shift;
+		const uint32_t remainder = mantissa & ((1u << shift) - 1);
+		const uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1) != 0)) { ++half; }
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	// Note: If rounding up overflows the mantissa it carries into the exponent - which is exactly right (up to & including infinity)
+	uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+	const uint32_t remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1) != 0)) { ++half; }
+	return static_cast<uint16_t>(sign | half);
+}
+
+// Method to convert an IEEE 754 half back to a float (which is always exact)
+inline float halfToFloat(uint16_t half)
+{
+	const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+	const uint32_t exponent = (half >> 10) & 0x1F;
+	const uint32_t mantissa = half & 0x3FF;
+
+	if (exponent == 0)
+	{
+		const float magnitude = std::ldexp(static_cast<float>(mantissa), -24); // Zero or a denormal
+		return sign != 0 ? -magnitude : magnitude;
+	}
+
+	const uint32_t bits = exponent == 31 ? (sign | 0x7F800000 | (mantissa << 13)) : (sign | ((exponent - 15 + 127) << 23) | (mantissa << 13));
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// The operations `ComputeKernelLibrary::recordElementwise` can do. Note: The values are the shader's `OPERATION` specialization constant.
+enum class ElementwiseOperation : uint32_t
+{
+	Add,      // x + y
+	Multiply, // x * y
+	Axpy,     // alpha * x + y
+	Relu,     // max(x, 0) - y is ignored
+	Count
+};
+
+// What each of our kernels binds - see the matching `.comp` files in `shaders/`
+struct ElementwiseDescriptors
+{
+	VkDescriptorBufferInfo X;
+	VkDescriptorBufferInfo Y;
+	VkDescriptorBufferInfo Result;
+};
+template <> struct DescriptorLayout<ElementwiseDescriptors>
+{
+	static constexpr std::array<DescriptorBinding, 3> Bindings = {
+		DESCRIPTOR_BINDING(ElementwiseDescriptors, X,      0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(ElementwiseDescriptors, Y,      1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(ElementwiseDescriptors, Result, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) };
+};
+
+struct ReduceDescriptors
+{
+	VkDescriptorBufferInfo Values;
+	VkDescriptorBufferInfo PartialSums;
+};
+template <> struct DescriptorLayout<ReduceDescriptors>
+{
+	static constexpr std::array<DescriptorBinding, 2> Bindings = {
+		DESCRIPTOR_BINDING(ReduceDescriptors, Values,      0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(ReduceDescriptors, PartialSums, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) };
+};
+
+struct GemmDescriptors
+{
+	VkDescriptorBufferInfo A;
+	VkDescriptorBufferInfo B;
+	VkDescriptorBufferInfo C;
+};
+template <> struct DescriptorLayout<GemmDescriptors>
+{
+	static constexpr std::array<DescriptorBinding, 3> Bindings = {
+		DESCRIPTOR_BINDING(GemmDescriptors, A, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(GemmDescriptors, B, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(GemmDescriptors, C, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) };
+};
+
+// Class to record our core compute kernels - element-wise ops, sum reductions & matrix multiplies - in one precision.
+//
+// Every buffer a library's kernels read or write holds elements of its precision: 32-bit floats for `Fp32`, halves for the fp16
+// variants (see `floatToHalf` / `halfToFloat`) - except for reduction results & scratch, which are always float. Picking an fp16
+// variant (see `selectComputePrecision`) halves the memory traffic of bandwidth-bound work like this. Only the element-wise kernels
+// have an fp16 ARITHMETIC variant: reductions & matrix multiplies sum up far too many terms for fp16's 11-bit mantissa (and 65504
+// maximum), so they always accumulate in float.
+//
+// The kernels come from `shaders/*.comp`, compiled to SPIR-V (one file per variant) by `shaders/compile_shaders.bat` / `.sh`.
+// Note: Every dispatch gets its own descriptor set from our pool. Call `resetDescriptors` once the GPU's finished with everything
+// recorded since the last reset, to hand them all back at once.
+class ComputeKernelLibrary
+{
+public:
+
+	// Method to load the kernels for `kernelPrecision` from `shaderDirectory` & create their pipelines, plus a descriptor pool with
+	// enough sets for `maxDispatchesPerReset` dispatches. Returns false (and cleans up after itself) if anything's missing or fails.
+	bool create(VkDevice logicalDevice, ComputePrecision kernelPrecision, const string& shaderDirectory = "shaders/spv", uint32_t maxDispatchesPerReset = 256,
+		ObjectCache* objectCache = nullptr)
+	{
+		device = logicalDevice;
+		precision = kernelPrecision;
+
+		if (!elementwiseTemplate.create(device, objectCache) || !reduceTemplate.create(device, objectCache) || !gemmTemplate.create(device, objectCache))
+		{
+			destroy();
+			return false;
+		}
+
+		const string storageSuffix = precision == ComputePrecision::Fp32 ? "_fp32.spv" : "_fp16.spv";
+		const string elementwiseSuffix = precision == ComputePrecision::Fp16Arithmetic ? "_fp16_arithmetic.spv" : storageSuffix;
+		std::vector<uint32_t> code;
+		if (!loadSpirvFile(shaderDirectory + "/elementwise" + elementwiseSuffix, code))
+		{
+			destroy();
+			return false;
+		}
+		for (uint32_t operation = 0; operation < static_cast<uint32_t>(ElementwiseOperation::Count); ++operation)
+		{
+			if (!elementwisePipelines[operation].create(device, code, elementwiseTemplate.SetLayout, sizeof(ElementwisePushConstants), { operation }, objectCache))
+			{
+				destroy();
+				return false;
+			}
+		}
+
+		// Note: Only the first pass of a reduction reads our precision - every later pass reads the float partial sums of the one before
+		if (!reduceFirstPassPipeline.createFromFile(device, shaderDirectory + "/reduce_sum" + storageSuffix, reduceTemplate.SetLayout, sizeof(ReducePushConstants), { ReduceItemsPerInvocation }, objectCache) ||
+			!reducePartialSumsPipeline.createFromFile(device, shaderDirectory + "/reduce_sum_fp32.spv", reduceTemplate.SetLayout, sizeof(ReducePushConstants), { ReduceItemsPerInvocation }, objectCache) ||
+			!gemmPipeline.createFromFile(device, shaderDirectory + "/gemm" + storageSuffix, gemmTemplate.SetLayout, sizeof(GemmPushConstants), {}, objectCache))
+		{
+			destroy();
+			return false;
+		}
+
+		// Size the pool for the worst case of every dispatch being the kernel with the most bindings
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		DescriptorSetTemplate<ElementwiseDescriptors>::addPoolSizes(poolSizes, maxDispatchesPerReset);
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.pNext = nullptr;
+		poolCreateInfo.flags = 0;
+		poolCreateInfo.maxSets = maxDispatchesPerReset;
+		poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolCreateInfo.pPoolSizes = poolSizes.data();
+		const VkResult result = VulkanFunctionLoaders::vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &descriptorPool);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create compute kernel descriptor pool. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			descriptorPool = VK_NULL_HANDLE;
+			destroy();
+			return false;
+		}
+
+		LOG_VERBOSE("[OK] Loaded {} compute kernels from: {}", getComputePrecisionName(precision), shaderDirectory);
+		return true;
+	}
+
+	ComputePrecision getPrecision() const { return precision; }
+
+	// Size of one element of the buffers our kernels read & write (reduction results aside)
+	uint32_t getElementSize() const { return getComputePrecisionElementSize(precision); }
+
+	// Method to hand back every descriptor set our dispatches have used since the last reset.
+	// CAREFUL: The GPU must be finished with everything recorded since then!
+	void resetDescriptors()
+	{
+		VulkanFunctionLoaders::vkResetDescriptorPool(device, descriptorPool, 0);
+	}
+
+	// Method to record `result[i] = operation(x[i], y[i])` for `count` elements. Returns false if we've run out of descriptor sets.
+	// Note: `Relu` ignores `y`, but it still has to be bound to something - passing `x` again is fine.
+	bool recordElementwise(VkCommandBuffer commandBuffer, ElementwiseOperation operation, const VkDescriptorBufferInfo& x, const VkDescriptorBufferInfo& y,
+		const VkDescriptorBufferInfo& result, uint32_t count, float alpha = 1.0f)
+	{
+		const VkDescriptorSet set = allocateSet(elementwiseTemplate.SetLayout);
+		if (set == VK_NULL_HANDLE) { return false; }
+		elementwiseTemplate.update(set, { x, y, result });
+
+		const ComputePipeline& pipeline = elementwisePipelines[static_cast<uint32_t>(operation)];
+		pipeline.bind(commandBuffer, set);
+		pipeline.pushConstants(commandBuffer, ElementwisePushConstants{ count, alpha });
+
+		// Note: The shader loops over the array, so we don't need more workgroups than it takes to keep the GPU busy
+		const uint32_t groupCount = std::clamp((count + ElementwiseWorkgroupSize - 1) / ElementwiseWorkgroupSize, 1u, MaxWorkgroupCount);
+		pipeline.dispatch(commandBuffer, groupCount);
+		return true;
+	}
+
+	// How many bytes of scratch `recordReduceSum` needs to sum `count` elements
+	static VkDeviceSize getReduceScratchSize(uint32_t count)
+	{
+		VkDeviceSize scratchSize = 0;
+		for (uint32_t remaining = count; ; )
+		{
+			const uint32_t groupCount = getReduceGroupCount(remaining);
+			if (groupCount <= 1) { break; }
+			scratchSize += alignScratchOffset(groupCount * sizeof(float));
+			remaining = groupCount;
+		}
+		return scratchSize;
+	}
+
+	// Method to record summing `count` elements of `values` into the single float at the start of `result`. Takes as many passes as it
+	// needs (one per 2048x reduction), with the partial sums in between going in `scratch` - which must be at least
+	// `getReduceScratchSize(count)` bytes, starting at a multiple of 256 bytes. Returns false if `count` is too big for us or we've run
+	// out of descriptor sets.
+	bool recordReduceSum(VkCommandBuffer commandBuffer, const VkDescriptorBufferInfo& values, const VkDescriptorBufferInfo& scratch,
+		const VkDescriptorBufferInfo& result, uint32_t count)
+	{
+		if (getReduceGroupCount(count) > MaxWorkgroupCount)
+		{
+			LOG_ERROR("[FAIL] Can't reduce {} elements - the first pass would need more than {} workgroups.", count, MaxWorkgroupCount);
+			return false;
+		}
+
+		ReduceDescriptors descriptors = { values, result };
+		const ComputePipeline* pipeline = &reduceFirstPassPipeline;
+		VkDeviceSize scratchOffset = 0;
+		for (uint32_t remaining = count; ; )
+		{
+			const uint32_t groupCount = getReduceGroupCount(remaining);
+			const VkDeviceSize partialSumsSize = groupCount * sizeof(float);
+			descriptors.PartialSums = groupCount == 1 ? result : VkDescriptorBufferInfo{ scratch.buffer, scratch.offset + scratchOffset, partialSumsSize };
+
+			const VkDescriptorSet set = allocateSet(reduceTemplate.SetLayout);
+			if (set == VK_NULL_HANDLE) { return false; }
+			reduceTemplate.update(set, descriptors);
+			pipeline->bind(commandBuffer, set);
+			pipeline->pushConstants(commandBuffer, ReducePushConstants{ remaining });
+			pipeline->dispatch(commandBuffer, groupCount);
+			if (groupCount == 1) { break; }
+
+			// The next pass sums up this one's partial sums
+			recordComputeToComputeBarrier(commandBuffer);
+			descriptors.Values = descriptors.PartialSums;
+			pipeline = &reducePartialSumsPipeline;
+			scratchOffset += alignScratchOffset(partialSumsSize);
+			remaining = groupCount;
+		}
+		return true;
+	}
+
+	// Method to record `c = a * b`, where `a` is `m` x `k`, `b` is `k` x `n` and `c` is `m` x `n` - all row-major & tightly packed.
+	// Returns false if we've run out of descriptor sets.
+	bool recordGemm(VkCommandBuffer commandBuffer, const VkDescriptorBufferInfo& a, const VkDescriptorBufferInfo& b, const VkDescriptorBufferInfo& c,
+		uint32_t m, uint32_t n, uint32_t k)
+	{
+		const VkDescriptorSet set = allocateSet(gemmTemplate.SetLayout);
+		if (set == VK_NULL_HANDLE) { return false; }
+		gemmTemplate.update(set, { a, b, c });
+
+		gemmPipeline.bind(commandBuffer, set);
+		gemmPipeline.pushConstants(commandBuffer, GemmPushConstants{ m, n, k });
+		gemmPipeline.dispatch(commandBuffer, (n + GemmTileSize - 1) / GemmTileSize, (m + GemmTileSize - 1) / GemmTileSize);
+		return true;
+	}
+
+	// CAREFUL: The GPU must be finished with everything we've recorded before we call this!
+	void destroy()
+	{
+		if (descriptorPool != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+			descriptorPool = VK_NULL_HANDLE;
+		}
+		for (auto& pipeline : elementwisePipelines) { pipeline.destroy(); }
+		reduceFirstPassPipeline.destroy();
+		reducePartialSumsPipeline.destroy();
+		gemmPipeline.destroy();
+		elementwiseTemplate.destroy();
+		reduceTemplate.destroy();
+		gemmTemplate.destroy();
+	}
+
+private:
+
+	// These must match the `push_constant` blocks & workgroup sizes in the shaders
+	struct ElementwisePushConstants { uint32_t Count; float Alpha; };
+	struct ReducePushConstants { uint32_t Count; };
+	struct GemmPushConstants { uint32_t M; uint32_t N; uint32_t K; };
+	static constexpr uint32_t ElementwiseWorkgroupSize = 256;
+	static constexpr uint32_t ReduceWorkgroupSize = 256;
+	static constexpr uint32_t ReduceItemsPerInvocation = 8;
+	static constexpr uint32_t GemmTileSize = 16;
+
+	// Note: 65535 is the least `maxComputeWorkGroupCount` every device has to support
+	static constexpr uint32_t MaxWorkgroupCount = 65535;
+
+	static uint32_t getReduceGroupCount(uint32_t count)
+	{
+		const uint32_t valuesPerGroup = ReduceWorkgroupSize * ReduceItemsPerInvocation;
+		return std::max(1u, static_cast<uint32_t>((static_cast<uint64_t>(count) + valuesPerGroup - 1) / valuesPerGroup));
+	}
+
+	// Note: 256 bytes is the largest `minStorageBufferOffsetAlignment` a device is allowed to have, so it's always safe
+	static VkDeviceSize alignScratchOffset(VkDeviceSize offset) { return (offset + 255) & ~VkDeviceSize(255); }
+
+	VkDescriptorSet allocateSet(VkDescriptorSetLayout setLayout)
+	{
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.descriptorPool = descriptorPool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &setLayout;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		const VkResult result = VulkanFunctionLoaders::vkAllocateDescriptorSets(device, &allocateInfo, &set);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not allocate a descriptor set for a compute kernel - call `resetDescriptors` more often? VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return VK_NULL_HANDLE;
+		}
+		return set;
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	ComputePrecision precision = ComputePrecision::Fp32;
+	DescriptorSetTemplate<ElementwiseDescriptors> elementwiseTemplate;
+	DescriptorSetTemplate<ReduceDescriptors> reduceTemplate;
+	DescriptorSetTemplate<GemmDescriptors> gemmTemplate;
+	ComputePipeline elementwisePipelines[static_cast<uint32_t>(ElementwiseOperation::Count)];
+	ComputePipeline reduceFirstPassPipeline;
+	ComputePipeline reducePartialSumsPipeline;
+	ComputePipeline gemmPipeline;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "ObjectCache.hpp"
+
+// Method to read a SPIR-V binary (e.g., as written by `glslangValidator -V`) into `code`. Returns false if the file can't be read or
+// doesn't look like SPIR-V.
+inline bool loadSpirvFile(const string& path, std::vector<uint32_t>& code)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		LOG_ERROR("[FAIL] Could not open SPIR-V file: {}", path);
+		return false;
+	}
+
+	const std::streamsize sizeInBytes = file.tellg();
+	if (sizeInBytes < 20 || sizeInBytes % 4 != 0) // Note: 20 bytes is the size of the header every SPIR-V module starts with
+	{
+		LOG_ERROR("[FAIL] SPIR-V file {} is {} bytes - which can't be a valid module.", path, static_cast<int64_t>(sizeInBytes));
+		return false;
+	}
+	code.resize(static_cast<size_t>(sizeInBytes) / sizeof(uint32_t));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(code.data()), sizeInBytes);
+
+	const uint32_t SpirvMagicNumber = 0x07230203;
+	if (!file || code[0] != SpirvMagicNumber)
+	{
+		LOG_ERROR("[FAIL] {} is not a SPIR-V module.", path);
+		return false;
+	}
+	return true;
+}
+
+// Method to get a float's bit pattern - which is how `float` specialization constants (and push constants) have to be passed in
+inline uint32_t floatBitsToUint(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+// Method to record a barrier making everything earlier compute shaders wrote visible to later compute shaders, indirect commands and
+// transfers - which is what every chain of our compute dispatches needs between each step.
+inline void recordComputeToComputeBarrier(VkCommandBuffer commandBuffer)
+{
+	VkMemoryBarrier memoryBarrier = {};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.pNext = nullptr;
+	memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+// Class to wrap a compute pipeline: its shader (one `main` entry point), a pipeline layout with a single descriptor set & an optional
+// block of push constants, and any specialization constants it's built with.
+//
+// Specialization constants are how our kernels get tuned without recompiling the GLSL - the `n`th value we're given is the one with
+// `layout(constant_id = n)` in the shader. They're all 32-bit, so `float` constants have to be passed as their bit pattern (see
+// `floatBitsToUint`) and `bool` ones as 0 or 1.
+// See: https://registry.khronos.org/vulkan/specs/1.3-extensions/html/vkspec.html#pipelines-specialization-constants
+class ComputePipeline
+{
+public:
+	VkPipeline Pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout Layout = VK_NULL_HANDLE;
+
+	// Method to create the pipeline from SPIR-V `code`. If we're given an `objectCache` the pipeline layout comes from it, so every kernel
+	// with the same set layout & push constant size shares one.
+	bool create(VkDevice logicalDevice, const std::vector<uint32_t>& code, VkDescriptorSetLayout setLayout, uint32_t pushConstantSize,
+		const std::vector<uint32_t>& specializationConstants = {}, ObjectCache* objectCache = nullptr)
+	{
+		device = logicalDevice;
+		cache = objectCache;
+		pushConstantBytes = pushConstantSize;
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = pushConstantSize;
+
+		VkPipelineLayoutCreateInfo layoutCreateInfo = {};
+		layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutCreateInfo.pNext = nullptr;
+		layoutCreateInfo.flags = 0;
+		layoutCreateInfo.setLayoutCount = 1;
+		layoutCreateInfo.pSetLayouts = &setLayout;
+		layoutCreateInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+		layoutCreateInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
+		if (cache != nullptr)
+		{
+			Layout = cache->acquirePipelineLayout(layoutCreateInfo);
+			if (Layout == VK_NULL_HANDLE) { return false; }
+		}
+		else
+		{
+			const VkResult result = VulkanFunctionLoaders::vkCreatePipelineLayout(device, &layoutCreateInfo, nullptr, &Layout);
+			if (result != VK_SUCCESS)
+			{
+				LOG_ERROR("[FAIL] Could not create compute pipeline layout. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+				return false;
+			}
+		}
+
+		VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+		shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		shaderModuleCreateInfo.pNext = nullptr;
+		shaderModuleCreateInfo.flags = 0;
+		shaderModuleCreateInfo.codeSize = code.size() * sizeof(uint32_t); // Note: In BYTES, even though `pCode` is 32-bit words
+		shaderModuleCreateInfo.pCode = code.data();
+		VkShaderModule shaderModule = VK_NULL_HANDLE;
+		VkResult result = VulkanFunctionLoaders::vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr, &shaderModule);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create compute shader module. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			destroy();
+			return false;
+		}
+
+		std::vector<VkSpecializationMapEntry> mapEntries(specializationConstants.size());
+		for (uint32_t i = 0; i < static_cast<uint32_t>(mapEntries.size()); ++i)
+		{
+			mapEntries[i].constantID = i;
+			mapEntries[i].offset = i * sizeof(uint32_t);
+			mapEntries[i].size = sizeof(uint32_t);
+		}
+		VkSpecializationInfo specializationInfo = {};
+		specializationInfo.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+		specializationInfo.pMapEntries = mapEntries.data();
+		specializationInfo.dataSize = specializationConstants.size() * sizeof(uint32_t);
+		specializationInfo.pData = specializationConstants.data();
+
+		VkComputePipelineCreateInfo pipelineCreateInfo = {};
+		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineCreateInfo.pNext = nullptr;
+		pipelineCreateInfo.flags = 0;
+		pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineCreateInfo.stage.pNext = nullptr;
+		pipelineCreateInfo.stage.flags = 0;
+		pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineCreateInfo.stage.module = shaderModule;
+		pipelineCreateInfo.stage.pName = "main";
+		pipelineCreateInfo.stage.pSpecializationInfo = specializationConstants.empty() ? nullptr : &specializationInfo;
+		pipelineCreateInfo.layout = Layout;
+		pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineCreateInfo.basePipelineIndex = -1;
+		result = VulkanFunctionLoaders::vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &Pipeline);
+
+		// Note: The pipeline keeps everything it needs from the shader module, so we can let that go straight away
+		VulkanFunctionLoaders::vkDestroyShaderModule(device, shaderModule, nullptr);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create compute pipeline. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			Pipeline = VK_NULL_HANDLE;
+			destroy();
+			return false;
+		}
+		return true;
+	}
+
+	// Method to create the pipeline from a SPIR-V file (see `loadSpirvFile`)
+	bool createFromFile(VkDevice logicalDevice, const string& spirvPath, VkDescriptorSetLayout setLayout, uint32_t pushConstantSize,
+		const std::vector<uint32_t>& specializationConstants = {}, ObjectCache* objectCache = nullptr)
+	{
+		std::vector<uint32_t> code;
+		return loadSpirvFile(spirvPath, code) && create(logicalDevice, code, setLayout, pushConstantSize, specializationConstants, objectCache);
+	}
+
+	// Method to bind the pipeline & its descriptor set, ready for `dispatch`
+	void bind(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet) const
+	{
+		VulkanFunctionLoaders::vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline);
+		VulkanFunctionLoaders::vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Layout, 0, 1, &descriptorSet, 0, nullptr);
+	}
+
+	// Method to set the pipeline's push constants from a struct laid out to match the shader's `push_constant` block
+	template <typename PushConstants>
+	void pushConstants(VkCommandBuffer commandBuffer, const PushConstants& constants) const
+	{
+		VulkanFunctionLoaders::vkCmdPushConstants(commandBuffer, Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, static_cast<uint32_t>(sizeof(PushConstants)), &constants);
+	}
+
+	void dispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1) const
+	{
+		VulkanFunctionLoaders::vkCmdDispatch(commandBuffer, groupCountX, groupCountY, groupCountZ);
+	}
+
+	// Method to dispatch with the group counts in a `VkDispatchIndirectCommand` at `offset` in `buffer` - e.g., as sized by an earlier dispatch
+	// from a count that's only known on the GPU. The buffer needs `VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT`.
+	void dispatchIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset) const
+	{
+		VulkanFunctionLoaders::vkCmdDispatchIndirect(commandBuffer, buffer, offset);
+	}
+
+	uint32_t getPushConstantSize() const { return pushConstantBytes; }
+
+	// CAREFUL: The GPU must be finished with any command buffers that use the pipeline before we call this!
+	void destroy()
+	{
+		if (Pipeline != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyPipeline(device, Pipeline, nullptr);
+			Pipeline = VK_NULL_HANDLE;
+		}
+		if (Layout != VK_NULL_HANDLE)
+		{
+			if (cache != nullptr) { cache->releasePipelineLayout(Layout); }
+			else { VulkanFunctionLoaders::vkDestroyPipelineLayout(device, Layout, nullptr); }
+			Layout = VK_NULL_HANDLE;
+		}
+		cache = nullptr;
+	}
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	ObjectCache* cache = nullptr;
+	uint32_t pushConstantBytes = 0;
+};
@@ -0,0 +1,444 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "GpuCulling.hpp"
+#include "JobSystem.hpp"
+
+// Which SIMD instruction sets we can build kernels for. x86 kernels are built for their instruction set function by function (so the rest of
+// the program doesn't need compiling for it) and only picked if the CPU we're running on has it - see `getBestCpuCullKernel`.
+#if defined _M_X64 || defined __x86_64__ || defined _M_IX86 || defined __i386__
+	#define CPU_CULL_X86 1
+	#include <immintrin.h>
+	#if defined _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+#if defined __ARM_NEON || defined _M_ARM64
+	#define CPU_CULL_NEON 1
+	#include <arm_neon.h>
+#endif
+
+// Note: MSVC will happily compile any intrinsic anywhere, whereas GCC & Clang only allow them in functions built for their instruction set
+#if defined _MSC_VER && !defined __clang__
+	#define CPU_CULL_TARGET(isa)
+#else
+	#define CPU_CULL_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// Instances to cull on the CPU, as a structure of arrays rather than an array of `CullInstance`s - so a kernel loads a SIMD register's worth
+// of centres (or radii, or extents) at a time and never touches the fields it doesn't need. Bounding spheres & axis-aligned bounding boxes
+// share their centres, and every array is `getCount()` long.
+struct CullInstancesSoA
+{
+	std::vector<float> CenterX;
+	std::vector<float> CenterY;
+	std::vector<float> CenterZ;
+	std::vector<float> Radius;
+	std::vector<float> ExtentX; // Half the box's size along each axis
+	std::vector<float> ExtentY;
+	std::vector<float> ExtentZ;
+
+	uint32_t getCount() const { return static_cast<uint32_t>(CenterX.size()); }
+
+	void resize(uint32_t count)
+	{
+		for (std::vector<float>* array : { &CenterX, &CenterY, &CenterZ, &Radius, &ExtentX, &ExtentY, &ExtentZ }) { array->resize(count); }
+	}
+};
+
+// Method to make a `CullInstancesSoA` from a `CullingScene`. Each instance's box is its mesh's box (about the mesh's origin, as that's
+// where its bounding sphere is centred) scaled by the instance's radius - for the cube that's a good deal tighter than the sphere.
+inline CullInstancesSoA makeCullInstancesSoA(const CullingScene& scene)
+{
+	std::vector<std::array<float, 3>> meshExtents(scene.Meshes.size(), { 0.0f, 0.0f, 0.0f });
+	for (size_t m = 0; m < scene.Meshes.size(); ++m)
+	{
+		const CullMesh& mesh = scene.Meshes[m];
+		for (uint32_t i = 0; i < mesh.IndexCount; ++i)
+		{
+			const size_t vertex = static_cast<size_t>(static_cast<int64_t>(scene.Indices[mesh.FirstIndex + i]) + mesh.VertexOffset);
+			for (uint32_t axis = 0; axis < 3; ++axis) { meshExtents[m][axis] = std::max(meshExtents[m][axis], std::fabs(scene.Vertices[vertex * 3 + axis])); }
+		}
+	}
+
+	CullInstancesSoA soa;
+	soa.resize(static_cast<uint32_t>(scene.Instances.size()));
+	for (size_t i = 0; i < scene.Instances.size(); ++i)
+	{
+		const CullInstance& instance = scene.Instances[i];
+		const std::array<float, 3>& extents = meshExtents[instance.MeshIndex];
+		soa.CenterX[i] = instance.Center[0];
+		soa.CenterY[i] = instance.Center[1];
+		soa.CenterZ[i] = instance.Center[2];
+		soa.Radius[i] = instance.Radius;
+		soa.ExtentX[i] = extents[0] * instance.Radius;
+		soa.ExtentY[i] = extents[1] * instance.Radius;
+		soa.ExtentZ[i] = extents[2] * instance.Radius;
+	}
+	return soa;
+}
+
+enum class CpuCullShape
+{
+	Sphere,
+	Aabb
+};
+
+enum class CpuCullKernel
+{
+	Scalar,
+	Neon,   // 4 instances at a time
+	Avx2,   // 8 instances at a time
+	Avx512  // 16 instances at a time
+};
+
+inline const char* getCpuCullKernelName(CpuCullKernel kernel)
+{
+	switch (kernel)
+	{
+	case CpuCullKernel::Scalar: return "scalar";
+	case CpuCullKernel::Neon:   return "neon";
+	case CpuCullKernel::Avx2:   return "avx2";
+	case CpuCullKernel::Avx512: return "avx512";
+	}
+	return "unknown";
+}
+
+// Method to find out whether this build has `kernel` in it AND the CPU we're running on can run it
+inline bool isCpuCullKernelSupported(CpuCullKernel kernel)
+{
+	switch (kernel)
+	{
+	case CpuCullKernel::Scalar:
+		return true;
+	case CpuCullKernel::Neon:
+#if defined CPU_CULL_NEON
+		return true;
+#else
+		return false;
+#endif
+	case CpuCullKernel::Avx2:
+	case CpuCullKernel::Avx512:
+#if defined CPU_CULL_X86 && defined _MSC_VER && !defined __clang__
+	{
+		// Note: The CPU having the instructions isn't enough - the OS must also save the wider registers on a context switch (XCR0)
+		int info[4] = {};
+		__cpuid(info, 0);
+		if (info[0] < 7) { return false; }
+		__cpuid(info, 1);
+		const bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+		if (!osSavesAvx) { return false; }
+		const unsigned long long xcr0 = _xgetbv(0);
+		__cpuidex(info, 7, 0);
+		if (kernel == CpuCullKernel::Avx2) { return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0; }
+		return (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+	}
+#elif defined CPU_CULL_X86
+		return kernel == CpuCullKernel::Avx2 ? __builtin_cpu_supports("avx2") != 0 : __builtin_cpu_supports("avx512f") != 0;
+#else
+		return false;
+#endif
+	}
+	return false;
+}
+
+// Method to pick the widest kernel we can run. Worked out once, as asking the CPU isn't free.
+inline CpuCullKernel getBestCpuCullKernel()
+{
+	static const CpuCullKernel best = []()
+	{
+		for (CpuCullKernel kernel : { CpuCullKernel::Avx512, CpuCullKernel::Avx2, CpuCullKernel::Neon })
+		{
+			if (isCpuCullKernelSupported(kernel)) { return kernel; }
+		}
+		return CpuCullKernel::Scalar;
+	}();
+	return best;
+}
+
+// A `CullView`'s frustum planes, split into components (so a kernel can broadcast each one) with the absolute values of the normals ready
+// for the box test
+struct CpuCullPlanes
+{
+	float NormalX[6];
+	float NormalY[6];
+	float NormalZ[6];
+	float Distance[6];
+	float AbsNormalX[6];
+	float AbsNormalY[6];
+	float AbsNormalZ[6];
+};
+
+inline CpuCullPlanes makeCpuCullPlanes(const CullView& view)
+{
+	CpuCullPlanes planes = {};
+	for (uint32_t i = 0; i < 6; ++i)
+	{
+		planes.NormalX[i] = view.FrustumPlanes[i][0];
+		planes.NormalY[i] = view.FrustumPlanes[i][1];
+		planes.NormalZ[i] = view.FrustumPlanes[i][2];
+		planes.Distance[i] = view.FrustumPlanes[i][3];
+		planes.AbsNormalX[i] = std::fabs(view.FrustumPlanes[i][0]);
+		planes.AbsNormalY[i] = std::fabs(view.FrustumPlanes[i][1]);
+		planes.AbsNormalZ[i] = std::fabs(view.FrustumPlanes[i][2]);
+	}
+	return planes;
+}
+
+// Method to work out how far instance `i` reaches past the frustum's planes - negative if it's entirely outside one of them (so culled).
+// A sphere reaches its radius past its centre's distance to a plane, and a box reaches the extents projected onto the plane's normal.
+// Note: Every kernel does exactly this sum in exactly this order, separate multiplies & adds (no fused multiply-adds), so they all agree.
+inline float getCpuCullMargin(const CpuCullPlanes& planes, const CullInstancesSoA& instances, uint32_t i, CpuCullShape shape)
+{
+	float margin = 3.0e38f;
+	for (uint32_t p = 0; p < 6; ++p)
+	{
+		const float distance = ((planes.NormalX[p] * instances.CenterX[i] + planes.NormalY[p] * instances.CenterY[i]) + planes.NormalZ[p] * instances.CenterZ[i]) + planes.Distance[p];
+		const float reach = shape == CpuCullShape::Sphere ? instances.Radius[i] :
+			(planes.AbsNormalX[p] * instances.ExtentX[i] + planes.AbsNormalY[p] * instances.ExtentY[i]) + planes.AbsNormalZ[p] * instances.ExtentZ[i];
+		margin = std::min(margin, distance + reach);
+	}
+	return margin;
+}
+
+// ----- Kernels -----
+// Each culls instances [begin, end) and writes the indices of the visible ones - in order - to `visible`, returning how many there were.
+// CAREFUL: `visible` must have room for `end - begin` indices, as the kernels write every index & only then count it (or not), branch-free.
+using CpuCullFunction = uint32_t (*)(const CpuCullPlanes& planes, const CullInstancesSoA& instances, uint32_t begin, uint32_t end, uint32_t* visible);
+
+template <CpuCullShape Shape>
+inline uint32_t cullInstancesScalar(const CpuCullPlanes& planes, const CullInstancesSoA& instances, uint32_t begin, uint32_t end, uint32_t* visible)
+{
+	uint32_t visibleCount = 0;
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		visible[visibleCount] = i;
+		visibleCount += getCpuCullMargin(planes, instances, i, Shape) >= 0.0f ? 1 : 0;
+	}
+	return visibleCount;
+}
+
+#if defined CPU_CULL_X86
+// For each 8-bit mask, the lanes that are set - packed to the front - so one permute squeezes the visible indices out of an AVX2 register
+struct CpuCullCompactionTable
+{
+	alignas(32) uint32_t Lanes[256][8];
+
+	constexpr CpuCullCompactionTable() : Lanes()
+	{
+		for (uint32_t mask = 0; mask < 256; ++mask)
+		{
+			uint32_t count = 0;
+			for (uint32_t lane = 0; lane < 8; ++lane)
+			{
+				if ((mask & (1u << lane)) != 0) { Lanes[mask][count++] = lane; }
+			}
+		}
+	}
+};
+inline constexpr CpuCullCompactionTable CpuCullCompaction;
+
+template <CpuCullShape Shape>
+CPU_CULL_TARGET("avx2") inline uint32_t cullInstancesAvx2(const CpuCullPlanes& planes, const CullInstancesSoA& instances, uint32_t begin, uint32_t end, uint32_t* visible)
+{
+	uint32_t visibleCount = 0;
+	uint32_t i = begin;
+	const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	for (; i + 8 <= end; i += 8)
+	{
+		const __m256 x = _mm256_loadu_ps(instances.CenterX.data() + i);
+		const __m256 y = _mm256_loadu_ps(instances.CenterY.data() + i);
+		const __m256 z = _mm256_loadu_ps(instances.CenterZ.data() + i);
+		__m256 radius = _mm256_setzero_ps(), extentX = radius, extentY = radius, extentZ = radius;
+		if constexpr (Shape == CpuCullShape::Sphere) { radius = _mm256_loadu_ps(instances.Radius.data() + i); }
+		else
+		{
+			extentX = _mm256_loadu_ps(instances.ExtentX.data() + i);
+			extentY = _mm256_loadu_ps(instances.ExtentY.data() + i);
+			extentZ = _mm256_loadu_ps(instances.ExtentZ.data() + i);
+		}
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (uint32_t p = 0; p < 6; ++p)
+		{
+			const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.NormalX[p]), x),
+				_mm256_mul_ps(_mm256_set1_ps(planes.NormalY[p]), y)), _mm256_mul_ps(_mm256_set1_ps(planes.NormalZ[p]), z)), _mm256_set1_ps(planes.Distance[p]));
+			__m256 reach = radius;
+			if constexpr (Shape == CpuCullShape::Aabb)
+			{
+				reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.AbsNormalX[p]), extentX),
+					_mm256_mul_ps(_mm256_set1_ps(planes.AbsNormalY[p]), extentY)), _mm256_mul_ps(_mm256_set1_ps(planes.AbsNormalZ[p]), extentZ));
+			}
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+
+		const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+		const __m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i*>(CpuCullCompaction.Lanes[mask]));
+		const __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), laneOffsets);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(visible + visibleCount), _mm256_permutevar8x32_epi32(indices, lanes));
+		visibleCount += static_cast<uint32_t>(std::popcount(mask));
+	}
+	return visibleCount + cullInstancesScalar<Shape>(planes, instances, i, end, visible + visibleCount);
+}
+
+template <CpuCullShape Shape>
+CPU_CULL_TARGET("avx512f") inline uint32_t cullInstancesAvx512(const CpuCullPlanes& planes, const CullInstancesSoA& instances, uint32_t begin, uint32_t end, uint32_t* visible)
+{
+	uint32_t visibleCount = 0;
+	const __m512i laneOffsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	for (uint32_t i = begin; i < end; i += 16)
+	{
+		// Note: The last few instances just mask off the lanes past the end, so there's no scalar tail
+		const __mmask16 lanesInRange = end - i >= 16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << (end - i)) - 1);
+		const __m512 x = _mm512_maskz_loadu_ps(lanesInRange, instances.CenterX.data() + i);
+		const __m512 y = _mm512_maskz_loadu_ps(lanesInRange, instances.CenterY.data() + i);
+		const __m512 z = _mm512_maskz_loadu_ps(lanesInRange, instances.CenterZ.data() + i);
+		__m512 radius = _mm512_setzero_ps(), extentX = radius, extentY = radius, extentZ = radius;
+		if constexpr (Shape == CpuCullShape::Sphere) { radius = _mm512_maskz_loadu_ps(lanesInRange, instances.Radius.data() + i); }
+		else
+		{
+			extentX = _mm512_maskz_loadu_ps(lanesInRange, instances.ExtentX.data() + i);
+			extentY = _mm512_maskz_loadu_ps(lanesInRange, instances.ExtentY.data() + i);
+			extentZ = _mm512_maskz_loadu_ps(lanesInRange, instances.ExtentZ.data() + i);
+		}
+
+		__mmask16 inside = lanesInRange;
+		for (uint32_t p = 0; p < 6; ++p)
+		{
+			const __m512 distance = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(planes.NormalX[p]), x),
+				_mm512_mul_ps(_mm512_set1_ps(planes.NormalY[p]), y)), _mm512_mul_ps(_mm512_set1_ps(planes.NormalZ[p]), z)), _mm512_set1_ps(planes.Distance[p]));
+			__m512 reach = radius;
+			if constexpr (Shape == CpuCullShape::Aabb)
+			{
+				reach = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(planes.AbsNormalX[p]), extentX),
+					_mm512_mul_ps(_mm512_set1_ps(planes.AbsNormalY[p]), extentY)), _mm512_mul_ps(_mm512_set1_ps(planes.AbsNormalZ[p]), extentZ));
+			}
+			inside = _mm512_mask_cmp_ps_mask(inside, _mm512_add_ps(distance, reach), _mm512_setzero_ps(), _CMP_GE_OQ);
+		}
+
+		const __m512i indices = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(i)), laneOffsets);
+		_mm512_mask_compressstoreu_epi32(visible + visibleCount, inside, indices);
+		visibleCount += static_cast<uint32_t>(std::popcount(static_cast<uint32_t>(inside)));
+	}
+	return visibleCount;
+}
+#endif
+
+#if defined CPU_CULL_NEON
+template <CpuCullShape Shape>
+inline uint32_t cullInstancesNeon(const CpuCullPlanes& planes, const CullInstancesSoA& instances, uint32_t begin, uint32_t end, uint32_t* visible)
+{
+	uint32_t visibleCount = 0;
+	uint32_t i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		const float32x4_t x = vld1q_f32(instances.CenterX.data() + i);
+		const float32x4_t y = vld1q_f32(instances.CenterY.data() + i);
+		const float32x4_t z = vld1q_f32(instances.CenterZ.data() + i);
+		float32x4_t radius = vdupq_n_f32(0.0f), extentX = radius, extentY = radius, extentZ = radius;
+		if constexpr (Shape == CpuCullShape::Sphere) { radius = vld1q_f32(instances.Radius.data() + i); }
+		else
+		{
+			extentX = vld1q_f32(instances.ExtentX.data() + i);
+			extentY = vld1q_f32(instances.ExtentY.data() + i);
+			extentZ = vld1q_f32(instances.ExtentZ.data() + i);
+		}
+
+		// Note: vmulq & vaddq rather than vmlaq/vfmaq, which may fuse - see `getCpuCullMargin`
+		uint32x4_t inside = vdupq_n_u32(0xFFFFFFFFu);
+		for (uint32_t p = 0; p < 6; ++p)
+		{
+			const float32x4_t distance = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_n_f32(x, planes.NormalX[p]), vmulq_n_f32(y, planes.NormalY[p])),
+				vmulq_n_f32(z, planes.NormalZ[p])), vdupq_n_f32(planes.Distance[p]));
+			float32x4_t reach = radius;
+			if constexpr (Shape == CpuCullShape::Aabb)
+			{
+				reach = vaddq_f32(vaddq_f32(vmulq_n_f32(extentX, planes.AbsNormalX[p]), vmulq_n_f32(extentY, planes.AbsNormalY[p])), vmulq_n_f32(extentZ, planes.AbsNormalZ[p]));
+			}
+			inside = vandq_u32(inside, vcgeq_f32(vaddq_f32(distance, reach), vdupq_n_f32(0.0f)));
+		}
+
+		visible[visibleCount] = i;
+		visibleCount += vgetq_lane_u32(inside, 0) & 1;
+		visible[visibleCount] = i + 1;
+		visibleCount += vgetq_lane_u32(inside, 1) & 1;
+		visible[visibleCount] = i + 2;
+		visibleCount += vgetq_lane_u32(inside, 2) & 1;
+		visible[visibleCount] = i + 3;
+		visibleCount += vgetq_lane_u32(inside, 3) & 1;
+	}
+	return visibleCount + cullInstancesScalar<Shape>(planes, instances, i, end, visible + visibleCount);
+}
+#endif
+
+// Method to get the function for `kernel` & `shape` - or the scalar one, if this build or CPU can't run `kernel`
+inline CpuCullFunction getCpuCullFunction(CpuCullKernel kernel, CpuCullShape shape)
+{
+	const bool spheres = shape == CpuCullShape::Sphere;
+	if (isCpuCullKernelSupported(kernel))
+	{
+#if defined CPU_CULL_X86
+		if (kernel == CpuCullKernel::Avx2) { return spheres ? &cullInstancesAvx2<CpuCullShape::Sphere> : &cullInstancesAvx2<CpuCullShape::Aabb>; }
+		if (kernel == CpuCullKernel::Avx512) { return spheres ? &cullInstancesAvx512<CpuCullShape::Sphere> : &cullInstancesAvx512<CpuCullShape::Aabb>; }
+#endif
+#if defined CPU_CULL_NEON
+		if (kernel == CpuCullKernel::Neon) { return spheres ? &cullInstancesNeon<CpuCullShape::Sphere> : &cullInstancesNeon<CpuCullShape::Aabb>; }
+#endif
+	}
+	return spheres ? &cullInstancesScalar<CpuCullShape::Sphere> : &cullInstancesScalar<CpuCullShape::Aabb>;
+}
+
+// Method to frustum cull `instances` on the CPU - the fallback for when `GpuCulling` can't run. On return the first N (returned) entries of
+// `visible` are the indices of the visible instances, in order. Given a `JobSystem`, chunks of instances are culled across its workers (and
+// this thread) into their own parts of `visible`, which are then shuffled down to sit back to back.
+// Note: `visible` is sized to the instance count, so reusing it from frame to frame means no allocations after the first.
+// CAREFUL: Like `JobSystem::parallelFor`, don't call this with a job system from inside one of its jobs.
+inline uint32_t cullInstancesSoA(const CullView& view, const CullInstancesSoA& instances, CpuCullShape shape, std::vector<uint32_t>& visible,
+	CpuCullKernel kernel = getBestCpuCullKernel(), JobSystem* jobs = nullptr)
+{
+	constexpr uint32_t ChunkSize = 16384; // Instances per job: 64KB of each array, big enough to dwarf the cost of handing it out
+	const CpuCullPlanes planes = makeCpuCullPlanes(view);
+	const CpuCullFunction cull = getCpuCullFunction(kernel, shape);
+	const uint32_t instanceCount = instances.getCount();
+	if (visible.size() < instanceCount) { visible.resize(instanceCount); }
+	if (jobs == nullptr || jobs->getThreadCount() == 0 || instanceCount <= ChunkSize) { return cull(planes, instances, 0, instanceCount, visible.data()); }
+
+	std::vector<uint32_t> chunkVisibleCounts((instanceCount + ChunkSize - 1) / ChunkSize, 0);
+	jobs->parallelFor(instanceCount, ChunkSize, [&](uint32_t begin, uint32_t end)
+	{
+		chunkVisibleCounts[begin / ChunkSize] = cull(planes, instances, begin, end, visible.data() + begin);
+	});
+
+	uint32_t visibleCount = chunkVisibleCounts[0];
+	for (size_t chunk = 1; chunk < chunkVisibleCounts.size(); ++chunk)
+	{
+		std::memmove(visible.data() + visibleCount, visible.data() + chunk * ChunkSize, chunkVisibleCounts[chunk] * sizeof(uint32_t));
+		visibleCount += chunkVisibleCounts[chunk];
+	}
+	return visibleCount;
+}
+
+// Method to check a cull from `cullInstancesSoA` against what the scalar kernel makes of each instance. The list must be in instance order
+// with no repeats, and must match the scalar kernel exactly - unlike `checkGpuCulling` there's no slack for instances near a plane, as every
+// kernel does the same sums in the same order (see `getCpuCullMargin`).
+inline bool checkCpuCulling(const CullView& view, const CullInstancesSoA& instances, CpuCullShape shape, const uint32_t* visible, uint32_t visibleCount)
+{
+	const CpuCullPlanes planes = makeCpuCullPlanes(view);
+	const uint32_t instanceCount = instances.getCount();
+	if (visibleCount > instanceCount) { return false; }
+	uint32_t next = 0;
+	for (uint32_t i = 0; i < instanceCount; ++i)
+	{
+		const bool drawn = next < visibleCount && visible[next] == i;
+		if (drawn) { ++next; }
+		if (drawn != (getCpuCullMargin(planes, instances, i, shape) >= 0.0f)) { return false; }
+	}
+	return next == visibleCount; // Anything left over was out of order, repeated or past the end
+}
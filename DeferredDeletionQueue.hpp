@@ -0,0 +1,232 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "TimelineSemaphore.hpp"
+
+// The kinds of object a `DeferredDeletionQueue` can destroy. Each gets its own queue, so collecting destroys them a batch at a time.
+enum class DeferredObjectType : uint32_t
+{
+	Buffer,
+	Image,
+	ImageView,
+	Memory,
+	Sampler,
+	Framebuffer,
+	RenderPass,
+	DescriptorPool,
+	DescriptorSetLayout,
+	PipelineLayout,
+	QueryPool,
+	CommandPool,
+	Semaphore,
+	Fence,
+	Count
+};
+
+// Class to destroy Vulkan objects once the GPU has finished with them, without waiting for it.
+//
+// Whoever submits work to the GPU tells us (via `setRetireValue`) the timeline semaphore value that work will signal. Anything destroyed
+// through us from then on is tagged with that value and queued rather than destroyed - and `collect` destroys everything whose value
+// the timeline has since reached, in one batch per type of object. So freeing an object never costs a `vkDeviceWaitIdle` (or even a
+// wait on a fence), and the actual driver calls happen wherever the owner calls `collect` rather than in the middle of whatever dropped
+// the object.
+// Note: Queuing is thread-safe. Values must only ever go up (they're timeline values, after all), which keeps each type's queue in
+// retire order - so collecting only ever looks at the front of each one.
+// CAREFUL: Objects destroyed through here must have been used by nothing newer than the current retire value. If they might have been
+// used by work that's already been submitted with a later value, use `setRetireValue` first (or just `destroyX` after it).
+class DeferredDeletionQueue
+{
+public:
+	bool create(VkDevice logicalDevice)
+	{
+		device = logicalDevice;
+		return true;
+	}
+
+	// Method to set the timeline value the next submission will signal - i.e., the value everything queued from now on waits for
+	void setRetireValue(uint64_t value)
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if (value < retireValue)
+		{
+			LOG_WARNING("[WARNING] Deferred deletion retire value can't go backwards (from {} to {}) - keeping {}.", retireValue, value, retireValue);
+			return;
+		}
+		retireValue = value;
+	}
+	uint64_t getRetireValue() const { std::lock_guard<std::mutex> lock(queueMutex); return retireValue; }
+
+	// Methods to queue an object for destruction. Null handles are ignored, so it's fine to pass anything you'd pass to `vkDestroyX`.
+	// Note: These can't just be overloads of one method - on 32-bit platforms every non-dispatchable handle is a `uint64_t`.
+	void destroyBuffer(VkBuffer buffer)                            { enqueue(DeferredObjectType::Buffer, toHandleValue(buffer)); }
+	void destroyImage(VkImage image)                               { enqueue(DeferredObjectType::Image, toHandleValue(image)); }
+	void destroyImageView(VkImageView view)                        { enqueue(DeferredObjectType::ImageView, toHandleValue(view)); }
+	void freeMemory(VkDeviceMemory memory)                         { enqueue(DeferredObjectType::Memory, toHandleValue(memory)); }
+	void destroySampler(VkSampler sampler)                         { enqueue(DeferredObjectType::Sampler, toHandleValue(sampler)); }
+	void destroyFramebuffer(VkFramebuffer framebuffer)             { enqueue(DeferredObjectType::Framebuffer, toHandleValue(framebuffer)); }
+	void destroyRenderPass(VkRenderPass renderPass)                { enqueue(DeferredObjectType::RenderPass, toHandleValue(renderPass)); }
+	void destroyDescriptorPool(VkDescriptorPool pool)              { enqueue(DeferredObjectType::DescriptorPool, toHandleValue(pool)); }
+	void destroyDescriptorSetLayout(VkDescriptorSetLayout layout) { enqueue(DeferredObjectType::DescriptorSetLayout, toHandleValue(layout)); }
+	void destroyPipelineLayout(VkPipelineLayout layout)            { enqueue(DeferredObjectType::PipelineLayout, toHandleValue(layout)); }
+	void destroyQueryPool(VkQueryPool pool)                        { enqueue(DeferredObjectType::QueryPool, toHandleValue(pool)); }
+	void destroyCommandPool(VkCommandPool pool)                    { enqueue(DeferredObjectType::CommandPool, toHandleValue(pool)); }
+	void destroySemaphore(VkSemaphore semaphore)                   { enqueue(DeferredObjectType::Semaphore, toHandleValue(semaphore)); }
+	void destroyFence(VkFence fence)                               { enqueue(DeferredObjectType::Fence, toHandleValue(fence)); }
+
+	// Method to run something once the GPU is past the current retire value - for anything that isn't a single object (e.g., handing a
+	// reference back to an `ObjectCache`). Callbacks run after that collect's objects have been destroyed.
+	void defer(std::function<void()> callback)
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		callbacks.push_back({ retireValue, std::move(callback) });
+	}
+
+	// Method to destroy everything whose retire value the GPU has reached (i.e., `completedValue` from the timeline). Returns how many
+	// objects (and callbacks) went.
+	uint32_t collect(uint64_t completedValue)
+	{
+		// Pull everything that's ready out under the queue lock, then destroy it without - so other threads can keep queuing meanwhile.
+		// Note: Only one thread collects at once, as the ready lists are shared (so their memory gets reused from one collect to the next).
+		std::lock_guard<std::mutex> collectLock(collectMutex);
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			for (uint32_t type = 0; type < TypeCount; ++type)
+			{
+				std::deque<PendingObject>& pending = pendingObjects[type];
+				while (!pending.empty() && pending.front().RetireValue <= completedValue)
+				{
+					readyHandles[type].push_back(pending.front().Handle);
+					pending.pop_front();
+				}
+			}
+			while (!callbacks.empty() && callbacks.front().RetireValue <= completedValue)
+			{
+				readyCallbacks.push_back(std::move(callbacks.front().Callback));
+				callbacks.pop_front();
+			}
+		}
+		return destroyReady();
+	}
+
+	// As above, reading the completed value from `timeline`
+	uint32_t collect(const TimelineSemaphore& timeline) { return collect(timeline.getValue(device)); }
+
+	// Method to destroy everything queued, whatever its retire value.
+	// CAREFUL: Only call this once the GPU has finished with all of it (e.g., after `vkDeviceWaitIdle`, or waiting on the timeline).
+	uint32_t flush() { return collect(UINT64_MAX); }
+
+	uint32_t getPendingCount() const
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		size_t count = callbacks.size();
+		for (const auto& pending : pendingObjects) { count += pending.size(); }
+		return static_cast<uint32_t>(count);
+	}
+	uint64_t getDestroyedCount() const { return destroyedCount.load(std::memory_order_relaxed); }
+
+	// Method to destroy anything still queued. The same CAREFUL as `flush` applies.
+	void destroy()
+	{
+		const uint32_t pending = getPendingCount();
+		if (pending > 0) { LOG_VERBOSE("[OK] Deferred deletion queue destroying {} remaining object(s).", pending); }
+		flush();
+		retireValue = 0;
+		destroyedCount.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	static constexpr uint32_t TypeCount = static_cast<uint32_t>(DeferredObjectType::Count);
+
+	struct PendingObject
+	{
+		uint64_t RetireValue = 0;
+		uint64_t Handle = 0;
+	};
+
+	struct PendingCallback
+	{
+		uint64_t RetireValue = 0;
+		std::function<void()> Callback;
+	};
+
+	// Non-dispatchable handles are pointers on 64-bit platforms but `uint64_t`s on 32-bit ones - so we store them all as the latter
+	template <typename T>
+	static uint64_t toHandleValue(T handle)
+	{
+		if constexpr (std::is_pointer_v<T>) { return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle)); }
+		else { return static_cast<uint64_t>(handle); }
+	}
+	template <typename T>
+	static T fromHandleValue(uint64_t value)
+	{
+		if constexpr (std::is_pointer_v<T>) { return reinterpret_cast<T>(static_cast<uintptr_t>(value)); }
+		else { return static_cast<T>(value); }
+	}
+
+	void enqueue(DeferredObjectType type, uint64_t handleValue)
+	{
+		if (handleValue == 0) { return; }
+		std::lock_guard<std::mutex> lock(queueMutex);
+		pendingObjects[static_cast<uint32_t>(type)].push_back({ retireValue, handleValue });
+	}
+
+	// Method to destroy everything `collect` pulled out, a type at a time. Note: Must hold `collectMutex`.
+	uint32_t destroyReady()
+	{
+		uint32_t destroyed = 0;
+		for (uint32_t type = 0; type < TypeCount; ++type)
+		{
+			for (uint64_t handleValue : readyHandles[type]) { destroyObject(static_cast<DeferredObjectType>(type), handleValue); }
+			destroyed += static_cast<uint32_t>(readyHandles[type].size());
+			readyHandles[type].clear();
+		}
+		for (auto& callback : readyCallbacks) { callback(); }
+		destroyed += static_cast<uint32_t>(readyCallbacks.size());
+		readyCallbacks.clear();
+		destroyedCount.fetch_add(destroyed, std::memory_order_relaxed);
+		return destroyed;
+	}
+
+	void destroyObject(DeferredObjectType type, uint64_t handleValue) const
+	{
+		switch (type)
+		{
+		case DeferredObjectType::Buffer:              VulkanFunctionLoaders::vkDestroyBuffer(device, fromHandleValue<VkBuffer>(handleValue), nullptr); break;
+		case DeferredObjectType::Image:               VulkanFunctionLoaders::vkDestroyImage(device, fromHandleValue<VkImage>(handleValue), nullptr); break;
+		case DeferredObjectType::ImageView:           VulkanFunctionLoaders::vkDestroyImageView(device, fromHandleValue<VkImageView>(handleValue), nullptr); break;
+		case DeferredObjectType::Memory:              VulkanFunctionLoaders::vkFreeMemory(device, fromHandleValue<VkDeviceMemory>(handleValue), nullptr); break;
+		case DeferredObjectType::Sampler:             VulkanFunctionLoaders::vkDestroySampler(device, fromHandleValue<VkSampler>(handleValue), nullptr); break;
+		case DeferredObjectType::Framebuffer:         VulkanFunctionLoaders::vkDestroyFramebuffer(device, fromHandleValue<VkFramebuffer>(handleValue), nullptr); break;
+		case DeferredObjectType::RenderPass:          VulkanFunctionLoaders::vkDestroyRenderPass(device, fromHandleValue<VkRenderPass>(handleValue), nullptr); break;
+		case DeferredObjectType::DescriptorPool:      VulkanFunctionLoaders::vkDestroyDescriptorPool(device, fromHandleValue<VkDescriptorPool>(handleValue), nullptr); break;
+		case DeferredObjectType::DescriptorSetLayout: VulkanFunctionLoaders::vkDestroyDescriptorSetLayout(device, fromHandleValue<VkDescriptorSetLayout>(handleValue), nullptr); break;
+		case DeferredObjectType::PipelineLayout:      VulkanFunctionLoaders::vkDestroyPipelineLayout(device, fromHandleValue<VkPipelineLayout>(handleValue), nullptr); break;
+		case DeferredObjectType::QueryPool:           VulkanFunctionLoaders::vkDestroyQueryPool(device, fromHandleValue<VkQueryPool>(handleValue), nullptr); break;
+		case DeferredObjectType::CommandPool:         VulkanFunctionLoaders::vkDestroyCommandPool(device, fromHandleValue<VkCommandPool>(handleValue), nullptr); break;
+		case DeferredObjectType::Semaphore:           VulkanFunctionLoaders::vkDestroySemaphore(device, fromHandleValue<VkSemaphore>(handleValue), nullptr); break;
+		case DeferredObjectType::Fence:               VulkanFunctionLoaders::vkDestroyFence(device, fromHandleValue<VkFence>(handleValue), nullptr); break;
+		case DeferredObjectType::Count:               break;
+		}
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	mutable std::mutex queueMutex;
+	uint64_t retireValue = 0;
+	std::array<std::deque<PendingObject>, TypeCount> pendingObjects;
+	std::deque<PendingCallback> callbacks;
+
+	std::mutex collectMutex;
+	std::array<std::vector<uint64_t>, TypeCount> readyHandles;
+	std::vector<std::function<void()>> readyCallbacks;
+	std::atomic<uint64_t> destroyedCount{ 0 };
+};
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "ObjectCache.hpp"
+
+// Which of the three descriptor info structs a binding's descriptors are written from
+enum class DescriptorInfoKind : uint32_t
+{
+	Buffer,     // `VkDescriptorBufferInfo`
+	Image,      // `VkDescriptorImageInfo`
+	TexelBuffer // `VkBufferView`
+};
+
+// One binding of a descriptor set, and where its descriptor infos live in the packed struct we update the set from
+struct DescriptorBinding
+{
+	uint32_t Binding = 0;
+	VkDescriptorType Type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	uint32_t Count = 1;
+	VkShaderStageFlags Stages = 0;
+	size_t Offset = 0; // Of the binding's first info from the start of the struct
+	size_t Stride = 0; // Between one info & the next (for arrays of descriptors)
+	DescriptorInfoKind Kind = DescriptorInfoKind::Buffer;
+};
+
+template <typename Info> constexpr DescriptorInfoKind getDescriptorInfoKind();
+template <> constexpr DescriptorInfoKind getDescriptorInfoKind<VkDescriptorBufferInfo>() { return DescriptorInfoKind::Buffer; }
+template <> constexpr DescriptorInfoKind getDescriptorInfoKind<VkDescriptorImageInfo>()  { return DescriptorInfoKind::Image; }
+template <> constexpr DescriptorInfoKind getDescriptorInfoKind<VkBufferView>()           { return DescriptorInfoKind::TexelBuffer; }
+
+// Method to get which info struct a descriptor type is written from
+constexpr DescriptorInfoKind getDescriptorInfoKind(VkDescriptorType type)
+{
+	switch (type)
+	{
+	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+		return DescriptorInfoKind::Buffer;
+	case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+	case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+		return DescriptorInfoKind::TexelBuffer;
+	default:
+		return DescriptorInfoKind::Image;
+	}
+}
+
+template <typename Info>
+constexpr DescriptorBinding makeDescriptorBinding(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages, size_t offset, uint32_t count)
+{
+	DescriptorBinding descriptorBinding;
+	descriptorBinding.Binding = binding;
+	descriptorBinding.Type = type;
+	descriptorBinding.Count = count;
+	descriptorBinding.Stages = stages;
+	descriptorBinding.Offset = offset;
+	descriptorBinding.Stride = sizeof(Info);
+	descriptorBinding.Kind = getDescriptorInfoKind<Info>();
+	return descriptorBinding;
+}
+
+// Macro to describe a binding that's written from member `Member` of struct `Struct` - which may be a single info or an array of them
+// (one per descriptor), e.g.:
+//     struct SkinningDescriptors { VkDescriptorBufferInfo Bones; VkDescriptorImageInfo Textures[4]; };
+//     template <> struct DescriptorLayout<SkinningDescriptors>
+//     {
+//         static constexpr std::array<DescriptorBinding, 2> Bindings = {
+//             DESCRIPTOR_BINDING(SkinningDescriptors, Bones,    0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         VK_SHADER_STAGE_VERTEX_BIT),
+//             DESCRIPTOR_BINDING(SkinningDescriptors, Textures, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) };
+//     };
+#define DESCRIPTOR_BINDING(Struct, Member, binding, type, stages) \
+	makeDescriptorBinding<std::remove_all_extents_t<decltype(Struct::Member)>>(binding, type, stages, offsetof(Struct, Member), \
+		static_cast<uint32_t>(std::max<size_t>(1, std::extent_v<decltype(Struct::Member)>)))
+
+// Specialise this for each struct a descriptor set gets updated from, with a `Bindings` array as per `DESCRIPTOR_BINDING` above. That's
+// the compile-time description of the shader's binding layout that a `DescriptorSetTemplate` builds everything else from.
+template <typename Descriptors>
+struct DescriptorLayout;
+
+// Method to check (at compile time) that each binding is written from the right kind of info, and no binding number is used twice
+template <size_t N>
+constexpr bool areDescriptorBindingsValid(const std::array<DescriptorBinding, N>& bindings)
+{
+	for (size_t i = 0; i < N; ++i)
+	{
+		if (bindings[i].Count == 0 || bindings[i].Kind != getDescriptorInfoKind(bindings[i].Type)) { return false; }
+		for (size_t j = i + 1; j < N; ++j)
+		{
+			if (bindings[i].Binding == bindings[j].Binding) { return false; }
+		}
+	}
+	return true;
+}
+
+// Class to write a descriptor set with the layout `DescriptorLayout<Descriptors>` from a packed `Descriptors` struct.
+//
+// Updating a set the usual way means filling in a `VkWriteDescriptorSet` for every binding, which the driver then has to walk. A
+// descriptor update template tells the driver once, up front, where each binding's infos live in our struct - so each update after that
+// is a single `vkUpdateDescriptorSetWithTemplate` call with a pointer to the struct, and the driver can copy straight out of it.
+// Note: Update templates are core in Vulkan 1.1, but our instance only gets 1.1 when the loader has it (and 1.0 otherwise), so we always
+// go through `VK_KHR_descriptor_update_template`. If that isn't enabled, `update` falls back to building the `VkWriteDescriptorSet`s itself from the same description - so callers don't have
+// to care which they got.
+// See: https://www.khronos.org/assets/uploads/developers/library/2018-gdc-webinar/05-Vulkan-Descriptor-Update-Templates_Mar18.pdf
+template <typename Descriptors>
+class DescriptorSetTemplate
+{
+public:
+	VkDescriptorSetLayout SetLayout = VK_NULL_HANDLE;
+
+	static constexpr const std::array<DescriptorBinding, DescriptorLayout<Descriptors>::Bindings.size()>& Bindings = DescriptorLayout<Descriptors>::Bindings;
+	static_assert(areDescriptorBindingsValid(DescriptorLayout<Descriptors>::Bindings), "Each binding must be written from the info struct its descriptor type uses, and binding numbers must be unique");
+	static_assert(std::is_trivially_copyable_v<Descriptors>, "Descriptor structs are read by the driver as raw memory, so must be trivially copyable");
+
+	// Method to make the set layout (from `objectCache`, if we're given one, so equal layouts are shared) and, if we can, the update
+	// template. `bindPoint` is only used by push descriptor templates, which we don't make - but it's good form to fill it in.
+	bool create(VkDevice logicalDevice, ObjectCache* objectCache = nullptr, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE)
+	{
+		device = logicalDevice;
+		cache = objectCache;
+
+		std::array<VkDescriptorSetLayoutBinding, Bindings.size()> layoutBindings = {};
+		for (size_t i = 0; i < Bindings.size(); ++i)
+		{
+			layoutBindings[i].binding = Bindings[i].Binding;
+			layoutBindings[i].descriptorType = Bindings[i].Type;
+			layoutBindings[i].descriptorCount = Bindings[i].Count;
+			layoutBindings[i].stageFlags = Bindings[i].Stages;
+			layoutBindings[i].pImmutableSamplers = nullptr;
+		}
+		VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+		layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutCreateInfo.pNext = nullptr;
+		layoutCreateInfo.flags = 0;
+		layoutCreateInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+		layoutCreateInfo.pBindings = layoutBindings.data();
+		if (cache != nullptr)
+		{
+			SetLayout = cache->acquireDescriptorSetLayout(layoutCreateInfo);
+			if (SetLayout == VK_NULL_HANDLE) { return false; }
+		}
+		else
+		{
+			const VkResult result = VulkanFunctionLoaders::vkCreateDescriptorSetLayout(device, &layoutCreateInfo, nullptr, &SetLayout);
+			if (result != VK_SUCCESS)
+			{
+				LOG_ERROR("[FAIL] Could not create descriptor set layout. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+				return false;
+			}
+		}
+
+		// No template if the extension isn't enabled - `update` will write the descriptors itself
+		if (VulkanFunctionLoaders::vkCreateDescriptorUpdateTemplateKHR == nullptr) { return true; }
+
+		std::array<VkDescriptorUpdateTemplateEntryKHR, Bindings.size()> entries = {};
+		for (size_t i = 0; i < Bindings.size(); ++i)
+		{
+			entries[i].dstBinding = Bindings[i].Binding;
+			entries[i].dstArrayElement = 0;
+			entries[i].descriptorCount = Bindings[i].Count;
+			entries[i].descriptorType = Bindings[i].Type;
+			entries[i].offset = Bindings[i].Offset;
+			entries[i].stride = Bindings[i].Stride;
+		}
+		VkDescriptorUpdateTemplateCreateInfoKHR templateCreateInfo = {};
+		templateCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+		templateCreateInfo.pNext = nullptr;
+		templateCreateInfo.flags = 0;
+		templateCreateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+		templateCreateInfo.pDescriptorUpdateEntries = entries.data();
+		templateCreateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+		templateCreateInfo.descriptorSetLayout = SetLayout;
+		templateCreateInfo.pipelineBindPoint = bindPoint;
+		templateCreateInfo.pipelineLayout = VK_NULL_HANDLE; // Note: Only used for push descriptors
+		templateCreateInfo.set = 0;
+		const VkResult result = VulkanFunctionLoaders::vkCreateDescriptorUpdateTemplateKHR(device, &templateCreateInfo, nullptr, &updateTemplate);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create descriptor update template. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		return true;
+	}
+
+	bool usesTemplate() const { return updateTemplate != VK_NULL_HANDLE; }
+
+	// Method to write every binding of `set` from `descriptors`, with the update template if we have one
+	void update(VkDescriptorSet set, const Descriptors& descriptors) const
+	{
+		if (updateTemplate != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkUpdateDescriptorSetWithTemplateKHR(device, set, updateTemplate, &descriptors); }
+		else { updateWithWrites(set, descriptors); }
+	}
+
+	// Method to write every binding of `set` from `descriptors` the old-fashioned way, with one `VkWriteDescriptorSet` per binding. This
+	// is what `update` does without a template - it's public so the two can be compared.
+	void updateWithWrites(VkDescriptorSet set, const Descriptors& descriptors) const
+	{
+		const auto* base = reinterpret_cast<const uint8_t*>(&descriptors);
+		std::array<VkWriteDescriptorSet, Bindings.size()> writes;
+		for (size_t i = 0; i < Bindings.size(); ++i)
+		{
+			// CAREFUL: This relies on arrays of infos being tightly packed in the struct, which they are as we describe them from C++ arrays
+			const void* infos = base + Bindings[i].Offset;
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].pNext = nullptr;
+			writes[i].dstSet = set;
+			writes[i].dstBinding = Bindings[i].Binding;
+			writes[i].dstArrayElement = 0;
+			writes[i].descriptorCount = Bindings[i].Count;
+			writes[i].descriptorType = Bindings[i].Type;
+			writes[i].pImageInfo = Bindings[i].Kind == DescriptorInfoKind::Image ? static_cast<const VkDescriptorImageInfo*>(infos) : nullptr;
+			writes[i].pBufferInfo = Bindings[i].Kind == DescriptorInfoKind::Buffer ? static_cast<const VkDescriptorBufferInfo*>(infos) : nullptr;
+			writes[i].pTexelBufferView = Bindings[i].Kind == DescriptorInfoKind::TexelBuffer ? static_cast<const VkBufferView*>(infos) : nullptr;
+		}
+		VulkanFunctionLoaders::vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	// Method to add the descriptors one of our sets needs to a pool's sizes, so callers can size a `VkDescriptorPool` for `setCount` sets
+	static void addPoolSizes(std::vector<VkDescriptorPoolSize>& poolSizes, uint32_t setCount)
+	{
+		for (const DescriptorBinding& binding : Bindings)
+		{
+			auto existing = std::find_if(poolSizes.begin(), poolSizes.end(), [&binding](const VkDescriptorPoolSize& size) { return size.type == binding.Type; });
+			if (existing != poolSizes.end()) { existing->descriptorCount += binding.Count * setCount; }
+			else { poolSizes.push_back({ binding.Type, binding.Count * setCount }); }
+		}
+	}
+
+	// CAREFUL: Sets allocated with our layout may outlive this, but nothing may be updating them when we call it
+	void destroy()
+	{
+		if (updateTemplate != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyDescriptorUpdateTemplateKHR(device, updateTemplate, nullptr);
+			updateTemplate = VK_NULL_HANDLE;
+		}
+		if (SetLayout != VK_NULL_HANDLE)
+		{
+			if (cache != nullptr) { cache->releaseDescriptorSetLayout(SetLayout); }
+			else { VulkanFunctionLoaders::vkDestroyDescriptorSetLayout(device, SetLayout, nullptr); }
+			SetLayout = VK_NULL_HANDLE;
+		}
+		cache = nullptr;
+	}
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	ObjectCache* cache = nullptr;
+	VkDescriptorUpdateTemplateKHR updateTemplate = VK_NULL_HANDLE;
+};
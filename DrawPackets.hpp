@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+
+// ----- Sort keys -----
+// A draw's 64-bit sort key, most significant first: pass (6 bits), pipeline (14), material (20), depth (24). Sorting by it groups draws by
+// pass, then by pipeline within a pass and material within a pipeline - so consecutive draws share as much state as they can - and only
+// then by depth. Pipelines & materials are whatever small numbers the caller gives them (an index into its own table, say), not handles.
+constexpr uint32_t DrawKeyPassBits = 6;
+constexpr uint32_t DrawKeyPipelineBits = 14;
+constexpr uint32_t DrawKeyMaterialBits = 20;
+constexpr uint32_t DrawKeyDepthBits = 24;
+static_assert(DrawKeyPassBits + DrawKeyPipelineBits + DrawKeyMaterialBits + DrawKeyDepthBits == 64, "Draw sort key fields must fill 64 bits");
+
+// Method to pack a draw's sort key. `depth` is clamped to [0, 1] (NaN counts as 0; view depth over the far plane, say) and sorted front to back - or back
+// to front for `backToFront` passes, like transparency, where the order matters more than the state changes.
+// CAREFUL: `pass`, `pipeline` & `material` are cut down to their fields' sizes, so anything past 2^6, 2^14 or 2^20 wraps around!
+inline uint64_t makeDrawSortKey(uint32_t pass, uint32_t pipeline, uint32_t material, float depth, bool backToFront = false)
+{
+	constexpr uint32_t DepthMax = (1u << DrawKeyDepthBits) - 1;
+	// Note: Written so a NaN depth lands on 0 (the front) - `std::clamp` would let it through, and casting a NaN to an integer is undefined
+	const float clampedDepth = !(depth > 0.0f) ? 0.0f : std::min(depth, 1.0f);
+	uint32_t quantisedDepth = static_cast<uint32_t>(clampedDepth * static_cast<float>(DepthMax));
+	if (backToFront) { quantisedDepth = DepthMax - quantisedDepth; }
+	return (static_cast<uint64_t>(pass & ((1u << DrawKeyPassBits) - 1)) << (DrawKeyPipelineBits + DrawKeyMaterialBits + DrawKeyDepthBits)) |
+		(static_cast<uint64_t>(pipeline & ((1u << DrawKeyPipelineBits) - 1)) << (DrawKeyMaterialBits + DrawKeyDepthBits)) |
+		(static_cast<uint64_t>(material & ((1u << DrawKeyMaterialBits) - 1)) << DrawKeyDepthBits) |
+		quantisedDepth;
+}
+
+// ----- State tracking -----
+// Everything one indexed draw needs bound, plus the draw itself. Unused descriptor sets & vertex buffers are VK_NULL_HANDLE.
+struct DrawPacket
+{
+	static constexpr uint32_t MaxDescriptorSets = 2; // e.g., set 0 for the pass, set 1 for the material
+	static constexpr uint32_t MaxVertexBuffers = 2;  // e.g., binding 0 per vertex, binding 1 per instance
+
+	VkPipeline Pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout Layout = VK_NULL_HANDLE;
+	VkDescriptorSet DescriptorSets[MaxDescriptorSets] = {};
+	VkBuffer VertexBuffers[MaxVertexBuffers] = {};
+	VkDeviceSize VertexBufferOffsets[MaxVertexBuffers] = {};
+	VkBuffer IndexBuffer = VK_NULL_HANDLE;
+	VkDeviceSize IndexBufferOffset = 0;
+	VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
+	uint32_t IndexCount = 0;
+	uint32_t InstanceCount = 1;
+	uint32_t FirstIndex = 0;
+	int32_t VertexOffset = 0;
+	uint32_t FirstInstance = 0;
+};
+
+// How many binds a frame's draws made - and how many they'd have made without a `DrawStateTracker`, less those
+struct DrawStats
+{
+	uint32_t Draws = 0;
+	uint32_t PipelineBinds = 0;
+	uint32_t PipelineBindsAvoided = 0;
+	uint32_t DescriptorSetBinds = 0;
+	uint32_t DescriptorSetBindsAvoided = 0;
+	uint32_t VertexBufferBinds = 0;
+	uint32_t VertexBufferBindsAvoided = 0;
+	uint32_t IndexBufferBinds = 0;
+	uint32_t IndexBufferBindsAvoided = 0;
+
+	uint32_t getBinds() const { return PipelineBinds + DescriptorSetBinds + VertexBufferBinds + IndexBufferBinds; }
+	uint32_t getBindsAvoided() const { return PipelineBindsAvoided + DescriptorSetBindsAvoided + VertexBufferBindsAvoided + IndexBufferBindsAvoided; }
+};
+
+// Class to record draws into a command buffer, remembering what's bound so that binding it again is skipped (and counted in `Stats`).
+//
+// Note: Descriptor sets stay bound across pipelines with the same layout. A pipeline with a different layout may disturb them - it
+// depends on how compatible the layouts are - so we play it safe and forget every set we'd bound when the layout changes.
+// Note: Given a VK_NULL_HANDLE command buffer nothing is recorded - the binds & draws are just counted - which is handy for seeing what
+// a draw order would cost without a render pass to record into.
+class DrawStateTracker
+{
+public:
+	DrawStats Stats;
+
+	// Method to start tracking a command buffer (inside a render pass) with nothing bound, and zero `Stats`
+	void begin(VkCommandBuffer commandBuffer)
+	{
+		this->commandBuffer = commandBuffer;
+		pipeline = VK_NULL_HANDLE;
+		descriptorLayout = VK_NULL_HANDLE;
+		descriptorSets.fill(VK_NULL_HANDLE);
+		vertexBuffers.fill(VK_NULL_HANDLE);
+		vertexBufferOffsets.fill(0);
+		indexBuffer = VK_NULL_HANDLE;
+		indexBufferOffset = 0;
+		indexType = VK_INDEX_TYPE_UINT32;
+		Stats = {};
+	}
+
+	void bindPipeline(VkPipeline newPipeline)
+	{
+		if (newPipeline == pipeline)
+		{
+			++Stats.PipelineBindsAvoided;
+			return;
+		}
+		if (commandBuffer != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, newPipeline); }
+		pipeline = newPipeline;
+		++Stats.PipelineBinds;
+	}
+
+	void bindDescriptorSet(VkPipelineLayout layout, uint32_t setIndex, VkDescriptorSet set)
+	{
+		if (layout != descriptorLayout)
+		{
+			descriptorSets.fill(VK_NULL_HANDLE);
+			descriptorLayout = layout;
+		}
+		else if (descriptorSets[setIndex] == set)
+		{
+			++Stats.DescriptorSetBindsAvoided;
+			return;
+		}
+		if (commandBuffer != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, setIndex, 1, &set, 0, nullptr); }
+		descriptorSets[setIndex] = set;
+		++Stats.DescriptorSetBinds;
+	}
+
+	void bindVertexBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset)
+	{
+		if (vertexBuffers[binding] == buffer && vertexBufferOffsets[binding] == offset)
+		{
+			++Stats.VertexBufferBindsAvoided;
+			return;
+		}
+		if (commandBuffer != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkCmdBindVertexBuffers(commandBuffer, binding, 1, &buffer, &offset); }
+		vertexBuffers[binding] = buffer;
+		vertexBufferOffsets[binding] = offset;
+		++Stats.VertexBufferBinds;
+	}
+
+	void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType type)
+	{
+		if (indexBuffer == buffer && indexBufferOffset == offset && indexType == type)
+		{
+			++Stats.IndexBufferBindsAvoided;
+			return;
+		}
+		if (commandBuffer != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkCmdBindIndexBuffer(commandBuffer, buffer, offset, type); }
+		indexBuffer = buffer;
+		indexBufferOffset = offset;
+		indexType = type;
+		++Stats.IndexBufferBinds;
+	}
+
+	// Method to bind whatever `packet` needs that isn't bound already, then draw it
+	void draw(const DrawPacket& packet)
+	{
+		bindPipeline(packet.Pipeline);
+		for (uint32_t i = 0; i < DrawPacket::MaxDescriptorSets; ++i)
+		{
+			if (packet.DescriptorSets[i] != VK_NULL_HANDLE) { bindDescriptorSet(packet.Layout, i, packet.DescriptorSets[i]); }
+		}
+		for (uint32_t i = 0; i < DrawPacket::MaxVertexBuffers; ++i)
+		{
+			if (packet.VertexBuffers[i] != VK_NULL_HANDLE) { bindVertexBuffer(i, packet.VertexBuffers[i], packet.VertexBufferOffsets[i]); }
+		}
+		bindIndexBuffer(packet.IndexBuffer, packet.IndexBufferOffset, packet.IndexType);
+		if (commandBuffer != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkCmdDrawIndexed(commandBuffer, packet.IndexCount, packet.InstanceCount, packet.FirstIndex, packet.VertexOffset, packet.FirstInstance);
+		}
+		++Stats.Draws;
+	}
+
+private:
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout descriptorLayout = VK_NULL_HANDLE; // What the sets in `descriptorSets` were bound with
+	std::array<VkDescriptorSet, DrawPacket::MaxDescriptorSets> descriptorSets = {};
+	std::array<VkBuffer, DrawPacket::MaxVertexBuffers> vertexBuffers = {};
+	std::array<VkDeviceSize, DrawPacket::MaxVertexBuffers> vertexBufferOffsets = {};
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	VkDeviceSize indexBufferOffset = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+};
+
+// ----- Draw packet queue -----
+// Class to collect a frame's draws, sort them by key & record them through a `DrawStateTracker`. Meant to be cleared & refilled every
+// frame - it holds on to its memory, so after the first few frames that's no allocations at all.
+//
+// The sort is a least significant digit radix sort of the keys (with each packet's index along for the ride), a byte per pass: every
+// histogram comes from one read of the keys up front, and a pass whose byte is the same for every key is skipped - so the unused top bits
+// of the pass field, say, cost nothing. It's stable, so draws with equal keys keep the order they were added in.
+class DrawPacketQueue
+{
+public:
+	void clear()
+	{
+		keys.clear();
+		packets.clear();
+		order.clear();
+		sorted = false;
+	}
+
+	void add(uint64_t sortKey, const DrawPacket& packet)
+	{
+		keys.push_back(sortKey);
+		packets.push_back(packet);
+		sorted = false;
+	}
+
+	uint32_t getCount() const { return static_cast<uint32_t>(packets.size()); }
+
+	// Method to put the draws in key order (otherwise they're recorded in the order they were added)
+	void sort()
+	{
+		const uint32_t count = getCount();
+		order.resize(count);
+		for (uint32_t i = 0; i < count; ++i) { order[i] = i; }
+		sortedKeys.assign(keys.begin(), keys.end());
+		sorted = true;
+		if (count < 2) { return; }
+
+		std::array<std::array<uint32_t, 256>, 8> histograms = {};
+		for (uint64_t key : sortedKeys)
+		{
+			for (uint32_t digit = 0; digit < 8; ++digit) { ++histograms[digit][(key >> (digit * 8)) & 0xFF]; }
+		}
+
+		scratchKeys.resize(count);
+		scratchOrder.resize(count);
+		for (uint32_t digit = 0; digit < 8; ++digit)
+		{
+			const uint32_t shift = digit * 8;
+			std::array<uint32_t, 256>& offsets = histograms[digit];
+			if (offsets[(sortedKeys[0] >> shift) & 0xFF] == count) { continue; } // Every key has the same byte here
+			uint32_t sum = 0;
+			for (uint32_t& offset : offsets)
+			{
+				const uint32_t bucketSize = offset;
+				offset = sum;
+				sum += bucketSize;
+			}
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const uint32_t destination = offsets[(sortedKeys[i] >> shift) & 0xFF]++;
+				scratchKeys[destination] = sortedKeys[i];
+				scratchOrder[destination] = order[i];
+			}
+			sortedKeys.swap(scratchKeys);
+			order.swap(scratchOrder);
+		}
+	}
+
+	// Method to get the index (in the order they were added) of the `i`th draw to be recorded
+	uint32_t getDrawIndex(uint32_t i) const { return sorted ? order[i] : i; }
+
+	const DrawPacket& getPacket(uint32_t index) const { return packets[index]; }
+	uint64_t getSortKey(uint32_t index) const { return keys[index]; }
+
+	// Method to record every draw (in key order, if we've sorted since the last `add`) into `commandBuffer`, which must be inside a render
+	// pass - or, given VK_NULL_HANDLE, just to count them. Returns the frame's bind counts.
+	DrawStats record(VkCommandBuffer commandBuffer)
+	{
+		tracker.begin(commandBuffer);
+		for (uint32_t i = 0; i < getCount(); ++i) { tracker.draw(packets[getDrawIndex(i)]); }
+		return tracker.Stats;
+	}
+
+private:
+	std::vector<uint64_t> keys;
+	std::vector<DrawPacket> packets;
+	std::vector<uint32_t> order; // Indices into `packets`, in key order once sorted
+	std::vector<uint64_t> sortedKeys;
+	std::vector<uint64_t> scratchKeys;
+	std::vector<uint32_t> scratchOrder;
+	DrawStateTracker tracker;
+	bool sorted = false;
+};
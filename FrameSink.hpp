@@ -0,0 +1,558 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined __linux
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include "VulkanFunctions.h" // Note: On Windows this pulls in "Windows.h" (via "vulkan.h"), which we need for `CreateFile` etc.
+#include "Logger.hpp"
+#include "JobSystem.hpp"
+#include "OffscreenRenderer.hpp"
+#include "TraceRecorder.hpp"
+
+using std::string;
+
+// What a `FrameSink` writes our frames out as
+enum class FrameSinkFormat : uint8_t
+{
+	Raw, // Every frame's pixels, back to back, exactly as they came off the GPU (e.g., RGBA) - no header, so the reader must know the size & format
+	Y4M, // YUV4MPEG2 video (8-bit 4:2:0, full range BT.601) - which ffmpeg, mpv and most encoders read directly
+	Png  // One PNG file per frame, named `<path>_000001.png` etc.
+};
+
+// Class to write to a file at explicit offsets, from several threads at once, going around the OS page cache where we can.
+//
+// Direct (unbuffered) I/O - `O_DIRECT` on Linux, `FILE_FLAG_NO_BUFFERING` on Windows - DMAs straight from our memory to the disk, so a
+// frame dump doesn't copy every byte into the page cache first (and then evict everything else we had cached to make room for it). The
+// catch is that the memory address, the size AND the file offset of each write must all be multiples of the disk's block size. So we keep a
+// second, normal handle on the same file and quietly use that for anything that isn't aligned.
+// Note: Not every filesystem supports direct I/O (e.g., tmpfs doesn't) and not every kind of mapped memory can be DMA'd from - so if a
+// direct write fails we fall back to buffered writes for good, rather than failing the whole dump.
+class FrameFile
+{
+public:
+
+	static constexpr uint64_t DirectAlignment = 4096; // A multiple of the block size of every disk we're likely to meet
+
+	bool open(const string& path, bool tryDirect)
+	{
+#if defined _WIN32
+		bufferedHandle = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (bufferedHandle == INVALID_HANDLE_VALUE)
+		{
+			LOG_ERROR("[FAIL] Could not create output file: {}", path);
+			return false;
+		}
+		if (tryDirect)
+		{
+			directHandle = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+				FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH, nullptr);
+		}
+		directUsable.store(directHandle != INVALID_HANDLE_VALUE, std::memory_order_relaxed);
+#elif defined __linux
+		bufferedFile = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (bufferedFile < 0)
+		{
+			LOG_ERROR("[FAIL] Could not create output file: {} - {}", path, std::strerror(errno));
+			return false;
+		}
+		if (tryDirect) { directFile = ::open(path.c_str(), O_WRONLY | O_DIRECT | O_CLOEXEC); }
+		directUsable.store(directFile >= 0, std::memory_order_relaxed);
+#endif
+		if (tryDirect && !isDirect()) { LOG_VERBOSE("[OK] Direct I/O isn't available for {} - writing through the page cache instead.", path); }
+		return true;
+	}
+
+	// Method to write `size` bytes from `data` at `offset`. Safe to call from several threads at once (for different ranges of the file).
+	bool writeAt(uint64_t offset, const void* data, size_t size)
+	{
+		const bool aligned = reinterpret_cast<uintptr_t>(data) % DirectAlignment == 0 && size % DirectAlignment == 0 && offset % DirectAlignment == 0;
+		if (aligned && directUsable.load(std::memory_order_relaxed))
+		{
+			if (writeAll(true, offset, data, size))
+			{
+				directBytesWritten.fetch_add(size, std::memory_order_relaxed);
+				return true;
+			}
+
+			if (directUsable.exchange(false, std::memory_order_relaxed))
+			{
+				LOG_WARNING("[WARNING] Direct I/O write failed - falling back to writing through the page cache.");
+			}
+		}
+		return writeAll(false, offset, data, size);
+	}
+
+	bool isDirect() const { return directUsable.load(std::memory_order_relaxed); }
+	uint64_t getDirectBytesWritten() const { return directBytesWritten.load(std::memory_order_relaxed); }
+
+	void close()
+	{
+#if defined _WIN32
+		if (directHandle != INVALID_HANDLE_VALUE)   { CloseHandle(directHandle);   directHandle = INVALID_HANDLE_VALUE; }
+		if (bufferedHandle != INVALID_HANDLE_VALUE) { CloseHandle(bufferedHandle); bufferedHandle = INVALID_HANDLE_VALUE; }
+#elif defined __linux
+		if (directFile >= 0)   { ::close(directFile);   directFile = -1; }
+		if (bufferedFile >= 0) { ::close(bufferedFile); bufferedFile = -1; }
+#endif
+		directUsable.store(false, std::memory_order_relaxed);
+	}
+
+	~FrameFile() { close(); }
+
+private:
+
+	// Method to write everything, in as many calls as it takes (writes can come up short - and Windows takes 32-bit sizes)
+	bool writeAll(bool direct, uint64_t offset, const void* data, size_t size)
+	{
+		const auto* bytes = static_cast<const uint8_t*>(data);
+		while (size > 0)
+		{
+			const size_t chunk = size < MaxChunkBytes ? size : MaxChunkBytes;
+#if defined _WIN32
+			OVERLAPPED overlapped = {}; // Note: On a synchronous handle this just says where to write
+			overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFFu);
+			overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+			DWORD written = 0;
+			if (!WriteFile(direct ? directHandle : bufferedHandle, bytes, static_cast<DWORD>(chunk), &written, &overlapped) || written == 0) { return false; }
+#elif defined __linux
+			const ssize_t written = ::pwrite(direct ? directFile : bufferedFile, bytes, chunk, static_cast<off_t>(offset));
+			if (written < 0 && errno == EINTR) { continue; }
+			if (written <= 0)
+			{
+				if (!direct) { LOG_ERROR("[FAIL] Writing frame data failed: {}", std::strerror(errno)); }
+				return false;
+			}
+#endif
+			bytes += written;
+			offset += static_cast<uint64_t>(written);
+			size -= static_cast<size_t>(written);
+		}
+		return true;
+	}
+
+	static constexpr size_t MaxChunkBytes = 1u << 30; // 1 GiB - a multiple of `DirectAlignment`, so direct writes stay aligned
+
+#if defined _WIN32
+	HANDLE bufferedHandle = INVALID_HANDLE_VALUE;
+	HANDLE directHandle = INVALID_HANDLE_VALUE;
+#elif defined __linux
+	int bufferedFile = -1;
+	int directFile = -1;
+#endif
+	std::atomic<bool> directUsable{ false };
+	std::atomic<uint64_t> directBytesWritten{ 0 };
+};
+
+// Class to stream frames from an `OffscreenRenderer` to disk, encoding & writing them in parallel on a `JobSystem`'s workers.
+//
+// We never copy the frames we're given: raw frames are written straight out of the renderer's mapped readback memory, and Y4M / PNG frames
+// are encoded straight from it into a (re-used) buffer per frame being encoded. That means the renderer mustn't re-use a frame's memory
+// until we're done with it - so set the renderer's consumer up with `consumerReleasesFrames` and pass its `releaseFrame` as `onDone`:
+//     renderer.setConsumer([&](const ReadbackFrame& frame) { sink.submit(frame, [&renderer, n = frame.FrameNumber]() { renderer.releaseFrame(n); }); }, true);
+// Every frame of the video / raw file is the same size, so each frame's position in the file is known up front and frames can be written in
+// whatever order their jobs finish.
+class FrameSink
+{
+public:
+
+	// Method to parse a format name from the command line ("raw", "y4m" or "png"). Returns false if we don't know it.
+	static bool parseFormat(const string& text, FrameSinkFormat& format)
+	{
+		if (text == "raw") { format = FrameSinkFormat::Raw; return true; }
+		if (text == "y4m") { format = FrameSinkFormat::Y4M; return true; }
+		if (text == "png") { format = FrameSinkFormat::Png; return true; }
+		return false;
+	}
+
+	// Method to get ready to write `width` x `height` frames of `pixelFormat` (which must be 8-bit RGBA or BGRA). For PNG output `path` is
+	// the prefix of each frame's file name, otherwise it's the file to write. `jobSystem` must outlive the sink.
+	bool create(const string& path, FrameSinkFormat format, uint32_t width, uint32_t height, VkFormat pixelFormat, JobSystem& jobSystem, uint32_t framesPerSecond = 30)
+	{
+		outputPath = path;
+		sinkFormat = format;
+		frameWidth = width;
+		frameHeight = height;
+		jobs = &jobSystem;
+
+		switch (pixelFormat)
+		{
+		case VK_FORMAT_R8G8B8A8_UNORM: case VK_FORMAT_R8G8B8A8_SRGB: redIndex = 0; blueIndex = 2; break;
+		case VK_FORMAT_B8G8R8A8_UNORM: case VK_FORMAT_B8G8R8A8_SRGB: redIndex = 2; blueIndex = 0; break;
+		default:
+			LOG_ERROR("[FAIL] Frame sink only supports 8-bit RGBA / BGRA frames, not format: {}", pixelFormat);
+			return false;
+		}
+
+		if (sinkFormat == FrameSinkFormat::Png) { return true; } // Each frame gets its own file
+
+		// Only raw frames are written straight from the GPU's memory - everything else goes through an encode buffer
+		if (!file.open(outputPath, sinkFormat == FrameSinkFormat::Raw)) { return false; }
+		if (sinkFormat == FrameSinkFormat::Raw)
+		{
+			frameRecordBytes = static_cast<uint64_t>(width) * height * 4;
+			if (file.isDirect() && frameRecordBytes % FrameFile::DirectAlignment != 0)
+			{
+				LOG_WARNING("[WARNING] {}x{} frames aren't a multiple of {} bytes, so they can't be written with direct I/O.", width, height, FrameFile::DirectAlignment);
+			}
+		}
+		else
+		{
+			// Note: `C420jpeg` is full-range 4:2:0 with the chroma sited between each 2x2 block of luma samples - which is what we produce
+			char header[128];
+			const int headerLength = std::snprintf(header, sizeof(header), "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width, height, framesPerSecond);
+			headerBytes = static_cast<uint64_t>(headerLength);
+			frameRecordBytes = sizeof(Y4mFrameTag) - 1 + getY4mPlaneBytes();
+			if (!file.writeAt(0, header, static_cast<size_t>(headerLength))) { return false; }
+		}
+		return true;
+	}
+
+	// Method to queue a frame to be encoded & written on a worker thread. `onDone` gets called (on the worker) as soon as we no longer
+	// need `frame.Pixels` - whether or not the write worked.
+	void submit(const ReadbackFrame& frame, std::function<void()> onDone)
+	{
+		{
+			std::lock_guard<std::mutex> lock(pendingMutex);
+			if (firstFrameNumber == 0) { firstFrameNumber = frame.FrameNumber; }
+			++pendingFrames;
+		}
+
+		jobs->submit([this, frame, onDone = std::move(onDone)]()
+		{
+			TraceScope writeZone("Encode & write frame");
+			const bool written = writeFrame(frame);
+			onDone();
+			if (!written) { failed.store(true, std::memory_order_relaxed); }
+			else { framesWritten.fetch_add(1, std::memory_order_relaxed); }
+
+			bool allDone = false;
+			{
+				std::lock_guard<std::mutex> lock(pendingMutex);
+				allDone = --pendingFrames == 0;
+			}
+			if (allDone) { framesDone.notify_all(); }
+		});
+	}
+
+	// Method to wait for every frame we've been given to be written. Returns false if any of them couldn't be.
+	bool finish()
+	{
+		TraceScope finishZone("Finish writing frames");
+		std::unique_lock<std::mutex> lock(pendingMutex);
+		framesDone.wait(lock, [this]() { return pendingFrames == 0; });
+		return !failed.load(std::memory_order_relaxed);
+	}
+
+	uint64_t getFramesWritten() const { return framesWritten.load(std::memory_order_relaxed); }
+	uint64_t getBytesWritten() const { return bytesWritten.load(std::memory_order_relaxed); }
+	uint64_t getDirectBytesWritten() const { return file.getDirectBytesWritten(); } // How much of `getBytesWritten` bypassed the page cache
+
+	// CAREFUL: Call `finish` first!
+	void destroy()
+	{
+		file.close();
+		std::lock_guard<std::mutex> lock(bufferMutex);
+		freeBuffers.clear();
+	}
+
+private:
+
+	static constexpr char Y4mFrameTag[] = "FRAME\n";
+
+	uint64_t getY4mPlaneBytes() const
+	{
+		const uint64_t chromaWidth = (frameWidth + 1) / 2;
+		const uint64_t chromaHeight = (frameHeight + 1) / 2;
+		return static_cast<uint64_t>(frameWidth) * frameHeight + 2 * chromaWidth * chromaHeight;
+	}
+
+	bool writeFrame(const ReadbackFrame& frame)
+	{
+		const uint64_t frameIndex = frame.FrameNumber - firstFrameNumber;
+		if (sinkFormat == FrameSinkFormat::Raw)
+		{
+			// Straight from the readback memory to the disk
+			const auto frameBytes = static_cast<size_t>(frame.RowPitch) * frame.Height;
+			if (!file.writeAt(frameIndex * frameRecordBytes, frame.Pixels, frameBytes)) { return false; }
+			bytesWritten.fetch_add(frameBytes, std::memory_order_relaxed);
+			return true;
+		}
+
+		std::vector<uint8_t> encoded = acquireBuffer();
+		bool written = false;
+		if (sinkFormat == FrameSinkFormat::Y4M)
+		{
+			encodeY4mFrame(frame, encoded);
+			written = file.writeAt(headerBytes + frameIndex * frameRecordBytes, encoded.data(), encoded.size());
+		}
+		else
+		{
+			encodePng(frame, encoded);
+			char suffix[32];
+			std::snprintf(suffix, sizeof(suffix), "_%06llu.png", static_cast<unsigned long long>(frameIndex + 1));
+			FrameFile pngFile;
+			written = pngFile.open(outputPath + suffix, false) && pngFile.writeAt(0, encoded.data(), encoded.size());
+		}
+		if (written) { bytesWritten.fetch_add(encoded.size(), std::memory_order_relaxed); }
+		releaseBuffer(std::move(encoded));
+		return written;
+	}
+
+	// ----- Y4M -----
+
+	// Method to convert an RGBA / BGRA frame to a Y4M frame record: the "FRAME" tag, then the Y, Cb & Cr planes (chroma at half resolution
+	// both ways, each sample the average of a 2x2 block of pixels). Full range BT.601 in 8.8 fixed point.
+	void encodeY4mFrame(const ReadbackFrame& frame, std::vector<uint8_t>& out) const
+	{
+		const uint32_t width = frame.Width;
+		const uint32_t height = frame.Height;
+		const uint32_t chromaWidth = (width + 1) / 2;
+		const uint32_t chromaHeight = (height + 1) / 2;
+		out.resize(sizeof(Y4mFrameTag) - 1 + getY4mPlaneBytes());
+
+		std::memcpy(out.data(), Y4mFrameTag, sizeof(Y4mFrameTag) - 1);
+		uint8_t* yPlane = out.data() + sizeof(Y4mFrameTag) - 1;
+		uint8_t* cbPlane = yPlane + static_cast<size_t>(width) * height;
+		uint8_t* crPlane = cbPlane + static_cast<size_t>(chromaWidth) * chromaHeight;
+
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const uint8_t* row = frame.Pixels + static_cast<size_t>(y) * frame.RowPitch;
+			uint8_t* yRow = yPlane + static_cast<size_t>(y) * width;
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const uint8_t* pixel = row + x * 4;
+				yRow[x] = static_cast<uint8_t>((77 * pixel[redIndex] + 150 * pixel[1] + 29 * pixel[blueIndex] + 128) >> 8);
+			}
+		}
+
+		for (uint32_t cy = 0; cy < chromaHeight; ++cy)
+		{
+			// Note: On odd-sized frames the last row / column of chroma just averages the edge pixels with themselves
+			const uint8_t* row0 = frame.Pixels + static_cast<size_t>(cy * 2) * frame.RowPitch;
+			const uint8_t* row1 = frame.Pixels + static_cast<size_t>(cy * 2 + 1 < height ? cy * 2 + 1 : cy * 2) * frame.RowPitch;
+			for (uint32_t cx = 0; cx < chromaWidth; ++cx)
+			{
+				const uint32_t x0 = cx * 2 * 4;
+				const uint32_t x1 = (cx * 2 + 1 < width ? cx * 2 + 1 : cx * 2) * 4;
+				const int r = (row0[x0 + redIndex] + row0[x1 + redIndex] + row1[x0 + redIndex] + row1[x1 + redIndex] + 2) / 4;
+				const int g = (row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1] + 2) / 4;
+				const int b = (row0[x0 + blueIndex] + row0[x1 + blueIndex] + row1[x0 + blueIndex] + row1[x1 + blueIndex] + 2) / 4;
+
+				// Note: The 128 << 8 offset keeps everything positive before the shift
+				const int cb = (-43 * r - 85 * g + 128 * b + (128 << 8) + 128) >> 8;
+				const int cr = (128 * r - 107 * g - 21 * b + (128 << 8) + 128) >> 8;
+				cbPlane[static_cast<size_t>(cy) * chromaWidth + cx] = static_cast<uint8_t>(cb > 255 ? 255 : cb);
+				crPlane[static_cast<size_t>(cy) * chromaWidth + cx] = static_cast<uint8_t>(cr > 255 ? 255 : cr);
+			}
+		}
+	}
+
+	// ----- PNG -----
+
+	// Method to encode a frame as an 8-bit RGBA PNG.
+	// Note: We have no compression library, so the image data goes in uncompressed ("stored") deflate blocks - the files are as big as the
+	// raw pixels (plus a little), but they're perfectly valid PNGs and take next to no CPU time to make.
+	// See: https://www.w3.org/TR/png/ and https://www.rfc-editor.org/rfc/rfc1950 (zlib) / rfc1951 (deflate)
+	void encodePng(const ReadbackFrame& frame, std::vector<uint8_t>& out) const
+	{
+		const uint64_t rowBytes = static_cast<uint64_t>(frame.Width) * 4 + 1; // Each row starts with its filter type (0 = none)
+		const uint64_t imageBytes = rowBytes * frame.Height;
+		const uint64_t numBlocks = (imageBytes + MaxStoredBlockBytes - 1) / MaxStoredBlockBytes;
+		const uint64_t zlibBytes = 2 + imageBytes + numBlocks * 5 + 4;
+
+		out.clear();
+		out.reserve(static_cast<size_t>(8 + (12 + 13) + (12 + zlibBytes) + 12));
+		static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		out.insert(out.end(), signature, signature + 8);
+
+		uint8_t header[13];
+		writeBigEndian(header, frame.Width);
+		writeBigEndian(header + 4, frame.Height);
+		header[8] = 8;  // Bits per channel
+		header[9] = 6;  // Colour type: RGBA
+		header[10] = 0; // Compression method: deflate
+		header[11] = 0; // Filter method: adaptive (we always pick "none")
+		header[12] = 0; // No interlacing
+		appendPngChunk(out, "IHDR", header, sizeof(header));
+
+		// The IDAT chunk: length & type, then the zlib stream, then the CRC (which we work out over the type & data once they're in place)
+		const size_t chunkStart = out.size();
+		out.resize(chunkStart + 8 + static_cast<size_t>(zlibBytes));
+		writeBigEndian(out.data() + chunkStart, static_cast<uint32_t>(zlibBytes));
+		std::memcpy(out.data() + chunkStart + 4, "IDAT", 4);
+
+		uint8_t* zlib = out.data() + chunkStart + 8;
+		zlib[0] = 0x78; // Deflate with a 32K window..
+		zlib[1] = 0x01; // ..and the check bits that make the header a multiple of 31
+		uint8_t* write = zlib + 2;
+
+		// Each row gets swizzled into RGBA (behind its filter byte) in a small row buffer, then copied into as many stored blocks as it takes
+		std::vector<uint8_t> row(static_cast<size_t>(rowBytes));
+		uint32_t adlerA = 1;
+		uint32_t adlerB = 0;
+		uint64_t remainingInBlock = 0;
+		uint64_t remainingInImage = imageBytes;
+		for (uint32_t y = 0; y < frame.Height; ++y)
+		{
+			row[0] = 0;
+			const uint8_t* pixels = frame.Pixels + static_cast<size_t>(y) * frame.RowPitch;
+			for (uint32_t x = 0; x < frame.Width; ++x)
+			{
+				const uint8_t* pixel = pixels + x * 4;
+				uint8_t* rgba = row.data() + 1 + x * 4;
+				rgba[0] = pixel[redIndex];
+				rgba[1] = pixel[1];
+				rgba[2] = pixel[blueIndex];
+				rgba[3] = pixel[3];
+			}
+			updateAdler32(adlerA, adlerB, row.data(), row.size());
+
+			const uint8_t* read = row.data();
+			uint64_t remainingInRow = rowBytes;
+			while (remainingInRow > 0)
+			{
+				if (remainingInBlock == 0)
+				{
+					const auto blockBytes = static_cast<uint16_t>(remainingInImage < MaxStoredBlockBytes ? remainingInImage : MaxStoredBlockBytes);
+					*write++ = remainingInImage <= MaxStoredBlockBytes ? 1 : 0; // BFINAL on the last block, BTYPE 00 (stored)
+					*write++ = static_cast<uint8_t>(blockBytes & 0xFF);
+					*write++ = static_cast<uint8_t>(blockBytes >> 8);
+					*write++ = static_cast<uint8_t>(~blockBytes & 0xFF);
+					*write++ = static_cast<uint8_t>((~blockBytes >> 8) & 0xFF);
+					remainingInBlock = blockBytes;
+				}
+				const uint64_t copied = remainingInRow < remainingInBlock ? remainingInRow : remainingInBlock;
+				std::memcpy(write, read, static_cast<size_t>(copied));
+				write += copied;
+				read += copied;
+				remainingInRow -= copied;
+				remainingInBlock -= copied;
+				remainingInImage -= copied;
+			}
+		}
+		writeBigEndian(write, (adlerB << 16) | adlerA);
+
+		uint8_t crc[4];
+		writeBigEndian(crc, getCrc32(out.data() + chunkStart + 4, 4 + static_cast<size_t>(zlibBytes)));
+		out.insert(out.end(), crc, crc + 4);
+
+		appendPngChunk(out, "IEND", nullptr, 0);
+	}
+
+	static constexpr uint64_t MaxStoredBlockBytes = 65535;
+
+	// Method to add bytes to an Adler-32 checksum (as used by zlib). Note: 5552 is the most bytes we can sum before `b` could overflow 32 bits,
+	// so we only need to do the (slow) modulo once per 5552 bytes rather than once per byte.
+	static void updateAdler32(uint32_t& a, uint32_t& b, const uint8_t* data, size_t length)
+	{
+		while (length > 0)
+		{
+			size_t chunk = length < 5552 ? length : 5552;
+			length -= chunk;
+			while (chunk-- > 0)
+			{
+				a += *data++;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+	}
+
+	static void writeBigEndian(uint8_t* out, uint32_t value)
+	{
+		out[0] = static_cast<uint8_t>(value >> 24);
+		out[1] = static_cast<uint8_t>(value >> 16);
+		out[2] = static_cast<uint8_t>(value >> 8);
+		out[3] = static_cast<uint8_t>(value);
+	}
+
+	static void appendPngChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, uint32_t length)
+	{
+		uint8_t lengthBytes[4];
+		writeBigEndian(lengthBytes, length);
+		out.insert(out.end(), lengthBytes, lengthBytes + 4);
+		const size_t typeStart = out.size();
+		out.insert(out.end(), type, type + 4);
+		if (length > 0) { out.insert(out.end(), data, data + length); }
+
+		uint8_t crc[4];
+		writeBigEndian(crc, getCrc32(out.data() + typeStart, 4 + length));
+		out.insert(out.end(), crc, crc + 4);
+	}
+
+	// Method to get the CRC-32 (as used by PNG & zlib) of some bytes
+	static uint32_t getCrc32(const uint8_t* data, size_t length)
+	{
+		static const std::vector<uint32_t> table = []()
+		{
+			std::vector<uint32_t> entries(256);
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t value = i;
+				for (int bit = 0; bit < 8; ++bit) { value = (value & 1) != 0 ? 0xEDB88320u ^ (value >> 1) : value >> 1; }
+				entries[i] = value;
+			}
+			return entries;
+		}();
+
+		uint32_t crc = 0xFFFFFFFFu;
+		for (size_t i = 0; i < length; ++i) { crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8); }
+		return crc ^ 0xFFFFFFFFu;
+	}
+
+	// ----- Encode buffers -----
+	// Note: Frames are all the same size, so once we've got as many buffers as we ever have frames encoding at once we stop allocating
+
+	std::vector<uint8_t> acquireBuffer()
+	{
+		std::lock_guard<std::mutex> lock(bufferMutex);
+		if (freeBuffers.empty()) { return {}; }
+		std::vector<uint8_t> buffer = std::move(freeBuffers.back());
+		freeBuffers.pop_back();
+		return buffer;
+	}
+
+	void releaseBuffer(std::vector<uint8_t>&& buffer)
+	{
+		std::lock_guard<std::mutex> lock(bufferMutex);
+		freeBuffers.push_back(std::move(buffer));
+	}
+
+	string outputPath;
+	FrameSinkFormat sinkFormat = FrameSinkFormat::Raw;
+	uint32_t frameWidth = 0;
+	uint32_t frameHeight = 0;
+	uint32_t redIndex = 0;
+	uint32_t blueIndex = 2;
+	JobSystem* jobs = nullptr;
+	FrameFile file;
+	uint64_t headerBytes = 0;      // Bytes before the first frame in the file
+	uint64_t frameRecordBytes = 0; // Bytes each frame takes up in the file (including any per-frame header)
+
+	std::mutex pendingMutex;
+	std::condition_variable framesDone;
+	uint64_t pendingFrames = 0;
+	uint64_t firstFrameNumber = 0; // Frame numbers from the renderer don't have to start at 1 - we number our output from the first one we get
+
+	std::atomic<uint64_t> framesWritten{ 0 };
+	std::atomic<uint64_t> bytesWritten{ 0 };
+	std::atomic<bool> failed{ false };
+
+	std::mutex bufferMutex;
+	std::vector<std::vector<uint8_t>> freeBuffers;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+
+// A `VkBuffer` along with the `VkDeviceMemory` that backs it. We give every buffer its own allocation for now, which is fine for the
+// handful of buffers we make - but keep `maxMemoryAllocationCount` in mind (it can be as low as 4096) before using this for lots of things!
+struct GpuBuffer
+{
+	VkBuffer Buffer       = VK_NULL_HANDLE;
+	VkDeviceMemory Memory = VK_NULL_HANDLE;
+	VkDeviceSize Size     = 0;
+	void* Mapped          = nullptr; // Only set if we asked for a host-visible buffer to be persistently mapped
+	VkMemoryPropertyFlags MemoryFlags = 0; // Of the memory type we actually got - which may have more than we asked for (e.g., coherent)
+
+	// Method to create the buffer, allocate memory for it from a memory type with `memoryFlags` and bind the two together.
+	// Returns false (and cleans up after itself) if any step fails.
+	bool create(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, VkDeviceSize size, VkBufferUsageFlags usage,
+		VkMemoryPropertyFlags memoryFlags, bool persistentlyMap = false)
+	{
+		VkBufferCreateInfo bufferCreateInfo = {};
+		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferCreateInfo.pNext = nullptr;
+		bufferCreateInfo.flags = 0;
+		bufferCreateInfo.size = size;
+		bufferCreateInfo.usage = usage;
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // We only ever touch our buffers from a single queue family
+		bufferCreateInfo.queueFamilyIndexCount = 0;
+		bufferCreateInfo.pQueueFamilyIndices = nullptr;
+
+		VkResult result = VulkanFunctionLoaders::vkCreateBuffer(device, &bufferCreateInfo, nullptr, &Buffer);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create buffer of {} bytes. VkResult is: {}", size, VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		Size = size;
+
+		// Note: The memory requirements may ask for MORE than `size` bytes (alignment padding etc.) so always allocate what it tells us to.
+		VkMemoryRequirements memoryRequirements;
+		VulkanFunctionLoaders::vkGetBufferMemoryRequirements(device, Buffer, &memoryRequirements);
+
+		const uint32_t memoryTypeIndex = VulkanHelpers::findMemoryTypeIndex(memoryProperties, memoryRequirements.memoryTypeBits, memoryFlags);
+		if (memoryTypeIndex == UINT32_MAX)
+		{
+			LOG_ERROR("[FAIL] No memory type is suitable for a buffer with memory property flags: {}", memoryFlags);
+			destroy(device);
+			return false;
+		}
+
+		MemoryFlags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+		VkMemoryAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.allocationSize = memoryRequirements.size;
+		allocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+		result = VulkanFunctionLoaders::vkAllocateMemory(device, &allocateInfo, nullptr, &Memory);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not allocate {} bytes of buffer memory. VkResult is: {}", memoryRequirements.size, VulkanHelpers::getFriendlyResultString(result));
+			destroy(device);
+			return false;
+		}
+
+		result = VulkanFunctionLoaders::vkBindBufferMemory(device, Buffer, Memory, 0);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not bind buffer memory. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			destroy(device);
+			return false;
+		}
+
+		if (persistentlyMap)
+		{
+			result = VulkanFunctionLoaders::vkMapMemory(device, Memory, 0, VK_WHOLE_SIZE, 0, &Mapped);
+			if (result != VK_SUCCESS)
+			{
+				LOG_ERROR("[FAIL] Could not map buffer memory. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+				destroy(device);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Method to destroy the buffer and free its memory. Safe to call on a partially-created (or never-created) buffer.
+	// CAREFUL: The GPU must be finished with the buffer before we call this!
+	void destroy(VkDevice device)
+	{
+		if (Mapped != nullptr)
+		{
+			VulkanFunctionLoaders::vkUnmapMemory(device, Memory);
+			Mapped = nullptr;
+		}
+		if (Buffer != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyBuffer(device, Buffer, nullptr);
+			Buffer = VK_NULL_HANDLE;
+		}
+		if (Memory != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkFreeMemory(device, Memory, nullptr);
+			Memory = VK_NULL_HANDLE;
+		}
+		Size = 0;
+		MemoryFlags = 0;
+	}
+};
@@ -0,0 +1,1008 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "ObjectCache.hpp"
+#include "GpuBuffer.hpp"
+#include "RenderTarget.hpp"
+#include "RenderGraph.hpp"
+#include "DescriptorTemplate.hpp"
+#include "ComputePipeline.hpp"
+#include "ComputeBatch.hpp"
+
+// A 4x4 matrix of floats, column-major like GLSL's `mat4` - so element (row, column) is at `[column * 4 + row]`
+using Matrix4 = std::array<float, 16>;
+
+inline Matrix4 multiplyMatrices(const Matrix4& a, const Matrix4& b)
+{
+	Matrix4 result = {};
+	for (uint32_t column = 0; column < 4; ++column)
+	{
+		for (uint32_t row = 0; row < 4; ++row)
+		{
+			float sum = 0.0f;
+			for (uint32_t k = 0; k < 4; ++k) { sum += a[k * 4 + row] * b[column * 4 + k]; }
+			result[column * 4 + row] = sum;
+		}
+	}
+	return result;
+}
+
+// Method to make a right-handed perspective projection (looking down -z) for Vulkan's clip space: y points down the screen and depth goes
+// from 0 at `nearPlane` to 1 at `farPlane`.
+inline Matrix4 makePerspective(float verticalFovRadians, float aspectRatio, float nearPlane, float farPlane)
+{
+	const float focalLength = 1.0f / std::tan(verticalFovRadians * 0.5f);
+	Matrix4 result = {};
+	result[0] = focalLength / aspectRatio;
+	result[5] = -focalLength; // Note: Vulkan's y is flipped compared to OpenGL's
+	result[10] = farPlane / (nearPlane - farPlane);
+	result[11] = -1.0f;
+	result[14] = nearPlane * farPlane / (nearPlane - farPlane);
+	return result;
+}
+
+// Method to make a view matrix for a camera at `eye` looking at `target`, with `up` roughly up
+inline Matrix4 makeLookAt(const std::array<float, 3>& eye, const std::array<float, 3>& target, const std::array<float, 3>& up)
+{
+	auto normalise = [](std::array<float, 3> v)
+	{
+		const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		return std::array<float, 3>{ v[0] / length, v[1] / length, v[2] / length };
+	};
+	auto cross = [](const std::array<float, 3>& a, const std::array<float, 3>& b)
+	{
+		return std::array<float, 3>{ a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+	};
+	auto dot = [](const std::array<float, 3>& a, const std::array<float, 3>& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; };
+
+	const std::array<float, 3> forward = normalise({ target[0] - eye[0], target[1] - eye[1], target[2] - eye[2] });
+	const std::array<float, 3> side = normalise(cross(forward, up));
+	const std::array<float, 3> realUp = cross(side, forward);
+	Matrix4 result = {};
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		result[i * 4 + 0] = side[i];
+		result[i * 4 + 1] = realUp[i];
+		result[i * 4 + 2] = -forward[i];
+	}
+	result[12] = -dot(side, eye);
+	result[13] = -dot(realUp, eye);
+	result[14] = dot(forward, eye);
+	result[15] = 1.0f;
+	return result;
+}
+
+// One instance to cull: its bounding sphere & which mesh it draws. Must match `Instance` in `gpu_cull.comp` - and its first 16 bytes are
+// read as a per-instance vertex attribute by `cull_depth.vert`, so the instance buffer doubles as a vertex buffer.
+struct CullInstance
+{
+	float Center[3];
+	float Radius;
+	uint32_t MeshIndex;
+	uint32_t Padding[3];
+};
+static_assert(sizeof(CullInstance) == 32, "CullInstance must match the std430 layout of `Instance` in gpu_cull.comp");
+
+// Where a mesh's indices live in the shared index & vertex buffers. Must match `Mesh` in `gpu_cull.comp`.
+struct CullMesh
+{
+	uint32_t IndexCount;
+	uint32_t FirstIndex;
+	int32_t VertexOffset;
+	uint32_t Padding;
+};
+
+// What the culling shader knows about the camera. Must match the std140 `View` block in `gpu_cull.comp` - see `makeCullView`.
+struct CullView
+{
+	float ViewProjection[16];
+	float FrustumPlanes[6][4]; // Normalised & pointing inwards: (normal, distance)
+	float PyramidSize[2];      // Of the depth pyramid's top level, for occlusion culling
+	uint32_t PyramidLevels;
+	uint32_t Padding;
+};
+static_assert(sizeof(CullView) == 176, "CullView must match the std140 layout of `View` in gpu_cull.comp");
+
+// Method to fill in a `CullView` from a view-projection matrix, pulling the six frustum planes out of its rows (Gribb & Hartmann) - for
+// Vulkan's 0 to 1 depth range the near plane is just the third row. The pyramid size & levels only matter for occlusion culling.
+// See: https://www.gamedevs.org/uploads/fast-extraction-viewing-frustum-planes-from-world-view-projection-matrix.pdf
+inline CullView makeCullView(const Matrix4& viewProjection, uint32_t pyramidWidth = 0, uint32_t pyramidHeight = 0, uint32_t pyramidLevels = 0)
+{
+	CullView view = {};
+	std::memcpy(view.ViewProjection, viewProjection.data(), sizeof(view.ViewProjection));
+	auto row = [&viewProjection](uint32_t r) { return std::array<float, 4>{ viewProjection[r], viewProjection[4 + r], viewProjection[8 + r], viewProjection[12 + r] }; };
+	const std::array<float, 4> x = row(0), y = row(1), z = row(2), w = row(3);
+	const std::array<float, 4> planes[6] = {
+		{ w[0] + x[0], w[1] + x[1], w[2] + x[2], w[3] + x[3] }, // Left
+		{ w[0] - x[0], w[1] - x[1], w[2] - x[2], w[3] - x[3] }, // Right
+		{ w[0] + y[0], w[1] + y[1], w[2] + y[2], w[3] + y[3] }, // Top (as y points down)
+		{ w[0] - y[0], w[1] - y[1], w[2] - y[2], w[3] - y[3] }, // Bottom
+		z,                                                      // Near
+		{ w[0] - z[0], w[1] - z[1], w[2] - z[2], w[3] - z[3] }  // Far
+	};
+	for (uint32_t i = 0; i < 6; ++i)
+	{
+		const float length = std::sqrt(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+		for (uint32_t j = 0; j < 4; ++j) { view.FrustumPlanes[i][j] = planes[i][j] / length; }
+	}
+	view.PyramidSize[0] = static_cast<float>(pyramidWidth);
+	view.PyramidSize[1] = static_cast<float>(pyramidHeight);
+	view.PyramidLevels = pyramidLevels;
+	return view;
+}
+
+// Method to test a sphere against the frustum exactly as `gpu_cull.comp` does. `slack` widens (or, if negative, narrows) every plane -
+// which is how a check against the GPU tells the instances that are clearly in or out from ones right on an edge, where rounding may
+// legitimately go either way.
+inline bool isSphereInFrustum(const CullView& view, const CullInstance& instance, float slack = 0.0f)
+{
+	for (uint32_t i = 0; i < 6; ++i)
+	{
+		const float* plane = view.FrustumPlanes[i];
+		if (plane[0] * instance.Center[0] + plane[1] * instance.Center[1] + plane[2] * instance.Center[2] + plane[3] < -instance.Radius - slack) { return false; }
+	}
+	return true;
+}
+
+// Method to cull on the CPU what `GpuCulling::recordCull` culls on the GPU: a `VkDrawIndexedIndirectCommand` for each visible instance
+// (in instance order), drawing one instance of its mesh with `firstInstance` set to its index. Returns how many there were.
+inline uint32_t cullInstancesOnCpu(const CullView& view, const CullInstance* instances, uint32_t instanceCount, const std::vector<CullMesh>& meshes,
+	std::vector<VkDrawIndexedIndirectCommand>& commands)
+{
+	commands.clear();
+	for (uint32_t i = 0; i < instanceCount; ++i)
+	{
+		if (!isSphereInFrustum(view, instances[i])) { continue; }
+		const CullMesh& mesh = meshes[instances[i].MeshIndex];
+		commands.push_back({ mesh.IndexCount, 1, mesh.FirstIndex, mesh.VertexOffset, i });
+	}
+	return static_cast<uint32_t>(commands.size());
+}
+
+// A scene to cull: instances scattered through a box around a camera at the origin looking down -z, each drawing one of two meshes (a cube
+// & an octahedron, both inside the unit sphere, so an instance's bounding sphere bounds what it draws). Instance 0 is always a big one
+// straight ahead of the camera - so something covers the middle of the screen, and it can hide things behind it.
+struct CullingScene
+{
+	std::vector<CullInstance> Instances;
+	std::vector<CullMesh> Meshes;
+	std::vector<float> Vertices; // xyz
+	std::vector<uint32_t> Indices;
+	Matrix4 ViewProjection = {};
+};
+
+// Method to make a `CullingScene` of `instanceCount` instances. The box grows with the count so the density (and the fraction of instances
+// inside the frustum - roughly a tenth) stays about the same whatever the size. The same `seed` always gives the same scene.
+inline CullingScene generateCullingScene(uint32_t instanceCount, float aspectRatio = 16.0f / 9.0f, uint32_t seed = 1)
+{
+	CullingScene scene;
+
+	// A cube inscribed in the unit sphere...
+	const float h = 1.0f / std::sqrt(3.0f);
+	scene.Vertices = { -h, -h, -h,  h, -h, -h,  h, h, -h,  -h, h, -h,  -h, -h, h,  h, -h, h,  h, h, h,  -h, h, h };
+	scene.Indices = { 0, 2, 1, 0, 3, 2,  4, 5, 6, 4, 6, 7,  0, 1, 5, 0, 5, 4,  3, 7, 6, 3, 6, 2,  0, 4, 7, 0, 7, 3,  1, 2, 6, 1, 6, 5 };
+	scene.Meshes.push_back({ 36, 0, 0, 0 });
+
+	// ...and an octahedron, whose vertices are on it
+	const uint32_t octahedronFirstIndex = static_cast<uint32_t>(scene.Indices.size());
+	const int32_t octahedronVertexOffset = static_cast<int32_t>(scene.Vertices.size() / 3);
+	const float octahedron[] = { 1, 0, 0,  -1, 0, 0,  0, 1, 0,  0, -1, 0,  0, 0, 1,  0, 0, -1 };
+	scene.Vertices.insert(scene.Vertices.end(), std::begin(octahedron), std::end(octahedron));
+	const uint32_t octahedronIndices[] = { 0, 2, 4,  2, 1, 4,  1, 3, 4,  3, 0, 4,  2, 0, 5,  1, 2, 5,  3, 1, 5,  0, 3, 5 };
+	scene.Indices.insert(scene.Indices.end(), std::begin(octahedronIndices), std::end(octahedronIndices));
+	scene.Meshes.push_back({ 24, octahedronFirstIndex, octahedronVertexOffset, 0 });
+
+	const float halfExtent = 2.0f * std::cbrt(static_cast<float>(std::max(instanceCount, 1u)));
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u; // Note: A plain LCG is plenty random enough for test data
+		return static_cast<float>(seed >> 8) * (1.0f / 16777216.0f);
+	};
+	scene.Instances.resize(instanceCount);
+	for (uint32_t i = 0; i < instanceCount; ++i)
+	{
+		CullInstance& instance = scene.Instances[i];
+		instance.Center[0] = (random() * 2.0f - 1.0f) * halfExtent;
+		instance.Center[1] = (random() * 2.0f - 1.0f) * halfExtent;
+		instance.Center[2] = (random() * 2.0f - 1.0f) * halfExtent;
+		instance.Radius = 0.25f + 0.75f * random();
+		instance.MeshIndex = random() < 0.5f ? 0 : 1;
+		instance.Padding[0] = instance.Padding[1] = instance.Padding[2] = 0;
+	}
+	if (instanceCount > 0)
+	{
+		scene.Instances[0].Center[0] = 0.0f;
+		scene.Instances[0].Center[1] = 0.0f;
+		scene.Instances[0].Center[2] = -4.0f;
+		scene.Instances[0].Radius = 1.5f;
+	}
+
+	const float pi = 3.14159265358979f;
+	scene.ViewProjection = multiplyMatrices(makePerspective(60.0f * pi / 180.0f, aspectRatio, 0.1f, 2.0f * halfExtent),
+		makeLookAt({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f, 0.0f }));
+	return scene;
+}
+
+// Descriptors for `gpu_cull.comp`
+struct CullDescriptors
+{
+	VkDescriptorBufferInfo Instances;
+	VkDescriptorBufferInfo Meshes;
+	VkDescriptorBufferInfo View;
+	VkDescriptorBufferInfo Commands;
+	VkDescriptorBufferInfo DrawCount;
+};
+template <> struct DescriptorLayout<CullDescriptors>
+{
+	static constexpr std::array<DescriptorBinding, 5> Bindings = {
+		DESCRIPTOR_BINDING(CullDescriptors, Instances, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(CullDescriptors, Meshes, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(CullDescriptors, View, 2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(CullDescriptors, Commands, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(CullDescriptors, DrawCount, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) };
+};
+
+// Descriptors for `gpu_cull.comp` compiled with OCCLUSION - the same, plus the depth pyramid
+struct OcclusionCullDescriptors
+{
+	VkDescriptorBufferInfo Instances;
+	VkDescriptorBufferInfo Meshes;
+	VkDescriptorBufferInfo View;
+	VkDescriptorBufferInfo Commands;
+	VkDescriptorBufferInfo DrawCount;
+	VkDescriptorImageInfo DepthPyramid;
+};
+template <> struct DescriptorLayout<OcclusionCullDescriptors>
+{
+	static constexpr std::array<DescriptorBinding, 6> Bindings = {
+		DESCRIPTOR_BINDING(OcclusionCullDescriptors, Instances, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(OcclusionCullDescriptors, Meshes, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(OcclusionCullDescriptors, View, 2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(OcclusionCullDescriptors, Commands, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(OcclusionCullDescriptors, DrawCount, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(OcclusionCullDescriptors, DepthPyramid, 5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) };
+};
+
+// Method to create (or, given a cache, acquire) a sampler with nearest filtering & clamped edges over every mip level - for shaders that pick
+// the level & texels they want themselves, as a min or max doesn't survive being blended. Returns VK_NULL_HANDLE if that fails.
+inline VkSampler createNearestSampler(VkDevice device, ObjectCache* cache)
+{
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.pNext = nullptr;
+	samplerCreateInfo.flags = 0;
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.mipLodBias = 0.0f;
+	samplerCreateInfo.anisotropyEnable = VK_FALSE;
+	samplerCreateInfo.maxAnisotropy = 1.0f;
+	samplerCreateInfo.compareEnable = VK_FALSE;
+	samplerCreateInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+	samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+	samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
+	if (cache != nullptr) { return cache->acquireSampler(samplerCreateInfo); }
+
+	VkSampler sampler = VK_NULL_HANDLE;
+	const VkResult result = VulkanFunctionLoaders::vkCreateSampler(device, &samplerCreateInfo, nullptr, &sampler);
+	if (result != VK_SUCCESS)
+	{
+		LOG_ERROR("[FAIL] Could not create nearest sampler. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+		return VK_NULL_HANDLE;
+	}
+	return sampler;
+}
+
+// Method to hand back a sampler from `createNearestSampler` (with the same `cache`), setting it to VK_NULL_HANDLE
+inline void destroyNearestSampler(VkDevice device, ObjectCache* cache, VkSampler& sampler)
+{
+	if (sampler == VK_NULL_HANDLE) { return; }
+	if (cache != nullptr) { cache->releaseSampler(sampler); }
+	else { VulkanFunctionLoaders::vkDestroySampler(device, sampler, nullptr); }
+	sampler = VK_NULL_HANDLE;
+}
+
+// Class to record GPU-driven culling: a compute pass that tests every instance's bounding sphere against the view frustum (and, optionally,
+// a depth pyramid - see `recordOcclusionCull`) and writes a `VkDrawIndexedIndirectCommand` for each survivor, plus how many there were.
+// `recordDraws` then draws them with `vkCmdDrawIndexedIndirectCount`, so the CPU never touches an instance - one dispatch & one draw call
+// however big the scene gets, rather than a loop over every instance & a draw call for each that's visible.
+//
+// Survivors are appended in whatever order workgroups finish, not instance order (nothing about drawing them needs an order). Each command
+// draws a single instance of its mesh with `firstInstance` set to the instance's index, so per-instance data can be looked up by
+// `gl_InstanceIndex` or fed in as a per-instance vertex attribute - which needs the `drawIndirectFirstInstance` feature.
+//
+// `vkCmdDrawIndexedIndirectCount` comes from `VK_KHR_draw_indirect_count` (core in 1.2, but our instance asks for 1.0 or 1.1). Where that
+// isn't enabled, or `maxDrawCount` is over `maxDrawIndirectCount`, we zero the commands before culling and `recordDraws` falls back on
+// `vkCmdDrawIndexedIndirect` over all `maxDrawCount` of them - the unused ones draw no indices, which is cheap but not free. Without the
+// `multiDrawIndirect` feature (where `maxDrawIndirectCount` is 1) that's one draw call per command, so it's really only there to stay correct.
+//
+// CAREFUL: The draw count (and the commands, for the fallback) get zeroed with `vkCmdFillBuffer`, so they need
+// `VK_BUFFER_USAGE_TRANSFER_DST_BIT` as well as storage & indirect. As with our other compute passes there's no barrier after the dispatch:
+// use `recordComputeToComputeBarrier` (or a render graph) between culling and the draws.
+// Note: Every dispatch gets its own descriptor set - call `resetDescriptors` to hand them all back.
+class GpuCulling
+{
+public:
+
+	static constexpr uint32_t WorkgroupSize = 64;
+
+	// Method to load `gpu_cull.spv` & `gpu_cull_occlusion.spv` from `shaderDirectory` and create their pipelines, a sampler for the depth
+	// pyramid, and a descriptor pool with enough sets for `maxDispatchesPerReset` dispatches. `maxDrawIndirectCount` is the device limit of
+	// the same name. Returns false (having cleaned up after itself) if anything's missing or fails.
+	bool create(VkDevice logicalDevice, uint32_t maxDrawIndirectCount, const string& shaderDirectory = "shaders/spv", uint32_t maxDispatchesPerReset = 64,
+		ObjectCache* objectCache = nullptr)
+	{
+		device = logicalDevice;
+		cache = objectCache;
+		maxIndirectDraws = std::max(maxDrawIndirectCount, 1u);
+
+		if (!cullTemplate.create(device, objectCache) || !occlusionCullTemplate.create(device, objectCache) ||
+			!cullPipeline.createFromFile(device, shaderDirectory + "/gpu_cull.spv", cullTemplate.SetLayout, sizeof(CullPushConstants), {}, objectCache) ||
+			!occlusionCullPipeline.createFromFile(device, shaderDirectory + "/gpu_cull_occlusion.spv", occlusionCullTemplate.SetLayout, sizeof(CullPushConstants), {}, objectCache))
+		{
+			destroy();
+			return false;
+		}
+
+		pyramidSampler = createNearestSampler(device, cache);
+		if (pyramidSampler == VK_NULL_HANDLE)
+		{
+			destroy();
+			return false;
+		}
+
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		DescriptorSetTemplate<OcclusionCullDescriptors>::addPoolSizes(poolSizes, maxDispatchesPerReset);
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.pNext = nullptr;
+		poolCreateInfo.flags = 0;
+		poolCreateInfo.maxSets = maxDispatchesPerReset;
+		poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolCreateInfo.pPoolSizes = poolSizes.data();
+		const VkResult result = VulkanFunctionLoaders::vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &descriptorPool);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create GPU culling descriptor pool. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			descriptorPool = VK_NULL_HANDLE;
+			destroy();
+			return false;
+		}
+
+		LOG_VERBOSE("[OK] Loaded GPU culling from: {} (draws with {})", shaderDirectory,
+			VulkanFunctionLoaders::vkCmdDrawIndexedIndirectCountKHR != nullptr ? "vkCmdDrawIndexedIndirectCountKHR" : "vkCmdDrawIndexedIndirect over zeroed commands");
+		return true;
+	}
+
+	// The most instances one dispatch can cull (a workgroup per 64, and there can only be so many workgroups)
+	static constexpr uint32_t getMaxInstanceCount() { return MaxWorkgroupCount * WorkgroupSize; }
+
+	// Whether draws of up to `maxDrawCount` commands go through `vkCmdDrawIndexedIndirectCount` - if not, see the fallback above
+	bool usesDrawCount(uint32_t maxDrawCount) const
+	{
+		return VulkanFunctionLoaders::vkCmdDrawIndexedIndirectCountKHR != nullptr && maxDrawCount <= maxIndirectDraws;
+	}
+
+	// Method to hand back every descriptor set our dispatches have used since the last reset.
+	// CAREFUL: The GPU must be finished with everything recorded since then!
+	void resetDescriptors()
+	{
+		if (descriptorPool != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkResetDescriptorPool(device, descriptorPool, 0); }
+	}
+
+	// Method to record frustum culling the first `instanceCount` instances in `buffers.Instances` against the `CullView` in `buffers.View`,
+	// writing a command for each survivor to `buffers.Commands` and how many there were to the uint at the start of `buffers.DrawCount`.
+	// `buffers.Commands` has room for `maxDrawCount` commands: survivors past that are counted but not written (and not drawn - the count
+	// `recordDraws` uses is clamped to `maxDrawCount`). Returns false if `instanceCount` is over `getMaxInstanceCount` or we've run out of
+	// descriptor sets.
+	bool recordCull(VkCommandBuffer commandBuffer, const CullDescriptors& buffers, uint32_t instanceCount, uint32_t maxDrawCount)
+	{
+		if (!checkCount(instanceCount)) { return false; }
+		const VkDescriptorSet set = allocateSet(cullTemplate.SetLayout);
+		if (set == VK_NULL_HANDLE) { return false; }
+		cullTemplate.update(set, buffers);
+		recordClear(commandBuffer, buffers.Commands, buffers.DrawCount, maxDrawCount);
+		recordDispatch(commandBuffer, cullPipeline, set, instanceCount, maxDrawCount);
+		return true;
+	}
+
+	// Method to record frustum AND occlusion culling: as `recordCull`, but instances are also dropped if they're hidden behind what's in
+	// `depthPyramid` - a min/max depth pyramid (R = nearest, G = farthest) of a depth buffer drawn with the same view-projection, in
+	// `pyramidLayout`. `buffers.View` needs the pyramid's size & level count (see `makeCullView`).
+	bool recordOcclusionCull(VkCommandBuffer commandBuffer, const CullDescriptors& buffers, VkImageView depthPyramid, uint32_t instanceCount, uint32_t maxDrawCount,
+		VkImageLayout pyramidLayout = VK_IMAGE_LAYOUT_GENERAL)
+	{
+		if (!checkCount(instanceCount)) { return false; }
+		const VkDescriptorSet set = allocateSet(occlusionCullTemplate.SetLayout);
+		if (set == VK_NULL_HANDLE) { return false; }
+		occlusionCullTemplate.update(set, { buffers.Instances, buffers.Meshes, buffers.View, buffers.Commands, buffers.DrawCount, { pyramidSampler, depthPyramid, pyramidLayout } });
+		recordClear(commandBuffer, buffers.Commands, buffers.DrawCount, maxDrawCount);
+		recordDispatch(commandBuffer, occlusionCullPipeline, set, instanceCount, maxDrawCount);
+		return true;
+	}
+
+	// Method to record drawing the commands a cull wrote - inside a render pass, with a graphics pipeline, vertex & index buffers bound.
+	// `commands` & `drawCount` are the buffers (and offsets) that were `buffers.Commands` & `buffers.DrawCount` for the cull, and
+	// `maxDrawCount` must be the same too.
+	void recordDraws(VkCommandBuffer commandBuffer, VkBuffer commands, VkDeviceSize commandsOffset, VkBuffer drawCount, VkDeviceSize drawCountOffset, uint32_t maxDrawCount) const
+	{
+		const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+		if (usesDrawCount(maxDrawCount))
+		{
+			VulkanFunctionLoaders::vkCmdDrawIndexedIndirectCountKHR(commandBuffer, commands, commandsOffset, drawCount, drawCountOffset, maxDrawCount, stride);
+			return;
+		}
+		for (uint32_t first = 0; first < maxDrawCount; first += maxIndirectDraws)
+		{
+			VulkanFunctionLoaders::vkCmdDrawIndexedIndirect(commandBuffer, commands, commandsOffset + static_cast<VkDeviceSize>(first) * stride,
+				std::min(maxIndirectDraws, maxDrawCount - first), stride);
+		}
+	}
+
+	// CAREFUL: The GPU must be finished with everything we've recorded before we call this!
+	void destroy()
+	{
+		if (descriptorPool != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+			descriptorPool = VK_NULL_HANDLE;
+		}
+		destroyNearestSampler(device, cache, pyramidSampler);
+		cullPipeline.destroy();
+		occlusionCullPipeline.destroy();
+		cullTemplate.destroy();
+		occlusionCullTemplate.destroy();
+		cache = nullptr;
+	}
+
+private:
+
+	// Must match the `push_constant` block in `gpu_cull.comp`
+	struct CullPushConstants { uint32_t InstanceCount; uint32_t MaxDrawCount; };
+
+	// Note: 65535 is the least `maxComputeWorkGroupCount` every device has to support
+	static constexpr uint32_t MaxWorkgroupCount = 65535;
+
+	static bool checkCount(uint32_t instanceCount)
+	{
+		if (instanceCount > getMaxInstanceCount())
+		{
+			LOG_ERROR("[FAIL] Can't cull {} instances in one dispatch - the most we can is {}.", instanceCount, getMaxInstanceCount());
+			return false;
+		}
+		return true;
+	}
+
+	// Method to record zeroing the draw count - and the commands too, if `recordDraws` is going to draw all `maxDrawCount` of them
+	void recordClear(VkCommandBuffer commandBuffer, const VkDescriptorBufferInfo& commands, const VkDescriptorBufferInfo& drawCount, uint32_t maxDrawCount)
+	{
+		// Whatever read these last (an earlier cull or draw) must be done with them before we clear them
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.pNext = nullptr;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+			&memoryBarrier, 0, nullptr, 0, nullptr);
+
+		VulkanFunctionLoaders::vkCmdFillBuffer(commandBuffer, drawCount.buffer, drawCount.offset, sizeof(uint32_t), 0);
+		if (!usesDrawCount(maxDrawCount) && maxDrawCount > 0)
+		{
+			VulkanFunctionLoaders::vkCmdFillBuffer(commandBuffer, commands.buffer, commands.offset, static_cast<VkDeviceSize>(maxDrawCount) * sizeof(VkDrawIndexedIndirectCommand), 0);
+		}
+
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	static void recordDispatch(VkCommandBuffer commandBuffer, const ComputePipeline& pipeline, VkDescriptorSet set, uint32_t instanceCount, uint32_t maxDrawCount)
+	{
+		pipeline.bind(commandBuffer, set);
+		pipeline.pushConstants(commandBuffer, CullPushConstants{ instanceCount, maxDrawCount });
+		if (instanceCount > 0) { pipeline.dispatch(commandBuffer, (instanceCount + WorkgroupSize - 1) / WorkgroupSize); }
+	}
+
+	VkDescriptorSet allocateSet(VkDescriptorSetLayout setLayout)
+	{
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.descriptorPool = descriptorPool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &setLayout;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		const VkResult result = VulkanFunctionLoaders::vkAllocateDescriptorSets(device, &allocateInfo, &set);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not allocate a descriptor set for GPU culling - call `resetDescriptors` more often? VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return VK_NULL_HANDLE;
+		}
+		return set;
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	ObjectCache* cache = nullptr;
+	uint32_t maxIndirectDraws = 1;
+	DescriptorSetTemplate<CullDescriptors> cullTemplate;
+	DescriptorSetTemplate<OcclusionCullDescriptors> occlusionCullTemplate;
+	ComputePipeline cullPipeline;
+	ComputePipeline occlusionCullPipeline;
+	VkSampler pyramidSampler = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+};
+
+// Class to draw what `GpuCulling` lets through, depth only, into a depth buffer of its own - the smallest graphics pipeline that consumes
+// the culled commands (`cull_depth.vert`, with no fragment shader), and the depth a Hi-Z pyramid for next frame's occlusion culling is built
+// from. Each instance's mesh is scaled by its bounding sphere's radius & moved to its centre, which come straight from the instance buffer
+// as a per-instance vertex attribute.
+//
+// The render pass leaves layouts alone - the depth buffer must be in `VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL` before it starts and
+// stays there (i.e., use it as `ResourceUsage::DepthAttachmentWrite` in a render graph) - and it's cleared to 1 (the far plane) each time.
+// Note: Needs a graphics queue, and the `drawIndirectFirstInstance` feature for the per-instance attributes to line up.
+class CulledDepthRenderer
+{
+public:
+	RenderTarget Depth;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+
+	// Method to create the depth buffer (`VK_FORMAT_D32_SFLOAT`, or `VK_FORMAT_D16_UNORM` where that can't be sampled as well as drawn into),
+	// render pass, framebuffer & pipeline. The depth buffer can also be copied from and sampled. Returns false (having cleaned up after
+	// itself) if the device is missing anything we need or something fails.
+	bool create(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, const VkPhysicalDeviceMemoryProperties& memoryProperties, const VkPhysicalDeviceFeatures& enabledFeatures,
+		uint32_t width, uint32_t height, const string& shaderDirectory = "shaders/spv")
+	{
+		device = logicalDevice;
+		Width = width;
+		Height = height;
+		if (enabledFeatures.drawIndirectFirstInstance != VK_TRUE)
+		{
+			LOG_WARNING("[WARNING] Can't draw culled instances - the device doesn't have the `drawIndirectFirstInstance` feature.");
+			return false;
+		}
+
+		const VkFormat depthFormat = findSampledDepthFormat(physicalDevice);
+		if (!Depth.create(device, memoryProperties, depthFormat, width, height, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, false))
+		{
+			destroy();
+			return false;
+		}
+
+		VkAttachmentDescription attachment = {};
+		attachment.flags = 0;
+		attachment.format = depthFormat;
+		attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		const VkAttachmentReference depthReference = { 0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+		VkSubpassDescription subpass = {};
+		subpass.flags = 0;
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 0;
+		subpass.pColorAttachments = nullptr;
+		subpass.pDepthStencilAttachment = &depthReference;
+
+		// Note: No subpass dependencies - whoever records us puts the barriers either side (e.g., a render graph)
+		VkRenderPassCreateInfo renderPassCreateInfo = {};
+		renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassCreateInfo.pNext = nullptr;
+		renderPassCreateInfo.flags = 0;
+		renderPassCreateInfo.attachmentCount = 1;
+		renderPassCreateInfo.pAttachments = &attachment;
+		renderPassCreateInfo.subpassCount = 1;
+		renderPassCreateInfo.pSubpasses = &subpass;
+		renderPassCreateInfo.dependencyCount = 0;
+		renderPassCreateInfo.pDependencies = nullptr;
+		VkResult result = VulkanFunctionLoaders::vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, &renderPass);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create depth-only render pass. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			renderPass = VK_NULL_HANDLE;
+			destroy();
+			return false;
+		}
+
+		VkFramebufferCreateInfo framebufferCreateInfo = {};
+		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferCreateInfo.pNext = nullptr;
+		framebufferCreateInfo.flags = 0;
+		framebufferCreateInfo.renderPass = renderPass;
+		framebufferCreateInfo.attachmentCount = 1;
+		framebufferCreateInfo.pAttachments = &Depth.View;
+		framebufferCreateInfo.width = width;
+		framebufferCreateInfo.height = height;
+		framebufferCreateInfo.layers = 1;
+		result = VulkanFunctionLoaders::vkCreateFramebuffer(device, &framebufferCreateInfo, nullptr, &framebuffer);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create depth-only framebuffer. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			framebuffer = VK_NULL_HANDLE;
+			destroy();
+			return false;
+		}
+
+		if (!createPipeline(shaderDirectory))
+		{
+			destroy();
+			return false;
+		}
+		LOG_VERBOSE("[OK] Created {}x{} culled depth renderer ({}).", width, height, depthFormat == VK_FORMAT_D32_SFLOAT ? "D32_SFLOAT" : "D16_UNORM");
+		return true;
+	}
+
+	// Method to record drawing the commands from a cull (see `GpuCulling::recordDraws` for what `commands`, `drawCount` & `maxDrawCount` are)
+	// into our depth buffer, with the mesh `vertices` (xyz floats), `indices` (uint32) & `instances` (`CullInstance`s) the cull used.
+	void record(VkCommandBuffer commandBuffer, const GpuCulling& culling, const Matrix4& viewProjection, VkBuffer vertices, VkBuffer indices, VkBuffer instances,
+		VkBuffer commands, VkBuffer drawCount, uint32_t maxDrawCount) const
+	{
+		VkClearValue clearValue = {};
+		clearValue.depthStencil = { 1.0f, 0 };
+		VkRenderPassBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		beginInfo.pNext = nullptr;
+		beginInfo.renderPass = renderPass;
+		beginInfo.framebuffer = framebuffer;
+		beginInfo.renderArea = { { 0, 0 }, { Width, Height } };
+		beginInfo.clearValueCount = 1;
+		beginInfo.pClearValues = &clearValue;
+		VulkanFunctionLoaders::vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		VulkanFunctionLoaders::vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		VulkanFunctionLoaders::vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Matrix4), viewProjection.data());
+		const VkBuffer vertexBuffers[2] = { vertices, instances };
+		const VkDeviceSize vertexOffsets[2] = { 0, 0 };
+		VulkanFunctionLoaders::vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, vertexOffsets);
+		VulkanFunctionLoaders::vkCmdBindIndexBuffer(commandBuffer, indices, 0, VK_INDEX_TYPE_UINT32);
+		culling.recordDraws(commandBuffer, commands, 0, drawCount, 0, maxDrawCount);
+
+		VulkanFunctionLoaders::vkCmdEndRenderPass(commandBuffer);
+	}
+
+	// CAREFUL: The GPU must be finished with everything we've recorded before we call this!
+	void destroy()
+	{
+		if (pipeline != VK_NULL_HANDLE)       { VulkanFunctionLoaders::vkDestroyPipeline(device, pipeline, nullptr); }
+		if (pipelineLayout != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkDestroyPipelineLayout(device, pipelineLayout, nullptr); }
+		if (framebuffer != VK_NULL_HANDLE)    { VulkanFunctionLoaders::vkDestroyFramebuffer(device, framebuffer, nullptr); }
+		if (renderPass != VK_NULL_HANDLE)     { VulkanFunctionLoaders::vkDestroyRenderPass(device, renderPass, nullptr); }
+		pipeline = VK_NULL_HANDLE;
+		pipelineLayout = VK_NULL_HANDLE;
+		framebuffer = VK_NULL_HANDLE;
+		renderPass = VK_NULL_HANDLE;
+		if (device != VK_NULL_HANDLE) { Depth.destroy(device); }
+	}
+
+private:
+
+	bool createPipeline(const string& shaderDirectory)
+	{
+		std::vector<uint32_t> code;
+		if (!loadSpirvFile(shaderDirectory + "/cull_depth_vert.spv", code)) { return false; }
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(Matrix4);
+		VkPipelineLayoutCreateInfo layoutCreateInfo = {};
+		layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutCreateInfo.pNext = nullptr;
+		layoutCreateInfo.flags = 0;
+		layoutCreateInfo.setLayoutCount = 0;
+		layoutCreateInfo.pSetLayouts = nullptr;
+		layoutCreateInfo.pushConstantRangeCount = 1;
+		layoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+		VkResult result = VulkanFunctionLoaders::vkCreatePipelineLayout(device, &layoutCreateInfo, nullptr, &pipelineLayout);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create depth-only pipeline layout. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			pipelineLayout = VK_NULL_HANDLE;
+			return false;
+		}
+
+		VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+		shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		shaderModuleCreateInfo.pNext = nullptr;
+		shaderModuleCreateInfo.flags = 0;
+		shaderModuleCreateInfo.codeSize = code.size() * sizeof(uint32_t);
+		shaderModuleCreateInfo.pCode = code.data();
+		VkShaderModule shaderModule = VK_NULL_HANDLE;
+		result = VulkanFunctionLoaders::vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr, &shaderModule);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create depth-only vertex shader module. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+
+		// Note: Depth only, so there's just a vertex shader - with no fragment shader, rasterisation still writes depth
+		VkPipelineShaderStageCreateInfo stage = {};
+		stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stage.pNext = nullptr;
+		stage.flags = 0;
+		stage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+		stage.module = shaderModule;
+		stage.pName = "main";
+		stage.pSpecializationInfo = nullptr;
+
+		// Binding 0 is the mesh positions, binding 1 the instances - of which only the bounding sphere gets read
+		const VkVertexInputBindingDescription bindings[2] = {
+			{ 0, 3 * sizeof(float), VK_VERTEX_INPUT_RATE_VERTEX },
+			{ 1, sizeof(CullInstance), VK_VERTEX_INPUT_RATE_INSTANCE } };
+		const VkVertexInputAttributeDescription attributes[2] = {
+			{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 },
+			{ 1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0 } };
+		VkPipelineVertexInputStateCreateInfo vertexInput = {};
+		vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInput.pNext = nullptr;
+		vertexInput.flags = 0;
+		vertexInput.vertexBindingDescriptionCount = 2;
+		vertexInput.pVertexBindingDescriptions = bindings;
+		vertexInput.vertexAttributeDescriptionCount = 2;
+		vertexInput.pVertexAttributeDescriptions = attributes;
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.pNext = nullptr;
+		inputAssembly.flags = 0;
+		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+		const VkViewport viewport = { 0.0f, 0.0f, static_cast<float>(Width), static_cast<float>(Height), 0.0f, 1.0f };
+		const VkRect2D scissor = { { 0, 0 }, { Width, Height } };
+		VkPipelineViewportStateCreateInfo viewportState = {};
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.pNext = nullptr;
+		viewportState.flags = 0;
+		viewportState.viewportCount = 1;
+		viewportState.pViewports = &viewport;
+		viewportState.scissorCount = 1;
+		viewportState.pScissors = &scissor;
+
+		// Note: No face culling - the y-flipped projection turns windings around, and for depth alone it doesn't matter which faces we keep
+		VkPipelineRasterizationStateCreateInfo rasterization = {};
+		rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterization.pNext = nullptr;
+		rasterization.flags = 0;
+		rasterization.depthClampEnable = VK_FALSE;
+		rasterization.rasterizerDiscardEnable = VK_FALSE;
+		rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterization.cullMode = VK_CULL_MODE_NONE;
+		rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		rasterization.depthBiasEnable = VK_FALSE;
+		rasterization.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo multisample = {};
+		multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisample.pNext = nullptr;
+		multisample.flags = 0;
+		multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		multisample.sampleShadingEnable = VK_FALSE;
+
+		VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+		depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthStencil.pNext = nullptr;
+		depthStencil.flags = 0;
+		depthStencil.depthTestEnable = VK_TRUE;
+		depthStencil.depthWriteEnable = VK_TRUE;
+		depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+		depthStencil.depthBoundsTestEnable = VK_FALSE;
+		depthStencil.stencilTestEnable = VK_FALSE;
+		depthStencil.minDepthBounds = 0.0f;
+		depthStencil.maxDepthBounds = 1.0f;
+
+		VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineCreateInfo.pNext = nullptr;
+		pipelineCreateInfo.flags = 0;
+		pipelineCreateInfo.stageCount = 1;
+		pipelineCreateInfo.pStages = &stage;
+		pipelineCreateInfo.pVertexInputState = &vertexInput;
+		pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
+		pipelineCreateInfo.pTessellationState = nullptr;
+		pipelineCreateInfo.pViewportState = &viewportState;
+		pipelineCreateInfo.pRasterizationState = &rasterization;
+		pipelineCreateInfo.pMultisampleState = &multisample;
+		pipelineCreateInfo.pDepthStencilState = &depthStencil;
+		pipelineCreateInfo.pColorBlendState = nullptr; // Note: Allowed as the subpass has no colour attachments
+		pipelineCreateInfo.pDynamicState = nullptr;
+		pipelineCreateInfo.layout = pipelineLayout;
+		pipelineCreateInfo.renderPass = renderPass;
+		pipelineCreateInfo.subpass = 0;
+		pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineCreateInfo.basePipelineIndex = -1;
+		result = VulkanFunctionLoaders::vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+		VulkanFunctionLoaders::vkDestroyShaderModule(device, shaderModule, nullptr);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create depth-only graphics pipeline. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			pipeline = VK_NULL_HANDLE;
+			return false;
+		}
+		return true;
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+};
+
+// Method to check the commands a GPU cull wrote against a cull of the same instances on the CPU. The GPU's order doesn't matter, and nor
+// do instances within a hair of a frustum plane (which rounding may put on either side) - but every command must draw one instance that's
+// (near enough) visible, with its mesh's indices, no instance may be drawn twice, and every instance that's clearly visible must be drawn.
+inline bool checkGpuCulling(const CullView& view, const CullInstance* instances, uint32_t instanceCount, const std::vector<CullMesh>& meshes,
+	const VkDrawIndexedIndirectCommand* commands, uint32_t drawCount)
+{
+	constexpr float EdgeSlack = 1.0e-3f;
+	if (drawCount > instanceCount) { return false; }
+	std::vector<uint8_t> drawn(instanceCount, 0);
+	for (uint32_t i = 0; i < drawCount; ++i)
+	{
+		const VkDrawIndexedIndirectCommand& command = commands[i];
+		if (command.firstInstance >= instanceCount || drawn[command.firstInstance] != 0) { return false; }
+		drawn[command.firstInstance] = 1;
+		const CullInstance& instance = instances[command.firstInstance];
+		const CullMesh& mesh = meshes[instance.MeshIndex];
+		if (command.instanceCount != 1 || command.indexCount != mesh.IndexCount || command.firstIndex != mesh.FirstIndex || command.vertexOffset != mesh.VertexOffset ||
+			!isSphereInFrustum(view, instance, EdgeSlack))
+		{
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < instanceCount; ++i)
+	{
+		if (drawn[i] == 0 && isSphereInFrustum(view, instances[i], -EdgeSlack)) { return false; }
+	}
+	return true;
+}
+
+// A self-checking workload for `GpuCulling`: frustum culls a `generateCullingScene` of `instanceCount` instances on the GPU into indirect draw
+// commands and checks them against the CPU (see `checkGpuCulling`). Given a `CulledDepthRenderer` (which needs a graphics queue) it also
+// draws the commands - straight from the cull, with nothing coming back to the CPU in between - then reads the depth buffer back and checks
+// the scene's big instance in the middle of the screen got drawn.
+inline BatchWorkload makeGpuCullingWorkload(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, GpuCulling& culling, const CulledDepthRenderer* renderer,
+	uint32_t instanceCount)
+{
+	struct CullingState
+	{
+		VkDevice Device = VK_NULL_HANDLE;
+		CullingScene Scene;
+		CullView View = {};
+		GpuBuffer Instances;
+		GpuBuffer Meshes;
+		GpuBuffer ViewBuffer;
+		GpuBuffer Commands;
+		GpuBuffer DrawCount;
+		GpuBuffer Vertices;
+		GpuBuffer Indices;
+		GpuBuffer DepthReadback;
+		~CullingState()
+		{
+			Instances.destroy(Device); Meshes.destroy(Device); ViewBuffer.destroy(Device); Commands.destroy(Device); DrawCount.destroy(Device);
+			Vertices.destroy(Device); Indices.destroy(Device); DepthReadback.destroy(Device);
+		}
+	};
+	auto state = std::make_shared<CullingState>();
+	state->Device = device;
+
+	BatchWorkload workload;
+	workload.Name = renderer != nullptr ? "gpu-culling-draw" : "gpu-culling";
+	workload.Record = [state, memoryProperties, &culling, renderer, instanceCount](VkCommandBuffer commandBuffer)
+	{
+		const uint32_t depthTexelSize = renderer != nullptr && renderer->Depth.Format == VK_FORMAT_D16_UNORM ? 2 : 4;
+		if (state->Instances.Buffer == VK_NULL_HANDLE)
+		{
+			const float aspectRatio = renderer != nullptr ? static_cast<float>(renderer->Width) / static_cast<float>(renderer->Height) : 16.0f / 9.0f;
+			state->Scene = generateCullingScene(instanceCount, aspectRatio);
+			state->View = makeCullView(state->Scene.ViewProjection);
+			const CullingScene& scene = state->Scene;
+
+			const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			const VkBufferUsageFlags indirect = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			const VkDeviceSize readbackSize = renderer != nullptr ? static_cast<VkDeviceSize>(renderer->Width) * renderer->Height * depthTexelSize : 4;
+			if (!state->Instances.create(state->Device, memoryProperties, std::max<VkDeviceSize>(scene.Instances.size(), 1) * sizeof(CullInstance),
+					VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, hostVisible, true) ||
+				!state->Meshes.create(state->Device, memoryProperties, scene.Meshes.size() * sizeof(CullMesh), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->ViewBuffer.create(state->Device, memoryProperties, sizeof(CullView), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible, true) ||
+				!state->Commands.create(state->Device, memoryProperties, std::max<VkDeviceSize>(instanceCount, 1) * sizeof(VkDrawIndexedIndirectCommand), indirect, hostVisible, true) ||
+				!state->DrawCount.create(state->Device, memoryProperties, sizeof(uint32_t), indirect, hostVisible, true) ||
+				!state->Vertices.create(state->Device, memoryProperties, scene.Vertices.size() * sizeof(float), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, hostVisible, true) ||
+				!state->Indices.create(state->Device, memoryProperties, scene.Indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, hostVisible, true) ||
+				!state->DepthReadback.create(state->Device, memoryProperties, readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostVisible, true))
+			{
+				return false;
+			}
+			std::memcpy(state->Instances.Mapped, scene.Instances.data(), scene.Instances.size() * sizeof(CullInstance));
+			std::memcpy(state->Meshes.Mapped, scene.Meshes.data(), scene.Meshes.size() * sizeof(CullMesh));
+			std::memcpy(state->ViewBuffer.Mapped, &state->View, sizeof(CullView));
+			std::memcpy(state->Vertices.Mapped, scene.Vertices.data(), scene.Vertices.size() * sizeof(float));
+			std::memcpy(state->Indices.Mapped, scene.Indices.data(), scene.Indices.size() * sizeof(uint32_t));
+		}
+
+		RenderGraph graph;
+		const RenderGraphResource instances = graph.importBuffer("Instances", state->Instances.Buffer);
+		const RenderGraphResource meshes = graph.importBuffer("Meshes", state->Meshes.Buffer);
+		const RenderGraphResource view = graph.importBuffer("View", state->ViewBuffer.Buffer);
+		const RenderGraphResource commands = graph.importBuffer("Draw commands", state->Commands.Buffer);
+		const RenderGraphResource drawCount = graph.importBuffer("Draw count", state->DrawCount.Buffer);
+		bool recorded = false;
+		graph.addPass("GPU culling", [state, &culling, &recorded, instanceCount](VkCommandBuffer cb)
+		{
+			const CullDescriptors buffers = { { state->Instances.Buffer, 0, VK_WHOLE_SIZE }, { state->Meshes.Buffer, 0, VK_WHOLE_SIZE }, { state->ViewBuffer.Buffer, 0, VK_WHOLE_SIZE },
+				{ state->Commands.Buffer, 0, VK_WHOLE_SIZE }, { state->DrawCount.Buffer, 0, VK_WHOLE_SIZE } };
+			recorded = culling.recordCull(cb, buffers, instanceCount, instanceCount);
+		}).read(instances, ResourceUsage::ComputeShaderRead).read(meshes, ResourceUsage::ComputeShaderRead).read(view, ResourceUsage::UniformBufferRead)
+			.write(commands, ResourceUsage::ComputeShaderWrite).write(drawCount, ResourceUsage::ComputeShaderWrite);
+		graph.markOutput(commands, ResourceUsage::HostRead);
+		graph.markOutput(drawCount, ResourceUsage::HostRead);
+
+		if (renderer != nullptr)
+		{
+			const RenderGraphResource vertices = graph.importBuffer("Vertices", state->Vertices.Buffer);
+			const RenderGraphResource indices = graph.importBuffer("Indices", state->Indices.Buffer);
+			const RenderGraphResource depth = graph.importImage("Depth", renderer->Depth.Image, VK_IMAGE_ASPECT_DEPTH_BIT);
+			const RenderGraphResource readback = graph.importBuffer("Depth readback", state->DepthReadback.Buffer);
+			graph.addPass("Depth prepass", [state, &culling, renderer, instanceCount](VkCommandBuffer cb)
+			{
+				renderer->record(cb, culling, state->Scene.ViewProjection, state->Vertices.Buffer, state->Indices.Buffer, state->Instances.Buffer, state->Commands.Buffer,
+					state->DrawCount.Buffer, instanceCount);
+			}).read(vertices, ResourceUsage::VertexBufferRead).read(instances, ResourceUsage::VertexBufferRead).read(indices, ResourceUsage::IndexBufferRead)
+				.read(commands, ResourceUsage::IndirectBufferRead).read(drawCount, ResourceUsage::IndirectBufferRead).write(depth, ResourceUsage::DepthAttachmentWrite);
+			graph.addPass("Depth readback", [state, renderer](VkCommandBuffer cb)
+			{
+				VkBufferImageCopy region = {};
+				region.bufferOffset = 0;
+				region.bufferRowLength = 0;
+				region.bufferImageHeight = 0;
+				region.imageSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 };
+				region.imageOffset = { 0, 0, 0 };
+				region.imageExtent = { renderer->Width, renderer->Height, 1 };
+				VulkanFunctionLoaders::vkCmdCopyImageToBuffer(cb, renderer->Depth.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, state->DepthReadback.Buffer, 1, &region);
+			}).read(depth, ResourceUsage::TransferRead).write(readback, ResourceUsage::TransferWrite);
+			graph.markOutput(readback, ResourceUsage::HostRead);
+		}
+
+		if (!graph.compile()) { return false; }
+		graph.execute(commandBuffer);
+		return recorded;
+	};
+	workload.Verify = [state, renderer, instanceCount]()
+	{
+		const uint32_t drawCount = *static_cast<const uint32_t*>(state->DrawCount.Mapped);
+		if (!checkGpuCulling(state->View, state->Scene.Instances.data(), instanceCount, state->Scene.Meshes, static_cast<const VkDrawIndexedIndirectCommand*>(state->Commands.Mapped),
+			drawCount))
+		{
+			return false;
+		}
+		if (renderer == nullptr) { return true; }
+
+		// The big instance straight ahead covers the middle of the screen, so the depth there must be nearer than the far plane
+		const size_t centre = static_cast<size_t>(renderer->Height / 2) * renderer->Width + renderer->Width / 2;
+		const float centreDepth = renderer->Depth.Format == VK_FORMAT_D16_UNORM ? static_cast<const uint16_t*>(state->DepthReadback.Mapped)[centre] / 65535.0f :
+			static_cast<const float*>(state->DepthReadback.Mapped)[centre];
+		return centreDepth < 1.0f;
+	};
+	return workload;
+}
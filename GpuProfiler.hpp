@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+
+// Accumulated GPU timings for all zones that share a name
+struct GpuZoneStats
+{
+	uint64_t Count = 0;
+	double TotalMilliseconds = 0.0;
+	double MinMilliseconds = 0.0;
+	double MaxMilliseconds = 0.0;
+	double LastMilliseconds = 0.0;
+
+	double averageMilliseconds() const { return Count > 0 ? TotalMilliseconds / static_cast<double>(Count) : 0.0; }
+};
+
+// A single resolved zone - as well as its duration we keep the raw (masked) start & end ticks so that others (e.g., a trace exporter)
+// can place the zone on a timeline.
+struct GpuZoneResult
+{
+	string Name;
+	uint64_t StartTicks = 0;
+	uint64_t EndTicks = 0;
+	double Milliseconds = 0.0;
+};
+
+// Class to time regions ("zones") of command buffers on the GPU using timestamp queries.
+//
+// We keep one `VkQueryPool` per frame-in-flight. When a frame slot comes back around in `beginFrame` we read whatever it recorded last
+// time WITHOUT waiting (`VK_QUERY_RESULT_WITH_AVAILABILITY_BIT` rather than `VK_QUERY_RESULT_WAIT_BIT`) - so as long as the caller has
+// waited on that frame's fence (which they must have done to re-use its command buffers anyway) the results are simply there, and if
+// they aren't we drop them rather than stall the CPU.
+//
+// Note: Timestamp ticks are converted to nanoseconds using `VkPhysicalDeviceLimits::timestampPeriod`, and only the low
+// `timestampValidBits` of each value are meaningful - so we mask differences with that to survive the counter wrapping.
+// See: https://registry.khronos.org/vulkan/specs/1.3-extensions/html/vkspec.html#queries-timestamps
+class GpuProfiler
+{
+public:
+
+	// Method to create the profiler. Returns false if the queue family can't do timestamps (i.e., `timestampValidBits` is 0).
+	bool create(VkDevice logicalDevice, float timestampPeriodNs, uint32_t timestampValidBits, uint32_t numFramesInFlight = 2, uint32_t maxZonesPerFrame = 256)
+	{
+		if (timestampValidBits == 0)
+		{
+			LOG_WARNING("[WARNING] Active queue family does not support timestamps - GPU profiling is disabled.");
+			return false;
+		}
+
+		device = logicalDevice;
+		timestampPeriod = timestampPeriodNs;
+		validBitsMask = timestampValidBits >= 64 ? UINT64_MAX : ((uint64_t(1) << timestampValidBits) - 1);
+		maxZones = maxZonesPerFrame;
+
+		VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+		queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCreateInfo.pNext = nullptr;
+		queryPoolCreateInfo.flags = 0;
+		queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCreateInfo.queryCount = maxZones * 2; // A begin & end timestamp per zone
+		queryPoolCreateInfo.pipelineStatistics = 0;
+
+		frames.resize(numFramesInFlight);
+		for (auto& frame : frames)
+		{
+			const VkResult result = VulkanFunctionLoaders::vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &frame.QueryPool);
+			if (result != VK_SUCCESS)
+			{
+				LOG_ERROR("[FAIL] Could not create timestamp query pool. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+				destroy();
+				return false;
+			}
+		}
+		readbackScratch.resize(maxZones * 2 * 2); // Each query gives us a value AND an availability word
+		return true;
+	}
+
+	// Method to start a new frame. Must be recorded into the first command buffer of the frame (outside of any render pass) - it reads
+	// back the results this frame slot recorded last time around and then resets its queries ready for re-use.
+	void beginFrame(VkCommandBuffer commandBuffer)
+	{
+		if (frames.empty()) { return; }
+
+		currentFrame = (currentFrame + 1) % static_cast<uint32_t>(frames.size());
+		FrameQueries& frame = frames[currentFrame];
+		latestResults.clear();
+		resolveFrame(frame);
+
+		VulkanFunctionLoaders::vkCmdResetQueryPool(commandBuffer, frame.QueryPool, 0, maxZones * 2);
+		frame.Zones.clear();
+	}
+
+	// Method to open a zone. Returns a handle to pass to `endZone`, or UINT32_MAX if this frame has run out of zones (in which case the
+	// zone is silently not timed).
+	// CAREFUL: We keep hold of the `name` pointer until the zone is read back, so it must live at least that long (string literals are ideal).
+	uint32_t beginZone(VkCommandBuffer commandBuffer, const char* name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT)
+	{
+		if (frames.empty()) { return UINT32_MAX; }
+
+		FrameQueries& frame = frames[currentFrame];
+		if (frame.Zones.size() >= maxZones) { return UINT32_MAX; }
+
+		const auto zoneIndex = static_cast<uint32_t>(frame.Zones.size());
+		frame.Zones.push_back({ name, false });
+		VulkanFunctionLoaders::vkCmdWriteTimestamp(commandBuffer, stage, frame.QueryPool, zoneIndex * 2);
+		return zoneIndex;
+	}
+
+	// Method to close a zone opened by `beginZone` (which must have been recorded earlier in submission order)
+	void endZone(VkCommandBuffer commandBuffer, uint32_t zoneIndex, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT)
+	{
+		if (frames.empty() || zoneIndex == UINT32_MAX) { return; }
+
+		FrameQueries& frame = frames[currentFrame];
+		VulkanFunctionLoaders::vkCmdWriteTimestamp(commandBuffer, stage, frame.QueryPool, zoneIndex * 2 + 1);
+		frame.Zones[zoneIndex].Ended = true;
+	}
+
+	// Method to read back every frame slot's results that are ready right now, without waiting. Handy once we know the GPU is idle
+	// (e.g., after waiting on a batch's fence) so we don't have to wait for the slot to come back around in `beginFrame`.
+	void resolve()
+	{
+		latestResults.clear();
+		for (auto& frame : frames) { resolveFrame(frame); }
+	}
+
+	// The zones resolved by the most recent `beginFrame` or `resolve` call
+	const std::vector<GpuZoneResult>& getLatestResults() const { return latestResults; }
+
+	// Per-zone-name statistics accumulated over every resolved frame
+	const std::map<string, GpuZoneStats>& getZoneStats() const { return zoneStats; }
+
+	// Number of zones we had to throw away because their results weren't available when we went to read them
+	uint64_t getDroppedZoneCount() const { return droppedZones; }
+
+	float getTimestampPeriod() const { return timestampPeriod; }
+
+	// Method to write a human-readable table of our accumulated zone timings
+	void printSummary(std::ostream& out) const
+	{
+		out << "----- GPU Profiler Summary (milliseconds) -----\n";
+		out << std::left << std::setw(32) << "Zone" << std::right << std::setw(8) << "Count" << std::setw(12) << "Avg" << std::setw(12) << "Min" << std::setw(12) << "Max" << std::setw(12) << "Total" << '\n';
+		out << std::fixed << std::setprecision(4);
+		for (auto& [name, stats] : zoneStats)
+		{
+			out << std::left << std::setw(32) << name << std::right << std::setw(8) << stats.Count << std::setw(12) << stats.averageMilliseconds()
+				<< std::setw(12) << stats.MinMilliseconds << std::setw(12) << stats.MaxMilliseconds << std::setw(12) << stats.TotalMilliseconds << '\n';
+		}
+		if (droppedZones > 0) { out << "(" << droppedZones << " zone(s) dropped because their results were not ready in time)\n"; }
+		out << std::defaultfloat;
+	}
+
+	void destroy()
+	{
+		for (auto& frame : frames)
+		{
+			if (frame.QueryPool != VK_NULL_HANDLE)
+			{
+				VulkanFunctionLoaders::vkDestroyQueryPool(device, frame.QueryPool, nullptr);
+			}
+		}
+		frames.clear();
+	}
+
+private:
+
+	struct PendingZone
+	{
+		const char* Name;
+		bool Ended;
+	};
+
+	struct FrameQueries
+	{
+		VkQueryPool QueryPool = VK_NULL_HANDLE;
+		std::vector<PendingZone> Zones; // Zones recorded into this frame that we haven't read back yet
+	};
+
+	void resolveFrame(FrameQueries& frame)
+	{
+		if (frame.Zones.empty()) { return; }
+
+		const auto numQueries = static_cast<uint32_t>(frame.Zones.size() * 2);
+
+		// Note: We'll get `VK_NOT_READY` back if ANY query isn't available yet - that's not an error here, as we check each query's
+		// availability word ourselves & only keep the zones whose begin AND end are both available.
+		const VkResult result = VulkanFunctionLoaders::vkGetQueryPoolResults(device, frame.QueryPool, 0, numQueries, numQueries * 2 * sizeof(uint64_t),
+			readbackScratch.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if (result != VK_SUCCESS && result != VK_NOT_READY)
+		{
+			LOG_WARNING("[WARNING] Could not read back GPU timestamps. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			droppedZones += frame.Zones.size();
+			frame.Zones.clear();
+			return;
+		}
+
+		for (size_t i = 0; i < frame.Zones.size(); ++i)
+		{
+			const uint64_t beginTicks = readbackScratch[i * 4 + 0];
+			const bool beginAvailable = readbackScratch[i * 4 + 1] != 0;
+			const uint64_t endTicks = readbackScratch[i * 4 + 2];
+			const bool endAvailable = readbackScratch[i * 4 + 3] != 0;
+			if (!frame.Zones[i].Ended || !beginAvailable || !endAvailable)
+			{
+				++droppedZones;
+				continue;
+			}
+
+			const uint64_t elapsedTicks = (endTicks - beginTicks) & validBitsMask;
+			const double milliseconds = static_cast<double>(elapsedTicks) * timestampPeriod / 1.0e6;
+
+			GpuZoneResult zoneResult;
+			zoneResult.Name = frame.Zones[i].Name;
+			zoneResult.StartTicks = beginTicks & validBitsMask;
+			zoneResult.EndTicks = endTicks & validBitsMask;
+			zoneResult.Milliseconds = milliseconds;
+			latestResults.push_back(zoneResult);
+
+			GpuZoneStats& stats = zoneStats[zoneResult.Name];
+			stats.MinMilliseconds = stats.Count == 0 ? milliseconds : std::min(stats.MinMilliseconds, milliseconds);
+			stats.MaxMilliseconds = stats.Count == 0 ? milliseconds : std::max(stats.MaxMilliseconds, milliseconds);
+			stats.TotalMilliseconds += milliseconds;
+			stats.LastMilliseconds = milliseconds;
+			++stats.Count;
+		}
+		frame.Zones.clear();
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	float timestampPeriod = 1.0f;  // Nanoseconds per timestamp tick
+	uint64_t validBitsMask = UINT64_MAX;
+	uint32_t maxZones = 0;
+	uint32_t currentFrame = 0;
+	uint64_t droppedZones = 0;
+	std::vector<FrameQueries> frames;
+	std::vector<uint64_t> readbackScratch;
+	std::vector<GpuZoneResult> latestResults;
+	std::map<string, GpuZoneStats> zoneStats;
+};
+
+// RAII helper to time everything recorded into a command buffer while it's in scope, for example:
+//     { GpuProfileScope zone(profiler, commandBuffer, "Blur pass"); ...record the blur... }
+class GpuProfileScope
+{
+public:
+	GpuProfileScope(GpuProfiler& gpuProfiler, VkCommandBuffer commandBuffer, const char* name)
+		: profiler(gpuProfiler), zoneCommandBuffer(commandBuffer), zoneIndex(gpuProfiler.beginZone(commandBuffer, name)) {}
+
+	~GpuProfileScope() { profiler.endZone(zoneCommandBuffer, zoneIndex); }
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+	GpuProfiler& profiler;
+	VkCommandBuffer zoneCommandBuffer;
+	uint32_t zoneIndex;
+};
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "TraceRecorder.hpp"
+
+// How long each phase of `HeadlessContext::create` took, in nanoseconds
+struct HeadlessStartupTimings
+{
+	uint64_t LoadLibraryNanoseconds          = 0; // Connecting to the loader library & loading the exported / global functions
+	uint64_t CreateInstanceNanoseconds       = 0; // Creating the instance & loading the instance-level functions
+	uint64_t SelectPhysicalDeviceNanoseconds = 0; // Enumerating physical devices & picking a compute queue family
+	uint64_t CreateDeviceNanoseconds         = 0; // Creating the logical device & loading the device-level functions
+};
+
+// Everything we need to run compute work with no window: the loader library, an instance, physical device 0 and a logical device with a
+// single compute-capable queue (preferring a dedicated compute family). `main` walks through all of this step by step - this is the
+// same thing with none of the commentary, for code that just wants a device (e.g., the benchmarks).
+// Note: No layers, no instance extensions beyond `VK_KHR_get_physical_device_properties2` (if it's there) and only the device extensions
+// we're asked for, so this works on software implementations like lavapipe too.
+struct HeadlessContext
+{
+	LIBRARY_TYPE VulkanLibrary      = nullptr;
+	VkInstance Instance             = VK_NULL_HANDLE;
+	VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+	VkDevice Device                 = VK_NULL_HANDLE;
+	VkQueue Queue                   = VK_NULL_HANDLE;
+	uint32_t QueueFamilyIndex       = UINT32_MAX;
+	uint32_t TimestampValidBits     = 0;
+	VkQueueFlags QueueFlags         = 0;
+	VkPhysicalDeviceProperties Properties = {};
+	uint32_t ApiVersion             = VK_API_VERSION_1_0; // The Vulkan version we can use - the lower of the instance's (1.1 if the loader has it) and the device's
+	VkPhysicalDeviceMemoryProperties MemoryProperties = {};
+	std::vector<const char*> EnabledDeviceExtensions;
+	bool TimelineSemaphoresEnabled  = false; // Set if `VK_KHR_timeline_semaphore` was one of the optional extensions we enabled (see `TimelineSemaphore`)
+	bool Synchronization2Enabled    = false; // Set if `VK_KHR_synchronization2` was one of the optional extensions we enabled (see `RenderGraph`)
+	bool DescriptorUpdateTemplatesEnabled = false; // Set if `VK_KHR_descriptor_update_template` was too (see `DescriptorSetTemplate`)
+	bool HostQueryResetEnabled      = false; // Set if `VK_EXT_host_query_reset` was too (see `QueryManager`)
+	bool PipelineStatisticsQueryEnabled = false; // Set if the device supports the `pipelineStatisticsQuery` feature (we turn it on if so)
+	VkPhysicalDeviceFeatures EnabledFeatures = {}; // The core features we turned on (see `create`)
+	bool StorageBuffer16BitAccessEnabled = false; // Set if `VK_KHR_16bit_storage` was enabled AND the device has `storageBuffer16BitAccess` (see `ComputeKernelLibrary`)
+	bool ShaderFloat16Enabled       = false; // Set if `VK_KHR_shader_float16_int8` was enabled AND the device has `shaderFloat16`
+	HeadlessStartupTimings Timings;
+
+	// Method to bring everything up. Any of `optionalDeviceExtensions` that the device supports get enabled (see `EnabledDeviceExtensions`).
+	// Returns false (and cleans up after itself) if any step fails.
+	bool create(const char* applicationName, const std::vector<const char*>& optionalDeviceExtensions = {})
+	{
+		// ----- Loader library & global functions -----
+		uint64_t phaseStart = TraceRecorder::nowNanoseconds();
+		if (!ConnectWithVulkanLoaderLibrary(VulkanLibrary))
+		{
+			LOG_ERROR("[FAIL] Could not connect to Vulkan loader library.");
+			return false;
+		}
+		if (!VulkanFunctionLoaders::LoadFunctionExportedFromVulkanLoaderLibrary(VulkanLibrary) || !VulkanFunctionLoaders::LoadVulkanGlobalFunctions())
+		{
+			LOG_ERROR("[FAIL] Could not load Vulkan exported / global functions.");
+			destroy();
+			return false;
+		}
+		uint64_t phaseEnd = TraceRecorder::nowNanoseconds();
+		Timings.LoadLibraryNanoseconds = phaseEnd - phaseStart;
+
+		// ----- Instance -----
+		phaseStart = phaseEnd;
+		VkApplicationInfo applicationInfo = {};
+		applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		applicationInfo.pNext = nullptr;
+		applicationInfo.pApplicationName = applicationName;
+		applicationInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+		applicationInfo.pEngineName = "ACL_vulkan_engine";
+		applicationInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+		applicationInfo.apiVersion = std::min(VulkanFunctionLoaders::GetInstanceApiVersion(), VK_API_VERSION_1_1); // Note: 1.1 gets us subgroup operations
+
+		// Note: Plenty of device extensions (e.g., `VK_KHR_timeline_semaphore`) need this one at instance level when the loader only gives us 1.0
+		std::vector<const char*> instanceExtensions;
+		uint32_t instanceExtensionCount = 0;
+		VulkanFunctionLoaders::vkEnumerateInstanceExtensionProperties(nullptr, &instanceExtensionCount, nullptr);
+		std::vector<VkExtensionProperties> availableInstanceExtensions(instanceExtensionCount);
+		VulkanFunctionLoaders::vkEnumerateInstanceExtensionProperties(nullptr, &instanceExtensionCount, availableInstanceExtensions.data());
+		if (VulkanFunctionLoaders::IsExtensionSupported(availableInstanceExtensions, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+		{
+			instanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+		}
+
+		VkInstanceCreateInfo instanceCreateInfo = {};
+		instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instanceCreateInfo.pNext = nullptr;
+		instanceCreateInfo.flags = 0;
+		instanceCreateInfo.pApplicationInfo = &applicationInfo;
+		instanceCreateInfo.enabledLayerCount = 0;
+		instanceCreateInfo.ppEnabledLayerNames = nullptr;
+		instanceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(instanceExtensions.size());
+		instanceCreateInfo.ppEnabledExtensionNames = instanceExtensions.empty() ? nullptr : instanceExtensions.data();
+
+		VkResult result = VulkanFunctionLoaders::vkCreateInstance(&instanceCreateInfo, nullptr, &Instance);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create Vulkan instance. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			destroy();
+			return false;
+		}
+		if (!VulkanFunctionLoaders::LoadInstanceLevelFunctions(Instance) || !VulkanFunctionLoaders::LoadInstanceLevelFunctionFromExtension(Instance, instanceExtensions))
+		{
+			LOG_ERROR("[FAIL] Vulkan instance level functions could not be loaded.");
+			destroy();
+			return false;
+		}
+		phaseEnd = TraceRecorder::nowNanoseconds();
+		Timings.CreateInstanceNanoseconds = phaseEnd - phaseStart;
+
+		// ----- Physical device & queue family -----
+		phaseStart = phaseEnd;
+		uint32_t physicalDeviceCount = 1; // Note: We only want the first physical device, so only ask for one (we'll get VK_INCOMPLETE if there are more)
+		result = VulkanFunctionLoaders::vkEnumeratePhysicalDevices(Instance, &physicalDeviceCount, &PhysicalDevice);
+		if ((result != VK_SUCCESS && result != VK_INCOMPLETE) || physicalDeviceCount == 0)
+		{
+			LOG_ERROR("[FAIL] Could not find a physical device. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			destroy();
+			return false;
+		}
+		VulkanFunctionLoaders::vkGetPhysicalDeviceProperties(PhysicalDevice, &Properties);
+		ApiVersion = std::min(applicationInfo.apiVersion, VK_MAKE_API_VERSION(0, VK_API_VERSION_MAJOR(Properties.apiVersion), VK_API_VERSION_MINOR(Properties.apiVersion), 0));
+		VulkanFunctionLoaders::vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &MemoryProperties);
+
+		uint32_t queueFamiliesCount = 0;
+		VulkanFunctionLoaders::vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &queueFamiliesCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamiliesCount);
+		VulkanFunctionLoaders::vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &queueFamiliesCount, queueFamilies.data());
+		for (uint32_t i = 0; i < queueFamiliesCount; ++i)
+		{
+			const VkQueueFlags flags = queueFamilies[i].queueFlags;
+			if ((flags & VK_QUEUE_COMPUTE_BIT) == 0) { continue; }
+
+			// Take the first compute family we find, but swap to a dedicated (i.e., non-graphics) one if there is one
+			const bool dedicated = (flags & VK_QUEUE_GRAPHICS_BIT) == 0;
+			if (QueueFamilyIndex == UINT32_MAX || dedicated)
+			{
+				QueueFamilyIndex = i;
+				TimestampValidBits = queueFamilies[i].timestampValidBits;
+				QueueFlags = flags;
+				if (dedicated) { break; }
+			}
+		}
+		if (QueueFamilyIndex == UINT32_MAX)
+		{
+			LOG_ERROR("[FAIL] Physical device 0 has no compute-capable queue family.");
+			destroy();
+			return false;
+		}
+
+		uint32_t deviceExtensionCount = 0;
+		VulkanFunctionLoaders::vkEnumerateDeviceExtensionProperties(PhysicalDevice, nullptr, &deviceExtensionCount, nullptr);
+		std::vector<VkExtensionProperties> deviceExtensions(deviceExtensionCount);
+		VulkanFunctionLoaders::vkEnumerateDeviceExtensionProperties(PhysicalDevice, nullptr, &deviceExtensionCount, deviceExtensions.data());
+		EnabledDeviceExtensions.clear();
+		for (auto optionalExtension : optionalDeviceExtensions)
+		{
+			if (VulkanFunctionLoaders::IsExtensionSupported(deviceExtensions, optionalExtension))
+			{
+				EnabledDeviceExtensions.push_back(optionalExtension);
+				if (std::strcmp(optionalExtension, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0) { TimelineSemaphoresEnabled = true; }
+				if (std::strcmp(optionalExtension, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME) == 0) { Synchronization2Enabled = true; }
+				if (std::strcmp(optionalExtension, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME) == 0) { DescriptorUpdateTemplatesEnabled = true; }
+				if (std::strcmp(optionalExtension, VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME) == 0) { HostQueryResetEnabled = true; }
+			}
+		}
+
+		// The only core features we want are pipeline statistics queries (for `QueryManager`) and `rg32f` storage images (for `HiZPyramid`) -
+		// and only if they're there, as lavapipe & co. don't necessarily have them
+		VkPhysicalDeviceFeatures supportedFeatures = {};
+		VulkanFunctionLoaders::vkGetPhysicalDeviceFeatures(PhysicalDevice, &supportedFeatures);
+		EnabledFeatures = {};
+		EnabledFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+		EnabledFeatures.shaderStorageImageExtendedFormats = supportedFeatures.shaderStorageImageExtendedFormats;
+		PipelineStatisticsQueryEnabled = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+
+		// The fp16 features live in extension structs, so asking about them needs `vkGetPhysicalDeviceFeatures2KHR`. Whatever the device
+		// says it supports, we enable - by handing the very same structs to `vkCreateDevice` below.
+		const bool storage16BitExtensionEnabled = std::find_if(EnabledDeviceExtensions.begin(), EnabledDeviceExtensions.end(),
+			[](const char* name) { return std::strcmp(name, VK_KHR_16BIT_STORAGE_EXTENSION_NAME) == 0; }) != EnabledDeviceExtensions.end();
+		const bool float16Int8ExtensionEnabled = std::find_if(EnabledDeviceExtensions.begin(), EnabledDeviceExtensions.end(),
+			[](const char* name) { return std::strcmp(name, VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME) == 0; }) != EnabledDeviceExtensions.end();
+		VkPhysicalDevice16BitStorageFeaturesKHR storage16BitFeatures = {};
+		storage16BitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES_KHR;
+		storage16BitFeatures.pNext = nullptr;
+		VkPhysicalDeviceShaderFloat16Int8FeaturesKHR float16Int8Features = {};
+		float16Int8Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES_KHR;
+		float16Int8Features.pNext = nullptr;
+		if (VulkanFunctionLoaders::vkGetPhysicalDeviceFeatures2KHR != nullptr && (storage16BitExtensionEnabled || float16Int8ExtensionEnabled))
+		{
+			VkPhysicalDeviceFeatures2KHR features2 = {};
+			features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+			features2.pNext = &storage16BitFeatures;
+			storage16BitFeatures.pNext = float16Int8ExtensionEnabled ? &float16Int8Features : nullptr;
+			VulkanFunctionLoaders::vkGetPhysicalDeviceFeatures2KHR(PhysicalDevice, &features2);
+			storage16BitFeatures.pNext = nullptr;
+			StorageBuffer16BitAccessEnabled = storage16BitExtensionEnabled && storage16BitFeatures.storageBuffer16BitAccess == VK_TRUE;
+			ShaderFloat16Enabled = float16Int8ExtensionEnabled && float16Int8Features.shaderFloat16 == VK_TRUE;
+		}
+		phaseEnd = TraceRecorder::nowNanoseconds();
+		Timings.SelectPhysicalDeviceNanoseconds = phaseEnd - phaseStart;
+
+		// ----- Logical device & queue -----
+		phaseStart = phaseEnd;
+		const float queuePriority = 1.0f;
+		VkDeviceQueueCreateInfo deviceQueueCreateInfo = {};
+		deviceQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		deviceQueueCreateInfo.pNext = nullptr;
+		deviceQueueCreateInfo.flags = 0;
+		deviceQueueCreateInfo.queueFamilyIndex = QueueFamilyIndex;
+		deviceQueueCreateInfo.queueCount = 1;
+		deviceQueueCreateInfo.pQueuePriorities = &queuePriority;
+
+		VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures = {};
+		timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+		timelineSemaphoreFeatures.pNext = nullptr;
+		timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+
+		VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features = {};
+		synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+		synchronization2Features.pNext = nullptr;
+		synchronization2Features.synchronization2 = VK_TRUE;
+
+		VkPhysicalDeviceHostQueryResetFeaturesEXT hostQueryResetFeatures = {};
+		hostQueryResetFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES_EXT;
+		hostQueryResetFeatures.pNext = nullptr;
+		hostQueryResetFeatures.hostQueryReset = VK_TRUE;
+
+		// Chain on the features for whichever of the extensions we enabled
+		void* featureChain = nullptr;
+		if (Synchronization2Enabled)
+		{
+			synchronization2Features.pNext = featureChain;
+			featureChain = &synchronization2Features;
+		}
+		if (TimelineSemaphoresEnabled)
+		{
+			timelineSemaphoreFeatures.pNext = featureChain;
+			featureChain = &timelineSemaphoreFeatures;
+		}
+		if (HostQueryResetEnabled)
+		{
+			hostQueryResetFeatures.pNext = featureChain;
+			featureChain = &hostQueryResetFeatures;
+		}
+		if (StorageBuffer16BitAccessEnabled)
+		{
+			storage16BitFeatures.pNext = featureChain;
+			featureChain = &storage16BitFeatures;
+		}
+		if (ShaderFloat16Enabled)
+		{
+			float16Int8Features.pNext = featureChain;
+			featureChain = &float16Int8Features;
+		}
+
+		VkDeviceCreateInfo deviceCreateInfo = {};
+		deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceCreateInfo.pNext = featureChain;
+		deviceCreateInfo.flags = 0;
+		deviceCreateInfo.queueCreateInfoCount = 1;
+		deviceCreateInfo.pQueueCreateInfos = &deviceQueueCreateInfo;
+		deviceCreateInfo.enabledLayerCount = 0;
+		deviceCreateInfo.ppEnabledLayerNames = nullptr;
+		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(EnabledDeviceExtensions.size());
+		deviceCreateInfo.ppEnabledExtensionNames = EnabledDeviceExtensions.empty() ? nullptr : EnabledDeviceExtensions.data();
+		deviceCreateInfo.pEnabledFeatures = &EnabledFeatures;
+
+		result = VulkanFunctionLoaders::vkCreateDevice(PhysicalDevice, &deviceCreateInfo, nullptr, &Device);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Failed to create logical device. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			destroy();
+			return false;
+		}
+		if (!VulkanFunctionLoaders::LoadDeviceLevelFunction(Device, nullptr) ||
+			!VulkanFunctionLoaders::LoadDeviceLevelFunctionFromExtension(Device, nullptr, EnabledDeviceExtensions))
+		{
+			LOG_ERROR("[FAIL] Could not load device-level functions.");
+			destroy();
+			return false;
+		}
+		VulkanFunctionLoaders::vkGetDeviceQueue(Device, QueueFamilyIndex, 0, &Queue);
+		Timings.CreateDeviceNanoseconds = TraceRecorder::nowNanoseconds() - phaseStart;
+
+		LOG_VERBOSE("[OK] Headless context created on: {} (queue family {})", Properties.deviceName, QueueFamilyIndex);
+		return true;
+	}
+
+	// Method to tear everything down again. Safe to call on a partially-created (or never-created) context.
+	void destroy()
+	{
+		if (Device != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDeviceWaitIdle(Device);
+			VulkanFunctionLoaders::vkDestroyDevice(Device, nullptr);
+			Device = VK_NULL_HANDLE;
+		}
+		if (Instance != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyInstance(Instance, nullptr);
+			Instance = VK_NULL_HANDLE;
+		}
+		DisconnectFromVulkanLoaderLibrary(VulkanLibrary);
+		PhysicalDevice = VK_NULL_HANDLE;
+		Queue = VK_NULL_HANDLE;
+		QueueFamilyIndex = UINT32_MAX;
+		EnabledDeviceExtensions.clear();
+		TimelineSemaphoresEnabled = false;
+		Synchronization2Enabled = false;
+		DescriptorUpdateTemplatesEnabled = false;
+		HostQueryResetEnabled = false;
+		PipelineStatisticsQueryEnabled = false;
+		EnabledFeatures = {};
+		StorageBuffer16BitAccessEnabled = false;
+		ShaderFloat16Enabled = false;
+		QueueFlags = 0;
+		ApiVersion = VK_API_VERSION_1_0;
+
+		// `RenderGraph`, `DescriptorSetTemplate`, `QueryManager` and `GpuCulling` pick their paths by whether these are loaded - so don't leave them pointing into a
+		// device that's gone
+		VulkanFunctionLoaders::vkCmdPipelineBarrier2KHR = nullptr;
+		VulkanFunctionLoaders::vkCreateDescriptorUpdateTemplateKHR = nullptr;
+		VulkanFunctionLoaders::vkDestroyDescriptorUpdateTemplateKHR = nullptr;
+		VulkanFunctionLoaders::vkUpdateDescriptorSetWithTemplateKHR = nullptr;
+		VulkanFunctionLoaders::vkResetQueryPoolEXT = nullptr;
+		VulkanFunctionLoaders::vkCmdDrawIndexedIndirectCountKHR = nullptr;
+		VulkanFunctionLoaders::vkGetPhysicalDeviceFeatures2KHR = nullptr;
+		VulkanFunctionLoaders::vkGetPhysicalDeviceProperties2KHR = nullptr;
+	}
+};
@@ -0,0 +1,687 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "ObjectCache.hpp"
+#include "GpuBuffer.hpp"
+#include "RenderTarget.hpp"
+#include "RenderGraph.hpp"
+#include "DescriptorTemplate.hpp"
+#include "ComputePipeline.hpp"
+#include "ComputeBatch.hpp"
+#include "GpuCulling.hpp"
+
+// Descriptors for `hiz_pyramid.comp`: the depth buffer, a storage image per level, and the counter that finds the last workgroup
+struct HiZDescriptors
+{
+	VkDescriptorImageInfo Depth;
+	VkDescriptorImageInfo Levels[13]; // Note: `HiZPyramid::MaxLevels`, which isn't declared yet
+	VkDescriptorBufferInfo Counter;
+};
+template <> struct DescriptorLayout<HiZDescriptors>
+{
+	static constexpr std::array<DescriptorBinding, 3> Bindings = {
+		DESCRIPTOR_BINDING(HiZDescriptors, Depth, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(HiZDescriptors, Levels, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(HiZDescriptors, Counter, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) };
+};
+
+// Class to build a hierarchical-Z (Hi-Z) pyramid from a depth buffer: a mip chain where each texel holds the nearest (R) & farthest (G)
+// depth of everything under it, which is what `GpuCulling::recordOcclusionCull` tests bounding boxes against. All of it comes from a single
+// dispatch (`hiz_pyramid.comp`, after AMD's single-pass downsampler) - each workgroup reduces a 32x32 tile in shared memory, and the last
+// one to finish does the few small levels that are left - rather than a dispatch per level, with a barrier (and the GPU draining) between
+// each one and the next.
+//
+// Level 0 is half the depth buffer's size rounded up to a power of two each way (so 1920x1080 gets 1024x1024), which keeps every texel from
+// there on exactly four of the level above and lets each level 0 texel cover whatever depth texels overlap it - the pyramid is conservative
+// however the sizes line up. Levels go all the way down to 1x1.
+//
+// The depth buffer is read through a sampler, so it needs `VK_IMAGE_USAGE_SAMPLED_BIT` and a format that can be sampled (see
+// `findSampledDepthFormat`) - and it doesn't have to be a depth format at all: any image whose R channel is depth will do. The pyramid is
+// `VK_FORMAT_R32G32_SFLOAT`, written as `rg32f` storage images - which needs the `shaderStorageImageExtendedFormats` feature.
+//
+// CAREFUL: `record` expects the pyramid to be in `VK_IMAGE_LAYOUT_GENERAL` (i.e., `ResourceUsage::ComputeShaderWrite` in a render graph). As
+// with our other compute passes there's no barrier after the dispatch - whoever reads the pyramid next puts that in.
+// Note: Every dispatch gets its own descriptor set - call `resetDescriptors` to hand them all back.
+class HiZPyramid
+{
+public:
+
+	static constexpr uint32_t MaxLevels = 13; // Enough for a level 0 of 4096x4096, i.e., a depth buffer of up to 8192x8192
+	static constexpr uint32_t TileSize = 32;  // Level 0 texels each workgroup covers each way
+	static_assert(std::extent_v<decltype(HiZDescriptors::Levels)> == MaxLevels, "HiZDescriptors::Levels must have room for every level");
+
+	VkImage Image = VK_NULL_HANDLE;
+	VkImageView View = VK_NULL_HANDLE; // Of every level, for sampling (e.g., by occlusion culling)
+	uint32_t Width = 0;                // Of level 0
+	uint32_t Height = 0;
+	uint32_t Levels = 0;
+
+	// Method to get the size of level 0 for a depth buffer `depthSize` texels across: half that, rounded up to a power of two
+	static uint32_t getLevel0Size(uint32_t depthSize)
+	{
+		uint32_t size = 1;
+		while (size < depthSize) { size <<= 1; }
+		return std::max(size / 2, 1u);
+	}
+
+	// Method to get how many levels it takes to get from a level 0 of `width` x `height` down to 1x1
+	static uint32_t getLevelCount(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1;
+		for (uint32_t size = std::max(width, height); size > 1; size >>= 1) { ++levels; }
+		return levels;
+	}
+
+	// Method to load `hiz_pyramid.spv` from `shaderDirectory` and create its pipeline, the pyramid for a `depthWidth` x `depthHeight` depth
+	// buffer, a sampler to read the depth with, and a descriptor pool with enough sets for `maxDispatchesPerReset` dispatches. Returns false
+	// (having cleaned up after itself) if the device is missing anything we need or something fails.
+	bool create(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, const VkPhysicalDeviceMemoryProperties& memoryProperties, const VkPhysicalDeviceFeatures& enabledFeatures,
+		uint32_t depthWidth, uint32_t depthHeight, const string& shaderDirectory = "shaders/spv", uint32_t maxDispatchesPerReset = 16, ObjectCache* objectCache = nullptr)
+	{
+		device = logicalDevice;
+		cache = objectCache;
+		depthSize = { depthWidth, depthHeight };
+		Width = getLevel0Size(depthWidth);
+		Height = getLevel0Size(depthHeight);
+		Levels = getLevelCount(Width, Height);
+		if (Levels > MaxLevels)
+		{
+			LOG_ERROR("[FAIL] A {}x{} depth buffer is too big for a Hi-Z pyramid - the most we can do is {} levels.", depthWidth, depthHeight, MaxLevels);
+			return false;
+		}
+		if (enabledFeatures.shaderStorageImageExtendedFormats != VK_TRUE)
+		{
+			LOG_WARNING("[WARNING] Can't build a Hi-Z pyramid - the device doesn't have the `shaderStorageImageExtendedFormats` feature.");
+			return false;
+		}
+		VkFormatProperties formatProperties;
+		VulkanFunctionLoaders::vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R32G32_SFLOAT, &formatProperties);
+		const VkFormatFeatureFlags neededFeatures = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+		if ((formatProperties.optimalTilingFeatures & neededFeatures) != neededFeatures)
+		{
+			LOG_WARNING("[WARNING] Can't build a Hi-Z pyramid - the device can't use `VK_FORMAT_R32G32_SFLOAT` as a storage & sampled image.");
+			return false;
+		}
+
+		if (!pyramidTemplate.create(device, objectCache) ||
+			!pipeline.createFromFile(device, shaderDirectory + "/hiz_pyramid.spv", pyramidTemplate.SetLayout, sizeof(HiZPushConstants), {}, objectCache) ||
+			!createImage(memoryProperties) ||
+			!counter.create(device, memoryProperties, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+		{
+			destroy();
+			return false;
+		}
+
+		depthSampler = createNearestSampler(device, cache);
+		if (depthSampler == VK_NULL_HANDLE)
+		{
+			destroy();
+			return false;
+		}
+
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		DescriptorSetTemplate<HiZDescriptors>::addPoolSizes(poolSizes, maxDispatchesPerReset);
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.pNext = nullptr;
+		poolCreateInfo.flags = 0;
+		poolCreateInfo.maxSets = maxDispatchesPerReset;
+		poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolCreateInfo.pPoolSizes = poolSizes.data();
+		const VkResult result = VulkanFunctionLoaders::vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &descriptorPool);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create Hi-Z pyramid descriptor pool. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			descriptorPool = VK_NULL_HANDLE;
+			destroy();
+			return false;
+		}
+
+		LOG_VERBOSE("[OK] Created {}x{} Hi-Z pyramid ({} levels) for a {}x{} depth buffer from: {}", Width, Height, Levels, depthWidth, depthHeight, shaderDirectory);
+		return true;
+	}
+
+	// Method to hand back every descriptor set our dispatches have used since the last reset.
+	// CAREFUL: The GPU must be finished with everything recorded since then!
+	void resetDescriptors()
+	{
+		if (descriptorPool != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkResetDescriptorPool(device, descriptorPool, 0); }
+	}
+
+	// Method to record building the whole pyramid from `depth` - a view of the depth buffer's depth aspect, in `depthLayout`, that must be the
+	// size we were created for. Returns false if we've run out of descriptor sets.
+	bool record(VkCommandBuffer commandBuffer, VkImageView depth, VkImageLayout depthLayout = VK_IMAGE_LAYOUT_GENERAL)
+	{
+		const VkDescriptorSet set = allocateSet();
+		if (set == VK_NULL_HANDLE) { return false; }
+
+		// Note: Every level in the array gets used by the shader as far as Vulkan can tell, so the ones past our last level just repeat it
+		HiZDescriptors descriptors = {};
+		descriptors.Depth = { depthSampler, depth, depthLayout };
+		for (uint32_t level = 0; level < MaxLevels; ++level)
+		{
+			descriptors.Levels[level] = { VK_NULL_HANDLE, levelViews[std::min(level, Levels - 1)], VK_IMAGE_LAYOUT_GENERAL };
+		}
+		descriptors.Counter = { counter.Buffer, 0, VK_WHOLE_SIZE };
+		pyramidTemplate.update(set, descriptors);
+
+		// The counter that finds the last workgroup has to start at zero - and the last build must be done with it before we zero it
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.pNext = nullptr;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+		VulkanFunctionLoaders::vkCmdFillBuffer(commandBuffer, counter.Buffer, 0, sizeof(uint32_t), 0);
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		const uint32_t groupsX = (Width + TileSize - 1) / TileSize;
+		const uint32_t groupsY = (Height + TileSize - 1) / TileSize;
+		pipeline.bind(commandBuffer, set);
+		pipeline.pushConstants(commandBuffer, HiZPushConstants{ depthSize[0], depthSize[1], Width, Height, Levels, groupsX * groupsY });
+		pipeline.dispatch(commandBuffer, groupsX, groupsY);
+		return true;
+	}
+
+	// How many bytes `recordReadback` writes: every level, one after the other, at 8 bytes (nearest & farthest) a texel
+	VkDeviceSize getReadbackSize() const
+	{
+		VkDeviceSize size = 0;
+		for (uint32_t level = 0; level < Levels; ++level) { size += static_cast<VkDeviceSize>(getLevelWidth(level)) * getLevelHeight(level) * 2 * sizeof(float); }
+		return size;
+	}
+
+	uint32_t getLevelWidth(uint32_t level) const { return std::max(Width >> level, 1u); }
+	uint32_t getLevelHeight(uint32_t level) const { return std::max(Height >> level, 1u); }
+
+	// Method to record copying every level into `buffer` (see `getReadbackSize`), with the pyramid in `layout` - which must be
+	// `VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL` or `VK_IMAGE_LAYOUT_GENERAL`
+	void recordReadback(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImageLayout layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) const
+	{
+		std::array<VkBufferImageCopy, MaxLevels> regions = {};
+		VkDeviceSize offset = 0;
+		for (uint32_t level = 0; level < Levels; ++level)
+		{
+			regions[level].bufferOffset = offset;
+			regions[level].bufferRowLength = 0;
+			regions[level].bufferImageHeight = 0;
+			regions[level].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			regions[level].imageOffset = { 0, 0, 0 };
+			regions[level].imageExtent = { getLevelWidth(level), getLevelHeight(level), 1 };
+			offset += static_cast<VkDeviceSize>(getLevelWidth(level)) * getLevelHeight(level) * 2 * sizeof(float);
+		}
+		VulkanFunctionLoaders::vkCmdCopyImageToBuffer(commandBuffer, Image, layout, buffer, Levels, regions.data());
+	}
+
+	// CAREFUL: The GPU must be finished with everything we've recorded before we call this!
+	void destroy()
+	{
+		if (descriptorPool != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+			descriptorPool = VK_NULL_HANDLE;
+		}
+		destroyNearestSampler(device, cache, depthSampler);
+		for (VkImageView& levelView : levelViews)
+		{
+			if (levelView != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkDestroyImageView(device, levelView, nullptr); }
+			levelView = VK_NULL_HANDLE;
+		}
+		if (View != VK_NULL_HANDLE)   { VulkanFunctionLoaders::vkDestroyImageView(device, View, nullptr); }
+		if (Image != VK_NULL_HANDLE)  { VulkanFunctionLoaders::vkDestroyImage(device, Image, nullptr); }
+		if (memory != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkFreeMemory(device, memory, nullptr); }
+		View = VK_NULL_HANDLE;
+		Image = VK_NULL_HANDLE;
+		memory = VK_NULL_HANDLE;
+		if (device != VK_NULL_HANDLE) { counter.destroy(device); }
+		pipeline.destroy();
+		pyramidTemplate.destroy();
+		cache = nullptr;
+	}
+
+private:
+
+	// Must match the `push_constant` block in `hiz_pyramid.comp`
+	struct HiZPushConstants
+	{
+		uint32_t DepthWidth, DepthHeight;
+		uint32_t Level0Width, Level0Height;
+		uint32_t LevelCount;
+		uint32_t WorkgroupCount;
+	};
+
+	// Method to create the pyramid image, its memory, a view of every level for sampling and a view of each level on its own for the shader
+	// to write
+	bool createImage(const VkPhysicalDeviceMemoryProperties& memoryProperties)
+	{
+		VkImageCreateInfo imageCreateInfo = {};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.pNext = nullptr;
+		imageCreateInfo.flags = 0;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = VK_FORMAT_R32G32_SFLOAT;
+		imageCreateInfo.extent = { Width, Height, 1 };
+		imageCreateInfo.mipLevels = Levels;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.queueFamilyIndexCount = 0;
+		imageCreateInfo.pQueueFamilyIndices = nullptr;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkResult result = VulkanFunctionLoaders::vkCreateImage(device, &imageCreateInfo, nullptr, &Image);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create {}x{} Hi-Z pyramid image. VkResult is: {}", Width, Height, VulkanHelpers::getFriendlyResultString(result));
+			Image = VK_NULL_HANDLE;
+			return false;
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		VulkanFunctionLoaders::vkGetImageMemoryRequirements(device, Image, &memoryRequirements);
+		VkMemoryAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.allocationSize = memoryRequirements.size;
+		allocateInfo.memoryTypeIndex = VulkanHelpers::findMemoryTypeIndex(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (allocateInfo.memoryTypeIndex == UINT32_MAX)
+		{
+			LOG_ERROR("[FAIL] No memory type is suitable for a Hi-Z pyramid.");
+			return false;
+		}
+		result = VulkanFunctionLoaders::vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not allocate {} bytes of Hi-Z pyramid memory. VkResult is: {}", memoryRequirements.size, VulkanHelpers::getFriendlyResultString(result));
+			memory = VK_NULL_HANDLE;
+			return false;
+		}
+		result = VulkanFunctionLoaders::vkBindImageMemory(device, Image, memory, 0);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not bind Hi-Z pyramid memory. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+
+		VkImageViewCreateInfo viewCreateInfo = {};
+		viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewCreateInfo.pNext = nullptr;
+		viewCreateInfo.flags = 0;
+		viewCreateInfo.image = Image;
+		viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewCreateInfo.format = VK_FORMAT_R32G32_SFLOAT;
+		viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+		for (uint32_t level = 0; level <= Levels; ++level)
+		{
+			// Note: The last time round is the view of every level
+			VkImageView& view = level < Levels ? levelViews[level] : View;
+			viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level < Levels ? level : 0, level < Levels ? 1 : Levels, 0, 1 };
+			result = VulkanFunctionLoaders::vkCreateImageView(device, &viewCreateInfo, nullptr, &view);
+			if (result != VK_SUCCESS)
+			{
+				LOG_ERROR("[FAIL] Could not create Hi-Z pyramid view. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+				view = VK_NULL_HANDLE;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	VkDescriptorSet allocateSet()
+	{
+		const VkDescriptorSetLayout setLayout = pyramidTemplate.SetLayout;
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.descriptorPool = descriptorPool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &setLayout;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		const VkResult result = VulkanFunctionLoaders::vkAllocateDescriptorSets(device, &allocateInfo, &set);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not allocate a descriptor set for a Hi-Z pyramid - call `resetDescriptors` more often? VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return VK_NULL_HANDLE;
+		}
+		return set;
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	ObjectCache* cache = nullptr;
+	std::array<uint32_t, 2> depthSize = {};
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	std::array<VkImageView, MaxLevels> levelViews = {};
+	GpuBuffer counter;
+	VkSampler depthSampler = VK_NULL_HANDLE;
+	DescriptorSetTemplate<HiZDescriptors> pyramidTemplate;
+	ComputePipeline pipeline;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+};
+
+// Method to build on the CPU the pyramid `HiZPyramid` builds on the GPU from a `width` x `height` depth buffer, laid out as
+// `HiZPyramid::recordReadback` reads it back: every level one after the other, each texel's nearest then farthest depth
+inline std::vector<float> buildHiZPyramidOnCpu(const float* depth, uint32_t width, uint32_t height)
+{
+	const uint32_t level0Width = HiZPyramid::getLevel0Size(width);
+	const uint32_t level0Height = HiZPyramid::getLevel0Size(height);
+	const uint32_t levels = HiZPyramid::getLevelCount(level0Width, level0Height);
+	std::vector<float> pyramid;
+
+	// Level 0: each texel covers every depth texel its share of the screen overlaps
+	for (uint32_t y = 0; y < level0Height; ++y)
+	{
+		const uint32_t firstY = y * height / level0Height;
+		const uint32_t lastY = std::min(((y + 1) * height + level0Height - 1) / level0Height, height) - 1;
+		for (uint32_t x = 0; x < level0Width; ++x)
+		{
+			const uint32_t firstX = x * width / level0Width;
+			const uint32_t lastX = std::min(((x + 1) * width + level0Width - 1) / level0Width, width) - 1;
+			float nearest = depth[static_cast<size_t>(firstY) * width + firstX];
+			float farthest = nearest;
+			for (uint32_t sourceY = firstY; sourceY <= lastY; ++sourceY)
+			{
+				for (uint32_t sourceX = firstX; sourceX <= lastX; ++sourceX)
+				{
+					nearest = std::min(nearest, depth[static_cast<size_t>(sourceY) * width + sourceX]);
+					farthest = std::max(farthest, depth[static_cast<size_t>(sourceY) * width + sourceX]);
+				}
+			}
+			pyramid.push_back(nearest);
+			pyramid.push_back(farthest);
+		}
+	}
+
+	// Every other level: each texel covers (up to) 2x2 of the level above
+	size_t previousOffset = 0;
+	for (uint32_t level = 1; level < levels; ++level)
+	{
+		const uint32_t previousWidth = std::max(level0Width >> (level - 1), 1u);
+		const uint32_t previousHeight = std::max(level0Height >> (level - 1), 1u);
+		const uint32_t levelWidth = std::max(level0Width >> level, 1u);
+		const uint32_t levelHeight = std::max(level0Height >> level, 1u);
+		const size_t offset = pyramid.size();
+		for (uint32_t y = 0; y < levelHeight; ++y)
+		{
+			for (uint32_t x = 0; x < levelWidth; ++x)
+			{
+				float nearest = pyramid[previousOffset + (static_cast<size_t>(y * 2) * previousWidth + x * 2) * 2];
+				float farthest = pyramid[previousOffset + (static_cast<size_t>(y * 2) * previousWidth + x * 2) * 2 + 1];
+				for (uint32_t childY = y * 2; childY < std::min(y * 2 + 2, previousHeight); ++childY)
+				{
+					for (uint32_t childX = x * 2; childX < std::min(x * 2 + 2, previousWidth); ++childX)
+					{
+						nearest = std::min(nearest, pyramid[previousOffset + (static_cast<size_t>(childY) * previousWidth + childX) * 2]);
+						farthest = std::max(farthest, pyramid[previousOffset + (static_cast<size_t>(childY) * previousWidth + childX) * 2 + 1]);
+					}
+				}
+				pyramid.push_back(nearest);
+				pyramid.push_back(farthest);
+			}
+		}
+		previousOffset = offset;
+	}
+	return pyramid;
+}
+
+// Method to check whether an instance really is hidden in a `width` x `height` depth buffer drawn with `view`'s view-projection: the nearest
+// corner of its bounding box must be at or behind the farthest depth anywhere in the rectangle those corners cover on screen. That's the
+// same test `gpu_cull.comp` makes against the pyramid, only exact - so anything occlusion culling drops has to pass it. Anything poking
+// through the near plane never does.
+inline bool isHiddenInDepthBuffer(const CullView& view, const CullInstance& instance, const float* depth, uint32_t width, uint32_t height)
+{
+	constexpr float PixelSlack = 1.0e-3f; // Shrinks the rectangle a touch, so rounding can't make it pick up a texel the GPU's didn't
+	constexpr float DepthSlack = 1.0e-5f;
+	float minimum[2] = { 1.0f, 1.0f };
+	float maximum[2] = { 0.0f, 0.0f };
+	float nearestDepth = 1.0f;
+	for (uint32_t corner = 0; corner < 8; ++corner)
+	{
+		const float point[3] = { instance.Center[0] + ((corner & 1) != 0 ? instance.Radius : -instance.Radius),
+			instance.Center[1] + ((corner & 2) != 0 ? instance.Radius : -instance.Radius), instance.Center[2] + ((corner & 4) != 0 ? instance.Radius : -instance.Radius) };
+		float clip[4];
+		for (uint32_t row = 0; row < 4; ++row)
+		{
+			clip[row] = view.ViewProjection[row] * point[0] + view.ViewProjection[4 + row] * point[1] + view.ViewProjection[8 + row] * point[2] + view.ViewProjection[12 + row];
+		}
+		if (clip[3] <= 0.0f || clip[2] < 0.0f) { return false; }
+		for (uint32_t axis = 0; axis < 2; ++axis)
+		{
+			const float uv = clip[axis] / clip[3] * 0.5f + 0.5f;
+			minimum[axis] = std::min(minimum[axis], uv);
+			maximum[axis] = std::max(maximum[axis], uv);
+		}
+		nearestDepth = std::min(nearestDepth, clip[2] / clip[3]);
+	}
+
+	const uint32_t size[2] = { width, height };
+	uint32_t first[2], last[2];
+	for (uint32_t axis = 0; axis < 2; ++axis)
+	{
+		const float low = std::clamp(minimum[axis], 0.0f, 1.0f) * size[axis] + PixelSlack;
+		const float high = std::clamp(maximum[axis], 0.0f, 1.0f) * size[axis] - PixelSlack;
+		first[axis] = std::min(static_cast<uint32_t>(std::max(low, 0.0f)), size[axis] - 1);
+		last[axis] = std::clamp(static_cast<uint32_t>(std::max(std::ceil(high), 1.0f)) - 1, first[axis], size[axis] - 1);
+	}
+	float farthestDepth = 0.0f;
+	for (uint32_t y = first[1]; y <= last[1]; ++y)
+	{
+		for (uint32_t x = first[0]; x <= last[0]; ++x) { farthestDepth = std::max(farthestDepth, depth[static_cast<size_t>(y) * width + x]); }
+	}
+	return nearestDepth >= farthestDepth - DepthSlack;
+}
+
+// Method to check the commands an occlusion cull wrote: each must draw one instance that's (near enough) inside the frustum, with its
+// mesh's indices, and none twice - and every instance that's clearly inside the frustum but wasn't drawn must really be hidden in the
+// depth buffer the pyramid was built from (see `isHiddenInDepthBuffer`). Sets `occludedCount` to how many of those there were.
+inline bool checkOcclusionCulling(const CullView& view, const CullInstance* instances, uint32_t instanceCount, const std::vector<CullMesh>& meshes,
+	const VkDrawIndexedIndirectCommand* commands, uint32_t drawCount, const float* depth, uint32_t width, uint32_t height, uint32_t& occludedCount)
+{
+	constexpr float EdgeSlack = 1.0e-3f;
+	occludedCount = 0;
+	if (drawCount > instanceCount) { return false; }
+	std::vector<uint8_t> drawn(instanceCount, 0);
+	for (uint32_t i = 0; i < drawCount; ++i)
+	{
+		const VkDrawIndexedIndirectCommand& command = commands[i];
+		if (command.firstInstance >= instanceCount || drawn[command.firstInstance] != 0) { return false; }
+		drawn[command.firstInstance] = 1;
+		const CullInstance& instance = instances[command.firstInstance];
+		const CullMesh& mesh = meshes[instance.MeshIndex];
+		if (command.instanceCount != 1 || command.indexCount != mesh.IndexCount || command.firstIndex != mesh.FirstIndex || command.vertexOffset != mesh.VertexOffset ||
+			!isSphereInFrustum(view, instance, EdgeSlack))
+		{
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < instanceCount; ++i)
+	{
+		if (drawn[i] != 0 || !isSphereInFrustum(view, instances[i], -EdgeSlack)) { continue; }
+		if (!isHiddenInDepthBuffer(view, instances[i], depth, width, height)) { return false; }
+		++occludedCount;
+	}
+	return true;
+}
+
+// A self-checking workload for `HiZPyramid` & occlusion culling, which needs a graphics queue: frustum culls a `generateCullingScene` of
+// `instanceCount` instances, draws what's left into `renderer`'s depth buffer, builds a Hi-Z pyramid of that (`pyramid` must be made for
+// the renderer's size), then culls the same instances again against the pyramid - all in one submission, with nothing coming back to the
+// CPU in between. The pyramid is checked against one built on the CPU from the depth buffer, and every instance the second cull dropped
+// against the depth buffer itself (see `checkOcclusionCulling`). The scene's big instance in the middle of the screen makes sure some are.
+inline BatchWorkload makeHiZOcclusionWorkload(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, GpuCulling& culling, const CulledDepthRenderer& renderer,
+	HiZPyramid& pyramid, uint32_t instanceCount)
+{
+	struct OcclusionState
+	{
+		VkDevice Device = VK_NULL_HANDLE;
+		CullingScene Scene;
+		CullView View = {};
+		CullView OcclusionView = {};
+		GpuBuffer Instances;
+		GpuBuffer Meshes;
+		GpuBuffer ViewBuffer;
+		GpuBuffer OcclusionViewBuffer;
+		GpuBuffer Commands;
+		GpuBuffer DrawCount;
+		GpuBuffer OcclusionCommands;
+		GpuBuffer OcclusionDrawCount;
+		GpuBuffer Vertices;
+		GpuBuffer Indices;
+		GpuBuffer DepthReadback;
+		GpuBuffer PyramidReadback;
+		~OcclusionState()
+		{
+			Instances.destroy(Device); Meshes.destroy(Device); ViewBuffer.destroy(Device); OcclusionViewBuffer.destroy(Device); Commands.destroy(Device);
+			DrawCount.destroy(Device); OcclusionCommands.destroy(Device); OcclusionDrawCount.destroy(Device); Vertices.destroy(Device); Indices.destroy(Device);
+			DepthReadback.destroy(Device); PyramidReadback.destroy(Device);
+		}
+	};
+	auto state = std::make_shared<OcclusionState>();
+	state->Device = device;
+
+	BatchWorkload workload;
+	workload.Name = "hiz-occlusion-culling";
+	workload.Record = [state, memoryProperties, &culling, &renderer, &pyramid, instanceCount](VkCommandBuffer commandBuffer)
+	{
+		const uint32_t depthTexelSize = renderer.Depth.Format == VK_FORMAT_D16_UNORM ? 2 : 4;
+		if (state->Instances.Buffer == VK_NULL_HANDLE)
+		{
+			state->Scene = generateCullingScene(instanceCount, static_cast<float>(renderer.Width) / static_cast<float>(renderer.Height));
+			state->View = makeCullView(state->Scene.ViewProjection);
+			state->OcclusionView = makeCullView(state->Scene.ViewProjection, pyramid.Width, pyramid.Height, pyramid.Levels);
+			const CullingScene& scene = state->Scene;
+
+			const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			const VkBufferUsageFlags indirect = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			const VkDeviceSize commandsSize = std::max<VkDeviceSize>(instanceCount, 1) * sizeof(VkDrawIndexedIndirectCommand);
+			if (!state->Instances.create(state->Device, memoryProperties, std::max<VkDeviceSize>(scene.Instances.size(), 1) * sizeof(CullInstance),
+					VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, hostVisible, true) ||
+				!state->Meshes.create(state->Device, memoryProperties, scene.Meshes.size() * sizeof(CullMesh), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->ViewBuffer.create(state->Device, memoryProperties, sizeof(CullView), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible, true) ||
+				!state->OcclusionViewBuffer.create(state->Device, memoryProperties, sizeof(CullView), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible, true) ||
+				!state->Commands.create(state->Device, memoryProperties, commandsSize, indirect, hostVisible, true) ||
+				!state->DrawCount.create(state->Device, memoryProperties, sizeof(uint32_t), indirect, hostVisible, true) ||
+				!state->OcclusionCommands.create(state->Device, memoryProperties, commandsSize, indirect, hostVisible, true) ||
+				!state->OcclusionDrawCount.create(state->Device, memoryProperties, sizeof(uint32_t), indirect, hostVisible, true) ||
+				!state->Vertices.create(state->Device, memoryProperties, scene.Vertices.size() * sizeof(float), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, hostVisible, true) ||
+				!state->Indices.create(state->Device, memoryProperties, scene.Indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, hostVisible, true) ||
+				!state->DepthReadback.create(state->Device, memoryProperties, static_cast<VkDeviceSize>(renderer.Width) * renderer.Height * depthTexelSize,
+					VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostVisible, true) ||
+				!state->PyramidReadback.create(state->Device, memoryProperties, pyramid.getReadbackSize(), VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostVisible, true))
+			{
+				return false;
+			}
+			std::memcpy(state->Instances.Mapped, scene.Instances.data(), scene.Instances.size() * sizeof(CullInstance));
+			std::memcpy(state->Meshes.Mapped, scene.Meshes.data(), scene.Meshes.size() * sizeof(CullMesh));
+			std::memcpy(state->ViewBuffer.Mapped, &state->View, sizeof(CullView));
+			std::memcpy(state->OcclusionViewBuffer.Mapped, &state->OcclusionView, sizeof(CullView));
+			std::memcpy(state->Vertices.Mapped, scene.Vertices.data(), scene.Vertices.size() * sizeof(float));
+			std::memcpy(state->Indices.Mapped, scene.Indices.data(), scene.Indices.size() * sizeof(uint32_t));
+		}
+
+		RenderGraph graph;
+		const RenderGraphResource instances = graph.importBuffer("Instances", state->Instances.Buffer);
+		const RenderGraphResource meshes = graph.importBuffer("Meshes", state->Meshes.Buffer);
+		const RenderGraphResource view = graph.importBuffer("View", state->ViewBuffer.Buffer);
+		const RenderGraphResource occlusionView = graph.importBuffer("Occlusion view", state->OcclusionViewBuffer.Buffer);
+		const RenderGraphResource commands = graph.importBuffer("Draw commands", state->Commands.Buffer);
+		const RenderGraphResource drawCount = graph.importBuffer("Draw count", state->DrawCount.Buffer);
+		const RenderGraphResource occlusionCommands = graph.importBuffer("Occlusion draw commands", state->OcclusionCommands.Buffer);
+		const RenderGraphResource occlusionDrawCount = graph.importBuffer("Occlusion draw count", state->OcclusionDrawCount.Buffer);
+		const RenderGraphResource vertices = graph.importBuffer("Vertices", state->Vertices.Buffer);
+		const RenderGraphResource indices = graph.importBuffer("Indices", state->Indices.Buffer);
+		const RenderGraphResource depth = graph.importImage("Depth", renderer.Depth.Image, VK_IMAGE_ASPECT_DEPTH_BIT);
+		const RenderGraphResource hiZ = graph.importImage("Hi-Z pyramid", pyramid.Image);
+		const RenderGraphResource depthReadback = graph.importBuffer("Depth readback", state->DepthReadback.Buffer);
+		const RenderGraphResource pyramidReadback = graph.importBuffer("Hi-Z pyramid readback", state->PyramidReadback.Buffer);
+
+		bool recorded = true;
+		graph.addPass("GPU culling", [state, &culling, &recorded, instanceCount](VkCommandBuffer cb)
+		{
+			const CullDescriptors buffers = { { state->Instances.Buffer, 0, VK_WHOLE_SIZE }, { state->Meshes.Buffer, 0, VK_WHOLE_SIZE }, { state->ViewBuffer.Buffer, 0, VK_WHOLE_SIZE },
+				{ state->Commands.Buffer, 0, VK_WHOLE_SIZE }, { state->DrawCount.Buffer, 0, VK_WHOLE_SIZE } };
+			recorded = culling.recordCull(cb, buffers, instanceCount, instanceCount) && recorded;
+		}).read(instances, ResourceUsage::ComputeShaderRead).read(meshes, ResourceUsage::ComputeShaderRead).read(view, ResourceUsage::UniformBufferRead)
+			.write(commands, ResourceUsage::ComputeShaderWrite).write(drawCount, ResourceUsage::ComputeShaderWrite);
+		graph.addPass("Depth prepass", [state, &culling, &renderer, instanceCount](VkCommandBuffer cb)
+		{
+			renderer.record(cb, culling, state->Scene.ViewProjection, state->Vertices.Buffer, state->Indices.Buffer, state->Instances.Buffer, state->Commands.Buffer,
+				state->DrawCount.Buffer, instanceCount);
+		}).read(vertices, ResourceUsage::VertexBufferRead).read(instances, ResourceUsage::VertexBufferRead).read(indices, ResourceUsage::IndexBufferRead)
+			.read(commands, ResourceUsage::IndirectBufferRead).read(drawCount, ResourceUsage::IndirectBufferRead).write(depth, ResourceUsage::DepthAttachmentWrite);
+		graph.addPass("Hi-Z pyramid", [&pyramid, &renderer, &recorded](VkCommandBuffer cb)
+		{
+			recorded = pyramid.record(cb, renderer.Depth.View, VK_IMAGE_LAYOUT_GENERAL) && recorded;
+		}).read(depth, ResourceUsage::ComputeShaderRead).write(hiZ, ResourceUsage::ComputeShaderWrite);
+		graph.addPass("Occlusion culling", [state, &culling, &pyramid, &recorded, instanceCount](VkCommandBuffer cb)
+		{
+			const CullDescriptors buffers = { { state->Instances.Buffer, 0, VK_WHOLE_SIZE }, { state->Meshes.Buffer, 0, VK_WHOLE_SIZE },
+				{ state->OcclusionViewBuffer.Buffer, 0, VK_WHOLE_SIZE }, { state->OcclusionCommands.Buffer, 0, VK_WHOLE_SIZE }, { state->OcclusionDrawCount.Buffer, 0, VK_WHOLE_SIZE } };
+			recorded = culling.recordOcclusionCull(cb, buffers, pyramid.View, instanceCount, instanceCount, VK_IMAGE_LAYOUT_GENERAL) && recorded;
+		}).read(instances, ResourceUsage::ComputeShaderRead).read(meshes, ResourceUsage::ComputeShaderRead).read(occlusionView, ResourceUsage::UniformBufferRead)
+			.read(hiZ, ResourceUsage::ComputeShaderRead).write(occlusionCommands, ResourceUsage::ComputeShaderWrite).write(occlusionDrawCount, ResourceUsage::ComputeShaderWrite);
+		graph.addPass("Readback", [state, &renderer, &pyramid](VkCommandBuffer cb)
+		{
+			VkBufferImageCopy region = {};
+			region.bufferOffset = 0;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 };
+			region.imageOffset = { 0, 0, 0 };
+			region.imageExtent = { renderer.Width, renderer.Height, 1 };
+			VulkanFunctionLoaders::vkCmdCopyImageToBuffer(cb, renderer.Depth.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, state->DepthReadback.Buffer, 1, &region);
+			pyramid.recordReadback(cb, state->PyramidReadback.Buffer);
+		}).read(depth, ResourceUsage::TransferRead).read(hiZ, ResourceUsage::TransferRead).write(depthReadback, ResourceUsage::TransferWrite)
+			.write(pyramidReadback, ResourceUsage::TransferWrite);
+		graph.markOutput(occlusionCommands, ResourceUsage::HostRead);
+		graph.markOutput(occlusionDrawCount, ResourceUsage::HostRead);
+		graph.markOutput(depthReadback, ResourceUsage::HostRead);
+		graph.markOutput(pyramidReadback, ResourceUsage::HostRead);
+
+		if (!graph.compile()) { return false; }
+		graph.execute(commandBuffer);
+		return recorded;
+	};
+	workload.Verify = [state, &renderer, instanceCount]()
+	{
+		const size_t texelCount = static_cast<size_t>(renderer.Width) * renderer.Height;
+		std::vector<float> depth(texelCount);
+		for (size_t i = 0; i < texelCount; ++i)
+		{
+			depth[i] = renderer.Depth.Format == VK_FORMAT_D16_UNORM ? static_cast<const uint16_t*>(state->DepthReadback.Mapped)[i] / 65535.0f :
+				static_cast<const float*>(state->DepthReadback.Mapped)[i];
+		}
+
+		// Note: Nothing but mins & maxes of what's in the depth buffer - only the GPU's unorm to float conversion (for D16) can differ at all
+		const std::vector<float> expected = buildHiZPyramidOnCpu(depth.data(), renderer.Width, renderer.Height);
+		const float* pyramid = static_cast<const float*>(state->PyramidReadback.Mapped);
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			if (std::fabs(pyramid[i] - expected[i]) > 1.0e-6f) { return false; }
+		}
+
+		const uint32_t drawCount = *static_cast<const uint32_t*>(state->OcclusionDrawCount.Mapped);
+		uint32_t occludedCount = 0;
+		if (!checkOcclusionCulling(state->OcclusionView, state->Scene.Instances.data(), instanceCount, state->Scene.Meshes,
+			static_cast<const VkDrawIndexedIndirectCommand*>(state->OcclusionCommands.Mapped), drawCount, depth.data(), renderer.Width, renderer.Height, occludedCount))
+		{
+			return false;
+		}
+		LOG_VERBOSE("[OK] Hi-Z occlusion culling drew {} instances and hid {} more inside the frustum.", drawCount, occludedCount);
+		return occludedCount > 0;
+	};
+	return workload;
+}
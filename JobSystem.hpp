@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Logger.hpp"
+#include "TraceRecorder.hpp"
+
+// Class to run jobs on a fixed pool of worker threads. Jobs are run in the order they're submitted (though with more than one worker
+// they can of course finish in any order), and `waitIdle` blocks until every job submitted so far has finished.
+//
+// Note: This is deliberately simple - one mutex-protected queue that every worker takes from. That's plenty for jobs that each do a
+// decent chunk of work (e.g., encoding a whole frame) - it's NOT the thing to use for thousands of tiny jobs, where the lock would be
+// the bottleneck.
+class JobSystem
+{
+public:
+
+	// Method to start the workers. A `threadCount` of 0 means one per hardware thread, less one for the thread that's submitting jobs.
+	bool create(uint32_t threadCount = 0)
+	{
+		if (threadCount == 0)
+		{
+			const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		stopping = false;
+		workers.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			workers.emplace_back([this, i]() { workerLoop(i); });
+		}
+		LOG_VERBOSE("[OK] Started job system with {} worker thread(s).", threadCount);
+		return true;
+	}
+
+	// Method to queue a job to run on one of the workers. Safe to call from any thread (including from inside a job).
+	void submit(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(job));
+			++unfinishedJobs;
+		}
+		jobAvailable.notify_one();
+	}
+
+	// Method to block until every job submitted so far has finished
+	// CAREFUL: Don't call this from inside a job - it would be waiting for itself!
+	void waitIdle()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		allJobsFinished.wait(lock, [this]() { return unfinishedJobs == 0; });
+	}
+
+	// Method to run `body(begin, end)` over every index in [0, `count`), in chunks of `chunkSize` that the workers AND the calling thread grab
+	// one at a time until there are none left - so a chunk that takes longer than the rest doesn't hold everyone else up. Returns once every
+	// chunk has finished (and, unlike `waitIdle`, doesn't wait for anything else that's been submitted).
+	// Note: That's one job per worker however many chunks there are, so it's fine for a few dozen chunks of a few microseconds each.
+	// CAREFUL: Don't call this from inside a job either - it would be waiting on workers that may all be waiting too!
+	void parallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t, uint32_t)>& body)
+	{
+		chunkSize = std::max(chunkSize, 1u);
+		const uint32_t chunkCount = (count + chunkSize - 1) / chunkSize;
+		if (chunkCount <= 1 || workers.empty())
+		{
+			for (uint32_t begin = 0; begin < count; begin += chunkSize) { body(begin, std::min(begin + chunkSize, count)); }
+			return;
+		}
+
+		// Note: Shared, as a worker may only get round to its job after every chunk is done and we've returned - it just finds nothing to do
+		struct ParallelFor
+		{
+			std::atomic<uint32_t> NextChunk = 0;
+			std::atomic<uint32_t> ChunksLeft = 0;
+			std::mutex Mutex;
+			std::condition_variable Finished;
+			const std::function<void(uint32_t, uint32_t)>* Body = nullptr;
+			uint32_t Count = 0;
+			uint32_t ChunkSize = 0;
+			uint32_t ChunkCount = 0;
+		};
+		auto shared = std::make_shared<ParallelFor>();
+		shared->ChunksLeft = chunkCount;
+		shared->Body = &body;
+		shared->Count = count;
+		shared->ChunkSize = chunkSize;
+		shared->ChunkCount = chunkCount;
+		auto runChunks = [](ParallelFor& state)
+		{
+			for (;;)
+			{
+				const uint32_t chunk = state.NextChunk.fetch_add(1);
+				if (chunk >= state.ChunkCount) { return; }
+				const uint32_t begin = chunk * state.ChunkSize;
+				(*state.Body)(begin, std::min(begin + state.ChunkSize, state.Count));
+				if (state.ChunksLeft.fetch_sub(1) == 1)
+				{
+					std::lock_guard<std::mutex> lock(state.Mutex);
+					state.Finished.notify_all();
+				}
+			}
+		};
+
+		const uint32_t helpers = std::min(getThreadCount(), chunkCount - 1);
+		for (uint32_t i = 0; i < helpers; ++i) { submit([shared, runChunks]() { runChunks(*shared); }); }
+		runChunks(*shared);
+		std::unique_lock<std::mutex> lock(shared->Mutex);
+		shared->Finished.wait(lock, [&shared]() { return shared->ChunksLeft.load() == 0; });
+	}
+
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+	// Method to finish any queued jobs and then stop & join the workers
+	void destroy()
+	{
+		waitIdle();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		jobAvailable.notify_all();
+		for (std::thread& worker : workers) { worker.join(); }
+		workers.clear();
+	}
+
+	~JobSystem() { if (!workers.empty()) { destroy(); } }
+
+private:
+
+	void workerLoop(uint32_t workerIndex)
+	{
+		if (TraceRecorder::isEnabled()) { TraceRecorder::setThreadName("Worker " + std::to_string(workerIndex)); }
+
+		for (;;)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				if (jobs.empty()) { return; } // Only happens when we're stopping
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+
+			job();
+
+			bool idle = false;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				idle = --unfinishedJobs == 0;
+			}
+			if (idle) { allJobsFinished.notify_all(); }
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable allJobsFinished;
+	uint64_t unfinishedJobs = 0;
+	bool stopping = false;
+};
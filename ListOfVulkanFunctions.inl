@@ -35,6 +35,9 @@ INSTANCE_LEVEL_VULKAN_FUNCTION( vkGetPhysicalDeviceQueueFamilyProperties )
 INSTANCE_LEVEL_VULKAN_FUNCTION( vkGetPhysicalDeviceFeatures )
 INSTANCE_LEVEL_VULKAN_FUNCTION( vkCreateDevice )
 INSTANCE_LEVEL_VULKAN_FUNCTION( vkGetDeviceProcAddr )
+INSTANCE_LEVEL_VULKAN_FUNCTION( vkGetPhysicalDeviceMemoryProperties )
+INSTANCE_LEVEL_VULKAN_FUNCTION( vkGetPhysicalDeviceFormatProperties )
+INSTANCE_LEVEL_VULKAN_FUNCTION( vkDestroyInstance )
 
 #undef INSTANCE_LEVEL_VULKAN_FUNCTION
 
@@ -50,6 +53,10 @@ INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( vkGetPhysicalDeviceSurfaceFormats
 INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( vkGetPhysicalDeviceSurfacePresentModesKHR, VK_KHR_SURFACE_EXTENSION_NAME)
 INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( vkDestroySurfaceKHR,                       VK_KHR_SURFACE_EXTENSION_NAME)
 
+// Note: We need these to ask about features & properties that `VkPhysicalDeviceFeatures` / `VkPhysicalDeviceProperties` predate (e.g., 16-bit storage)
+INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( vkGetPhysicalDeviceFeatures2KHR,           VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)
+INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( vkGetPhysicalDeviceProperties2KHR,         VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)
+
 // Put this somewhere: Logical devices represent physical devices for which a set of features and extensions are enabled
 
 // Note: These platform specific instance functions from extensions are for Windows (1st) and Linux (2nd and 3rd).
@@ -62,9 +69,9 @@ INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( vkDestroySurfaceKHR,
 #ifdef VK_USE_PLATFORM_WIN32_KHR
 	//INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( vkCreateWin32SurfaceKHR, VK_KHR_WIN32_SURFACE_EXTENSION_NAME)
 #elif defined VK_USE_PLATFORM_XCB_KHR
-	INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCreateXcbSurfaceKHR, VK_KHR_XLIB_SURFACE_EXTENSION_NAME)
+	INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCreateXcbSurfaceKHR, VK_KHR_XCB_SURFACE_EXTENSION_NAME)
 #elif defined VK_USE_PLATFORM_XLIB_KHR
-	INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCreateXlibSurfaceKHR, VK_KHR_XCB_SURFACE_EXTENSION_NAME)
+	INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCreateXlibSurfaceKHR, VK_KHR_XLIB_SURFACE_EXTENSION_NAME)
 #endif
 
 #undef INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION
@@ -88,6 +95,103 @@ DEVICE_LEVEL_VULKAN_FUNCTION(vkDeviceWaitIdle)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyDevice)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateBuffer)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkGetBufferMemoryRequirements)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkAllocateMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkFreeMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkBindBufferMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkMapMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkUnmapMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkInvalidateMappedMemoryRanges)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateImage)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkGetImageMemoryRequirements)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkBindImageMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyImage)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateImageView)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyImageView)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkGetDeviceMemoryCommitment)
+
+// Render passes & framebuffers
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateRenderPass)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyRenderPass)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateFramebuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyFramebuffer)
+
+// Samplers, descriptor set layouts & pipeline layouts
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateSampler)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroySampler)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateDescriptorSetLayout)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyDescriptorSetLayout)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreatePipelineLayout)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyPipelineLayout)
+
+// Shader modules & pipelines
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateShaderModule)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyShaderModule)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateComputePipelines)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateGraphicsPipelines)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyPipeline)
+
+// Descriptor pools & sets
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateDescriptorPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyDescriptorPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkResetDescriptorPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkAllocateDescriptorSets)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkUpdateDescriptorSets)
+
+// Command pools, command buffers & submission
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateCommandPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkResetCommandPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyCommandPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkAllocateCommandBuffers)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkFreeCommandBuffers)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkBeginCommandBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkEndCommandBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkQueueSubmit)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkQueueWaitIdle)
+
+// Fences
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateFence)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyFence)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkResetFences)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkWaitForFences)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkGetFenceStatus)
+
+// Semaphores (see the timeline semaphore functions in the extension section below)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateSemaphore)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroySemaphore)
+
+// Events
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateEvent)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyEvent)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkResetEvent)
+
+// Commands we record into command buffers
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdFillBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdCopyBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdPipelineBarrier)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdClearColorImage)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdCopyImageToBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdCopyBufferToImage)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBeginRenderPass)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdEndRenderPass)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindPipeline)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindDescriptorSets)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdPushConstants)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDispatch)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDispatchIndirect)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindVertexBuffers)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindIndexBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDrawIndexed)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDrawIndexedIndirect)
+
+// Queries (timestamps etc.)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateQueryPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyQueryPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdResetQueryPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdWriteTimestamp)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBeginQuery)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdEndQuery)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkGetQueryPoolResults)
 
 #undef DEVICE_LEVEL_VULKAN_FUNCTION
 
@@ -103,4 +207,20 @@ DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkAcquireNextImageKHR,   VK_KHR_SWAP
 DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkQueuePresentKHR,       VK_KHR_SWAPCHAIN_EXTENSION_NAME)
 DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkDestroySwapchainKHR,   VK_KHR_SWAPCHAIN_EXTENSION_NAME)
 
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkGetCalibratedTimestampsEXT, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)
+
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkGetSemaphoreCounterValueKHR, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkWaitSemaphoresKHR,           VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkSignalSemaphoreKHR,          VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)
+
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCmdPipelineBarrier2KHR, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME)
+
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCreateDescriptorUpdateTemplateKHR,  VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkDestroyDescriptorUpdateTemplateKHR, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkUpdateDescriptorSetWithTemplateKHR, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)
+
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkResetQueryPoolEXT, VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME)
+
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCmdDrawIndexedIndirectCountKHR, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)
+
 #undef DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION
\ No newline at end of file
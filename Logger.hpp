@@ -0,0 +1,283 @@
+#pragma once
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+// How chatty we are. Each level includes all the levels above it, so `Verbose` also gets `Info`, `Warning` and `Error` messages.
+// Note: `Verbose` and `VeryVerbose` replace what used to be the compile-time `VERBOSE` and `VERY_VERBOSE` flags in `main`.
+enum class LogLevel : uint8_t
+{
+	Error       = 0, // Something failed - we usually bail out after these
+	Warning     = 1, // Something's not right but we can carry on
+	Info        = 2, // Things the user asked to see (summaries, results etc.)
+	Verbose     = 3, // Step-by-step progress of what we're doing
+	VeryVerbose = 4  // Everything - e.g., every extension & every physical device property
+};
+
+// Class to log messages without slowing down the thread doing the logging.
+//
+// Callers never format or write anything themselves: `log` copies the format string pointer and the (typed) arguments into a slot of a
+// fixed-size, lock-free multi-producer / single-consumer ring, and a background thread does the formatting and the writing - in
+// batches, flushing once per batch rather than once per line like `cout << ... << endl` does. And when a level is disabled, the
+// `LOG_...` macros skip the call entirely - so disabled messages cost one relaxed atomic load and a compare, and their arguments are
+// never even evaluated.
+//
+// Messages are formatted Python / std::format style, with each `{}` replaced by the next argument:
+//     LOG_VERBOSE("[OK] Found {} physical device(s).", physicalDeviceCount);
+//
+// CAREFUL: The format string must be a string literal (we keep the pointer, not a copy). String arguments ARE copied, so temporaries and
+// stack buffers are fine to pass as arguments.
+//
+// The ring is a bounded MPMC queue in the style of Dmitry Vyukov's, used here with a single consumer.
+// See: https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+class Logger
+{
+public:
+
+	static bool isEnabled(LogLevel level) { return static_cast<uint8_t>(level) <= levelValue().load(std::memory_order_relaxed); }
+	static void setLevel(LogLevel level) { levelValue().store(static_cast<uint8_t>(level), std::memory_order_relaxed); }
+	static LogLevel getLevel() { return static_cast<LogLevel>(levelValue().load(std::memory_order_relaxed)); }
+
+	// Method to turn a level name from the command line (e.g., "warning", "very-verbose") into a `LogLevel`. Returns false if we don't know it.
+	static bool parseLevel(const std::string& text, LogLevel& level)
+	{
+		if (text == "error")        { level = LogLevel::Error;       return true; }
+		if (text == "warning")      { level = LogLevel::Warning;     return true; }
+		if (text == "info")         { level = LogLevel::Info;        return true; }
+		if (text == "verbose")      { level = LogLevel::Verbose;     return true; }
+		if (text == "very-verbose") { level = LogLevel::VeryVerbose; return true; }
+		return false;
+	}
+
+	// Method to queue a message. Prefer the `LOG_...` macros, which check the level first so that disabled messages cost (almost) nothing.
+	template <typename... Args>
+	static void log(LogLevel level, const char* format, const Args&... args)
+	{
+		static_assert(sizeof...(Args) <= MaxArgs, "Too many arguments for a single log message - split it up!");
+
+		Queue& queue = instance();
+		size_t position = 0;
+		Record& record = queue.reserve(position);
+		record.Level = level;
+		record.Format = format;
+		record.ArgCount = static_cast<uint8_t>(sizeof...(Args));
+		record.TextUsed = 0;
+
+		uint32_t argIndex = 0;
+		(capture(record, argIndex++, args), ...);
+
+		queue.commit(record, position);
+	}
+
+	// Method to block until everything logged so far has been written out
+	static void flush() { instance().flush(); }
+
+private:
+
+	static constexpr uint32_t MaxArgs = 8;
+	static constexpr uint32_t TextCapacity = 256;  // Room for copies of string arguments (longer strings get truncated)
+	static constexpr size_t RingCapacity = 1024;   // Must be a power of two
+
+	enum class ArgType : uint8_t { Bool, Int, UInt, Double, Pointer, Text };
+
+	struct Arg
+	{
+		ArgType Type;
+		union
+		{
+			bool BoolValue;
+			int64_t IntValue;
+			uint64_t UIntValue;
+			double DoubleValue;
+			const void* PointerValue;
+			struct { uint16_t Offset; uint16_t Length; } TextValue;
+		};
+	};
+
+	struct Record
+	{
+		std::atomic<size_t> Sequence{ 0 };
+		LogLevel Level = LogLevel::Info;
+		uint8_t ArgCount = 0;
+		uint16_t TextUsed = 0;
+		const char* Format = nullptr;
+		Arg Args[MaxArgs];
+		char Text[TextCapacity];
+	};
+
+	// ----- Argument capture -----
+
+	static void captureText(Record& record, uint32_t index, const char* text, size_t length)
+	{
+		const size_t available = TextCapacity - record.TextUsed;
+		const size_t copied = length < available ? length : available;
+		std::memcpy(record.Text + record.TextUsed, text, copied);
+		record.Args[index].Type = ArgType::Text;
+		record.Args[index].TextValue.Offset = record.TextUsed;
+		record.Args[index].TextValue.Length = static_cast<uint16_t>(copied);
+		record.TextUsed = static_cast<uint16_t>(record.TextUsed + copied);
+	}
+
+	template <typename T>
+	static void capture(Record& record, uint32_t index, const T& value)
+	{
+		Arg& arg = record.Args[index];
+		if constexpr (std::is_same_v<T, bool>)                                   { arg.Type = ArgType::Bool; arg.BoolValue = value; }
+		else if constexpr (std::is_same_v<T, char>)                              { captureText(record, index, &value, 1); }
+		else if constexpr (std::is_enum_v<T>)                                    { arg.Type = ArgType::Int; arg.IntValue = static_cast<int64_t>(value); }
+		else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)         { arg.Type = ArgType::Int; arg.IntValue = value; }
+		else if constexpr (std::is_integral_v<T>)                                { arg.Type = ArgType::UInt; arg.UIntValue = value; }
+		else if constexpr (std::is_floating_point_v<T>)                          { arg.Type = ArgType::Double; arg.DoubleValue = value; }
+		else if constexpr (std::is_array_v<T>)                                   { captureText(record, index, value, strnlen(value, sizeof(T))); } // e.g., `deviceName`
+		else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) { captureText(record, index, value != nullptr ? value : "(null)", value != nullptr ? strlen(value) : 6); }
+		else if constexpr (std::is_convertible_v<const T&, std::string_view>)   { const std::string_view text = value; captureText(record, index, text.data(), text.size()); }
+		else if constexpr (std::is_pointer_v<T>)                                 { arg.Type = ArgType::Pointer; arg.PointerValue = static_cast<const void*>(value); } // e.g., dispatchable Vulkan handles
+		else { static_assert(std::is_pointer_v<T>, "Unsupported log argument type"); }
+	}
+
+	// ----- Formatting (on the background thread) -----
+
+	static void appendArg(std::string& out, const Record& record, const Arg& arg)
+	{
+		char buffer[32];
+		switch (arg.Type)
+		{
+		case ArgType::Bool:    out += arg.BoolValue ? "1" : "0"; break; // Same as `cout` gives us by default
+		case ArgType::Int:     out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), arg.IntValue).ptr); break;
+		case ArgType::UInt:    out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), arg.UIntValue).ptr); break;
+		case ArgType::Double:  out.append(buffer, static_cast<size_t>(std::snprintf(buffer, sizeof(buffer), "%g", arg.DoubleValue))); break;
+		case ArgType::Pointer: out.append(buffer, static_cast<size_t>(std::snprintf(buffer, sizeof(buffer), "%p", arg.PointerValue))); break;
+		case ArgType::Text:    out.append(record.Text + arg.TextValue.Offset, arg.TextValue.Length); break;
+		}
+	}
+
+	static void format(std::string& out, const Record& record)
+	{
+		uint32_t nextArg = 0;
+		for (const char* c = record.Format; *c != '\0'; ++c)
+		{
+			if (c[0] == '{' && c[1] == '}' && nextArg < record.ArgCount)
+			{
+				appendArg(out, record, record.Args[nextArg++]);
+				++c;
+			}
+			else
+			{
+				out += *c;
+			}
+		}
+		out += '\n';
+	}
+
+	// ----- The ring & its consumer thread -----
+
+	class Queue
+	{
+	public:
+		Queue()
+		{
+			for (size_t i = 0; i < RingCapacity; ++i) { ring[i].Sequence.store(i, std::memory_order_relaxed); }
+			consumer = std::thread([this]() { consume(); });
+		}
+
+		// Note: This runs during static destruction, i.e., after `main` returns (or calls `exit`) - so everything gets written even if
+		// we bail out of `main` early with an error code.
+		~Queue()
+		{
+			stopping.store(true, std::memory_order_release);
+			consumer.join();
+		}
+
+		Record& reserve(size_t& position)
+		{
+			position = enqueuePosition.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				Record& record = ring[position & (RingCapacity - 1)];
+				const size_t sequence = record.Sequence.load(std::memory_order_acquire);
+				const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+				if (difference == 0)
+				{
+					if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) { return record; }
+				}
+				else if (difference < 0)
+				{
+					// The ring is full - we'd rather briefly wait for the consumer than lose messages (errors especially)
+					std::this_thread::yield();
+					position = enqueuePosition.load(std::memory_order_relaxed);
+				}
+				else
+				{
+					position = enqueuePosition.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		void commit(Record& record, size_t position) { record.Sequence.store(position + 1, std::memory_order_release); }
+
+		void flush()
+		{
+			const size_t target = enqueuePosition.load(std::memory_order_acquire);
+			while (written.load(std::memory_order_acquire) < target) { std::this_thread::yield(); }
+		}
+
+	private:
+		void consume()
+		{
+			std::string batch;
+			size_t position = 0;
+			for (;;)
+			{
+				// Drain everything that's ready, formatting into one string, then write it out in one go
+				batch.clear();
+				for (;;)
+				{
+					Record& record = ring[position & (RingCapacity - 1)];
+					if (record.Sequence.load(std::memory_order_acquire) != position + 1) { break; }
+					format(batch, record);
+					record.Sequence.store(position + RingCapacity, std::memory_order_release);
+					++position;
+				}
+
+				if (!batch.empty())
+				{
+					std::cout.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+					std::cout.flush();
+					written.store(position, std::memory_order_release);
+					continue;
+				}
+
+				if (stopping.load(std::memory_order_acquire) && position == enqueuePosition.load(std::memory_order_acquire)) { return; }
+
+				// Nothing to do - nap rather than spin. Producers never wake us (that would put a syscall back on their path), so a
+				// message may sit in the ring for up to a millisecond before it appears.
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+
+		Record ring[RingCapacity];
+		alignas(64) std::atomic<size_t> enqueuePosition{ 0 };
+		alignas(64) std::atomic<size_t> written{ 0 };
+		std::atomic<bool> stopping{ false };
+		std::thread consumer;
+	};
+
+	static std::atomic<uint8_t>& levelValue() { static std::atomic<uint8_t> level{ static_cast<uint8_t>(LogLevel::Verbose) }; return level; }
+	static Queue& instance() { static Queue queue; return queue; }
+};
+
+#define LOG_AT(level, ...) do { if (Logger::isEnabled(level)) { Logger::log(level, __VA_ARGS__); } } while (0)
+#define LOG_ERROR(...)        LOG_AT(LogLevel::Error, __VA_ARGS__)
+#define LOG_WARNING(...)      LOG_AT(LogLevel::Warning, __VA_ARGS__)
+#define LOG_INFO(...)         LOG_AT(LogLevel::Info, __VA_ARGS__)
+#define LOG_VERBOSE(...)      LOG_AT(LogLevel::Verbose, __VA_ARGS__)
+#define LOG_VERY_VERBOSE(...) LOG_AT(LogLevel::VeryVerbose, __VA_ARGS__)
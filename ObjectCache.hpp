@@ -0,0 +1,465 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+
+// The kinds of object an `ObjectCache` can hold
+enum class CachedObjectType : uint32_t
+{
+	Sampler,
+	DescriptorSetLayout,
+	PipelineLayout,
+	RenderPass
+};
+
+// How well an `ObjectCache` has been doing. `Hits` are acquires that got an existing object, `Misses` ones that had to create one.
+struct ObjectCacheStats
+{
+	uint64_t Hits = 0;
+	uint64_t Misses = 0;
+	uint32_t LiveObjects = 0;     // Objects that currently exist, i.e., have at least one reference
+	uint32_t DistinctObjects = 0; // Different create infos we've ever seen
+};
+
+// Class to de-duplicate immutable Vulkan objects - samplers, descriptor set layouts, pipeline layouts and render passes. Asking for an
+// object whose create info matches one we've already made gives back the same handle, with its reference count bumped - so the driver
+// only ever holds one of each, and we don't burn through `maxSamplerAllocationCount` (which can be as low as 4000) making the same
+// sampler over and over. Each `acquireX` must be matched by a `releaseX` of the handle it returned, and the object is destroyed when the
+// last reference goes.
+//
+// Create infos are turned into a "key": a flat array of 32-bit words holding every field, following the pointers (so two layouts with
+// the same bindings in different arrays - or in a different order - match). Keys are hashed into an open-addressed table of entries.
+// Looking up an object that's already alive is lock-free: readers walk the table and bump the entry's reference count with a
+// compare-and-swap. Only creating an object, or bringing a dead entry back to life, takes the mutex (as does `release`).
+// Note: Entries are never removed from the table - when an object's last reference goes we destroy the Vulkan object but keep its entry
+// (with no handle) to re-use if that create info comes back. And when the table fills up we publish a bigger one but keep the old one
+// around until `destroy`, as a lock-free reader may still be walking it. So nothing a reader can reach is ever freed under it.
+// Note: The repo does ship `vulkan_hash.hpp`, but its `std::hash` specialisations are for the C++ bindings' types and hash each pointer
+// member by its address (not what it points at) - so two identical `VkDescriptorSetLayoutCreateInfo`s in different arrays wouldn't
+// match. Hence our own keys.
+// CAREFUL: Create infos with a `pNext` chain aren't supported (we'd have to know how to key every struct that might be on it) - asking
+// for one logs an error and returns `VK_NULL_HANDLE`.
+class ObjectCache
+{
+public:
+	bool create(VkDevice logicalDevice, uint32_t initialCapacity = 256)
+	{
+		device = logicalDevice;
+		uint32_t capacity = 16;
+		while (capacity < initialCapacity) { capacity *= 2; }
+		publishTable(capacity);
+		return true;
+	}
+
+	VkSampler acquireSampler(const VkSamplerCreateInfo& createInfo)
+	{
+		if (!checkNoChain(createInfo.pNext, "sampler")) { return VK_NULL_HANDLE; }
+		KeyBuilder key(CachedObjectType::Sampler);
+		key.add(createInfo.flags);
+		key.add(createInfo.magFilter);
+		key.add(createInfo.minFilter);
+		key.add(createInfo.mipmapMode);
+		key.add(createInfo.addressModeU);
+		key.add(createInfo.addressModeV);
+		key.add(createInfo.addressModeW);
+		key.addFloat(createInfo.mipLodBias);
+		key.add(createInfo.anisotropyEnable);
+		key.addFloat(createInfo.maxAnisotropy);
+		key.add(createInfo.compareEnable);
+		key.add(createInfo.compareOp);
+		key.addFloat(createInfo.minLod);
+		key.addFloat(createInfo.maxLod);
+		key.add(createInfo.borderColor);
+		key.add(createInfo.unnormalizedCoordinates);
+
+		return fromHandleValue<VkSampler>(acquireObject(key.Words, [this, &createInfo](uint64_t& handleValue)
+		{
+			VkSampler sampler = VK_NULL_HANDLE;
+			const VkResult result = VulkanFunctionLoaders::vkCreateSampler(device, &createInfo, nullptr, &sampler);
+			handleValue = toHandleValue(sampler);
+			return result;
+		}));
+	}
+
+	// Note: Bindings are keyed in binding-number order, as the order they're listed in doesn't change the layout
+	VkDescriptorSetLayout acquireDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& createInfo)
+	{
+		if (!checkNoChain(createInfo.pNext, "descriptor set layout")) { return VK_NULL_HANDLE; }
+		std::vector<const VkDescriptorSetLayoutBinding*> bindings(createInfo.bindingCount);
+		for (uint32_t i = 0; i < createInfo.bindingCount; ++i) { bindings[i] = &createInfo.pBindings[i]; }
+		std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding* a, const VkDescriptorSetLayoutBinding* b) { return a->binding < b->binding; });
+
+		KeyBuilder key(CachedObjectType::DescriptorSetLayout);
+		key.add(createInfo.flags);
+		key.add(createInfo.bindingCount);
+		for (const VkDescriptorSetLayoutBinding* binding : bindings)
+		{
+			key.add(binding->binding);
+			key.add(binding->descriptorType);
+			key.add(binding->descriptorCount);
+			key.add(binding->stageFlags);
+
+			// Note: Immutable samplers are only looked at for sampler descriptors - for anything else the pointer is ignored
+			const bool hasImmutableSamplers = binding->pImmutableSamplers != nullptr &&
+				(binding->descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER || binding->descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+			key.add(hasImmutableSamplers ? binding->descriptorCount : 0u);
+			for (uint32_t i = 0; hasImmutableSamplers && i < binding->descriptorCount; ++i) { key.addHandle(binding->pImmutableSamplers[i]); }
+		}
+
+		return fromHandleValue<VkDescriptorSetLayout>(acquireObject(key.Words, [this, &createInfo](uint64_t& handleValue)
+		{
+			VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+			const VkResult result = VulkanFunctionLoaders::vkCreateDescriptorSetLayout(device, &createInfo, nullptr, &layout);
+			handleValue = toHandleValue(layout);
+			return result;
+		}));
+	}
+
+	// Note: Set layouts are keyed by handle - so they should come from this cache too, or equal layouts made separately won't match
+	VkPipelineLayout acquirePipelineLayout(const VkPipelineLayoutCreateInfo& createInfo)
+	{
+		if (!checkNoChain(createInfo.pNext, "pipeline layout")) { return VK_NULL_HANDLE; }
+		KeyBuilder key(CachedObjectType::PipelineLayout);
+		key.add(createInfo.flags);
+		key.add(createInfo.setLayoutCount);
+		for (uint32_t i = 0; i < createInfo.setLayoutCount; ++i) { key.addHandle(createInfo.pSetLayouts[i]); }
+		key.add(createInfo.pushConstantRangeCount);
+		for (uint32_t i = 0; i < createInfo.pushConstantRangeCount; ++i)
+		{
+			key.add(createInfo.pPushConstantRanges[i].stageFlags);
+			key.add(createInfo.pPushConstantRanges[i].offset);
+			key.add(createInfo.pPushConstantRanges[i].size);
+		}
+
+		return fromHandleValue<VkPipelineLayout>(acquireObject(key.Words, [this, &createInfo](uint64_t& handleValue)
+		{
+			VkPipelineLayout layout = VK_NULL_HANDLE;
+			const VkResult result = VulkanFunctionLoaders::vkCreatePipelineLayout(device, &createInfo, nullptr, &layout);
+			handleValue = toHandleValue(layout);
+			return result;
+		}));
+	}
+
+	VkRenderPass acquireRenderPass(const VkRenderPassCreateInfo& createInfo)
+	{
+		if (!checkNoChain(createInfo.pNext, "render pass")) { return VK_NULL_HANDLE; }
+		KeyBuilder key(CachedObjectType::RenderPass);
+		key.add(createInfo.flags);
+		key.add(createInfo.attachmentCount);
+		for (uint32_t i = 0; i < createInfo.attachmentCount; ++i)
+		{
+			const VkAttachmentDescription& attachment = createInfo.pAttachments[i];
+			key.add(attachment.flags);
+			key.add(attachment.format);
+			key.add(attachment.samples);
+			key.add(attachment.loadOp);
+			key.add(attachment.storeOp);
+			key.add(attachment.stencilLoadOp);
+			key.add(attachment.stencilStoreOp);
+			key.add(attachment.initialLayout);
+			key.add(attachment.finalLayout);
+		}
+		key.add(createInfo.subpassCount);
+		for (uint32_t i = 0; i < createInfo.subpassCount; ++i)
+		{
+			const VkSubpassDescription& subpass = createInfo.pSubpasses[i];
+			key.add(subpass.flags);
+			key.add(subpass.pipelineBindPoint);
+			key.addReferences(subpass.inputAttachmentCount, subpass.pInputAttachments);
+			key.addReferences(subpass.colorAttachmentCount, subpass.pColorAttachments);
+			key.addReferences(subpass.pResolveAttachments != nullptr ? subpass.colorAttachmentCount : 0, subpass.pResolveAttachments);
+			key.addReferences(subpass.pDepthStencilAttachment != nullptr ? 1 : 0, subpass.pDepthStencilAttachment);
+			key.add(subpass.preserveAttachmentCount);
+			for (uint32_t j = 0; j < subpass.preserveAttachmentCount; ++j) { key.add(subpass.pPreserveAttachments[j]); }
+		}
+		key.add(createInfo.dependencyCount);
+		for (uint32_t i = 0; i < createInfo.dependencyCount; ++i)
+		{
+			const VkSubpassDependency& dependency = createInfo.pDependencies[i];
+			key.add(dependency.srcSubpass);
+			key.add(dependency.dstSubpass);
+			key.add(dependency.srcStageMask);
+			key.add(dependency.dstStageMask);
+			key.add(dependency.srcAccessMask);
+			key.add(dependency.dstAccessMask);
+			key.add(dependency.dependencyFlags);
+		}
+
+		return fromHandleValue<VkRenderPass>(acquireObject(key.Words, [this, &createInfo](uint64_t& handleValue)
+		{
+			VkRenderPass renderPass = VK_NULL_HANDLE;
+			const VkResult result = VulkanFunctionLoaders::vkCreateRenderPass(device, &createInfo, nullptr, &renderPass);
+			handleValue = toHandleValue(renderPass);
+			return result;
+		}));
+	}
+
+	// Methods to drop a reference to an object we handed out, destroying it if that was the last one.
+	// Note: These can't just be overloads of one `release` - on 32-bit platforms every non-dispatchable handle is a `uint64_t`.
+	// CAREFUL: As with destroying it directly, nothing pending on the GPU may still be using the object if this is its last reference.
+	void releaseSampler(VkSampler sampler)                         { releaseObject(toHandleValue(sampler)); }
+	void releaseDescriptorSetLayout(VkDescriptorSetLayout layout) { releaseObject(toHandleValue(layout)); }
+	void releasePipelineLayout(VkPipelineLayout layout)            { releaseObject(toHandleValue(layout)); }
+	void releaseRenderPass(VkRenderPass renderPass)                { releaseObject(toHandleValue(renderPass)); }
+
+	ObjectCacheStats getStats()
+	{
+		ObjectCacheStats stats;
+		stats.Hits = hits.load(std::memory_order_relaxed);
+		stats.Misses = misses.load(std::memory_order_relaxed);
+		std::lock_guard<std::mutex> lock(writeMutex);
+		stats.LiveObjects = static_cast<uint32_t>(entriesByHandle.size());
+		stats.DistinctObjects = static_cast<uint32_t>(entries.size());
+		return stats;
+	}
+
+	// Method to destroy every object still in the cache - whether or not it's been released - and free the tables.
+	// CAREFUL: No other thread may be using the cache, and the GPU must be done with all of its objects.
+	void destroy()
+	{
+		if (!entriesByHandle.empty())
+		{
+			LOG_WARNING("[WARNING] Object cache destroyed with {} object(s) still referenced.", static_cast<uint32_t>(entriesByHandle.size()));
+		}
+		for (auto& [handleValue, entry] : entriesByHandle) { destroyObject(entry->Type, handleValue); }
+		entriesByHandle.clear();
+		entries.clear();
+		table.store(nullptr, std::memory_order_relaxed);
+		tables.clear();
+		hits.store(0, std::memory_order_relaxed);
+		misses.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	// Builds a create info's key. The first word is the object type, so different kinds of object never match each other.
+	struct KeyBuilder
+	{
+		std::vector<uint32_t> Words;
+
+		explicit KeyBuilder(CachedObjectType type) { Words.reserve(32); Words.push_back(static_cast<uint32_t>(type)); }
+
+		template <typename T>
+		void add(T value)
+		{
+			static_assert(sizeof(T) == sizeof(uint32_t) && !std::is_floating_point_v<T>, "Key fields must be 32-bit integers, flags or enums - use addFloat for floats");
+			Words.push_back(static_cast<uint32_t>(value));
+		}
+
+		// Note: Floats go in by their bits, so e.g., 0.0 & -0.0 are different keys - which just means we might make one object too many
+		void addFloat(float value) { uint32_t bits; std::memcpy(&bits, &value, sizeof(bits)); Words.push_back(bits); }
+
+		template <typename T>
+		void addHandle(T handle)
+		{
+			const uint64_t value = toHandleValue(handle);
+			Words.push_back(static_cast<uint32_t>(value));
+			Words.push_back(static_cast<uint32_t>(value >> 32));
+		}
+
+		void addReferences(uint32_t count, const VkAttachmentReference* references)
+		{
+			Words.push_back(count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				Words.push_back(references[i].attachment);
+				Words.push_back(static_cast<uint32_t>(references[i].layout));
+			}
+		}
+	};
+
+	// Non-dispatchable handles are pointers on 64-bit platforms but `uint64_t`s on 32-bit ones - so we store them all as the latter
+	template <typename T>
+	static uint64_t toHandleValue(T handle)
+	{
+		if constexpr (std::is_pointer_v<T>) { return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle)); }
+		else { return static_cast<uint64_t>(handle); }
+	}
+	template <typename T>
+	static T fromHandleValue(uint64_t value)
+	{
+		if constexpr (std::is_pointer_v<T>) { return reinterpret_cast<T>(static_cast<uintptr_t>(value)); }
+		else { return static_cast<T>(value); }
+	}
+
+	// One create info we've seen. `References` is 0 while there's no live object (and then `Handle` is either 0, or an object that's
+	// on its way to being destroyed - see `acquireObject`).
+	struct Entry
+	{
+		uint64_t Hash = 0;
+		CachedObjectType Type = CachedObjectType::Sampler;
+		std::vector<uint32_t> Key;
+		std::atomic<uint64_t> Handle{ 0 };
+		std::atomic<uint32_t> References{ 0 };
+	};
+
+	struct Table
+	{
+		std::unique_ptr<std::atomic<Entry*>[]> Slots;
+		uint32_t Mask = 0;
+	};
+
+	// FNV-1a, a word at a time
+	static uint64_t hashKey(const std::vector<uint32_t>& key)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (uint32_t word : key) { hash = (hash ^ word) * 1099511628211ull; }
+		return hash;
+	}
+
+	static bool checkNoChain(const void* pNext, const char* objectName)
+	{
+		if (pNext == nullptr) { return true; }
+		LOG_ERROR("[FAIL] Object cache can't key a {} create info with a pNext chain.", objectName);
+		return false;
+	}
+
+	Entry* findEntry(uint64_t hash, const std::vector<uint32_t>& key) const
+	{
+		const Table* current = table.load(std::memory_order_acquire);
+		for (uint32_t i = static_cast<uint32_t>(hash) & current->Mask; ; i = (i + 1) & current->Mask)
+		{
+			Entry* entry = current->Slots[i].load(std::memory_order_acquire);
+			if (entry == nullptr) { return nullptr; }
+			if (entry->Hash == hash && entry->Key == key) { return entry; }
+		}
+	}
+
+	// Method to take a reference to an entry's object - but only if it's alive. An entry at 0 is dead (or dying), and only the mutex
+	// holder may bring it back.
+	static bool tryAddReference(Entry* entry)
+	{
+		uint32_t references = entry->References.load(std::memory_order_relaxed);
+		while (references > 0)
+		{
+			if (entry->References.compare_exchange_weak(references, references + 1, std::memory_order_acquire, std::memory_order_relaxed)) { return true; }
+		}
+		return false;
+	}
+
+	// Method to make a new table of `capacity` slots holding every entry we have, and publish it to readers.
+	// Note: Must hold the mutex (or be in `create`).
+	void publishTable(uint32_t capacity)
+	{
+		auto newTable = std::make_unique<Table>();
+		newTable->Slots = std::make_unique<std::atomic<Entry*>[]>(capacity);
+		newTable->Mask = capacity - 1;
+		for (uint32_t i = 0; i < capacity; ++i) { newTable->Slots[i].store(nullptr, std::memory_order_relaxed); }
+		for (const auto& entry : entries) { insertIntoTable(*newTable, entry.get()); }
+		table.store(newTable.get(), std::memory_order_release);
+		tables.push_back(std::move(newTable));
+	}
+
+	static void insertIntoTable(Table& target, Entry* entry)
+	{
+		uint32_t i = static_cast<uint32_t>(entry->Hash) & target.Mask;
+		while (target.Slots[i].load(std::memory_order_relaxed) != nullptr) { i = (i + 1) & target.Mask; }
+		target.Slots[i].store(entry, std::memory_order_release);
+	}
+
+	template <typename CreateFunction>
+	uint64_t acquireObject(const std::vector<uint32_t>& key, const CreateFunction& createObject)
+	{
+		// Fast path: the object is alive, so just take a reference
+		const uint64_t hash = hashKey(key);
+		Entry* entry = findEntry(hash, key);
+		if (entry != nullptr && tryAddReference(entry))
+		{
+			hits.fetch_add(1, std::memory_order_relaxed);
+			return entry->Handle.load(std::memory_order_relaxed);
+		}
+
+		// Slow path: look again under the mutex, as someone may have beaten us to it
+		std::lock_guard<std::mutex> lock(writeMutex);
+		entry = findEntry(hash, key);
+		if (entry != nullptr)
+		{
+			if (tryAddReference(entry) || entry->Handle.load(std::memory_order_relaxed) != 0)
+			{
+				// Note: If the count was 0 but the handle's still there, the last reference was dropped but `releaseObject` hasn't got the mutex
+				// to destroy it yet - so we can just bring it back, and it'll see the count isn't 0 any more.
+				if (entry->References.load(std::memory_order_relaxed) == 0) { entry->References.store(1, std::memory_order_release); }
+				hits.fetch_add(1, std::memory_order_relaxed);
+				return entry->Handle.load(std::memory_order_relaxed);
+			}
+		}
+		else
+		{
+			// Keep the table at most half full so probe chains stay short
+			if ((entries.size() + 1) * 2 > static_cast<size_t>(table.load(std::memory_order_relaxed)->Mask) + 1)
+			{
+				publishTable((table.load(std::memory_order_relaxed)->Mask + 1) * 2);
+			}
+			auto newEntry = std::make_unique<Entry>();
+			newEntry->Hash = hash;
+			newEntry->Type = static_cast<CachedObjectType>(key[0]);
+			newEntry->Key = key;
+			entry = newEntry.get();
+			entries.push_back(std::move(newEntry));
+			insertIntoTable(*table.load(std::memory_order_relaxed), entry);
+		}
+
+		uint64_t handleValue = 0;
+		const VkResult result = createObject(handleValue);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Object cache could not create object. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return 0;
+		}
+		entry->Handle.store(handleValue, std::memory_order_relaxed);
+		entriesByHandle[handleValue] = entry;
+		entry->References.store(1, std::memory_order_release);
+		misses.fetch_add(1, std::memory_order_relaxed);
+		return handleValue;
+	}
+
+	void releaseObject(uint64_t handleValue)
+	{
+		if (handleValue == 0) { return; }
+		std::lock_guard<std::mutex> lock(writeMutex);
+		auto found = entriesByHandle.find(handleValue);
+		if (found == entriesByHandle.end())
+		{
+			LOG_WARNING("[WARNING] Object cache asked to release an object it doesn't hold.");
+			return;
+		}
+
+		// Note: Nobody can bring the count back up from 0 without the mutex, which we hold - so once it's 0 the object is ours to destroy
+		Entry* entry = found->second;
+		if (entry->References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			destroyObject(entry->Type, handleValue);
+			entry->Handle.store(0, std::memory_order_relaxed);
+			entriesByHandle.erase(found);
+		}
+	}
+
+	void destroyObject(CachedObjectType type, uint64_t handleValue)
+	{
+		switch (type)
+		{
+		case CachedObjectType::Sampler:             VulkanFunctionLoaders::vkDestroySampler(device, fromHandleValue<VkSampler>(handleValue), nullptr); break;
+		case CachedObjectType::DescriptorSetLayout: VulkanFunctionLoaders::vkDestroyDescriptorSetLayout(device, fromHandleValue<VkDescriptorSetLayout>(handleValue), nullptr); break;
+		case CachedObjectType::PipelineLayout:      VulkanFunctionLoaders::vkDestroyPipelineLayout(device, fromHandleValue<VkPipelineLayout>(handleValue), nullptr); break;
+		case CachedObjectType::RenderPass:          VulkanFunctionLoaders::vkDestroyRenderPass(device, fromHandleValue<VkRenderPass>(handleValue), nullptr); break;
+		}
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	std::atomic<Table*> table{ nullptr };
+	std::vector<std::unique_ptr<Table>> tables;   // Every table we've published - see the class comment for why we keep the old ones
+	std::vector<std::unique_ptr<Entry>> entries;
+	std::unordered_map<uint64_t, Entry*> entriesByHandle; // Live objects only
+	std::mutex writeMutex;
+	std::atomic<uint64_t> hits{ 0 };
+	std::atomic<uint64_t> misses{ 0 };
+};
@@ -0,0 +1,694 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "GpuBuffer.hpp"
+#include "RenderTarget.hpp"
+#include "DeferredDeletionQueue.hpp"
+#include "TimelineSemaphore.hpp"
+#include "TraceRecorder.hpp"
+
+// One finished frame, as handed to a `FrameConsumer`
+struct ReadbackFrame
+{
+	uint64_t FrameNumber = 0;          // 1, 2, 3... in the order the frames were rendered (this is also the timeline value the frame signalled)
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	VkFormat Format = VK_FORMAT_UNDEFINED;
+	uint32_t RowPitch = 0;             // Bytes from the start of one row to the next - rows are tightly packed, so this is `Width * bytes per pixel`
+	const uint8_t* Pixels = nullptr;   // `Height * RowPitch` bytes, top row first
+};
+
+// Called once per frame, in frame order, on whichever thread calls `renderFrame` / `collectFinishedFrames` / `finish`.
+// CAREFUL: `Pixels` points straight into mapped readback memory, which gets re-used for a later frame as soon as the consumer returns - so
+// copy out anything that needs to live longer than the call. Unless the consumer was set with `consumerReleasesFrames`, in which case the
+// memory stays put until the consumer calls `releaseFrame` - which lets it hand the pixels off to other threads without copying them.
+using FrameConsumer = std::function<void(const ReadbackFrame&)>;
+
+// Records a frame's rendering into the given (already begun) command buffer. The target image is in `VK_IMAGE_LAYOUT_GENERAL` (which
+// clears, copies, storage writes and attachment writes all accept) and must be left in it. Return false to abort the frame.
+using FrameRecorder = std::function<bool(VkCommandBuffer commandBuffer, VkImage target, uint64_t frameNumber)>;
+
+// What a `RenderPassRecorder` renders into when the renderer was created with MSAA (see `createMsaaResolveRenderPass` for the attachments)
+struct RenderPassTarget
+{
+	VkRenderPass RenderPass = VK_NULL_HANDLE;
+	VkFramebuffer Framebuffer = VK_NULL_HANDLE;
+	VkExtent2D Extent = { 0, 0 };
+	VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT;
+};
+
+// Records a frame's rendering with MSAA. The recorder begins & ends the render pass itself (so it can pick the clear values) - ending it
+// resolves the multisampled colour into the frame's target, ready for readback. Return false to abort the frame.
+using RenderPassRecorder = std::function<bool(VkCommandBuffer commandBuffer, const RenderPassTarget& target, uint64_t frameNumber)>;
+
+// Class to render frames with no window or swapchain and get them back to the CPU without ever stalling the GPU.
+//
+// We keep a ring of `framesInFlight` slots, each with its own device-local target image, its own host-visible readback buffer and its own
+// command buffer. Each frame is rendered into its slot's image, copied into its slot's readback buffer and submitted signalling a timeline
+// semaphore to the frame's number. Nothing waits for that submission to finish: finished frames are spotted by polling the timeline and
+// handed to the consumer (in order) the next time we're called. The only time the CPU blocks is when every slot is still in use - i.e.,
+// the CPU has got `framesInFlight` frames ahead of the GPU - and even then the GPU already has the queued frames to be getting on with.
+//
+// With MSAA, each slot also gets multisampled colour & depth attachments and a framebuffer. Those are transient render targets (see
+// `RenderTarget`), so they're lazily allocated where the device allows it, and the render pass resolves into the slot's image before
+// anything gets written out - the multisampled data never needs to reach memory.
+//
+// Compare with the simple way of doing this (render, copy, `vkDeviceWaitIdle`, read): there the GPU sits idle while the CPU reads each
+// frame back and records the next one, and the CPU sits idle while the GPU renders.
+class OffscreenRenderer
+{
+public:
+
+	// CAREFUL: `device` must have timeline semaphores enabled (see `TimelineSemaphore`). Any queue family will do - we only need to be able
+	// to record transfer commands plus whatever the `FrameRecorder` records - unless `samples` is more than 1, in which case it must support
+	// graphics (for the render pass), and `samples` must be in the device's `framebufferColorSampleCounts` & `framebufferDepthSampleCounts`.
+	// If this returns false, `destroy` cleans up whatever did get made.
+	bool create(VkDevice logicalDevice, const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t queueFamilyIndex, VkQueue queue,
+		uint32_t width, uint32_t height, uint32_t framesInFlight = 3, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT)
+	{
+		device = logicalDevice;
+		activeQueue = queue;
+		frameWidth = width;
+		frameHeight = height;
+		frameFormat = format;
+		sampleCount = samples;
+		bytesPerPixel = getBytesPerPixel(format);
+		if (bytesPerPixel == 0)
+		{
+			LOG_ERROR("[FAIL] Offscreen rendering doesn't support image format: {}", format);
+			return false;
+		}
+		if (width == 0 || height == 0 || framesInFlight == 0)
+		{
+			LOG_ERROR("[FAIL] Offscreen render target must have a non-zero size and at least one frame in flight. Asked for {}x{} with {} frame(s) in flight.", width, height, framesInFlight);
+			return false;
+		}
+
+		VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+		commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		commandPoolCreateInfo.pNext = nullptr;
+		commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // Each slot re-records its own command buffer every time round
+		commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+		VkResult result = VulkanFunctionLoaders::vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create offscreen command pool. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+
+		if (!timeline.create(device, 0)) { return false; }
+		deletionQueue.create(device);
+
+		// We read every byte of every frame back on the CPU, so we'd really like cached memory - uncached reads can be an order of
+		// magnitude slower. Cached memory isn't necessarily coherent though, in which case we have to invalidate it before each read.
+		VkMemoryPropertyFlags readbackFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		if (VulkanHelpers::findMemoryTypeIndex(memoryProperties, UINT32_MAX, readbackFlags) == UINT32_MAX)
+		{
+			LOG_WARNING("[WARNING] No host-cached memory type available - frame readback will use uncached memory.");
+			readbackFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		}
+
+		slots.resize(framesInFlight);
+		std::vector<VkCommandBuffer> commandBuffers(framesInFlight);
+
+		VkCommandBufferAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.commandPool = commandPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = framesInFlight;
+
+		result = VulkanFunctionLoaders::vkAllocateCommandBuffers(device, &allocateInfo, commandBuffers.data());
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not allocate offscreen command buffers. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+
+		const VkDeviceSize frameBytes = static_cast<VkDeviceSize>(getRowPitch()) * height;
+		for (uint32_t i = 0; i < framesInFlight; ++i)
+		{
+			Slot& slot = slots[i];
+			slot.CommandBuffer = commandBuffers[i];
+			if (!createTargetImage(memoryProperties, slot)) { return false; }
+			if (!slot.Readback.create(device, memoryProperties, frameBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT, readbackFlags, true)) { return false; }
+		}
+		if (samples != VK_SAMPLE_COUNT_1_BIT && !createMsaaAttachments(memoryProperties)) { return false; }
+
+		LOG_VERBOSE("[OK] Created offscreen renderer: {}x{}, {} frame(s) in flight, {} bytes per frame.", width, height, framesInFlight, frameBytes);
+		if (samples != VK_SAMPLE_COUNT_1_BIT)
+		{
+			LOG_VERBOSE("[OK] Offscreen MSAA: {}x with {} attachments ({} bytes allocated, {} committed).", static_cast<uint32_t>(samples),
+				areAttachmentsLazilyAllocated() ? "lazily allocated" : "device-local (no lazily allocated memory type)", getAttachmentAllocatedBytes(), getAttachmentCommittedBytes());
+		}
+		return true;
+	}
+
+	// Method to set who gets our finished frames. If `consumerReleasesFrames` is set then each frame's slot stays out of use until the
+	// consumer calls `releaseFrame` for it (from any thread), rather than being re-used as soon as the consumer returns.
+	void setConsumer(FrameConsumer frameConsumer, bool consumerReleasesFrames = false)
+	{
+		consumer = std::move(frameConsumer);
+		manualRelease = consumerReleasesFrames;
+	}
+
+	// Method to say we're finished with a frame's pixels so its slot can be re-used. Only needed with `consumerReleasesFrames` - and then
+	// it must be called exactly once for every frame the consumer was given. Safe to call from any thread.
+	void releaseFrame(uint64_t frameNumber)
+	{
+		{
+			std::lock_guard<std::mutex> lock(releaseMutex);
+			slots[(frameNumber - 1) % slots.size()].HeldByConsumer = false;
+		}
+		frameReleased.notify_all();
+	}
+
+	// Method to render the next frame and queue its readback. Hands any frames that have finished since last time to the consumer, and
+	// only blocks if all our slots are still busy. Returns false if anything failed.
+	bool renderFrame(const FrameRecorder& record)
+	{
+		return submitFrame([this, &record](Slot& slot, uint64_t frameNumber)
+		{
+			// Undefined -> general. Note: Coming from `UNDEFINED` tells the driver it can throw the old contents away, which is fine as every
+			// frame renders the whole image.
+			VkImageMemoryBarrier toGeneral = makeImageBarrier(slot.Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+				0, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+			VulkanFunctionLoaders::vkCmdPipelineBarrier(slot.CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+				0, nullptr, 0, nullptr, 1, &toGeneral);
+
+			if (!record(slot.CommandBuffer, slot.Image, frameNumber)) { return false; }
+
+			// General -> transfer source, once everything the recorder did has finished writing
+			VkImageMemoryBarrier toTransferSource = makeImageBarrier(slot.Image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+			VulkanFunctionLoaders::vkCmdPipelineBarrier(slot.CommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				0, nullptr, 0, nullptr, 1, &toTransferSource);
+			return true;
+		});
+	}
+
+	// Method to render the next frame with MSAA, as per `renderFrame`. Only available if we were created with more than one sample.
+	// Note: No barriers needed here - the render pass's dependencies & final layout leave the resolved image ready to copy from.
+	bool renderMultisampledFrame(const RenderPassRecorder& record)
+	{
+		if (sampleCount == VK_SAMPLE_COUNT_1_BIT)
+		{
+			LOG_ERROR("[FAIL] Offscreen renderer wasn't created with MSAA, so can't render a multisampled frame.");
+			return false;
+		}
+		return submitFrame([this, &record](Slot& slot, uint64_t frameNumber)
+		{
+			RenderPassTarget target;
+			target.RenderPass = msaaRenderPass;
+			target.Framebuffer = slot.Framebuffer;
+			target.Extent = { frameWidth, frameHeight };
+			target.Samples = sampleCount;
+			return record(slot.CommandBuffer, target, frameNumber);
+		});
+	}
+
+	// Method to hand any finished frames to the consumer without blocking. Returns false if we couldn't read the timeline.
+	bool collectFinishedFrames()
+	{
+		const uint64_t completed = timeline.getValue(device);
+		if (completed < nextFrameToDeliver) { return true; }
+		return deliverFinishedFrames(completed);
+	}
+
+	// Method to wait for every frame we've submitted to finish and hand them all to the consumer
+	bool finish()
+	{
+		TraceScope finishZone("Finish offscreen frames");
+		if (nextFrameToDeliver != nextFrameNumber && !deliverFinishedFrames(nextFrameNumber - 1)) { return false; }
+		if (manualRelease)
+		{
+			std::unique_lock<std::mutex> lock(releaseMutex);
+			frameReleased.wait(lock, [this]() { for (const Slot& slot : slots) { if (slot.HeldByConsumer) { return false; } } return true; });
+		}
+		return true;
+	}
+
+	uint64_t getFramesRendered() const { return nextFrameNumber - 1; }
+
+	// How many times `renderFrame` had to wait for the GPU to free up a slot. If this is close to the number of frames rendered then the
+	// GPU (or the consumer) is the bottleneck, and more frames in flight won't help.
+	uint64_t getStallCount() const { return stallCount; }
+
+	uint32_t getRowPitch() const { return frameWidth * bytesPerPixel; }
+
+	// Objects our frames use (e.g., something a recorder binds) should be destroyed through this rather than directly. Anything handed
+	// to it while a frame is being recorded - or between frames - is destroyed once the GPU has finished the latest frame we'd submitted,
+	// which we notice as frames are delivered. So nothing ever has to wait for the GPU to go idle to free an object.
+	DeferredDeletionQueue& getDeletionQueue() { return deletionQueue; }
+
+	VkSampleCountFlagBits getSampleCount() const { return sampleCount; }
+
+	// How much memory the MSAA attachments were given, and how much of that the driver has actually committed so far. The two only differ
+	// when the attachments are lazily allocated.
+	VkDeviceSize getAttachmentAllocatedBytes() const
+	{
+		VkDeviceSize total = 0;
+		for (const Slot& slot : slots) { total += slot.MsaaColor.AllocationSize + slot.MsaaDepth.AllocationSize; }
+		return total;
+	}
+	VkDeviceSize getAttachmentCommittedBytes() const
+	{
+		VkDeviceSize total = 0;
+		for (const Slot& slot : slots)
+		{
+			if (slot.MsaaColor.Image != VK_NULL_HANDLE) { total += slot.MsaaColor.getCommittedBytes(device) + slot.MsaaDepth.getCommittedBytes(device); }
+		}
+		return total;
+	}
+	bool areAttachmentsLazilyAllocated() const { return !slots.empty() && slots[0].MsaaColor.LazilyAllocated && slots[0].MsaaDepth.LazilyAllocated; }
+
+	// CAREFUL: Call `finish` first - we destroy everything without waiting for the GPU.
+	void destroy()
+	{
+		deletionQueue.destroy();
+		for (Slot& slot : slots)
+		{
+			if (slot.Framebuffer != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkDestroyFramebuffer(device, slot.Framebuffer, nullptr); }
+			if (slot.ImageView != VK_NULL_HANDLE)   { VulkanFunctionLoaders::vkDestroyImageView(device, slot.ImageView, nullptr); }
+			slot.MsaaColor.destroy(device);
+			slot.MsaaDepth.destroy(device);
+			slot.Readback.destroy(device);
+			if (slot.Image != VK_NULL_HANDLE)       { VulkanFunctionLoaders::vkDestroyImage(device, slot.Image, nullptr); }
+			if (slot.ImageMemory != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkFreeMemory(device, slot.ImageMemory, nullptr); }
+		}
+		slots.clear();
+		if (msaaRenderPass != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyRenderPass(device, msaaRenderPass, nullptr);
+			msaaRenderPass = VK_NULL_HANDLE;
+		}
+		timeline.destroy(device);
+		if (commandPool != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyCommandPool(device, commandPool, nullptr); // Note: This frees the command buffers too
+			commandPool = VK_NULL_HANDLE;
+		}
+		nextFrameNumber = 1;
+		nextFrameToDeliver = 1;
+		stallCount = 0;
+	}
+
+private:
+
+	struct Slot
+	{
+		VkImage Image = VK_NULL_HANDLE;
+		VkDeviceMemory ImageMemory = VK_NULL_HANDLE;
+		GpuBuffer Readback;
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		RenderTarget MsaaColor;                      // MSAA only...
+		RenderTarget MsaaDepth;
+		VkImageView ImageView = VK_NULL_HANDLE;      // ...the resolve target's view
+		VkFramebuffer Framebuffer = VK_NULL_HANDLE;
+		uint64_t FrameNumber = 0;    // The frame this slot is busy with on the GPU, or 0 if the GPU is done with it
+		bool HeldByConsumer = false; // Set while the consumer still needs the readback memory (`consumerReleasesFrames` only). Guarded by `releaseMutex`.
+	};
+
+	// Method to do everything a frame needs apart from the rendering itself, which `recordBody` records into the slot's (already begun)
+	// command buffer - leaving the slot's image in `VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL` with the rendering finished
+	bool submitFrame(const std::function<bool(Slot& slot, uint64_t frameNumber)>& recordBody)
+	{
+		const uint64_t frameNumber = nextFrameNumber;
+		Slot& slot = slots[(frameNumber - 1) % slots.size()];
+
+		// If this slot still holds an older frame then the GPU is `framesInFlight` frames behind us - wait for it (and hand it over)
+		if (slot.FrameNumber != 0)
+		{
+			TraceScope waitZone("Wait for readback slot");
+			++stallCount;
+			if (!deliverFinishedFrames(slot.FrameNumber)) { return false; }
+		}
+		if (manualRelease) { waitForRelease(slot); }
+		deletionQueue.setRetireValue(frameNumber);
+
+		TraceScope recordZone("Record offscreen frame");
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.pNext = nullptr;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = nullptr;
+		VulkanFunctionLoaders::vkBeginCommandBuffer(slot.CommandBuffer, &beginInfo);
+
+		if (!recordBody(slot, frameNumber))
+		{
+			LOG_ERROR("[FAIL] Could not record offscreen frame: {}", frameNumber);
+			VulkanFunctionLoaders::vkEndCommandBuffer(slot.CommandBuffer);
+			return false;
+		}
+
+		VkBufferImageCopy region = {};
+		region.bufferOffset = 0;
+		region.bufferRowLength = 0;   // 0 = tightly packed, i.e., the same as `imageExtent`
+		region.bufferImageHeight = 0;
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { frameWidth, frameHeight, 1 };
+		VulkanFunctionLoaders::vkCmdCopyImageToBuffer(slot.CommandBuffer, slot.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.Readback.Buffer, 1, &region);
+
+		// Make the copy visible to the host. Note: The semaphore signal alone doesn't do this - we need the explicit `HOST_READ` barrier.
+		VkBufferMemoryBarrier toHost = {};
+		toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		toHost.pNext = nullptr;
+		toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toHost.buffer = slot.Readback.Buffer;
+		toHost.offset = 0;
+		toHost.size = VK_WHOLE_SIZE;
+		VulkanFunctionLoaders::vkCmdPipelineBarrier(slot.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+			0, nullptr, 1, &toHost, 0, nullptr);
+
+		VkResult result = VulkanFunctionLoaders::vkEndCommandBuffer(slot.CommandBuffer);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not end offscreen command buffer. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		recordZone.end();
+
+		VkTimelineSemaphoreSubmitInfoKHR timelineSubmitInfo = {};
+		timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timelineSubmitInfo.pNext = nullptr;
+		timelineSubmitInfo.waitSemaphoreValueCount = 0;
+		timelineSubmitInfo.pWaitSemaphoreValues = nullptr;
+		timelineSubmitInfo.signalSemaphoreValueCount = 1;
+		timelineSubmitInfo.pSignalSemaphoreValues = &frameNumber;
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineSubmitInfo;
+		submitInfo.waitSemaphoreCount = 0;
+		submitInfo.pWaitSemaphores = nullptr;
+		submitInfo.pWaitDstStageMask = nullptr;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &slot.CommandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &timeline.Semaphore;
+
+		TraceScope submitZone("Submit offscreen frame");
+		result = VulkanFunctionLoaders::vkQueueSubmit(activeQueue, 1, &submitInfo, VK_NULL_HANDLE);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not submit offscreen frame. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		submitZone.end();
+
+		slot.FrameNumber = frameNumber;
+		++nextFrameNumber;
+
+		// Pick up anything that's finished while we were busy - without waiting for anything that hasn't
+		return collectFinishedFrames();
+	}
+
+	// Method to block until the consumer has released the given slot's previous frame
+	void waitForRelease(Slot& slot)
+	{
+		std::unique_lock<std::mutex> lock(releaseMutex);
+		if (!slot.HeldByConsumer) { return; }
+
+		TraceScope waitZone("Wait for consumer to release frame");
+		++stallCount;
+		frameReleased.wait(lock, [&slot]() { return !slot.HeldByConsumer; });
+	}
+
+	// Method to get the size of a pixel in the formats we know how to read back (0 = unsupported)
+	static uint32_t getBytesPerPixel(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:       return 4;
+		case VK_FORMAT_R16G16B16A16_SFLOAT: return 8;
+		case VK_FORMAT_R32G32B32A32_SFLOAT: return 16;
+		default:                            return 0;
+		}
+	}
+
+	VkImageMemoryBarrier makeImageBarrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess) const
+	{
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.pNext = nullptr;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		return barrier;
+	}
+
+	bool createTargetImage(const VkPhysicalDeviceMemoryProperties& memoryProperties, Slot& slot)
+	{
+		VkImageCreateInfo imageCreateInfo = {};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.pNext = nullptr;
+		imageCreateInfo.flags = 0;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = frameFormat;
+		imageCreateInfo.extent = { frameWidth, frameHeight, 1 };
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL; // Note: Optimal tiling is the GPU's layout, not ours - which is why we copy into a buffer rather than map the image
+		imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.queueFamilyIndexCount = 0;
+		imageCreateInfo.pQueueFamilyIndices = nullptr;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VkResult result = VulkanFunctionLoaders::vkCreateImage(device, &imageCreateInfo, nullptr, &slot.Image);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create {}x{} offscreen render target. VkResult is: {}", frameWidth, frameHeight, VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		VulkanFunctionLoaders::vkGetImageMemoryRequirements(device, slot.Image, &memoryRequirements);
+		const uint32_t memoryTypeIndex = VulkanHelpers::findMemoryTypeIndex(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (memoryTypeIndex == UINT32_MAX)
+		{
+			LOG_ERROR("[FAIL] No device-local memory type is suitable for the offscreen render target.");
+			return false;
+		}
+
+		VkMemoryAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.allocationSize = memoryRequirements.size;
+		allocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+		result = VulkanFunctionLoaders::vkAllocateMemory(device, &allocateInfo, nullptr, &slot.ImageMemory);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not allocate {} bytes of render target memory. VkResult is: {}", memoryRequirements.size, VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+
+		result = VulkanFunctionLoaders::vkBindImageMemory(device, slot.Image, slot.ImageMemory, 0);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not bind render target memory. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		return true;
+	}
+
+	// Method to make the MSAA render pass, plus each slot's multisampled attachments, a view of its target image and a framebuffer
+	// Note: `VK_FORMAT_D16_UNORM` is the one depth format every device has to support as an attachment - and as we only ever clear the depth
+	// buffer and throw it away, its precision doesn't matter.
+	bool createMsaaAttachments(const VkPhysicalDeviceMemoryProperties& memoryProperties)
+	{
+		const VkFormat depthFormat = VK_FORMAT_D16_UNORM;
+		if (!createMsaaResolveRenderPass(device, frameFormat, depthFormat, sampleCount, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, msaaRenderPass)) { return false; }
+
+		for (Slot& slot : slots)
+		{
+			if (!slot.MsaaColor.create(device, memoryProperties, frameFormat, frameWidth, frameHeight, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, sampleCount, VK_IMAGE_ASPECT_COLOR_BIT, true) ||
+				!slot.MsaaDepth.create(device, memoryProperties, depthFormat, frameWidth, frameHeight, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, sampleCount, VK_IMAGE_ASPECT_DEPTH_BIT, true))
+			{
+				return false;
+			}
+
+			VkImageViewCreateInfo viewCreateInfo = {};
+			viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewCreateInfo.pNext = nullptr;
+			viewCreateInfo.flags = 0;
+			viewCreateInfo.image = slot.Image;
+			viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewCreateInfo.format = frameFormat;
+			viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+			viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			VkResult result = VulkanFunctionLoaders::vkCreateImageView(device, &viewCreateInfo, nullptr, &slot.ImageView);
+			if (result != VK_SUCCESS)
+			{
+				LOG_ERROR("[FAIL] Could not create offscreen render target view. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+				return false;
+			}
+
+			const VkImageView attachments[3] = { slot.MsaaColor.View, slot.MsaaDepth.View, slot.ImageView };
+			VkFramebufferCreateInfo framebufferCreateInfo = {};
+			framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferCreateInfo.pNext = nullptr;
+			framebufferCreateInfo.flags = 0;
+			framebufferCreateInfo.renderPass = msaaRenderPass;
+			framebufferCreateInfo.attachmentCount = 3;
+			framebufferCreateInfo.pAttachments = attachments;
+			framebufferCreateInfo.width = frameWidth;
+			framebufferCreateInfo.height = frameHeight;
+			framebufferCreateInfo.layers = 1;
+			result = VulkanFunctionLoaders::vkCreateFramebuffer(device, &framebufferCreateInfo, nullptr, &slot.Framebuffer);
+			if (result != VK_SUCCESS)
+			{
+				LOG_ERROR("[FAIL] Could not create offscreen framebuffer. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Method to wait until frame `upToFrame` has finished, then hand every undelivered frame up to it to the consumer, oldest first.
+	// Note: Frames finish in the order we submit them (it's all one queue), so the timeline reaching N means frames 1..N are all done.
+	bool deliverFinishedFrames(uint64_t upToFrame)
+	{
+		if (!timeline.wait(device, upToFrame)) { return false; }
+		deletionQueue.collect(upToFrame);
+
+		while (nextFrameToDeliver <= upToFrame)
+		{
+			Slot& slot = slots[(nextFrameToDeliver - 1) % slots.size()];
+			// Note: Checked against the memory type the buffer actually got, which only has to have the flags we asked for (and may have more)
+			if ((slot.Readback.MemoryFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
+			{
+				VkMappedMemoryRange range = {};
+				range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+				range.pNext = nullptr;
+				range.memory = slot.Readback.Memory;
+				range.offset = 0;
+				range.size = VK_WHOLE_SIZE;
+				VulkanFunctionLoaders::vkInvalidateMappedMemoryRanges(device, 1, &range);
+			}
+
+			if (consumer)
+			{
+				if (manualRelease)
+				{
+					std::lock_guard<std::mutex> lock(releaseMutex);
+					slot.HeldByConsumer = true;
+				}
+
+				TraceScope consumeZone("Consume offscreen frame");
+				ReadbackFrame frame;
+				frame.FrameNumber = nextFrameToDeliver;
+				frame.Width = frameWidth;
+				frame.Height = frameHeight;
+				frame.Format = frameFormat;
+				frame.RowPitch = getRowPitch();
+				frame.Pixels = static_cast<const uint8_t*>(slot.Readback.Mapped);
+				consumer(frame);
+			}
+
+			slot.FrameNumber = 0;
+			++nextFrameToDeliver;
+		}
+		return true;
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueue activeQueue = VK_NULL_HANDLE;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	TimelineSemaphore timeline;
+	DeferredDeletionQueue deletionQueue; // Retire values are frame numbers, same as the timeline
+	std::vector<Slot> slots;
+	FrameConsumer consumer;
+	bool manualRelease = false;
+	std::mutex releaseMutex;
+	std::condition_variable frameReleased;
+
+	uint32_t frameWidth = 0;
+	uint32_t frameHeight = 0;
+	VkFormat frameFormat = VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
+	VkRenderPass msaaRenderPass = VK_NULL_HANDLE;
+	uint32_t bytesPerPixel = 0;
+
+	uint64_t nextFrameNumber = 1;    // The number the next `renderFrame` will give its frame (and signal the timeline to)
+	uint64_t nextFrameToDeliver = 1; // The oldest frame the consumer hasn't had yet
+	uint64_t stallCount = 0;
+};
+
+// The colour `makeTestPatternRecorder` clears frame `frameNumber` to, as 8-bit RGBA - so consumers can check they got the right frame back
+inline void getTestPatternColor(uint64_t frameNumber, uint8_t rgba[4])
+{
+	rgba[0] = static_cast<uint8_t>(frameNumber * 7);
+	rgba[1] = static_cast<uint8_t>(frameNumber * 13);
+	rgba[2] = static_cast<uint8_t>(frameNumber * 29);
+	rgba[3] = 255;
+}
+
+// A stand-in for real rendering until we have pipelines: clears each frame to a colour that changes every frame (see `getTestPatternColor`).
+// Note: The colours are exact in UNORM formats - in sRGB formats the stored values will have been gamma encoded.
+inline FrameRecorder makeTestPatternRecorder()
+{
+	return [](VkCommandBuffer commandBuffer, VkImage target, uint64_t frameNumber)
+	{
+		uint8_t rgba[4];
+		getTestPatternColor(frameNumber, rgba);
+
+		VkClearColorValue clearColor = {};
+		for (int i = 0; i < 4; ++i) { clearColor.float32[i] = rgba[i] / 255.0f; }
+		const VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		VulkanFunctionLoaders::vkCmdClearColorImage(commandBuffer, target, VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &range);
+		return true;
+	};
+}
+
+// As per `makeTestPatternRecorder`, but for MSAA: clears the multisampled colour attachment to the frame's colour in the render pass's
+// load op and lets the end of the render pass resolve it. Every sample of a pixel gets the same colour, so the resolved frame matches
+// `getTestPatternColor` exactly too.
+inline RenderPassRecorder makeTestPatternRenderPassRecorder()
+{
+	return [](VkCommandBuffer commandBuffer, const RenderPassTarget& target, uint64_t frameNumber)
+	{
+		uint8_t rgba[4];
+		getTestPatternColor(frameNumber, rgba);
+
+		VkClearValue clearValues[2] = {};
+		for (int i = 0; i < 4; ++i) { clearValues[0].color.float32[i] = rgba[i] / 255.0f; }
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		beginInfo.pNext = nullptr;
+		beginInfo.renderPass = target.RenderPass;
+		beginInfo.framebuffer = target.Framebuffer;
+		beginInfo.renderArea = { { 0, 0 }, target.Extent };
+		beginInfo.clearValueCount = 2; // Note: The resolve target (attachment 2) isn't cleared, so doesn't need one
+		beginInfo.pClearValues = clearValues;
+		VulkanFunctionLoaders::vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		VulkanFunctionLoaders::vkCmdEndRenderPass(commandBuffer);
+		return true;
+	};
+}
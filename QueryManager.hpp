@@ -0,0 +1,444 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+
+// The kinds of query a pass can ask for - combine with `|` (see `QueryManager::beginPass`)
+enum QueryPassFlagBits : uint32_t
+{
+	QUERY_PASS_OCCLUSION           = 0x1, // Samples that passed the depth & stencil tests (graphics queues only)
+	QUERY_PASS_PIPELINE_STATISTICS = 0x2, // Shader invocation counts etc. (needs the `pipelineStatisticsQuery` device feature)
+	QUERY_PASS_TIMESTAMPS          = 0x4, // GPU time taken by the pass (needs a queue family with non-zero `timestampValidBits`)
+	QUERY_PASS_ALL                 = 0x7
+};
+typedef uint32_t QueryPassFlags;
+
+// Everything we could read back for a single pass. The `Has...` flags say which of the values are meaningful - a pass only gets the
+// queries it asked for AND the manager supports.
+struct QueryPassResult
+{
+	string Name;
+	bool HasOcclusion = false;
+	bool HasPipelineStatistics = false;
+	bool HasTimestamps = false;
+	uint64_t SamplesPassed = 0;
+	uint64_t InputAssemblyVertices = 0;
+	uint64_t VertexShaderInvocations = 0;
+	uint64_t ClippingPrimitives = 0;
+	uint64_t FragmentShaderInvocations = 0;
+	uint64_t ComputeShaderInvocations = 0;
+	double Milliseconds = 0.0;
+};
+
+// Accumulated query results for all passes that share a name
+struct QueryPassStats
+{
+	uint64_t Count = 0;
+	uint64_t TotalSamplesPassed = 0;
+	uint64_t TotalVertexShaderInvocations = 0;
+	uint64_t TotalFragmentShaderInvocations = 0;
+	uint64_t TotalComputeShaderInvocations = 0;
+	double TotalMilliseconds = 0.0;
+
+	double average(uint64_t total) const { return Count > 0 ? static_cast<double>(total) / static_cast<double>(Count) : 0.0; }
+	double averageMilliseconds() const { return Count > 0 ? TotalMilliseconds / static_cast<double>(Count) : 0.0; }
+
+	// Fragment shader invocations per sample that made it past the depth test. Anything much over 1 means we're shading fragments that
+	// then get thrown away (overdraw the early depth test didn't catch) - 0 if the pass had no occlusion results to compare against.
+	double fragmentsPerSamplePassed() const
+	{
+		return TotalSamplesPassed > 0 ? static_cast<double>(TotalFragmentShaderInvocations) / static_cast<double>(TotalSamplesPassed) : 0.0;
+	}
+};
+
+// Class to collect occlusion, pipeline statistics and timestamp queries for named regions ("passes") of command buffers.
+//
+// There's one large `VkQueryPool` per query type, and each frame-in-flight owns a fixed range of slots in each of them - so a pass costs
+// no allocation at all, just the next slot in its frame's range. Like `GpuProfiler`, when a frame slot comes back around in `beginFrame`
+// we read whatever it recorded last time WITHOUT waiting (`VK_QUERY_RESULT_WITH_AVAILABILITY_BIT` rather than `VK_QUERY_RESULT_WAIT_BIT`)
+// and then reset the frame's whole range in one go: on the host with `vkResetQueryPoolEXT` if `VK_EXT_host_query_reset` is enabled (so
+// there's nothing to record), otherwise with one `vkCmdResetQueryPool` per query type.
+//
+// CAREFUL: Only one query of each type can be active in a command buffer at a time, so passes can't be nested. Also, a pass that begins
+// inside a render pass must end inside the same subpass (and one begun outside a render pass must end outside of one).
+// Note: Pipeline statistics on a queue family without graphics support are limited to compute shader invocations, and occlusion
+// queries aren't available at all - `create` sorts that out from the queue family's flags.
+// See: https://registry.khronos.org/vulkan/specs/1.3-extensions/html/vkspec.html#queries
+class QueryManager
+{
+public:
+
+	// Method to create the manager. Whichever of occlusion / pipeline statistics / timestamps the device & queue family can't do are
+	// simply left out (with a warning) - returns false only if it can't do any of them, or a query pool couldn't be created.
+	bool create(VkDevice logicalDevice, VkQueueFlags queueFlags, bool pipelineStatisticsQueryEnabled, float timestampPeriodNs, uint32_t timestampValidBits,
+		uint32_t numFramesInFlight = 2, uint32_t maxPassesPerFrame = 256)
+	{
+		device = logicalDevice;
+		timestampPeriod = timestampPeriodNs;
+		validBitsMask = timestampValidBits >= 64 ? UINT64_MAX : ((uint64_t(1) << timestampValidBits) - 1);
+		maxPasses = maxPassesPerFrame;
+		hostReset = VulkanFunctionLoaders::vkResetQueryPoolEXT != nullptr;
+
+		const bool graphics = (queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		supportedFlags = 0;
+		if (graphics) { supportedFlags |= QUERY_PASS_OCCLUSION; }
+		if (pipelineStatisticsQueryEnabled && (graphics || (queueFlags & VK_QUEUE_COMPUTE_BIT) != 0)) { supportedFlags |= QUERY_PASS_PIPELINE_STATISTICS; }
+		if (timestampValidBits != 0) { supportedFlags |= QUERY_PASS_TIMESTAMPS; }
+		if (supportedFlags == 0)
+		{
+			LOG_WARNING("[WARNING] Active queue family supports none of occlusion, pipeline statistics or timestamp queries - query manager is disabled.");
+			return false;
+		}
+		if (!pipelineStatisticsQueryEnabled) { LOG_WARNING("[WARNING] The `pipelineStatisticsQuery` feature is not enabled - passes will have no pipeline statistics."); }
+		if (timestampValidBits == 0) { LOG_WARNING("[WARNING] Active queue family does not support timestamps - passes will not be timed."); }
+
+		// Note: Results come back in bit order - which is the order `resolveFrame` picks them out in
+		pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+		if (graphics)
+		{
+			pipelineStatistics |= VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+				VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+		}
+		numStatisticsValues = 0;
+		for (VkQueryPipelineStatisticFlags bits = pipelineStatistics; bits != 0; bits &= bits - 1) { ++numStatisticsValues; }
+
+		frames.resize(numFramesInFlight);
+		if (((supportedFlags & QUERY_PASS_OCCLUSION) != 0 && !createPool(Occlusion, VK_QUERY_TYPE_OCCLUSION, 1, 0)) ||
+			((supportedFlags & QUERY_PASS_PIPELINE_STATISTICS) != 0 && !createPool(PipelineStatistics, VK_QUERY_TYPE_PIPELINE_STATISTICS, 1, pipelineStatistics)) ||
+			((supportedFlags & QUERY_PASS_TIMESTAMPS) != 0 && !createPool(Timestamp, VK_QUERY_TYPE_TIMESTAMP, 2, 0)))
+		{
+			destroy();
+			return false;
+		}
+
+		// Queries have to be reset before their first use - with host reset we can do that now, otherwise the first `beginFrame` does it
+		if (hostReset)
+		{
+			for (uint32_t type = 0; type < NumQueryTypes; ++type)
+			{
+				if (pools[type] != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkResetQueryPoolEXT(device, pools[type], 0, numFramesInFlight * maxPasses * queriesPerPass[type]); }
+			}
+		}
+
+		// Each query gives us its value(s) AND an availability word
+		readbackScratch.resize(maxPasses * std::max<uint32_t>(numStatisticsValues + 1, 2 * 2));
+		LOG_VERBOSE("[OK] Query manager created with {} slot(s) per frame ({} reset).", maxPasses, hostReset ? "host" : "command buffer");
+		return true;
+	}
+
+	// Method to start a new frame. Reads back the results this frame slot recorded last time around and then resets its queries ready
+	// for re-use. Without host query reset this records the resets into `commandBuffer` - so it must go in the first command buffer of
+	// the frame (outside of any render pass); with host query reset `commandBuffer` isn't used and may be VK_NULL_HANDLE.
+	// CAREFUL: The caller must have waited for this frame slot's previous submission (e.g., on its fence) - resetting queries the GPU
+	// might still be writing is undefined behaviour.
+	void beginFrame(VkCommandBuffer commandBuffer)
+	{
+		if (frames.empty()) { return; }
+
+		currentFrame = (currentFrame + 1) % static_cast<uint32_t>(frames.size());
+		FrameQueries& frame = frames[currentFrame];
+		latestResults.clear();
+		resolveFrame(currentFrame, true);
+
+		for (uint32_t type = 0; type < NumQueryTypes; ++type)
+		{
+			if (pools[type] == VK_NULL_HANDLE) { continue; }
+
+			const uint32_t firstQuery = currentFrame * maxPasses * queriesPerPass[type];
+			const uint32_t numQueries = maxPasses * queriesPerPass[type];
+			if (hostReset) { VulkanFunctionLoaders::vkResetQueryPoolEXT(device, pools[type], firstQuery, numQueries); }
+			else { VulkanFunctionLoaders::vkCmdResetQueryPool(commandBuffer, pools[type], firstQuery, numQueries); }
+		}
+		frame.NextSlot = 0;
+		frame.Passes.clear();
+	}
+
+	// Method to open a pass with whichever of `flags` we support. Returns a handle to pass to `endPass`, or UINT32_MAX if this frame has
+	// run out of slots (in which case the pass is silently not measured).
+	// CAREFUL: We keep hold of the `name` pointer until the pass is read back, so it must live at least that long (string literals are ideal).
+	uint32_t beginPass(VkCommandBuffer commandBuffer, const char* name, QueryPassFlags flags = QUERY_PASS_ALL)
+	{
+		if (frames.empty()) { return UINT32_MAX; }
+
+		FrameQueries& frame = frames[currentFrame];
+		if (frame.NextSlot >= maxPasses) { return UINT32_MAX; }
+
+		PendingPass pass;
+		pass.Name = name;
+		pass.Slot = frame.NextSlot++;
+		pass.Flags = flags & supportedFlags;
+		pass.Ended = false;
+		pass.Resolved = false;
+
+		if ((pass.Flags & QUERY_PASS_TIMESTAMPS) != 0)
+		{
+			VulkanFunctionLoaders::vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pools[Timestamp], queryIndex(Timestamp, pass.Slot));
+		}
+		if ((pass.Flags & QUERY_PASS_PIPELINE_STATISTICS) != 0)
+		{
+			VulkanFunctionLoaders::vkCmdBeginQuery(commandBuffer, pools[PipelineStatistics], queryIndex(PipelineStatistics, pass.Slot), 0);
+		}
+		if ((pass.Flags & QUERY_PASS_OCCLUSION) != 0)
+		{
+			VulkanFunctionLoaders::vkCmdBeginQuery(commandBuffer, pools[Occlusion], queryIndex(Occlusion, pass.Slot), 0);
+		}
+
+		frame.Passes.push_back(pass);
+		return pass.Slot;
+	}
+
+	// Method to close a pass opened by `beginPass` (which must have been recorded earlier in the same command buffer)
+	void endPass(VkCommandBuffer commandBuffer, uint32_t passSlot)
+	{
+		if (frames.empty() || passSlot == UINT32_MAX) { return; }
+
+		PendingPass& pass = frames[currentFrame].Passes[passSlot];
+		if ((pass.Flags & QUERY_PASS_OCCLUSION) != 0)
+		{
+			VulkanFunctionLoaders::vkCmdEndQuery(commandBuffer, pools[Occlusion], queryIndex(Occlusion, pass.Slot));
+		}
+		if ((pass.Flags & QUERY_PASS_PIPELINE_STATISTICS) != 0)
+		{
+			VulkanFunctionLoaders::vkCmdEndQuery(commandBuffer, pools[PipelineStatistics], queryIndex(PipelineStatistics, pass.Slot));
+		}
+		if ((pass.Flags & QUERY_PASS_TIMESTAMPS) != 0)
+		{
+			VulkanFunctionLoaders::vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pools[Timestamp], queryIndex(Timestamp, pass.Slot) + 1);
+		}
+		pass.Ended = true;
+	}
+
+	// Method to read back every pass whose results are ready right now, without waiting. Unlike `beginFrame`, passes that aren't ready
+	// yet are kept so a later call (or the frame slot coming back around) can pick them up.
+	// CAREFUL: Without host query reset a frame's queries are only reset when the GPU gets to its `vkCmdResetQueryPool`s - until then
+	// they still hold LAST time's results. So only call this once the GPU has at least started on the current frame (e.g., after waiting
+	// on it, as `ComputeBatchRunner` does).
+	void resolve()
+	{
+		latestResults.clear();
+		for (uint32_t frameIndex = 0; frameIndex < static_cast<uint32_t>(frames.size()); ++frameIndex) { resolveFrame(frameIndex, false); }
+	}
+
+	// The passes resolved by the most recent `beginFrame` or `resolve` call
+	const std::vector<QueryPassResult>& getLatestResults() const { return latestResults; }
+
+	// Per-pass-name statistics accumulated over every resolved frame
+	const std::map<string, QueryPassStats>& getPassStats() const { return passStats; }
+
+	// Number of passes we had to throw away because their results still weren't available when their frame slot came back around
+	uint64_t getDroppedPassCount() const { return droppedPasses; }
+
+	// Which of the `QueryPassFlagBits` this manager can actually collect
+	QueryPassFlags getSupportedFlags() const { return supportedFlags; }
+
+	bool usesHostQueryReset() const { return hostReset; }
+
+	// Method to write a human-readable table of our accumulated per-pass averages
+	void printSummary(std::ostream& out) const
+	{
+		out << "----- GPU Query Summary (averages per pass) -----\n";
+		out << std::left << std::setw(32) << "Pass" << std::right << std::setw(8) << "Count" << std::setw(14) << "VS invoc" << std::setw(14) << "FS invoc"
+			<< std::setw(14) << "CS invoc" << std::setw(14) << "Samples" << std::setw(10) << "FS/Sample" << std::setw(12) << "ms" << '\n';
+		out << std::fixed;
+		for (auto& [name, stats] : passStats)
+		{
+			out << std::left << std::setw(32) << name << std::right << std::setw(8) << stats.Count << std::setprecision(0)
+				<< std::setw(14) << stats.average(stats.TotalVertexShaderInvocations) << std::setw(14) << stats.average(stats.TotalFragmentShaderInvocations)
+				<< std::setw(14) << stats.average(stats.TotalComputeShaderInvocations) << std::setw(14) << stats.average(stats.TotalSamplesPassed)
+				<< std::setprecision(2) << std::setw(10) << stats.fragmentsPerSamplePassed() << std::setprecision(4) << std::setw(12) << stats.averageMilliseconds() << '\n';
+		}
+		if (droppedPasses > 0) { out << "(" << droppedPasses << " pass(es) dropped because their results were not ready in time)\n"; }
+		out << std::defaultfloat;
+	}
+
+	void destroy()
+	{
+		for (auto& pool : pools)
+		{
+			if (pool != VK_NULL_HANDLE)
+			{
+				VulkanFunctionLoaders::vkDestroyQueryPool(device, pool, nullptr);
+				pool = VK_NULL_HANDLE;
+			}
+		}
+		frames.clear();
+		supportedFlags = 0;
+	}
+
+private:
+
+	enum QueryType : uint32_t { Occlusion = 0, PipelineStatistics, Timestamp, NumQueryTypes };
+
+	struct PendingPass
+	{
+		const char* Name;
+		uint32_t Slot;
+		QueryPassFlags Flags;
+		bool Ended;
+		bool Resolved; // Already reported by an earlier `resolve`
+	};
+
+	struct FrameQueries
+	{
+		uint32_t NextSlot = 0;
+		std::vector<PendingPass> Passes; // Every pass recorded into this frame since it was last reset, indexed by slot
+	};
+
+	bool createPool(QueryType type, VkQueryType queryType, uint32_t numQueriesPerPass, VkQueryPipelineStatisticFlags statistics)
+	{
+		VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+		queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCreateInfo.pNext = nullptr;
+		queryPoolCreateInfo.flags = 0;
+		queryPoolCreateInfo.queryType = queryType;
+		queryPoolCreateInfo.queryCount = static_cast<uint32_t>(frames.size()) * maxPasses * numQueriesPerPass;
+		queryPoolCreateInfo.pipelineStatistics = statistics;
+
+		const VkResult result = VulkanFunctionLoaders::vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &pools[type]);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create query pool. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			pools[type] = VK_NULL_HANDLE;
+			return false;
+		}
+		queriesPerPass[type] = numQueriesPerPass;
+		return true;
+	}
+
+	uint32_t queryIndex(QueryType type, uint32_t slot) const { return (currentFrame * maxPasses + slot) * queriesPerPass[type]; }
+
+	// Method to read back all of one query type's slots in a frame that have been used so far. Returns false if the read itself failed.
+	// Note: We'll get `VK_NOT_READY` back if ANY query isn't available yet - that's not an error here, as we check each query's
+	// availability word ourselves.
+	bool readFrame(QueryType type, uint32_t frameIndex, uint32_t numSlots, uint32_t valuesPerQuery)
+	{
+		const uint32_t firstQuery = frameIndex * maxPasses * queriesPerPass[type];
+		const uint32_t numQueries = numSlots * queriesPerPass[type];
+		const VkDeviceSize stride = (valuesPerQuery + 1) * sizeof(uint64_t);
+		const VkResult result = VulkanFunctionLoaders::vkGetQueryPoolResults(device, pools[type], firstQuery, numQueries, numQueries * stride,
+			readbackScratch.data(), stride, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if (result != VK_SUCCESS && result != VK_NOT_READY)
+		{
+			LOG_WARNING("[WARNING] Could not read back GPU queries. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		return true;
+	}
+
+	// Method to gather up the results of a frame slot's passes. Passes whose queries are all available get reported & removed; the rest
+	// are dropped if `dropUnavailable` is set (i.e., the slot is about to be reset), otherwise kept for next time.
+	void resolveFrame(uint32_t frameIndex, bool dropUnavailable)
+	{
+		FrameQueries& frame = frames[frameIndex];
+		const bool anyUnresolved = std::any_of(frame.Passes.begin(), frame.Passes.end(), [](const PendingPass& pass) { return !pass.Resolved; });
+		if (!anyUnresolved) { return; }
+
+		std::vector<QueryPassResult> frameResults(frame.Passes.size());
+		std::vector<bool> available(frame.Passes.size(), true);
+		for (size_t i = 0; i < frame.Passes.size(); ++i)
+		{
+			available[i] = frame.Passes[i].Ended && !frame.Passes[i].Resolved;
+			frameResults[i].Name = frame.Passes[i].Name;
+		}
+
+		// Note: One read per query type covers the whole frame - each pass then picks its own values out by slot
+		const uint32_t numSlots = frame.NextSlot;
+		if ((supportedFlags & QUERY_PASS_TIMESTAMPS) != 0)
+		{
+			const bool read = readFrame(Timestamp, frameIndex, numSlots, 1);
+			for (size_t i = 0; i < frame.Passes.size(); ++i)
+			{
+				if ((frame.Passes[i].Flags & QUERY_PASS_TIMESTAMPS) == 0) { continue; }
+
+				const uint64_t* values = readbackScratch.data() + frame.Passes[i].Slot * 4;
+				if (!read || values[1] == 0 || values[3] == 0) { available[i] = false; continue; }
+
+				frameResults[i].HasTimestamps = true;
+				frameResults[i].Milliseconds = static_cast<double>((values[2] - values[0]) & validBitsMask) * timestampPeriod / 1.0e6;
+			}
+		}
+		if ((supportedFlags & QUERY_PASS_PIPELINE_STATISTICS) != 0)
+		{
+			const bool read = readFrame(PipelineStatistics, frameIndex, numSlots, numStatisticsValues);
+			for (size_t i = 0; i < frame.Passes.size(); ++i)
+			{
+				if ((frame.Passes[i].Flags & QUERY_PASS_PIPELINE_STATISTICS) == 0) { continue; }
+
+				const uint64_t* values = readbackScratch.data() + frame.Passes[i].Slot * (numStatisticsValues + 1);
+				if (!read || values[numStatisticsValues] == 0) { available[i] = false; continue; }
+
+				QueryPassResult& passResult = frameResults[i];
+				passResult.HasPipelineStatistics = true;
+				if (numStatisticsValues == 5)
+				{
+					passResult.InputAssemblyVertices = values[0];
+					passResult.VertexShaderInvocations = values[1];
+					passResult.ClippingPrimitives = values[2];
+					passResult.FragmentShaderInvocations = values[3];
+				}
+				passResult.ComputeShaderInvocations = values[numStatisticsValues - 1];
+			}
+		}
+		if ((supportedFlags & QUERY_PASS_OCCLUSION) != 0)
+		{
+			const bool read = readFrame(Occlusion, frameIndex, numSlots, 1);
+			for (size_t i = 0; i < frame.Passes.size(); ++i)
+			{
+				if ((frame.Passes[i].Flags & QUERY_PASS_OCCLUSION) == 0) { continue; }
+
+				const uint64_t* values = readbackScratch.data() + frame.Passes[i].Slot * 2;
+				if (!read || values[1] == 0) { available[i] = false; continue; }
+
+				frameResults[i].HasOcclusion = true;
+				frameResults[i].SamplesPassed = values[0];
+			}
+		}
+
+		for (size_t i = 0; i < frame.Passes.size(); ++i)
+		{
+			if (frame.Passes[i].Resolved) { continue; }
+			if (!available[i])
+			{
+				if (dropUnavailable) { ++droppedPasses; }
+				continue;
+			}
+
+			const QueryPassResult& passResult = frameResults[i];
+			QueryPassStats& stats = passStats[passResult.Name];
+			stats.TotalSamplesPassed += passResult.SamplesPassed;
+			stats.TotalVertexShaderInvocations += passResult.VertexShaderInvocations;
+			stats.TotalFragmentShaderInvocations += passResult.FragmentShaderInvocations;
+			stats.TotalComputeShaderInvocations += passResult.ComputeShaderInvocations;
+			stats.TotalMilliseconds += passResult.Milliseconds;
+			++stats.Count;
+			latestResults.push_back(passResult);
+			frame.Passes[i].Resolved = true;
+		}
+		if (dropUnavailable) { frame.Passes.clear(); }
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueryPool pools[NumQueryTypes] = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE };
+	uint32_t queriesPerPass[NumQueryTypes] = { 1, 1, 2 };
+	QueryPassFlags supportedFlags = 0;
+	VkQueryPipelineStatisticFlags pipelineStatistics = 0;
+	uint32_t numStatisticsValues = 0;
+	bool hostReset = false;
+	float timestampPeriod = 1.0f; // Nanoseconds per timestamp tick
+	uint64_t validBitsMask = UINT64_MAX;
+	uint32_t maxPasses = 0;
+	uint32_t currentFrame = 0;
+	uint64_t droppedPasses = 0;
+	std::vector<FrameQueries> frames;
+	std::vector<uint64_t> readbackScratch;
+	std::vector<QueryPassResult> latestResults;
+	std::map<string, QueryPassStats> passStats;
+};
@@ -0,0 +1,368 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "ObjectCache.hpp"
+#include "GpuBuffer.hpp"
+#include "DescriptorTemplate.hpp"
+#include "ComputePipeline.hpp"
+#include "ComputeBatch.hpp"
+#include "ScanPrimitives.hpp"
+
+// The size of the keys a `GpuRadixSort` sorts. 64-bit keys are pairs of 32-bit words, low word first (i.e., a little-endian `uint64_t`).
+enum class RadixKeySize
+{
+	Bits32,
+	Bits64
+};
+
+// Descriptors shared by all three radix sort shaders - each only declares the bindings it uses
+struct RadixSortDescriptors
+{
+	VkDescriptorBufferInfo Count;
+	VkDescriptorBufferInfo KeysIn;
+	VkDescriptorBufferInfo ValuesIn;
+	VkDescriptorBufferInfo KeysOut;
+	VkDescriptorBufferInfo ValuesOut;
+	VkDescriptorBufferInfo State;
+};
+template <> struct DescriptorLayout<RadixSortDescriptors>
+{
+	static constexpr std::array<DescriptorBinding, 6> Bindings = {
+		DESCRIPTOR_BINDING(RadixSortDescriptors, Count, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(RadixSortDescriptors, KeysIn, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(RadixSortDescriptors, ValuesIn, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(RadixSortDescriptors, KeysOut, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(RadixSortDescriptors, ValuesOut, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(RadixSortDescriptors, State, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) };
+};
+
+// Class to record stable GPU sorts of key-value pairs - 32-bit or 64-bit unsigned keys, each with a 32-bit value (an index, a particle
+// id, whatever the caller needs to carry along) - by least-significant-digit radix sort, 8 bits per pass.
+//
+// It's a "Onesweep" sort (see `radix_sort_onesweep.comp`): one dispatch builds the digit histograms for every pass at once, then each pass
+// is a single dispatch that reads & writes every pair once - so sorting 32-bit keys costs about five reads & four writes of the data.
+// The element count comes from a buffer, so it can be written by an earlier GPU pass (say, the number of particles still alive) without
+// a round trip to the CPU: the first dispatch reads it and sizes the rest with `vkCmdDispatchIndirect`.
+//
+// The caller provides every buffer:
+// - `keys` & `values`: the pairs to sort, which is also where the sorted pairs end up.
+// - `tempKeys` & `tempValues`: the same size again. Passes ping-pong between the two, and as there's always an even number of passes
+//   the result lands back in `keys` & `values`.
+// - `count`: a single uint. Anything over the `maxCount` the sort was recorded with is clamped to it.
+// - `state`: at least `getStateSize(maxCount)` bytes of scratch, created with `VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT` as well as storage.
+// CAREFUL: Whatever writes `count` (or the pairs) must be made visible to compute shaders before the sort - and as usual, use
+// `recordComputeToComputeBarrier` before reading the results.
+// Note: Like `ComputeKernelLibrary`, every sort gets its own descriptor sets - call `resetDescriptors` to hand them all back.
+class GpuRadixSort
+{
+public:
+
+	static constexpr uint32_t WorkgroupSize = 256;
+	static constexpr uint32_t ItemsPerInvocation = 8;
+	static constexpr uint32_t PartitionSize = WorkgroupSize * ItemsPerInvocation;
+
+	// Method to load the radix sort shaders from `shaderDirectory` (with subgroup arithmetic if `subgroups` says we can) and create a
+	// pipeline for each step & key size, plus a descriptor pool with enough sets for `maxSortsPerReset` sorts. Returns false (having
+	// cleaned up after itself) if anything's missing or fails.
+	bool create(VkDevice logicalDevice, const SubgroupSupport& subgroups, const string& shaderDirectory = "shaders/spv", uint32_t maxSortsPerReset = 16,
+		ObjectCache* objectCache = nullptr)
+	{
+		device = logicalDevice;
+		useSubgroups = subgroups.Arithmetic;
+
+		if (!setTemplate.create(device, objectCache))
+		{
+			destroy();
+			return false;
+		}
+
+		// Note: Constants are KEY_WORDS & ITEMS_PER_INVOCATION - the setup step doesn't care about the key size, so it only needs the one pipeline
+		const string onesweepPath = shaderDirectory + (useSubgroups ? "/radix_sort_onesweep_subgroup.spv" : "/radix_sort_onesweep.spv");
+		if (!setupPipeline.createFromFile(device, shaderDirectory + "/radix_sort_setup.spv", setTemplate.SetLayout, sizeof(SetupPushConstants), { 1, ItemsPerInvocation }, objectCache))
+		{
+			destroy();
+			return false;
+		}
+		for (uint32_t keyWords = 1; keyWords <= 2; ++keyWords)
+		{
+			if (!histogramPipelines[keyWords - 1].createFromFile(device, shaderDirectory + "/radix_sort_histogram.spv", setTemplate.SetLayout, 0, { keyWords, ItemsPerInvocation }, objectCache) ||
+				!onesweepPipelines[keyWords - 1].createFromFile(device, onesweepPath, setTemplate.SetLayout, sizeof(OnesweepPushConstants), { keyWords, ItemsPerInvocation }, objectCache))
+			{
+				destroy();
+				return false;
+			}
+		}
+
+		// Two sets per sort: one for the passes from `keys` to `tempKeys`, one for the way back
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		DescriptorSetTemplate<RadixSortDescriptors>::addPoolSizes(poolSizes, 2 * maxSortsPerReset);
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.pNext = nullptr;
+		poolCreateInfo.flags = 0;
+		poolCreateInfo.maxSets = 2 * maxSortsPerReset;
+		poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolCreateInfo.pPoolSizes = poolSizes.data();
+		const VkResult result = VulkanFunctionLoaders::vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &descriptorPool);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create radix sort descriptor pool. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			descriptorPool = VK_NULL_HANDLE;
+			destroy();
+			return false;
+		}
+
+		LOG_VERBOSE("[OK] Loaded radix sort ({}) from: {}", useSubgroups ? "subgroup arithmetic" : "shared memory", shaderDirectory);
+		return true;
+	}
+
+	bool usesSubgroups() const { return useSubgroups; }
+
+	// The most pairs one sort can handle - a workgroup per partition, and there can only be so many workgroups
+	static constexpr uint32_t getMaxCount() { return MaxWorkgroupCount * PartitionSize; }
+
+	// How many bytes of `state` a sort of up to `maxCount` pairs needs: the header & histograms, then two halves of look-back state
+	static VkDeviceSize getStateSize(uint32_t maxCount)
+	{
+		const VkDeviceSize partitionCount = (static_cast<VkDeviceSize>(maxCount) + PartitionSize - 1) / PartitionSize;
+		return (StateLookBackOffset + 2 * partitionCount * Radix) * sizeof(uint32_t);
+	}
+
+	// Method to hand back every descriptor set our sorts have used since the last reset.
+	// CAREFUL: The GPU must be finished with everything recorded since then!
+	void resetDescriptors()
+	{
+		if (descriptorPool != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkResetDescriptorPool(device, descriptorPool, 0); }
+	}
+
+	// Method to record sorting the first `count` (read on the GPU, and clamped to `maxCount`) key-value pairs by key, keeping pairs with
+	// equal keys in their original order. See the class comment for what every buffer needs to be. Returns false if `maxCount` is over
+	// `getMaxCount`, or we've run out of descriptor sets.
+	bool recordSort(VkCommandBuffer commandBuffer, RadixKeySize keySize, const VkDescriptorBufferInfo& keys, const VkDescriptorBufferInfo& values,
+		const VkDescriptorBufferInfo& tempKeys, const VkDescriptorBufferInfo& tempValues, const VkDescriptorBufferInfo& count,
+		const VkDescriptorBufferInfo& state, uint32_t maxCount)
+	{
+		if (maxCount > getMaxCount())
+		{
+			LOG_ERROR("[FAIL] Can't sort {} pairs - the most we can is {}.", maxCount, getMaxCount());
+			return false;
+		}
+
+		const VkDescriptorSet forwardSet = allocateSet();
+		const VkDescriptorSet backwardSet = forwardSet != VK_NULL_HANDLE ? allocateSet() : VK_NULL_HANDLE;
+		if (backwardSet == VK_NULL_HANDLE) { return false; }
+		setTemplate.update(forwardSet, { count, keys, values, tempKeys, tempValues, state });
+		setTemplate.update(backwardSet, { count, tempKeys, tempValues, keys, values, state });
+
+		// The last sort to use this state (if any) must be finished with it - including reading its dispatch sizes - before we reset it
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.pNext = nullptr;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		setupPipeline.bind(commandBuffer, forwardSet);
+		setupPipeline.pushConstants(commandBuffer, SetupPushConstants{ maxCount });
+		setupPipeline.dispatch(commandBuffer, 1);
+		recordComputeToComputeBarrier(commandBuffer); // Note: This covers the indirect dispatch sizes too
+
+		const uint32_t keyWords = keySize == RadixKeySize::Bits32 ? 1 : 2;
+		const ComputePipeline& histogramPipeline = histogramPipelines[keyWords - 1];
+		histogramPipeline.bind(commandBuffer, forwardSet);
+		histogramPipeline.dispatchIndirect(commandBuffer, state.buffer, state.offset);
+
+		const ComputePipeline& onesweepPipeline = onesweepPipelines[keyWords - 1];
+		for (uint32_t pass = 0; pass < keyWords * 4; ++pass)
+		{
+			recordComputeToComputeBarrier(commandBuffer);
+			onesweepPipeline.bind(commandBuffer, pass % 2 == 0 ? forwardSet : backwardSet);
+			onesweepPipeline.pushConstants(commandBuffer, OnesweepPushConstants{ pass });
+			onesweepPipeline.dispatchIndirect(commandBuffer, state.buffer, state.offset);
+		}
+		return true;
+	}
+
+	// CAREFUL: The GPU must be finished with everything we've recorded before we call this!
+	void destroy()
+	{
+		if (descriptorPool != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+			descriptorPool = VK_NULL_HANDLE;
+		}
+		setupPipeline.destroy();
+		for (ComputePipeline& pipeline : histogramPipelines) { pipeline.destroy(); }
+		for (ComputePipeline& pipeline : onesweepPipelines) { pipeline.destroy(); }
+		setTemplate.destroy();
+	}
+
+private:
+
+	// Must match the `push_constant` blocks in `radix_sort_setup.comp` & `radix_sort_onesweep.comp`
+	struct SetupPushConstants { uint32_t MaxCount; };
+	struct OnesweepPushConstants { uint32_t Pass; };
+
+	// Note: 65535 is the least `maxComputeWorkGroupCount` every device has to support
+	static constexpr uint32_t MaxWorkgroupCount = 65535;
+	static constexpr uint32_t Radix = 256;
+	static constexpr uint32_t MaxPasses = 8;
+	static constexpr VkDeviceSize StateLookBackOffset = 4 + MaxPasses + MaxPasses * Radix; // In words - must match the shaders' STATE_LOOK_BACK
+
+	VkDescriptorSet allocateSet()
+	{
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.descriptorPool = descriptorPool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &setTemplate.SetLayout;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		const VkResult result = VulkanFunctionLoaders::vkAllocateDescriptorSets(device, &allocateInfo, &set);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not allocate a descriptor set for a radix sort - call `resetDescriptors` more often? VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return VK_NULL_HANDLE;
+		}
+		return set;
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	bool useSubgroups = false;
+	DescriptorSetTemplate<RadixSortDescriptors> setTemplate;
+	ComputePipeline setupPipeline;
+	ComputePipeline histogramPipelines[2]; // By key size: 32-bit, then 64-bit
+	ComputePipeline onesweepPipelines[2];
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+};
+
+// Method to make up the `index`th 32-bit word of some test keys: a hash, so the keys look random but can be recomputed from the index
+inline uint32_t getRadixSortTestKeyWord(uint32_t index)
+{
+	// Note: The finalizer from MurmurHash3
+	uint32_t hash = index * 0x9E3779B9u;
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6Bu;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35u;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+// Method to check a sort of `count` pairs whose values started out as their indices, and whose keys started out as `originalKey(index)`
+// (which returns the key's words in `words`): the keys must be in order, every value must be there exactly once with its own key, and
+// equal keys must have kept their original order.
+template <typename OriginalKey>
+bool checkRadixSort(const uint32_t* keys, const uint32_t* values, uint32_t count, RadixKeySize keySize, OriginalKey originalKey)
+{
+	const uint32_t keyWords = keySize == RadixKeySize::Bits32 ? 1 : 2;
+	std::vector<bool> seen(count, false);
+	uint64_t previousKey = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t value = values[i];
+		if (value >= count || seen[value]) { return false; }
+		seen[value] = true;
+
+		uint32_t words[2] = { 0, 0 };
+		originalKey(value, words);
+		const uint64_t key = keys[i * keyWords] | (keyWords == 2 ? static_cast<uint64_t>(keys[i * keyWords + 1]) << 32 : 0);
+		if (key != (words[0] | static_cast<uint64_t>(words[1]) << 32)) { return false; }
+		if (i > 0 && (key < previousKey || (key == previousKey && value < values[i - 1]))) { return false; }
+		previousKey = key;
+	}
+	return true;
+}
+
+// A self-checking workload for `GpuRadixSort`: sorts `count` pairs of hashed keys & their indices, with the count coming from a buffer like
+// it would from an earlier pass. Only `keyBits` bits of each key are kept - so with a few, there are lots of equal keys to check stability
+// with - and the buffers are `maxCount` long, so the clamping gets checked too if that's less than `count`.
+inline BatchWorkload makeRadixSortWorkload(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, GpuRadixSort& sort, RadixKeySize keySize,
+	uint32_t count, uint32_t maxCount, uint32_t keyBits)
+{
+	struct SortState
+	{
+		VkDevice Device = VK_NULL_HANDLE;
+		GpuBuffer Keys;
+		GpuBuffer Values;
+		GpuBuffer TempKeys;
+		GpuBuffer TempValues;
+		GpuBuffer Count;
+		GpuBuffer State;
+		~SortState() { Keys.destroy(Device); Values.destroy(Device); TempKeys.destroy(Device); TempValues.destroy(Device); Count.destroy(Device); State.destroy(Device); }
+	};
+	auto state = std::make_shared<SortState>();
+	state->Device = device;
+
+	const uint32_t keyWords = keySize == RadixKeySize::Bits32 ? 1 : 2;
+	auto originalKey = [keyWords, keyBits](uint32_t index, uint32_t* words)
+	{
+		const uint64_t key = (getRadixSortTestKeyWord(index * keyWords) | (keyWords == 2 ? static_cast<uint64_t>(getRadixSortTestKeyWord(index * keyWords + 1)) << 32 : 0)) &
+			(keyBits >= 64 ? ~0ull : (1ull << keyBits) - 1);
+		words[0] = static_cast<uint32_t>(key);
+		words[1] = static_cast<uint32_t>(key >> 32);
+	};
+	const uint32_t sortedCount = std::min(count, maxCount);
+
+	BatchWorkload workload;
+	workload.Name = string("radix-sort-") + (keyWords == 1 ? "u32-" : "u64-") + (sort.usesSubgroups() ? "subgroup" : "shared");
+	workload.Record = [state, memoryProperties, &sort, keySize, keyWords, count, maxCount, originalKey](VkCommandBuffer commandBuffer)
+	{
+		if (state->Keys.Buffer == VK_NULL_HANDLE)
+		{
+			const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			const VkDeviceSize keysSize = static_cast<VkDeviceSize>(maxCount) * keyWords * sizeof(uint32_t);
+			const VkDeviceSize valuesSize = static_cast<VkDeviceSize>(maxCount) * sizeof(uint32_t);
+			if (!state->Keys.create(state->Device, memoryProperties, keysSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->Values.create(state->Device, memoryProperties, valuesSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->TempKeys.create(state->Device, memoryProperties, keysSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ||
+				!state->TempValues.create(state->Device, memoryProperties, valuesSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ||
+				!state->Count.create(state->Device, memoryProperties, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->State.create(state->Device, memoryProperties, GpuRadixSort::getStateSize(maxCount), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+			{
+				return false;
+			}
+			for (uint32_t i = 0; i < maxCount; ++i)
+			{
+				uint32_t words[2];
+				originalKey(i, words);
+				std::memcpy(static_cast<uint32_t*>(state->Keys.Mapped) + i * keyWords, words, keyWords * sizeof(uint32_t));
+				static_cast<uint32_t*>(state->Values.Mapped)[i] = i;
+			}
+			*static_cast<uint32_t*>(state->Count.Mapped) = count;
+		}
+
+		RenderGraph graph;
+		const RenderGraphResource keys = graph.importBuffer("Keys", state->Keys.Buffer);
+		const RenderGraphResource values = graph.importBuffer("Values", state->Values.Buffer);
+		const RenderGraphResource countResource = graph.importBuffer("Count", state->Count.Buffer);
+		bool recorded = false;
+		graph.addPass("Radix sort", [state, &sort, &recorded, keySize, maxCount](VkCommandBuffer cb)
+		{
+			recorded = sort.recordSort(cb, keySize, { state->Keys.Buffer, 0, VK_WHOLE_SIZE }, { state->Values.Buffer, 0, VK_WHOLE_SIZE },
+				{ state->TempKeys.Buffer, 0, VK_WHOLE_SIZE }, { state->TempValues.Buffer, 0, VK_WHOLE_SIZE }, { state->Count.Buffer, 0, sizeof(uint32_t) },
+				{ state->State.Buffer, 0, VK_WHOLE_SIZE }, maxCount);
+		}).read(countResource, ResourceUsage::ComputeShaderRead).write(keys, ResourceUsage::ComputeShaderWrite).write(values, ResourceUsage::ComputeShaderWrite);
+		graph.markOutput(keys, ResourceUsage::HostRead);
+		graph.markOutput(values, ResourceUsage::HostRead);
+		if (!graph.compile()) { return false; }
+		graph.execute(commandBuffer);
+		return recorded;
+	};
+	workload.Verify = [state, keySize, sortedCount, originalKey]()
+	{
+		return checkRadixSort(static_cast<const uint32_t*>(state->Keys.Mapped), static_cast<const uint32_t*>(state->Values.Mapped), sortedCount, keySize, originalKey);
+	};
+	return workload;
+}
@@ -0,0 +1,868 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "TraceRecorder.hpp"
+#include "TransientResourcePool.hpp"
+
+// The ways a pass can use a buffer or image. Each one maps to the pipeline stages, access types and (for images) the layout that use
+// needs - see `getResourceUsageInfo` - so passes never have to spell any of those out themselves.
+enum class ResourceUsage : uint8_t
+{
+	TransferRead,          // Source of a copy / blit
+	TransferWrite,         // Destination of a copy / blit / fill / clear
+	ComputeShaderRead,     // Read from a compute shader (storage / uniform buffer, storage image)
+	ComputeShaderWrite,    // Written (or read AND written) by a compute shader
+	FragmentShaderRead,    // Sampled or read from a fragment shader
+	ColorAttachmentWrite,  // Rendered to as a colour attachment
+	DepthAttachmentRead,   // Depth tested against, but not written
+	DepthAttachmentWrite,  // Depth tested & written
+	VertexBufferRead,
+	IndexBufferRead,
+	IndirectBufferRead,    // Arguments of an indirect draw / dispatch
+	UniformBufferRead,     // Uniform buffer read from any shader stage
+	HostRead               // Read by the CPU once the work has finished (e.g., a readback buffer)
+};
+
+// What a `ResourceUsage` means to Vulkan
+struct ResourceUsageInfo
+{
+	VkPipelineStageFlags2KHR Stages = VK_PIPELINE_STAGE_2_NONE_KHR;
+	VkAccessFlags2KHR Access        = VK_ACCESS_2_NONE_KHR;
+	VkImageLayout Layout            = VK_IMAGE_LAYOUT_UNDEFINED; // Ignored for buffers
+	bool Writes                     = false;
+};
+
+// Note: Everything here deliberately sticks to stage & access bits that have the same values in the original `VkPipelineStageFlags` /
+// `VkAccessFlags` - that's what lets us fall back to plain `vkCmdPipelineBarrier` on devices without `VK_KHR_synchronization2`.
+inline ResourceUsageInfo getResourceUsageInfo(ResourceUsage usage)
+{
+	switch (usage)
+	{
+	case ResourceUsage::TransferRead:         return { VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_READ_BIT_KHR, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false };
+	case ResourceUsage::TransferWrite:        return { VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true };
+	case ResourceUsage::ComputeShaderRead:    return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_READ_BIT_KHR, VK_IMAGE_LAYOUT_GENERAL, false };
+	case ResourceUsage::ComputeShaderWrite:   return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_READ_BIT_KHR | VK_ACCESS_2_SHADER_WRITE_BIT_KHR, VK_IMAGE_LAYOUT_GENERAL, true };
+	case ResourceUsage::FragmentShaderRead:   return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_READ_BIT_KHR, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+	case ResourceUsage::ColorAttachmentWrite: return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true };
+	case ResourceUsage::DepthAttachmentRead:  return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false };
+	case ResourceUsage::DepthAttachmentWrite: return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true };
+	case ResourceUsage::VertexBufferRead:     return { VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT_KHR, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT_KHR, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case ResourceUsage::IndexBufferRead:      return { VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT_KHR, VK_ACCESS_2_INDEX_READ_BIT_KHR, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case ResourceUsage::IndirectBufferRead:   return { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT_KHR, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case ResourceUsage::UniformBufferRead:    return { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_UNIFORM_READ_BIT_KHR, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case ResourceUsage::HostRead:             return { VK_PIPELINE_STAGE_2_HOST_BIT_KHR, VK_ACCESS_2_HOST_READ_BIT_KHR, VK_IMAGE_LAYOUT_GENERAL, false };
+	}
+	return {};
+}
+
+// Handle to a buffer or image that's been imported into (or created by) a `RenderGraph`
+using RenderGraphResource = uint32_t;
+
+// What `RenderGraph::compile` came up with
+struct RenderGraphStats
+{
+	uint32_t PassesDeclared = 0;
+	uint32_t PassesCulled   = 0;
+	uint32_t Levels         = 0; // Groups of passes with no dependencies on each other - each gets (at most) one barrier call
+	uint32_t BarrierCalls   = 0; // `vkCmdPipelineBarrier2` calls we'll make (including the one that puts outputs in their final state)
+	uint32_t ImageBarriers  = 0; // Layout transitions
+	uint32_t MemoryBarriers = 0; // Global memory barriers - every other hazard (buffer or image) in a call gets folded into one of these
+
+	// Transient resources, i.e., ones the graph created for itself
+	uint32_t TransientResources    = 0; // That survived culling (and so got memory)
+	uint32_t AliasedTransients     = 0; // Placed in memory that an earlier transient used in the same frame
+	VkDeviceSize TransientNaiveBytes   = 0; // What they'd need with a separate allocation each
+	VkDeviceSize TransientAliasedBytes = 0; // What they actually need, sharing memory wherever their lifetimes don't overlap
+};
+
+// A render / compute graph. Passes declare which buffers & images they read and write (and how), and `compile` works out:
+//   - which passes can be culled, because nothing that's kept (or marked as an output) ever reads what they write,
+//   - an execution order that puts passes which don't depend on each other side by side, so their barriers can be merged, and
+//   - the smallest set of barriers that makes it all correct: one `vkCmdPipelineBarrier2` call per level at most, with every buffer
+//     hazard (and every image hazard that doesn't need a layout change) folded into a single global memory barrier.
+// Then `execute` records the lot into a command buffer.
+//
+// As well as importing buffers & images that live outside the graph, passes can use transient ones the graph creates itself (see
+// `createBuffer` / `createImage`). Those only exist from the first level that uses them to the last, so `compile` packs them into
+// shared memory wherever their lifetimes don't overlap, and adds the barriers that hand memory from one transient to the next.
+//
+// Typical use:
+//     RenderGraph graph;
+//     const RenderGraphResource scratch = graph.importBuffer("Scratch", scratchBuffer.Buffer);
+//     graph.addPass("Fill", [&](VkCommandBuffer cb) { ...vkCmdFillBuffer... }).write(scratch, ResourceUsage::TransferWrite);
+//     graph.addPass("Copy", [&](VkCommandBuffer cb) { ...vkCmdCopyBuffer... }).read(scratch, ResourceUsage::TransferRead).write(readback, ResourceUsage::TransferWrite);
+//     graph.markOutput(readback, ResourceUsage::HostRead);
+//     if (graph.compile()) { graph.execute(commandBuffer); }
+//
+// Note: Imported resources are assumed to have nothing pending on them when the graph starts (i.e., whatever last touched them was in an
+// earlier submission that we waited on, or that a semaphore orders us after) - only their starting layout carries over.
+// Note: A write is taken to possibly be partial, so a resource that's written twice keeps BOTH writers alive if it's needed at all.
+// CAREFUL: We use `vkCmdPipelineBarrier2KHR` if it's been loaded (i.e., the device was created with `VK_KHR_synchronization2` and its
+// `synchronization2` feature turned on) and fall back to `vkCmdPipelineBarrier` otherwise - which works, but has to use one src & dst
+// stage mask for everything in the call, so it's a little more conservative.
+// See: https://themaister.net/blog/2017/08/15/render-graphs-and-vulkan-a-deep-dive/
+class RenderGraph
+{
+public:
+
+	// Returned by `addPass` so a pass's resource uses can be chained on after it
+	class PassBuilder
+	{
+	public:
+		PassBuilder(RenderGraph& renderGraph, uint32_t pass) : graph(renderGraph), passIndex(pass) {}
+
+		PassBuilder& read(RenderGraphResource resource, ResourceUsage usage)  { graph.addUse(passIndex, resource, usage, false); return *this; }
+		PassBuilder& write(RenderGraphResource resource, ResourceUsage usage) { graph.addUse(passIndex, resource, usage, true);  return *this; }
+
+		// Method to keep this pass even if nothing reads what it writes (e.g., it writes to something outside the graph's knowledge)
+		PassBuilder& setSideEffects() { graph.passes[passIndex].HasSideEffects = true; return *this; }
+
+	private:
+		RenderGraph& graph;
+		uint32_t passIndex;
+	};
+
+	RenderGraphResource importBuffer(const string& name, VkBuffer buffer)
+	{
+		Resource resource;
+		resource.Name = name;
+		resource.Buffer = buffer;
+		resources.push_back(resource);
+		return static_cast<RenderGraphResource>(resources.size() - 1);
+	}
+
+	// Note: `currentLayout` is whatever layout the image is in when the graph starts - leave it as `VK_IMAGE_LAYOUT_UNDEFINED` if we don't
+	// care about its contents (the first transition is then free to throw them away).
+	RenderGraphResource importImage(const string& name, VkImage image, VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, VkImageLayout currentLayout = VK_IMAGE_LAYOUT_UNDEFINED)
+	{
+		Resource resource;
+		resource.Name = name;
+		resource.Image = image;
+		resource.IsImage = true;
+		resource.AspectMask = aspectMask;
+		resource.InitialLayout = currentLayout;
+		resources.push_back(resource);
+		return static_cast<RenderGraphResource>(resources.size() - 1);
+	}
+
+	// Methods to add a transient buffer / image - i.e., one that only lives within this graph. The actual `VkBuffer` / `VkImage` (from the
+	// pool we're compiled with) isn't known until `compile`, so passes should look it up with `getBuffer` / `getImage` when they run.
+	// CAREFUL: A transient's contents don't survive from one frame to the next (or even from one level to another, if nothing uses it in
+	// between) - the first pass to use one must write it.
+	RenderGraphResource createBuffer(const string& name, VkDeviceSize size, VkBufferUsageFlags usage)
+	{
+		return addTransient(name, TransientDesc::buffer(size, usage));
+	}
+	RenderGraphResource createImage(const string& name, VkFormat format, uint32_t width, uint32_t height, VkImageUsageFlags usage, VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT)
+	{
+		return addTransient(name, TransientDesc::image(format, width, height, usage, aspectMask));
+	}
+
+	VkBuffer getBuffer(RenderGraphResource resource) const { return resources[resource].Buffer; }
+	VkImage getImage(RenderGraphResource resource) const   { return resources[resource].Image; }
+
+	// Method to add a pass. `execute` records the pass's commands - it's called from `RenderGraph::execute` (if the pass isn't culled).
+	PassBuilder addPass(const string& name, std::function<void(VkCommandBuffer)> execute)
+	{
+		Pass pass;
+		pass.Name = name;
+		pass.Execute = std::move(execute);
+		passes.push_back(std::move(pass));
+		compiled = false;
+		return PassBuilder(*this, static_cast<uint32_t>(passes.size() - 1));
+	}
+
+	// Method to mark a resource as used after the graph has run - so the passes that write it (and everything they depend on) are kept.
+	// If we're given a `finalUsage` then the graph ends with the barrier (and layout transition) that use needs.
+	void markOutput(RenderGraphResource resource, ResourceUsage finalUsage)
+	{
+		resources[resource].IsOutput = true;
+		resources[resource].HasFinalUsage = true;
+		resources[resource].FinalUsage = finalUsage;
+		compiled = false;
+	}
+	void markOutput(RenderGraphResource resource)
+	{
+		resources[resource].IsOutput = true;
+		compiled = false;
+	}
+
+	// Method to cull, order & work out barriers for everything added so far - and to place & create any transients using `pool`, which
+	// can only be left out if there aren't any. Returns false if a pass used a resource inconsistently or a transient couldn't be made.
+	bool compile(TransientResourcePool* pool = nullptr)
+	{
+		TRACE_SCOPE("RenderGraph::compile");
+		levels.clear();
+		finalBarriers = BarrierBatch();
+		stats = RenderGraphStats();
+		stats.PassesDeclared = static_cast<uint32_t>(passes.size());
+
+		if (!validate()) { return false; }
+		cullPasses();
+
+		// ----- Dependencies & levels -----
+		// Every pass goes one level after the latest pass it depends on. As passes can only depend on passes declared before them we can
+		// do this in a single walk - and any order that sorts by level is then a valid execution order.
+		std::vector<uint32_t> passLevel(passes.size(), 0);
+		std::vector<HazardTracker> trackers(resources.size());
+		uint32_t levelCount = 0;
+		for (uint32_t p = 0; p < passes.size(); ++p)
+		{
+			if (!passes[p].Live) { continue; }
+
+			uint32_t level = 0;
+			for (const Use& use : passes[p].Uses)
+			{
+				const HazardTracker& tracker = trackers[use.Resource];
+				const ResourceUsageInfo info = getResourceUsageInfo(use.Usage);
+
+				// A layout change is a write as far as ordering goes - it can't overlap anything else that touches the image
+				const bool layoutChange = isImage(use.Resource) && tracker.HasLayout && info.Layout != tracker.Layout;
+				if (tracker.LastWriter != UINT32_MAX) { level = std::max(level, passLevel[tracker.LastWriter] + 1); }  // RAW / WAW
+				if (info.Writes || layoutChange)
+				{
+					for (uint32_t reader : tracker.ReadersSinceWrite) { level = std::max(level, passLevel[reader] + 1); } // WAR
+				}
+			}
+			passLevel[p] = level;
+			levelCount = std::max(levelCount, level + 1);
+
+			for (const Use& use : passes[p].Uses)
+			{
+				HazardTracker& tracker = trackers[use.Resource];
+				const ResourceUsageInfo info = getResourceUsageInfo(use.Usage);
+				const bool layoutChange = isImage(use.Resource) && tracker.HasLayout && info.Layout != tracker.Layout;
+				if (info.Writes || layoutChange)
+				{
+					tracker.LastWriter = p;
+					tracker.ReadersSinceWrite.clear();
+				}
+				if (!info.Writes) { tracker.ReadersSinceWrite.push_back(p); }
+				tracker.Layout = info.Layout;
+				tracker.HasLayout = true;
+			}
+		}
+
+		levels.resize(levelCount);
+		for (uint32_t p = 0; p < passes.size(); ++p)
+		{
+			if (passes[p].Live) { levels[passLevel[p]].Passes.push_back(p); }
+		}
+		stats.Levels = levelCount;
+
+		if (!placeTransients(passLevel, pool)) { return false; }
+
+		// ----- Barriers -----
+		// Walk the levels in order, tracking what's pending on each resource, and work out the barrier each level needs up front
+		std::vector<SyncState> states(resources.size());
+		for (uint32_t r = 0; r < resources.size(); ++r) { states[r].Layout = resources[r].InitialLayout; }
+		std::vector<bool> aliasingHandled(resources.size(), false);
+
+		for (Level& level : levels)
+		{
+			// Gather what the whole level needs from each resource. Passes in the same level can't conflict (that would have been a
+			// dependency), so any one resource is either read by several of them in the same layout, or written by just one.
+			std::vector<ResourceUsageInfo> required(resources.size());
+			std::vector<bool> touched(resources.size(), false);
+			for (uint32_t p : level.Passes)
+			{
+				for (const Use& use : passes[p].Uses)
+				{
+					const ResourceUsageInfo info = getResourceUsageInfo(use.Usage);
+					ResourceUsageInfo& combined = required[use.Resource];
+					combined.Stages |= info.Stages;
+					combined.Access |= info.Access;
+					combined.Layout = info.Layout;
+					combined.Writes = combined.Writes || info.Writes;
+					touched[use.Resource] = true;
+				}
+			}
+			for (uint32_t r = 0; r < resources.size(); ++r)
+			{
+				if (!touched[r]) { continue; }
+				if (!resources[r].AliasPredecessors.empty() && !aliasingHandled[r])
+				{
+					addAliasingBarrierFor(r, required[r], states, level.Barriers);
+					aliasingHandled[r] = true;
+				}
+				addBarrierFor(r, required[r], states[r], level.Barriers);
+			}
+			countBatch(level.Barriers);
+		}
+
+		for (uint32_t r = 0; r < resources.size(); ++r)
+		{
+			if (resources[r].HasFinalUsage) { addBarrierFor(r, getResourceUsageInfo(resources[r].FinalUsage), states[r], finalBarriers); }
+		}
+		countBatch(finalBarriers);
+
+		compiled = true;
+		logPlan();
+		return true;
+	}
+
+	// Method to record every surviving pass, and the barriers between them, into `commandBuffer`
+	// CAREFUL: Call `compile` first (and again after adding anything) - otherwise this records nothing.
+	void execute(VkCommandBuffer commandBuffer) const
+	{
+		if (!compiled)
+		{
+			LOG_ERROR("[FAIL] Render graph must be compiled before it's executed.");
+			return;
+		}
+		for (const Level& level : levels)
+		{
+			recordBarriers(commandBuffer, level.Barriers);
+			for (uint32_t p : level.Passes) { passes[p].Execute(commandBuffer); }
+		}
+		recordBarriers(commandBuffer, finalBarriers);
+	}
+
+	const RenderGraphStats& getStats() const { return stats; }
+
+	// Method to get the names of the surviving passes in the order `execute` will record them
+	std::vector<string> getExecutionOrder() const
+	{
+		std::vector<string> order;
+		for (const Level& level : levels)
+		{
+			for (uint32_t p : level.Passes) { order.push_back(passes[p].Name); }
+		}
+		return order;
+	}
+
+	// Method to throw away every pass & resource so the graph can be rebuilt (e.g., next frame)
+	void reset()
+	{
+		passes.clear();
+		resources.clear();
+		levels.clear();
+		finalBarriers = BarrierBatch();
+		stats = RenderGraphStats();
+		compiled = false;
+	}
+
+private:
+
+	struct Use
+	{
+		RenderGraphResource Resource;
+		ResourceUsage Usage;
+		bool DeclaredAsWrite;
+	};
+
+	struct Pass
+	{
+		string Name;
+		std::function<void(VkCommandBuffer)> Execute;
+		std::vector<Use> Uses;
+		bool HasSideEffects = false;
+		bool Live = false;
+	};
+
+	struct Resource
+	{
+		string Name;
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		VkImage Image = VK_NULL_HANDLE;
+		bool IsImage = false;
+		VkImageAspectFlags AspectMask = 0;
+		VkImageLayout InitialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		bool IsOutput = false;
+		bool HasFinalUsage = false;
+		ResourceUsage FinalUsage = ResourceUsage::TransferRead;
+
+		// Transients only
+		bool IsTransient = false;
+		TransientDesc Desc;
+		uint32_t FirstLevel = UINT32_MAX;     // Lifetime, in levels (inclusive) - `UINT32_MAX` if no kept pass uses it
+		uint32_t LastLevel = 0;
+		uint32_t MemoryTypeIndex = UINT32_MAX;
+		VkDeviceSize Offset = 0;              // Where it sits in the pool's block for `MemoryTypeIndex`...
+		VkDeviceSize PlacedSize = 0;          // ...and how much of it, rounded up to the placement alignment
+		std::vector<uint32_t> AliasPredecessors; // Earlier transients whose memory this one reuses
+	};
+
+	// Who last touched a resource, while we work out dependencies
+	struct HazardTracker
+	{
+		uint32_t LastWriter = UINT32_MAX;
+		std::vector<uint32_t> ReadersSinceWrite;
+		VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		bool HasLayout = false;
+	};
+
+	// What's pending on a resource, while we work out barriers
+	struct SyncState
+	{
+		VkPipelineStageFlags2KHR WriteStages = VK_PIPELINE_STAGE_2_NONE_KHR;  // Stages of the last write (or layout transition)...
+		VkAccessFlags2KHR WriteAccess = VK_ACCESS_2_NONE_KHR;                  // ...and the writes that still need making available
+		VkPipelineStageFlags2KHR ReadStages = VK_PIPELINE_STAGE_2_NONE_KHR;   // Stages that have read it since then
+		VkPipelineStageFlags2KHR VisibleStages = VK_PIPELINE_STAGE_2_NONE_KHR; // Stages & accesses the last write has been made visible to
+		VkAccessFlags2KHR VisibleAccess = VK_ACCESS_2_NONE_KHR;
+		VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	// Everything one barrier call needs
+	struct BarrierBatch
+	{
+		VkMemoryBarrier2KHR Memory = { VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR, nullptr, VK_PIPELINE_STAGE_2_NONE_KHR, VK_ACCESS_2_NONE_KHR, VK_PIPELINE_STAGE_2_NONE_KHR, VK_ACCESS_2_NONE_KHR };
+		bool HasMemoryBarrier = false;
+		std::vector<VkImageMemoryBarrier2KHR> Images;
+	};
+
+	struct Level
+	{
+		BarrierBatch Barriers; // Recorded before any of the level's passes
+		std::vector<uint32_t> Passes;
+	};
+
+	static constexpr VkAccessFlags2KHR WriteAccessBits = VK_ACCESS_2_SHADER_WRITE_BIT_KHR | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR |
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR | VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR | VK_ACCESS_2_HOST_WRITE_BIT_KHR | VK_ACCESS_2_MEMORY_WRITE_BIT_KHR;
+
+	bool isImage(RenderGraphResource resource) const { return resources[resource].IsImage; }
+
+	RenderGraphResource addTransient(const string& name, const TransientDesc& desc)
+	{
+		Resource resource;
+		resource.Name = name;
+		resource.IsImage = desc.IsImage;
+		resource.AspectMask = desc.AspectMask;
+		resource.IsTransient = true;
+		resource.Desc = desc;
+		resources.push_back(resource);
+		compiled = false;
+		return static_cast<RenderGraphResource>(resources.size() - 1);
+	}
+
+	void addUse(uint32_t passIndex, RenderGraphResource resource, ResourceUsage usage, bool declaredAsWrite)
+	{
+		passes[passIndex].Uses.push_back({ resource, usage, declaredAsWrite });
+		compiled = false;
+	}
+
+	// Method to check every use makes sense - e.g., no reading with a usage that writes, or using one image in two layouts in one pass
+	bool validate() const
+	{
+		for (const Resource& resource : resources)
+		{
+			if (resource.IsTransient && resource.IsOutput)
+			{
+				LOG_ERROR("[FAIL] Render graph transient '{}' can't be an output - it doesn't outlive the graph. Import it instead.", resource.Name);
+				return false;
+			}
+		}
+		for (const Pass& pass : passes)
+		{
+			for (size_t i = 0; i < pass.Uses.size(); ++i)
+			{
+				const Use& use = pass.Uses[i];
+				if (use.Resource >= resources.size())
+				{
+					LOG_ERROR("[FAIL] Render graph pass '{}' uses resource {} which was never imported.", pass.Name, use.Resource);
+					return false;
+				}
+				const ResourceUsageInfo info = getResourceUsageInfo(use.Usage);
+				if (info.Writes != use.DeclaredAsWrite)
+				{
+					LOG_ERROR("[FAIL] Render graph pass '{}' declares a {} of '{}' with a usage that {}.", pass.Name, use.DeclaredAsWrite ? "write" : "read",
+						resources[use.Resource].Name, info.Writes ? "writes" : "only reads");
+					return false;
+				}
+				for (size_t j = 0; j < i; ++j)
+				{
+					if (pass.Uses[j].Resource == use.Resource && isImage(use.Resource) && getResourceUsageInfo(pass.Uses[j].Usage).Layout != info.Layout)
+					{
+						LOG_ERROR("[FAIL] Render graph pass '{}' uses image '{}' in two different layouts.", pass.Name, resources[use.Resource].Name);
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	// Method to mark the passes we need: those with side effects, those writing an output, and (working backwards) those writing
+	// anything a needed pass reads
+	void cullPasses()
+	{
+		std::vector<bool> needed(resources.size(), false);
+		for (uint32_t r = 0; r < resources.size(); ++r) { needed[r] = resources[r].IsOutput; }
+
+		for (size_t p = passes.size(); p-- > 0;)
+		{
+			Pass& pass = passes[p];
+			pass.Live = pass.HasSideEffects;
+			for (const Use& use : pass.Uses)
+			{
+				if (use.DeclaredAsWrite && needed[use.Resource]) { pass.Live = true; }
+			}
+			if (!pass.Live)
+			{
+				++stats.PassesCulled;
+				continue;
+			}
+			for (const Use& use : pass.Uses)
+			{
+				if (!use.DeclaredAsWrite) { needed[use.Resource] = true; }
+			}
+		}
+	}
+
+	// Method to work out each transient's lifetime, pack them into memory so that ones whose lifetimes overlap never overlap in memory, and
+	// get the actual buffers & images from the pool.
+	// Note: This is the classic "interval graph" packing: biggest first, each at the lowest offset that's clear of everything already
+	// placed whose lifetime overlaps its own. It isn't guaranteed optimal (that's NP-hard), but it's close on real frames.
+	bool placeTransients(const std::vector<uint32_t>& passLevel, TransientResourcePool* pool)
+	{
+		std::vector<uint32_t> live;
+		for (uint32_t r = 0; r < resources.size(); ++r)
+		{
+			Resource& resource = resources[r];
+			if (!resource.IsTransient) { continue; }
+			resource.FirstLevel = UINT32_MAX;
+			resource.LastLevel = 0;
+			resource.AliasPredecessors.clear();
+			resource.Buffer = VK_NULL_HANDLE;
+			resource.Image = VK_NULL_HANDLE;
+		}
+		for (uint32_t p = 0; p < passes.size(); ++p)
+		{
+			if (!passes[p].Live) { continue; }
+			for (const Use& use : passes[p].Uses)
+			{
+				Resource& resource = resources[use.Resource];
+				if (!resource.IsTransient) { continue; }
+				if (resource.FirstLevel == UINT32_MAX) { live.push_back(use.Resource); }
+				resource.FirstLevel = std::min(resource.FirstLevel, passLevel[p]);
+				resource.LastLevel = std::max(resource.LastLevel, passLevel[p]);
+			}
+		}
+		if (live.empty()) { return true; }
+		if (pool == nullptr)
+		{
+			LOG_ERROR("[FAIL] Render graph has transient resources but wasn't given a pool to put them in.");
+			return false;
+		}
+
+		for (uint32_t r : live)
+		{
+			Resource& resource = resources[r];
+			VkMemoryRequirements requirements = {};
+			if (!pool->getRequirements(resource.Desc, requirements, resource.MemoryTypeIndex)) { return false; }
+			const VkDeviceSize alignment = pool->getPlacementAlignment(requirements);
+			resource.PlacedSize = alignUp(requirements.size, alignment);
+			stats.TransientNaiveBytes += resource.PlacedSize;
+		}
+
+		std::sort(live.begin(), live.end(), [this](uint32_t a, uint32_t b)
+		{
+			if (resources[a].PlacedSize != resources[b].PlacedSize) { return resources[a].PlacedSize > resources[b].PlacedSize; }
+			return resources[a].FirstLevel < resources[b].FirstLevel;
+		});
+
+		std::map<uint32_t, VkDeviceSize> bytesPerMemoryType;
+		std::vector<uint32_t> placed;
+		std::vector<uint32_t> neighbours;
+		for (uint32_t r : live)
+		{
+			Resource& resource = resources[r];
+
+			// Everything already placed in the same memory that's alive at the same time, lowest first
+			neighbours.clear();
+			for (uint32_t q : placed)
+			{
+				const Resource& other = resources[q];
+				if (other.MemoryTypeIndex == resource.MemoryTypeIndex && other.FirstLevel <= resource.LastLevel && resource.FirstLevel <= other.LastLevel)
+				{
+					neighbours.push_back(q);
+				}
+			}
+			std::sort(neighbours.begin(), neighbours.end(), [this](uint32_t a, uint32_t b) { return resources[a].Offset < resources[b].Offset; });
+
+			// ..and take the first gap that's big enough
+			VkMemoryRequirements requirements = {};
+			uint32_t memoryTypeIndex = UINT32_MAX;
+			pool->getRequirements(resource.Desc, requirements, memoryTypeIndex);
+			const VkDeviceSize alignment = pool->getPlacementAlignment(requirements);
+			VkDeviceSize offset = 0;
+			for (uint32_t q : neighbours)
+			{
+				const Resource& other = resources[q];
+				if (offset + resource.PlacedSize <= other.Offset) { break; }
+				offset = std::max(offset, alignUp(other.Offset + other.PlacedSize, alignment));
+			}
+			resource.Offset = offset;
+			placed.push_back(r);
+
+			VkDeviceSize& blockBytes = bytesPerMemoryType[resource.MemoryTypeIndex];
+			blockBytes = std::max(blockBytes, offset + resource.PlacedSize);
+		}
+
+		// A transient that reuses memory an earlier one had needs to wait for that one to be finished with it
+		for (uint32_t r : live)
+		{
+			Resource& resource = resources[r];
+			for (uint32_t q : live)
+			{
+				const Resource& other = resources[q];
+				if (q != r && other.MemoryTypeIndex == resource.MemoryTypeIndex && other.LastLevel < resource.FirstLevel &&
+					other.Offset < resource.Offset + resource.PlacedSize && resource.Offset < other.Offset + other.PlacedSize)
+				{
+					resource.AliasPredecessors.push_back(q);
+				}
+			}
+			if (!resource.AliasPredecessors.empty()) { ++stats.AliasedTransients; }
+		}
+
+		if (!pool->beginFrame(bytesPerMemoryType)) { return false; }
+		for (uint32_t r : live)
+		{
+			Resource& resource = resources[r];
+			if (!pool->acquire(resource.Desc, resource.MemoryTypeIndex, resource.Offset, resource.Buffer, resource.Image)) { return false; }
+		}
+
+		stats.TransientResources = static_cast<uint32_t>(live.size());
+		for (const auto& [memoryTypeIndex, bytes] : bytesPerMemoryType) { stats.TransientAliasedBytes += bytes; }
+		return true;
+	}
+
+	static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+	// Method to add the barrier that hands memory over to transient `r` from the transients that used it before (its alias predecessors).
+	// The new one's contents are undefined, so we only need everything they did to have finished - and any writes to have been flushed, so
+	// they can't land on top of the new one's. Then we start `r` off as if those were its own earlier accesses.
+	void addAliasingBarrierFor(uint32_t r, const ResourceUsageInfo& required, std::vector<SyncState>& states, BarrierBatch& batch) const
+	{
+		SyncState& state = states[r];
+		VkAccessFlags2KHR pendingWrites = VK_ACCESS_2_NONE_KHR;
+		for (uint32_t q : resources[r].AliasPredecessors)
+		{
+			state.WriteStages |= states[q].WriteStages | states[q].ReadStages;
+			pendingWrites |= states[q].WriteAccess;
+		}
+		state.WriteAccess = VK_ACCESS_2_NONE_KHR;
+		state.ReadStages = VK_PIPELINE_STAGE_2_NONE_KHR;
+		state.VisibleStages = VK_PIPELINE_STAGE_2_NONE_KHR;
+		state.VisibleAccess = VK_ACCESS_2_NONE_KHR;
+		state.Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		// Note: The flush has to go in the global memory barrier - an image barrier's memory dependency only covers that image, and the
+		// earlier writes may well have been to a buffer (or another image) in the same memory
+		if (pendingWrites != VK_ACCESS_2_NONE_KHR)
+		{
+			batch.Memory.srcStageMask |= state.WriteStages;
+			batch.Memory.srcAccessMask |= pendingWrites;
+			batch.Memory.dstStageMask |= required.Stages;
+			batch.Memory.dstAccessMask |= required.Access;
+			batch.HasMemoryBarrier = true;
+		}
+		else if (!isImage(r))
+		{
+			// Only an execution dependency needed - which `addBarrierFor` will add, as a write-after-read, if the first use writes
+			state.ReadStages = state.WriteStages;
+			state.WriteStages = VK_PIPELINE_STAGE_2_NONE_KHR;
+		}
+	}
+
+	// Method to add whatever barrier resource `r` needs before it's used as per `required` to `batch`, and update its state to match
+	void addBarrierFor(uint32_t r, const ResourceUsageInfo& required, SyncState& state, BarrierBatch& batch) const
+	{
+		const bool layoutChange = isImage(r) && required.Layout != state.Layout;
+
+		VkPipelineStageFlags2KHR srcStages = VK_PIPELINE_STAGE_2_NONE_KHR;
+		VkAccessFlags2KHR srcAccess = VK_ACCESS_2_NONE_KHR;
+		VkPipelineStageFlags2KHR dstStages = required.Stages;
+		VkAccessFlags2KHR dstAccess = required.Access;
+		bool needed = false;
+
+		if (layoutChange)
+		{
+			// The transition has to wait for everything that's touched the image since it was last written
+			srcStages = state.WriteStages | state.ReadStages;
+			srcAccess = state.WriteAccess;
+			needed = true;
+		}
+		else if (required.Writes)
+		{
+			if (state.ReadStages != VK_PIPELINE_STAGE_2_NONE_KHR)
+			{
+				// Write-after-read only needs an execution dependency. Those reads already waited on the previous write (and it was made
+				// available then), so waiting on them covers write-after-write too.
+				srcStages = state.ReadStages;
+				needed = true;
+			}
+			else if (state.WriteStages != VK_PIPELINE_STAGE_2_NONE_KHR)
+			{
+				srcStages = state.WriteStages; // Write-after-write
+				srcAccess = state.WriteAccess;
+				needed = true;
+			}
+		}
+		else if (state.WriteStages != VK_PIPELINE_STAGE_2_NONE_KHR &&
+			((required.Stages & ~state.VisibleStages) != 0 || (required.Access & ~state.VisibleAccess) != 0))
+		{
+			// Read-after-write that the last barrier didn't already cover. We make the write visible to everything that could already
+			// see it as well as to the new reader, so that the latest barrier always covers every stage / access pair we think it does.
+			srcStages = state.WriteStages;
+			srcAccess = state.WriteAccess;
+			dstStages |= state.VisibleStages;
+			dstAccess |= state.VisibleAccess;
+			needed = true;
+		}
+
+		if (needed)
+		{
+			if (layoutChange)
+			{
+				VkImageMemoryBarrier2KHR imageBarrier = {};
+				imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+				imageBarrier.pNext = nullptr;
+				imageBarrier.srcStageMask = srcStages;
+				imageBarrier.srcAccessMask = srcAccess;
+				imageBarrier.dstStageMask = dstStages;
+				imageBarrier.dstAccessMask = dstAccess;
+				imageBarrier.oldLayout = state.Layout;
+				imageBarrier.newLayout = required.Layout;
+				imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				imageBarrier.image = resources[r].Image;
+				imageBarrier.subresourceRange = { resources[r].AspectMask, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+				batch.Images.push_back(imageBarrier);
+			}
+			else
+			{
+				batch.Memory.srcStageMask |= srcStages;
+				batch.Memory.srcAccessMask |= srcAccess;
+				batch.Memory.dstStageMask |= dstStages;
+				batch.Memory.dstAccessMask |= dstAccess;
+				batch.HasMemoryBarrier = true;
+			}
+		}
+
+		if (required.Writes || layoutChange)
+		{
+			// A layout transition counts as a write that's been made visible to the stages that asked for it - anything else that comes
+			// along later can chain off those stages
+			state.WriteStages = required.Stages;
+			state.WriteAccess = required.Writes ? (required.Access & WriteAccessBits) : VK_ACCESS_2_NONE_KHR;
+			state.ReadStages = required.Writes ? VK_PIPELINE_STAGE_2_NONE_KHR : required.Stages;
+			state.VisibleStages = required.Writes ? VK_PIPELINE_STAGE_2_NONE_KHR : required.Stages;
+			state.VisibleAccess = required.Writes ? VK_ACCESS_2_NONE_KHR : required.Access;
+		}
+		else
+		{
+			state.ReadStages |= required.Stages;
+			if (needed)
+			{
+				state.VisibleStages = dstStages;
+				state.VisibleAccess = dstAccess;
+			}
+		}
+		if (isImage(r)) { state.Layout = required.Layout; }
+	}
+
+	void countBatch(const BarrierBatch& batch)
+	{
+		if (!batch.HasMemoryBarrier && batch.Images.empty()) { return; }
+		++stats.BarrierCalls;
+		stats.ImageBarriers += static_cast<uint32_t>(batch.Images.size());
+		stats.MemoryBarriers += batch.HasMemoryBarrier ? 1 : 0;
+	}
+
+	static void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch)
+	{
+		if (!batch.HasMemoryBarrier && batch.Images.empty()) { return; }
+
+		if (VulkanFunctionLoaders::vkCmdPipelineBarrier2KHR != nullptr)
+		{
+			VkDependencyInfoKHR dependencyInfo = {};
+			dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+			dependencyInfo.pNext = nullptr;
+			dependencyInfo.dependencyFlags = 0;
+			dependencyInfo.memoryBarrierCount = batch.HasMemoryBarrier ? 1 : 0;
+			dependencyInfo.pMemoryBarriers = batch.HasMemoryBarrier ? &batch.Memory : nullptr;
+			dependencyInfo.bufferMemoryBarrierCount = 0;
+			dependencyInfo.pBufferMemoryBarriers = nullptr;
+			dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(batch.Images.size());
+			dependencyInfo.pImageMemoryBarriers = batch.Images.empty() ? nullptr : batch.Images.data();
+			VulkanFunctionLoaders::vkCmdPipelineBarrier2KHR(commandBuffer, &dependencyInfo);
+			return;
+		}
+
+		// No `VK_KHR_synchronization2`, so squash everything into one src & dst stage mask. Our flags all fit in 32 bits (see above).
+		// Note: The original barriers can't have an empty src stage mask - "wait for nothing" is spelled `TOP_OF_PIPE` there.
+		VkPipelineStageFlags srcStages = static_cast<VkPipelineStageFlags>(batch.Memory.srcStageMask);
+		VkPipelineStageFlags dstStages = static_cast<VkPipelineStageFlags>(batch.Memory.dstStageMask);
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		imageBarriers.reserve(batch.Images.size());
+		for (const VkImageMemoryBarrier2KHR& image : batch.Images)
+		{
+			srcStages |= static_cast<VkPipelineStageFlags>(image.srcStageMask);
+			dstStages |= static_cast<VkPipelineStageFlags>(image.dstStageMask);
+
+			VkImageMemoryBarrier imageBarrier = {};
+			imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarrier.pNext = nullptr;
+			imageBarrier.srcAccessMask = static_cast<VkAccessFlags>(image.srcAccessMask);
+			imageBarrier.dstAccessMask = static_cast<VkAccessFlags>(image.dstAccessMask);
+			imageBarrier.oldLayout = image.oldLayout;
+			imageBarrier.newLayout = image.newLayout;
+			imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.image = image.image;
+			imageBarrier.subresourceRange = image.subresourceRange;
+			imageBarriers.push_back(imageBarrier);
+		}
+		if (srcStages == 0) { srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT; }
+
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.pNext = nullptr;
+		memoryBarrier.srcAccessMask = static_cast<VkAccessFlags>(batch.Memory.srcAccessMask);
+		memoryBarrier.dstAccessMask = static_cast<VkAccessFlags>(batch.Memory.dstAccessMask);
+		VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0,
+			batch.HasMemoryBarrier ? 1 : 0, batch.HasMemoryBarrier ? &memoryBarrier : nullptr,
+			0, nullptr,
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.empty() ? nullptr : imageBarriers.data());
+	}
+
+	void logPlan() const
+	{
+		LOG_VERY_VERBOSE("[OK] Compiled render graph: {} of {} passes kept in {} level(s), {} barrier call(s) ({} image, {} memory barrier(s)).",
+			stats.PassesDeclared - stats.PassesCulled, stats.PassesDeclared, stats.Levels, stats.BarrierCalls, stats.ImageBarriers, stats.MemoryBarriers);
+		if (stats.TransientResources > 0)
+		{
+			LOG_VERY_VERBOSE("[OK] Render graph transients: {} resource(s) ({} aliased) in {} bytes, vs {} bytes unaliased.",
+				stats.TransientResources, stats.AliasedTransients, stats.TransientAliasedBytes, stats.TransientNaiveBytes);
+		}
+		if (Logger::isEnabled(LogLevel::VeryVerbose))
+		{
+			for (size_t l = 0; l < levels.size(); ++l)
+			{
+				string names;
+				for (uint32_t p : levels[l].Passes) { names += (names.empty() ? "" : ", ") + passes[p].Name; }
+				LOG_VERY_VERBOSE("\tLevel {}: {} (image barriers before it: {}, memory barrier: {})", l, names, levels[l].Barriers.Images.size(), levels[l].Barriers.HasMemoryBarrier);
+			}
+			for (const Pass& pass : passes)
+			{
+				if (!pass.Live) { LOG_VERY_VERBOSE("\tCulled: {}", pass.Name); }
+			}
+		}
+	}
+
+	std::vector<Pass> passes;
+	std::vector<Resource> resources;
+	std::vector<Level> levels;
+	BarrierBatch finalBarriers;
+	RenderGraphStats stats;
+	bool compiled = false;
+};
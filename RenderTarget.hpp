@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstdint>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+
+// An image we render into, with its own memory & a view of the whole thing for use in a framebuffer.
+//
+// A `Transient` render target is one that only lives inside a render pass - its contents are cleared (or don't care) on load and thrown
+// away on store, like an MSAA colour buffer that gets resolved or a depth buffer nobody samples afterwards. Those get created with
+// `VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT` and go in lazily allocated memory when the device has it (see
+// `VulkanHelpers::findAttachmentMemoryTypeIndex`) - on tile-based GPUs such attachments may never take up any real memory, or bandwidth.
+// Where there's no lazily allocated memory we quietly fall back to normal device-local memory, so callers don't need to care either way.
+struct RenderTarget
+{
+	VkImage Image = VK_NULL_HANDLE;
+	VkDeviceMemory Memory = VK_NULL_HANDLE;
+	VkImageView View = VK_NULL_HANDLE;
+	VkFormat Format = VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT;
+	VkDeviceSize AllocationSize = 0;
+	bool LazilyAllocated = false;
+
+	// Note: For a transient target `usage` should only hold attachment bits (colour, depth / stencil or input) - that's all the spec allows
+	// alongside `VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT`, which we add ourselves.
+	bool create(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, VkFormat format, uint32_t width, uint32_t height,
+		VkImageUsageFlags usage, VkSampleCountFlagBits samples, VkImageAspectFlags aspectMask, bool transient)
+	{
+		Format = format;
+		Samples = samples;
+
+		VkImageCreateInfo imageCreateInfo = {};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.pNext = nullptr;
+		imageCreateInfo.flags = 0;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = format;
+		imageCreateInfo.extent = { width, height, 1 };
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.samples = samples;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage = transient ? (usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) : usage;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.queueFamilyIndexCount = 0;
+		imageCreateInfo.pQueueFamilyIndices = nullptr;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VkResult result = VulkanFunctionLoaders::vkCreateImage(device, &imageCreateInfo, nullptr, &Image);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create {}x{} render target with {} sample(s). VkResult is: {}", width, height, static_cast<uint32_t>(samples), VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		VulkanFunctionLoaders::vkGetImageMemoryRequirements(device, Image, &memoryRequirements);
+		const uint32_t memoryTypeIndex = VulkanHelpers::findAttachmentMemoryTypeIndex(memoryProperties, memoryRequirements.memoryTypeBits, transient, LazilyAllocated);
+		if (memoryTypeIndex == UINT32_MAX)
+		{
+			LOG_ERROR("[FAIL] No memory type is suitable for a render target.");
+			return false;
+		}
+
+		VkMemoryAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.allocationSize = memoryRequirements.size;
+		allocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+		result = VulkanFunctionLoaders::vkAllocateMemory(device, &allocateInfo, nullptr, &Memory);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not allocate {} bytes of render target memory. VkResult is: {}", memoryRequirements.size, VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		AllocationSize = memoryRequirements.size;
+
+		result = VulkanFunctionLoaders::vkBindImageMemory(device, Image, Memory, 0);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not bind render target memory. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+
+		VkImageViewCreateInfo viewCreateInfo = {};
+		viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewCreateInfo.pNext = nullptr;
+		viewCreateInfo.flags = 0;
+		viewCreateInfo.image = Image;
+		viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewCreateInfo.format = format;
+		viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+		viewCreateInfo.subresourceRange = { aspectMask, 0, 1, 0, 1 };
+
+		result = VulkanFunctionLoaders::vkCreateImageView(device, &viewCreateInfo, nullptr, &View);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create render target view. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		return true;
+	}
+
+	// Method to get how much memory the target is really using. For lazily allocated memory that's however much the driver has had to
+	// commit so far (often 0 on tile-based GPUs) - otherwise it's the whole allocation.
+	VkDeviceSize getCommittedBytes(VkDevice device) const
+	{
+		if (!LazilyAllocated) { return AllocationSize; }
+		VkDeviceSize committed = 0;
+		VulkanFunctionLoaders::vkGetDeviceMemoryCommitment(device, Memory, &committed);
+		return committed;
+	}
+
+	// CAREFUL: Nothing on the GPU may still be using the target (or a framebuffer made from its view) when we call this!
+	void destroy(VkDevice device)
+	{
+		if (View != VK_NULL_HANDLE)   { VulkanFunctionLoaders::vkDestroyImageView(device, View, nullptr); }
+		if (Image != VK_NULL_HANDLE)  { VulkanFunctionLoaders::vkDestroyImage(device, Image, nullptr); }
+		if (Memory != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkFreeMemory(device, Memory, nullptr); }
+		View = VK_NULL_HANDLE;
+		Image = VK_NULL_HANDLE;
+		Memory = VK_NULL_HANDLE;
+		AllocationSize = 0;
+		LazilyAllocated = false;
+	}
+};
+
+// Method to pick a depth format we can both render into and sample afterwards (e.g., to build a Hi-Z pyramid from - see `HiZPyramid`):
+// `VK_FORMAT_D32_SFLOAT` where the device allows that, otherwise `VK_FORMAT_D16_UNORM`, which every device has to support for both.
+inline VkFormat findSampledDepthFormat(VkPhysicalDevice physicalDevice)
+{
+	VkFormatProperties formatProperties;
+	VulkanFunctionLoaders::vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_D32_SFLOAT, &formatProperties);
+	const VkFormatFeatureFlags neededFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+	return (formatProperties.optimalTilingFeatures & neededFeatures) == neededFeatures ? VK_FORMAT_D32_SFLOAT : VK_FORMAT_D16_UNORM;
+}
+
+// Method to create a single-subpass render pass that renders into multisampled colour & depth attachments and resolves the colour into a
+// single-sampled image at the end of the subpass - so the multisampled data never has to be written out to memory. Attachments are:
+//   0: Multisampled colour - cleared on load, NOT stored
+//   1: Multisampled depth  - cleared on load, NOT stored
+//   2: The resolve target  - left in `resolveFinalLayout` when the render pass ends
+// so a framebuffer for it needs views in that order, and `vkCmdBeginRenderPass` needs clear values for the first two.
+// Note: On tile-based GPUs the resolve happens as each tile is written out, so with lazily allocated attachments the MSAA data only ever
+// exists in tile memory. Elsewhere it at least saves the bandwidth of storing it & reading it back for a separate resolve.
+inline bool createMsaaResolveRenderPass(VkDevice device, VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples, VkImageLayout resolveFinalLayout,
+	VkRenderPass& renderPass)
+{
+	VkAttachmentDescription attachments[3] = {};
+	attachments[0].format = colorFormat;
+	attachments[0].samples = samples;
+	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	attachments[1] = attachments[0];
+	attachments[1].format = depthFormat;
+	attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	attachments[2] = attachments[0];
+	attachments[2].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE; // Every pixel gets overwritten by the resolve
+	attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachments[2].finalLayout = resolveFinalLayout;
+
+	const VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	const VkAttachmentReference depthReference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+	const VkAttachmentReference resolveReference = { 2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+
+	VkSubpassDescription subpass = {};
+	subpass.flags = 0;
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.inputAttachmentCount = 0;
+	subpass.pInputAttachments = nullptr;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorReference;
+	subpass.pResolveAttachments = &resolveReference;
+	subpass.pDepthStencilAttachment = &depthReference;
+	subpass.preserveAttachmentCount = 0;
+	subpass.pPreserveAttachments = nullptr;
+
+	// Before: Whatever last touched these images (an earlier frame's render pass or the copy out of the resolve target) must be done
+	// before we clear them. After: The resolve must land before anything reads the result.
+	VkSubpassDependency dependencies[2] = {};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].srcAccessMask = 0;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dependencyFlags = 0;
+
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT; // Note: Resolves happen in this stage
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	dependencies[1].dependencyFlags = 0;
+
+	VkRenderPassCreateInfo renderPassCreateInfo = {};
+	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassCreateInfo.pNext = nullptr;
+	renderPassCreateInfo.flags = 0;
+	renderPassCreateInfo.attachmentCount = 3;
+	renderPassCreateInfo.pAttachments = attachments;
+	renderPassCreateInfo.subpassCount = 1;
+	renderPassCreateInfo.pSubpasses = &subpass;
+	renderPassCreateInfo.dependencyCount = 2;
+	renderPassCreateInfo.pDependencies = dependencies;
+
+	const VkResult result = VulkanFunctionLoaders::vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, &renderPass);
+	if (result != VK_SUCCESS)
+	{
+		LOG_ERROR("[FAIL] Could not create MSAA resolve render pass. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,416 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "ObjectCache.hpp"
+#include "GpuBuffer.hpp"
+#include "DescriptorTemplate.hpp"
+#include "ComputePipeline.hpp"
+#include "ComputeBatch.hpp"
+
+// What a device's subgroups (the invocations that execute in lockstep - a "warp" or "wavefront") can do for our compute shaders
+struct SubgroupSupport
+{
+	uint32_t SubgroupSize = 1;
+	bool Arithmetic = false; // Compute shaders can use the basic & arithmetic subgroup operations (`subgroupAdd`, `subgroupExclusiveAdd` etc.)
+};
+
+// Method to ask a device what its subgroups can do. `apiVersion` is the Vulkan version we're using the device at - the lower of the
+// instance's & the device's - as subgroup operations (and asking about them) need 1.1. So does the SPIR-V our subgroup shaders are
+// compiled to. We also need `vkGetPhysicalDeviceProperties2KHR`, so without either we report no support, and callers fall back on
+// shared memory.
+// See: https://www.khronos.org/blog/vulkan-subgroup-tutorial
+inline SubgroupSupport querySubgroupSupport(VkPhysicalDevice physicalDevice, uint32_t apiVersion)
+{
+	SubgroupSupport support;
+	if (apiVersion < VK_API_VERSION_1_1 || VulkanFunctionLoaders::vkGetPhysicalDeviceProperties2KHR == nullptr) { return support; }
+
+	VkPhysicalDeviceSubgroupProperties subgroupProperties = {};
+	subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+	subgroupProperties.pNext = nullptr;
+	VkPhysicalDeviceProperties2KHR properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+	properties.pNext = &subgroupProperties;
+	VulkanFunctionLoaders::vkGetPhysicalDeviceProperties2KHR(physicalDevice, &properties);
+
+	const VkSubgroupFeatureFlags requiredOperations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+	support.SubgroupSize = subgroupProperties.subgroupSize;
+	support.Arithmetic = (subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) != 0 &&
+		(subgroupProperties.supportedOperations & requiredOperations) == requiredOperations;
+	return support;
+}
+
+// Descriptors for `prefix_scan.comp`
+struct ScanDescriptors
+{
+	VkDescriptorBufferInfo Values;
+	VkDescriptorBufferInfo Heads;
+	VkDescriptorBufferInfo Output;
+	VkDescriptorBufferInfo LookBack;
+};
+template <> struct DescriptorLayout<ScanDescriptors>
+{
+	static constexpr std::array<DescriptorBinding, 4> Bindings = {
+		DESCRIPTOR_BINDING(ScanDescriptors, Values, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(ScanDescriptors, Heads, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(ScanDescriptors, Output, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(ScanDescriptors, LookBack, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) };
+};
+
+// Descriptors for `reduce_u32.comp`
+struct IntegerReduceDescriptors
+{
+	VkDescriptorBufferInfo Values;
+	VkDescriptorBufferInfo Result;
+};
+template <> struct DescriptorLayout<IntegerReduceDescriptors>
+{
+	static constexpr std::array<DescriptorBinding, 2> Bindings = {
+		DESCRIPTOR_BINDING(IntegerReduceDescriptors, Values, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(IntegerReduceDescriptors, Result, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) };
+};
+
+// Class to record parallel primitives over arrays of 32-bit unsigned integers: a sum reduction, inclusive & exclusive prefix sums (scans),
+// and segmented scans - which restart the sum at every element flagged as the head of a segment. These are the building blocks of stream
+// compaction, sorting & the like (anything that needs to know "where does my output go?").
+//
+// Every scan is a single pass using decoupled look-back (see `prefix_scan.comp`), so it reads its input once & writes its output once
+// however big the array is - which makes it as fast as a copy. The reduction is a single pass too, as integer sums don't care what order
+// they're added in. Both come in two variants: one that does its workgroup-wide sums with subgroup arithmetic, and one that does them in
+// shared memory for devices (or Vulkan 1.0 instances) without it. `create` picks between them from a `querySubgroupSupport`.
+//
+// CAREFUL: Scans need a "look-back" state buffer of at least `getLookBackSize(count)` bytes, and reductions write their result into a single
+// uint - we zero both with `vkCmdFillBuffer` before each dispatch, so their buffers need `VK_BUFFER_USAGE_TRANSFER_DST_BIT`. We put a barrier
+// before each fill (so one look-back buffer can be reused by scan after scan), but not after the dispatch: use `recordComputeToComputeBarrier`
+// before reading an output.
+// Note: Like `ComputeKernelLibrary`, every dispatch gets its own descriptor set - call `resetDescriptors` to hand them all back.
+class ScanPrimitives
+{
+public:
+
+	// Elements each scan workgroup handles: 256 invocations of 8 consecutive elements each
+	static constexpr uint32_t ScanWorkgroupSize = 256;
+	static constexpr uint32_t ScanItemsPerInvocation = 8;
+	static constexpr uint32_t ScanPartitionSize = ScanWorkgroupSize * ScanItemsPerInvocation;
+
+	// Method to load `prefix_scan[_subgroup].spv` & `reduce_u32[_subgroup].spv` from `shaderDirectory` (the subgroup variants if `subgroups`
+	// says we can) and create their pipelines, plus a descriptor pool with enough sets for `maxDispatchesPerReset` dispatches. Returns false
+	// (having cleaned up after itself) if anything's missing or fails.
+	bool create(VkDevice logicalDevice, const SubgroupSupport& subgroups, const string& shaderDirectory = "shaders/spv", uint32_t maxDispatchesPerReset = 256,
+		ObjectCache* objectCache = nullptr)
+	{
+		device = logicalDevice;
+		useSubgroups = subgroups.Arithmetic;
+
+		if (!scanTemplate.create(device, objectCache) || !reduceTemplate.create(device, objectCache))
+		{
+			destroy();
+			return false;
+		}
+
+		const string suffix = useSubgroups ? "_subgroup.spv" : ".spv";
+		std::vector<uint32_t> code;
+		if (!loadSpirvFile(shaderDirectory + "/prefix_scan" + suffix, code))
+		{
+			destroy();
+			return false;
+		}
+		for (uint32_t variant = 0; variant < ScanVariantCount; ++variant)
+		{
+			// Note: Constants are EXCLUSIVE, SEGMENTED & ITEMS_PER_INVOCATION - see `getScanVariant`
+			const uint32_t exclusive = variant & 1;
+			const uint32_t segmented = variant >> 1;
+			if (!scanPipelines[variant].create(device, code, scanTemplate.SetLayout, sizeof(PushConstants), { exclusive, segmented, ScanItemsPerInvocation }, objectCache))
+			{
+				destroy();
+				return false;
+			}
+		}
+		if (!reducePipeline.createFromFile(device, shaderDirectory + "/reduce_u32" + suffix, reduceTemplate.SetLayout, sizeof(PushConstants), {}, objectCache))
+		{
+			destroy();
+			return false;
+		}
+
+		// Size the pool for the worst case of every dispatch being a scan
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		DescriptorSetTemplate<ScanDescriptors>::addPoolSizes(poolSizes, maxDispatchesPerReset);
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.pNext = nullptr;
+		poolCreateInfo.flags = 0;
+		poolCreateInfo.maxSets = maxDispatchesPerReset;
+		poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolCreateInfo.pPoolSizes = poolSizes.data();
+		const VkResult result = VulkanFunctionLoaders::vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &descriptorPool);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create scan primitive descriptor pool. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			descriptorPool = VK_NULL_HANDLE;
+			destroy();
+			return false;
+		}
+
+		LOG_VERBOSE("[OK] Loaded scan primitives ({}) from: {}", useSubgroups ? "subgroup arithmetic" : "shared memory", shaderDirectory);
+		return true;
+	}
+
+	bool usesSubgroups() const { return useSubgroups; }
+
+	// How many bytes of look-back state a scan of `count` elements needs: a partition counter, then three words per partition
+	static VkDeviceSize getLookBackSize(uint32_t count)
+	{
+		return (1 + 3 * static_cast<VkDeviceSize>(getPartitionCount(count))) * sizeof(uint32_t);
+	}
+
+	// The most elements one scan can handle (a workgroup per partition, and there can only be so many workgroups)
+	static constexpr uint32_t getMaxScanCount() { return MaxWorkgroupCount * ScanPartitionSize; }
+
+	// Method to hand back every descriptor set our dispatches have used since the last reset.
+	// CAREFUL: The GPU must be finished with everything recorded since then!
+	void resetDescriptors()
+	{
+		if (descriptorPool != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkResetDescriptorPool(device, descriptorPool, 0); }
+	}
+
+	// Method to record summing `count` elements of `values` (wrapping on overflow) into the single uint at the start of `result`.
+	// Returns false if we've run out of descriptor sets.
+	bool recordReduce(VkCommandBuffer commandBuffer, const VkDescriptorBufferInfo& values, const VkDescriptorBufferInfo& result, uint32_t count)
+	{
+		const VkDescriptorSet set = allocateSet(reduceTemplate.SetLayout);
+		if (set == VK_NULL_HANDLE) { return false; }
+		reduceTemplate.update(set, { values, result });
+
+		recordClear(commandBuffer, result.buffer, result.offset, sizeof(uint32_t));
+		reducePipeline.bind(commandBuffer, set);
+		reducePipeline.pushConstants(commandBuffer, PushConstants{ count });
+
+		// Note: The shader loops over the array, so a workgroup per partition's worth of elements is plenty - each invocation sums 8 or more
+		const uint32_t groupCount = std::clamp(getPartitionCount(count), 1u, MaxWorkgroupCount);
+		reducePipeline.dispatch(commandBuffer, groupCount);
+		return true;
+	}
+
+	// Method to record `output[i] = values[0] + ... + values[i]` for `count` elements. `output` may be `values` (an in-place scan).
+	// Returns false if `count` is over `getMaxScanCount` or we've run out of descriptor sets.
+	bool recordInclusiveScan(VkCommandBuffer commandBuffer, const VkDescriptorBufferInfo& values, const VkDescriptorBufferInfo& output,
+		const VkDescriptorBufferInfo& lookBack, uint32_t count)
+	{
+		return recordScan(commandBuffer, getScanVariant(false, false), values, values, output, lookBack, count);
+	}
+
+	// Method to record `output[i] = values[0] + ... + values[i - 1]` (so `output[0]` is 0) for `count` elements
+	// CAREFUL: Unlike the inclusive scan, this can't be done in place - `output` must not overlap `values`.
+	bool recordExclusiveScan(VkCommandBuffer commandBuffer, const VkDescriptorBufferInfo& values, const VkDescriptorBufferInfo& output,
+		const VkDescriptorBufferInfo& lookBack, uint32_t count)
+	{
+		return recordScan(commandBuffer, getScanVariant(true, false), values, values, output, lookBack, count);
+	}
+
+	// Method to record a scan that restarts wherever `heads[i]` is non-zero - i.e., a separate scan of every segment that starts at a head
+	// (the first element always starts one, flagged or not). Inclusive unless `exclusive`, in which case every head's output is 0.
+	// CAREFUL: `output` must not overlap `values` or `heads`.
+	bool recordSegmentedScan(VkCommandBuffer commandBuffer, const VkDescriptorBufferInfo& values, const VkDescriptorBufferInfo& heads,
+		const VkDescriptorBufferInfo& output, const VkDescriptorBufferInfo& lookBack, uint32_t count, bool exclusive = false)
+	{
+		return recordScan(commandBuffer, getScanVariant(exclusive, true), values, heads, output, lookBack, count);
+	}
+
+	// CAREFUL: The GPU must be finished with everything we've recorded before we call this!
+	void destroy()
+	{
+		if (descriptorPool != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+			descriptorPool = VK_NULL_HANDLE;
+		}
+		for (ComputePipeline& pipeline : scanPipelines) { pipeline.destroy(); }
+		reducePipeline.destroy();
+		scanTemplate.destroy();
+		reduceTemplate.destroy();
+	}
+
+private:
+
+	// Must match the `push_constant` block in `prefix_scan.comp` & `reduce_u32.comp`
+	struct PushConstants { uint32_t Count; };
+
+	// Note: 65535 is the least `maxComputeWorkGroupCount` every device has to support
+	static constexpr uint32_t MaxWorkgroupCount = 65535;
+	static constexpr uint32_t ScanVariantCount = 4;
+
+	static uint32_t getPartitionCount(uint32_t count) { return static_cast<uint32_t>((static_cast<uint64_t>(count) + ScanPartitionSize - 1) / ScanPartitionSize); }
+	static uint32_t getScanVariant(bool exclusive, bool segmented) { return (exclusive ? 1u : 0u) | (segmented ? 2u : 0u); }
+
+	bool recordScan(VkCommandBuffer commandBuffer, uint32_t variant, const VkDescriptorBufferInfo& values, const VkDescriptorBufferInfo& heads,
+		const VkDescriptorBufferInfo& output, const VkDescriptorBufferInfo& lookBack, uint32_t count)
+	{
+		if (count == 0) { return true; }
+		const uint32_t groupCount = getPartitionCount(count);
+		if (groupCount > MaxWorkgroupCount)
+		{
+			LOG_ERROR("[FAIL] Can't scan {} elements - the most we can is {}.", count, getMaxScanCount());
+			return false;
+		}
+
+		const VkDescriptorSet set = allocateSet(scanTemplate.SetLayout);
+		if (set == VK_NULL_HANDLE) { return false; }
+		scanTemplate.update(set, { values, heads, output, lookBack });
+
+		recordClear(commandBuffer, lookBack.buffer, lookBack.offset, getLookBackSize(count));
+		const ComputePipeline& pipeline = scanPipelines[variant];
+		pipeline.bind(commandBuffer, set);
+		pipeline.pushConstants(commandBuffer, PushConstants{ count });
+		pipeline.dispatch(commandBuffer, groupCount);
+		return true;
+	}
+
+	// Method to record zeroing `size` bytes of a buffer our shaders are about to use - after any earlier dispatch is done with it, and before
+	// the next one starts
+	static void recordClear(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+	{
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.pNext = nullptr;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		VulkanFunctionLoaders::vkCmdFillBuffer(commandBuffer, buffer, offset, size, 0);
+
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	VkDescriptorSet allocateSet(VkDescriptorSetLayout setLayout)
+	{
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.descriptorPool = descriptorPool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &setLayout;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		const VkResult result = VulkanFunctionLoaders::vkAllocateDescriptorSets(device, &allocateInfo, &set);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not allocate a descriptor set for a scan primitive - call `resetDescriptors` more often? VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return VK_NULL_HANDLE;
+		}
+		return set;
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	bool useSubgroups = false;
+	DescriptorSetTemplate<ScanDescriptors> scanTemplate;
+	DescriptorSetTemplate<IntegerReduceDescriptors> reduceTemplate;
+	ComputePipeline scanPipelines[ScanVariantCount];
+	ComputePipeline reducePipeline;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+};
+
+// A self-checking workload for `ScanPrimitives`: reduces, and takes inclusive, exclusive & segmented scans of, `count` pseudo-random
+// values - checking every element against a scan on the CPU. Use a `count` of a few partitions or more (and not a multiple of
+// `ScanPartitionSize`) so the look-back & the ragged last partition both get exercised. The segments include ones much longer than a
+// partition, and partitions with several heads in them.
+inline BatchWorkload makeScanWorkload(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, ScanPrimitives& primitives, uint32_t count)
+{
+	struct ScanState
+	{
+		VkDevice Device = VK_NULL_HANDLE;
+		GpuBuffer Values;
+		GpuBuffer Heads;
+		GpuBuffer Inclusive;
+		GpuBuffer Exclusive;
+		GpuBuffer Segmented;
+		GpuBuffer LookBack;
+		GpuBuffer Sum;
+		~ScanState() { Values.destroy(Device); Heads.destroy(Device); Inclusive.destroy(Device); Exclusive.destroy(Device); Segmented.destroy(Device); LookBack.destroy(Device); Sum.destroy(Device); }
+	};
+	auto state = std::make_shared<ScanState>();
+	state->Device = device;
+
+	// Values of 0-255, so the sums overflow well past 2^24 (beyond where a float would be exact) without wrapping a uint for any count
+	// we'd check. Heads are sparse at first and dense later, with a long run of none in between.
+	auto value = [](uint32_t i) { return (i * 2654435761u) >> 24; };
+	auto isHead = [count](uint32_t i) { return i < count / 3 ? (i * 40503u) % 1499u == 0 : (i > count * 2 / 3 && (i * 40503u) % 97u == 0); };
+
+	BatchWorkload workload;
+	workload.Name = string("scan-primitives-") + (primitives.usesSubgroups() ? "subgroup" : "shared");
+	workload.Record = [state, memoryProperties, &primitives, count, value, isHead](VkCommandBuffer commandBuffer)
+	{
+		const VkDeviceSize arraySize = static_cast<VkDeviceSize>(count) * sizeof(uint32_t);
+		if (state->Values.Buffer == VK_NULL_HANDLE)
+		{
+			const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			const VkBufferUsageFlags clearable = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			if (!state->Values.create(state->Device, memoryProperties, arraySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->Heads.create(state->Device, memoryProperties, arraySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->Inclusive.create(state->Device, memoryProperties, arraySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->Exclusive.create(state->Device, memoryProperties, arraySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->Segmented.create(state->Device, memoryProperties, arraySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->LookBack.create(state->Device, memoryProperties, ScanPrimitives::getLookBackSize(count), clearable, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ||
+				!state->Sum.create(state->Device, memoryProperties, sizeof(uint32_t), clearable, hostVisible, true))
+			{
+				return false;
+			}
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				static_cast<uint32_t*>(state->Values.Mapped)[i] = value(i);
+				static_cast<uint32_t*>(state->Heads.Mapped)[i] = isHead(i) ? 1 : 0;
+			}
+		}
+
+		RenderGraph graph;
+		const RenderGraphResource values = graph.importBuffer("Values", state->Values.Buffer);
+		const RenderGraphResource heads = graph.importBuffer("Heads", state->Heads.Buffer);
+		const RenderGraphResource inclusive = graph.importBuffer("Inclusive", state->Inclusive.Buffer);
+		const RenderGraphResource exclusive = graph.importBuffer("Exclusive", state->Exclusive.Buffer);
+		const RenderGraphResource segmented = graph.importBuffer("Segmented", state->Segmented.Buffer);
+		const RenderGraphResource sum = graph.importBuffer("Sum", state->Sum.Buffer);
+		bool recorded = false;
+		graph.addPass("Scan primitives", [state, &primitives, &recorded, count](VkCommandBuffer cb)
+		{
+			const VkDescriptorBufferInfo lookBack = { state->LookBack.Buffer, 0, VK_WHOLE_SIZE };
+			recorded = primitives.recordReduce(cb, { state->Values.Buffer, 0, VK_WHOLE_SIZE }, { state->Sum.Buffer, 0, VK_WHOLE_SIZE }, count) &&
+				primitives.recordInclusiveScan(cb, { state->Values.Buffer, 0, VK_WHOLE_SIZE }, { state->Inclusive.Buffer, 0, VK_WHOLE_SIZE }, lookBack, count) &&
+				primitives.recordExclusiveScan(cb, { state->Values.Buffer, 0, VK_WHOLE_SIZE }, { state->Exclusive.Buffer, 0, VK_WHOLE_SIZE }, lookBack, count) &&
+				primitives.recordSegmentedScan(cb, { state->Values.Buffer, 0, VK_WHOLE_SIZE }, { state->Heads.Buffer, 0, VK_WHOLE_SIZE },
+					{ state->Segmented.Buffer, 0, VK_WHOLE_SIZE }, lookBack, count);
+		}).read(values, ResourceUsage::ComputeShaderRead).read(heads, ResourceUsage::ComputeShaderRead).write(inclusive, ResourceUsage::ComputeShaderWrite)
+			.write(exclusive, ResourceUsage::ComputeShaderWrite).write(segmented, ResourceUsage::ComputeShaderWrite).write(sum, ResourceUsage::ComputeShaderWrite);
+		graph.markOutput(inclusive, ResourceUsage::HostRead);
+		graph.markOutput(exclusive, ResourceUsage::HostRead);
+		graph.markOutput(segmented, ResourceUsage::HostRead);
+		graph.markOutput(sum, ResourceUsage::HostRead);
+		if (!graph.compile()) { return false; }
+		graph.execute(commandBuffer);
+		return recorded;
+	};
+	workload.Verify = [state, count, value, isHead]()
+	{
+		const uint32_t* inclusive = static_cast<const uint32_t*>(state->Inclusive.Mapped);
+		const uint32_t* exclusive = static_cast<const uint32_t*>(state->Exclusive.Mapped);
+		const uint32_t* segmented = static_cast<const uint32_t*>(state->Segmented.Mapped);
+		uint32_t running = 0;
+		uint32_t segmentRunning = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (exclusive[i] != running) { return false; }
+			running += value(i);
+			if (inclusive[i] != running) { return false; }
+			segmentRunning = (isHead(i) ? 0 : segmentRunning) + value(i);
+			if (segmented[i] != segmentRunning) { return false; }
+		}
+		return *static_cast<const uint32_t*>(state->Sum.Mapped) == running;
+	};
+	return workload;
+}
@@ -0,0 +1,446 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "ObjectCache.hpp"
+#include "GpuBuffer.hpp"
+#include "DescriptorTemplate.hpp"
+#include "ComputePipeline.hpp"
+#include "ComputeBatch.hpp"
+#include "ScanPrimitives.hpp"
+
+// What an element has to satisfy to survive a `StreamCompaction` - `value <op> operand`, or for the bit tests, `value & operand`
+// Note: Must match the PREDICATE_ constants in `stream_compact.comp`
+enum class CompactPredicate : uint32_t
+{
+	Equal,
+	NotEqual,
+	Less,
+	LessEqual,
+	Greater,
+	GreaterEqual,
+	AnyBitsSet, // (value & operand) != 0
+	NoBitsSet,  // (value & operand) == 0
+	Count
+};
+
+// What a compaction writes for each element that passes: the element itself, or its index (to gather anything bigger than a uint by)
+enum class CompactOutput : uint32_t
+{
+	Values,
+	Indices,
+	Count
+};
+
+// Descriptors for `stream_compact.comp`
+struct CompactDescriptors
+{
+	VkDescriptorBufferInfo Values;
+	VkDescriptorBufferInfo Output;
+	VkDescriptorBufferInfo LookBack;
+	VkDescriptorBufferInfo Count;
+	VkDescriptorBufferInfo InputCount;
+};
+template <> struct DescriptorLayout<CompactDescriptors>
+{
+	static constexpr std::array<DescriptorBinding, 5> Bindings = {
+		DESCRIPTOR_BINDING(CompactDescriptors, Values, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(CompactDescriptors, Output, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(CompactDescriptors, LookBack, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(CompactDescriptors, Count, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(CompactDescriptors, InputCount, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) };
+};
+
+// Descriptors for `indirect_args.comp`
+struct IndirectArgsDescriptors
+{
+	VkDescriptorBufferInfo Count;
+	VkDescriptorBufferInfo Arguments;
+};
+template <> struct DescriptorLayout<IndirectArgsDescriptors>
+{
+	static constexpr std::array<DescriptorBinding, 2> Bindings = {
+		DESCRIPTOR_BINDING(IndirectArgsDescriptors, Count, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(IndirectArgsDescriptors, Arguments, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) };
+};
+
+// Class to record GPU stream compaction - filtering an array of 32-bit unsigned integers by a predicate into a dense array of the values
+// (or indices) that pass, in their original order - plus turning the resulting count into the arguments of an indirect dispatch or
+// indexed draw. Together they let a pass whose size depends on an earlier pass's results be recorded up front and sized on the GPU, rather
+// than waiting on a readback of the count (a whole submit-wait-read round trip, and a pipeline bubble either side of it).
+//
+// A compaction is a single pass using decoupled look-back (see `stream_compact.comp`), so it reads its input once & writes only what passes.
+// It can take its element count from a buffer too (`recordCompactIndirect`), so compactions chain: filter, size the next filter's dispatch
+// from the count with `recordDispatchArgs(..., PartitionSize)`, filter again - all without the CPU knowing how many elements there are.
+//
+// CAREFUL: Compactions need a look-back state buffer of at least `getLookBackSize(maxCount)` bytes. We zero it (and the count) with
+// `vkCmdFillBuffer` before each dispatch, so those buffers need `VK_BUFFER_USAGE_TRANSFER_DST_BIT`, and argument buffers need
+// `VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT` as well as storage. As with `ScanPrimitives` there's no barrier after our dispatches: use
+// `recordComputeToComputeBarrier` between a compaction and whatever reads its count (it covers indirect commands too).
+// Note: Every dispatch gets its own descriptor set - call `resetDescriptors` to hand them all back.
+class StreamCompaction
+{
+public:
+
+	// Elements each compaction workgroup handles: 256 invocations of 8 consecutive elements each
+	static constexpr uint32_t WorkgroupSize = 256;
+	static constexpr uint32_t ItemsPerInvocation = 8;
+	static constexpr uint32_t PartitionSize = WorkgroupSize * ItemsPerInvocation;
+
+	// Method to load `stream_compact[_subgroup].spv` & `indirect_args.spv` from `shaderDirectory` and create a pipeline for every predicate
+	// & output, plus a descriptor pool with enough sets for `maxDispatchesPerReset` dispatches. Returns false (having cleaned up after itself)
+	// if anything's missing or fails.
+	bool create(VkDevice logicalDevice, const SubgroupSupport& subgroups, const string& shaderDirectory = "shaders/spv", uint32_t maxDispatchesPerReset = 256,
+		ObjectCache* objectCache = nullptr)
+	{
+		device = logicalDevice;
+		useSubgroups = subgroups.Arithmetic;
+
+		if (!compactTemplate.create(device, objectCache) || !argsTemplate.create(device, objectCache))
+		{
+			destroy();
+			return false;
+		}
+
+		std::vector<uint32_t> code;
+		if (!loadSpirvFile(shaderDirectory + "/stream_compact" + (useSubgroups ? "_subgroup.spv" : ".spv"), code))
+		{
+			destroy();
+			return false;
+		}
+		for (uint32_t predicate = 0; predicate < PredicateCount; ++predicate)
+		{
+			for (uint32_t output = 0; output < OutputCount; ++output)
+			{
+				// Note: Constants are PREDICATE, OUTPUT_INDICES & ITEMS_PER_INVOCATION
+				if (!compactPipelines[predicate][output].create(device, code, compactTemplate.SetLayout, sizeof(CompactPushConstants), { predicate, output, ItemsPerInvocation }, objectCache))
+				{
+					destroy();
+					return false;
+				}
+			}
+		}
+		code.clear();
+		if (!loadSpirvFile(shaderDirectory + "/indirect_args.spv", code) ||
+			!dispatchArgsPipeline.create(device, code, argsTemplate.SetLayout, sizeof(ArgsPushConstants), { 0 }, objectCache) ||
+			!drawArgsPipeline.create(device, code, argsTemplate.SetLayout, sizeof(ArgsPushConstants), { 1 }, objectCache))
+		{
+			destroy();
+			return false;
+		}
+
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		DescriptorSetTemplate<CompactDescriptors>::addPoolSizes(poolSizes, maxDispatchesPerReset);
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.pNext = nullptr;
+		poolCreateInfo.flags = 0;
+		poolCreateInfo.maxSets = maxDispatchesPerReset;
+		poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolCreateInfo.pPoolSizes = poolSizes.data();
+		const VkResult result = VulkanFunctionLoaders::vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &descriptorPool);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create stream compaction descriptor pool. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			descriptorPool = VK_NULL_HANDLE;
+			destroy();
+			return false;
+		}
+
+		LOG_VERBOSE("[OK] Loaded stream compaction ({}) from: {}", useSubgroups ? "subgroup arithmetic" : "shared memory", shaderDirectory);
+		return true;
+	}
+
+	bool usesSubgroups() const { return useSubgroups; }
+
+	// How many bytes of look-back state a compaction of up to `maxCount` elements needs: a partition counter, then a word per partition
+	static VkDeviceSize getLookBackSize(uint32_t maxCount)
+	{
+		return (1 + static_cast<VkDeviceSize>(getPartitionCount(maxCount))) * sizeof(uint32_t);
+	}
+
+	// The most elements one compaction can handle (a workgroup per partition, and there can only be so many workgroups)
+	static constexpr uint32_t getMaxCount() { return MaxWorkgroupCount * PartitionSize; }
+
+	// Method to hand back every descriptor set our dispatches have used since the last reset.
+	// CAREFUL: The GPU must be finished with everything recorded since then!
+	void resetDescriptors()
+	{
+		if (descriptorPool != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkResetDescriptorPool(device, descriptorPool, 0); }
+	}
+
+	// Method to record copying every one of the `count` elements of `values` that passes `predicate` against `operand` (or its index, if
+	// `output` says so) densely into `outputs` in order, and how many did into the uint at the start of `outputCount`. `outputs` needs room
+	// for `count` elements - which is what you get if they all pass. Returns false if `count` is over `getMaxCount` or we've run out of
+	// descriptor sets.
+	// CAREFUL: `outputs` must not overlap `values`.
+	bool recordCompact(VkCommandBuffer commandBuffer, CompactPredicate predicate, uint32_t operand, CompactOutput output, const VkDescriptorBufferInfo& values,
+		const VkDescriptorBufferInfo& outputs, const VkDescriptorBufferInfo& outputCount, const VkDescriptorBufferInfo& lookBack, uint32_t count)
+	{
+		if (!checkCount(count)) { return false; }
+		const ComputePipeline* pipeline = recordSetup(commandBuffer, predicate, output, { values, outputs, lookBack, outputCount, values }, count);
+		if (pipeline == nullptr) { return false; }
+		pipeline->pushConstants(commandBuffer, CompactPushConstants{ count, operand, 0 });
+		if (count > 0) { pipeline->dispatch(commandBuffer, getPartitionCount(count)); }
+		return true;
+	}
+
+	// Method to record a compaction of however many elements the uint at the start of `inputCount` says - e.g., the count from an earlier
+	// compaction - dispatched with the `VkDispatchIndirectCommand` at `dispatchArgsOffset` in `dispatchArgs`, which should come from
+	// `recordDispatchArgs(commandBuffer, inputCount, ..., PartitionSize)`. `maxCount` is what our buffers are sized for: we never look at
+	// more elements than that, whatever `inputCount` says.
+	bool recordCompactIndirect(VkCommandBuffer commandBuffer, CompactPredicate predicate, uint32_t operand, CompactOutput output, const VkDescriptorBufferInfo& values,
+		const VkDescriptorBufferInfo& outputs, const VkDescriptorBufferInfo& outputCount, const VkDescriptorBufferInfo& lookBack, const VkDescriptorBufferInfo& inputCount,
+		VkBuffer dispatchArgs, VkDeviceSize dispatchArgsOffset, uint32_t maxCount)
+	{
+		if (!checkCount(maxCount)) { return false; }
+		const ComputePipeline* pipeline = recordSetup(commandBuffer, predicate, output, { values, outputs, lookBack, outputCount, inputCount }, maxCount);
+		if (pipeline == nullptr) { return false; }
+		pipeline->pushConstants(commandBuffer, CompactPushConstants{ maxCount, operand, 1 });
+		pipeline->dispatchIndirect(commandBuffer, dispatchArgs, dispatchArgsOffset);
+		return true;
+	}
+
+	// Method to record writing a `VkDispatchIndirectCommand` into the start of `arguments` with enough workgroups of `workgroupSize`
+	// invocations (or elements - `PartitionSize` for `recordCompactIndirect`) for the count in `count`. At most 65535 workgroups.
+	bool recordDispatchArgs(VkCommandBuffer commandBuffer, const VkDescriptorBufferInfo& count, const VkDescriptorBufferInfo& arguments, uint32_t workgroupSize)
+	{
+		if (workgroupSize == 0)
+		{
+			LOG_ERROR("[FAIL] Can't size a dispatch for workgroups of 0 invocations.");
+			return false;
+		}
+		return recordArgs(commandBuffer, dispatchArgsPipeline, count, arguments, ArgsPushConstants{ workgroupSize, 0, 0, 0 });
+	}
+
+	// Method to record writing a `VkDrawIndexedIndirectCommand` into the start of `arguments` that draws the count in `count` instances of
+	// the `indexCount` indices from `firstIndex` - so each instance can look up what it's drawing by `gl_InstanceIndex` in a compacted array.
+	bool recordDrawIndexedArgs(VkCommandBuffer commandBuffer, const VkDescriptorBufferInfo& count, const VkDescriptorBufferInfo& arguments, uint32_t indexCount,
+		uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t firstInstance = 0)
+	{
+		return recordArgs(commandBuffer, drawArgsPipeline, count, arguments, ArgsPushConstants{ indexCount, firstIndex, vertexOffset, firstInstance });
+	}
+
+	// CAREFUL: The GPU must be finished with everything we've recorded before we call this!
+	void destroy()
+	{
+		if (descriptorPool != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+			descriptorPool = VK_NULL_HANDLE;
+		}
+		for (auto& pipelines : compactPipelines)
+		{
+			for (ComputePipeline& pipeline : pipelines) { pipeline.destroy(); }
+		}
+		dispatchArgsPipeline.destroy();
+		drawArgsPipeline.destroy();
+		compactTemplate.destroy();
+		argsTemplate.destroy();
+	}
+
+private:
+
+	// Must match the `push_constant` blocks in `stream_compact.comp` & `indirect_args.comp`
+	struct CompactPushConstants { uint32_t Count; uint32_t Operand; uint32_t CountFromBuffer; };
+	struct ArgsPushConstants { uint32_t WorkgroupSizeOrIndexCount; uint32_t FirstIndex; int32_t VertexOffset; uint32_t FirstInstance; };
+
+	// Note: 65535 is the least `maxComputeWorkGroupCount` every device has to support
+	static constexpr uint32_t MaxWorkgroupCount = 65535;
+	static constexpr uint32_t PredicateCount = static_cast<uint32_t>(CompactPredicate::Count);
+	static constexpr uint32_t OutputCount = static_cast<uint32_t>(CompactOutput::Count);
+
+	static uint32_t getPartitionCount(uint32_t count) { return static_cast<uint32_t>((static_cast<uint64_t>(count) + PartitionSize - 1) / PartitionSize); }
+
+	static bool checkCount(uint32_t count)
+	{
+		if (count > getMaxCount())
+		{
+			LOG_ERROR("[FAIL] Can't compact {} elements - the most we can is {}.", count, getMaxCount());
+			return false;
+		}
+		return true;
+	}
+
+	// Method to record everything a compaction does before its dispatch - returning the pipeline to dispatch, or nullptr if we couldn't
+	// get a descriptor set
+	const ComputePipeline* recordSetup(VkCommandBuffer commandBuffer, CompactPredicate predicate, CompactOutput output, const CompactDescriptors& descriptors, uint32_t maxCount)
+	{
+		const VkDescriptorSet set = allocateSet(compactTemplate.SetLayout);
+		if (set == VK_NULL_HANDLE) { return nullptr; }
+		compactTemplate.update(set, descriptors);
+
+		// Zero the look-back state, and the count (which no workgroup writes if there's nothing to compact)
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.pNext = nullptr;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+			&memoryBarrier, 0, nullptr, 0, nullptr);
+
+		VulkanFunctionLoaders::vkCmdFillBuffer(commandBuffer, descriptors.LookBack.buffer, descriptors.LookBack.offset, getLookBackSize(maxCount), 0);
+		VulkanFunctionLoaders::vkCmdFillBuffer(commandBuffer, descriptors.Count.buffer, descriptors.Count.offset, sizeof(uint32_t), 0);
+
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		const ComputePipeline& pipeline = compactPipelines[static_cast<uint32_t>(predicate)][static_cast<uint32_t>(output)];
+		pipeline.bind(commandBuffer, set);
+		return &pipeline;
+	}
+
+	bool recordArgs(VkCommandBuffer commandBuffer, const ComputePipeline& pipeline, const VkDescriptorBufferInfo& count, const VkDescriptorBufferInfo& arguments,
+		const ArgsPushConstants& pushConstants)
+	{
+		const VkDescriptorSet set = allocateSet(argsTemplate.SetLayout);
+		if (set == VK_NULL_HANDLE) { return false; }
+		argsTemplate.update(set, { count, arguments });
+		pipeline.bind(commandBuffer, set);
+		pipeline.pushConstants(commandBuffer, pushConstants);
+		pipeline.dispatch(commandBuffer, 1);
+		return true;
+	}
+
+	VkDescriptorSet allocateSet(VkDescriptorSetLayout setLayout)
+	{
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.descriptorPool = descriptorPool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &setLayout;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		const VkResult result = VulkanFunctionLoaders::vkAllocateDescriptorSets(device, &allocateInfo, &set);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not allocate a descriptor set for a stream compaction - call `resetDescriptors` more often? VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return VK_NULL_HANDLE;
+		}
+		return set;
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	bool useSubgroups = false;
+	DescriptorSetTemplate<CompactDescriptors> compactTemplate;
+	DescriptorSetTemplate<IndirectArgsDescriptors> argsTemplate;
+	ComputePipeline compactPipelines[PredicateCount][OutputCount];
+	ComputePipeline dispatchArgsPipeline;
+	ComputePipeline drawArgsPipeline;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+};
+
+// A self-checking workload for `StreamCompaction` that never reads a count back until it's all done: it keeps the `count` pseudo-random
+// values of 0-255 under 128 (about half, so most partitions have a ragged mix), then - sized from that count on the GPU - the indices
+// within those of the odd ones, then writes dispatch & indexed draw arguments for however many that leaves. Every output, count &
+// argument is checked against the same filters on the CPU.
+inline BatchWorkload makeStreamCompactionWorkload(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, StreamCompaction& compaction, uint32_t count)
+{
+	struct CompactionState
+	{
+		VkDevice Device = VK_NULL_HANDLE;
+		GpuBuffer Values;
+		GpuBuffer Filtered;
+		GpuBuffer OddIndices;
+		GpuBuffer Counts;    // The first compaction's count, then the second's
+		GpuBuffer Arguments; // The second compaction's VkDispatchIndirectCommand, then a VkDispatchIndirectCommand & VkDrawIndexedIndirectCommand from its count
+		GpuBuffer LookBack;
+		~CompactionState() { Values.destroy(Device); Filtered.destroy(Device); OddIndices.destroy(Device); Counts.destroy(Device); Arguments.destroy(Device); LookBack.destroy(Device); }
+	};
+	auto state = std::make_shared<CompactionState>();
+	state->Device = device;
+
+	// Note: Every count & block of arguments gets its own 256-byte slot, as that's the most `minStorageBufferOffsetAlignment` can be
+	constexpr VkDeviceSize ArgumentSlot = 256;
+	constexpr uint32_t DispatchWorkgroupSize = 64;
+	constexpr uint32_t MeshIndexCount = 36;
+	auto value = [](uint32_t i) { return (i * 2654435761u) >> 24; };
+
+	BatchWorkload workload;
+	workload.Name = string("stream-compaction-") + (compaction.usesSubgroups() ? "subgroup" : "shared");
+	workload.Record = [state, memoryProperties, &compaction, count, value](VkCommandBuffer commandBuffer)
+	{
+		const VkDeviceSize arraySize = static_cast<VkDeviceSize>(count) * sizeof(uint32_t);
+		if (state->Values.Buffer == VK_NULL_HANDLE)
+		{
+			const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			const VkBufferUsageFlags clearable = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			if (!state->Values.create(state->Device, memoryProperties, arraySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->Filtered.create(state->Device, memoryProperties, arraySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->OddIndices.create(state->Device, memoryProperties, arraySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->Counts.create(state->Device, memoryProperties, 2 * ArgumentSlot, clearable, hostVisible, true) ||
+				!state->Arguments.create(state->Device, memoryProperties, 3 * ArgumentSlot, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, hostVisible, true) ||
+				!state->LookBack.create(state->Device, memoryProperties, StreamCompaction::getLookBackSize(count), clearable, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+			{
+				return false;
+			}
+			for (uint32_t i = 0; i < count; ++i) { static_cast<uint32_t*>(state->Values.Mapped)[i] = value(i); }
+		}
+
+		RenderGraph graph;
+		const RenderGraphResource values = graph.importBuffer("Values", state->Values.Buffer);
+		const RenderGraphResource filtered = graph.importBuffer("Filtered", state->Filtered.Buffer);
+		const RenderGraphResource oddIndices = graph.importBuffer("Odd indices", state->OddIndices.Buffer);
+		const RenderGraphResource counts = graph.importBuffer("Counts", state->Counts.Buffer);
+		const RenderGraphResource arguments = graph.importBuffer("Arguments", state->Arguments.Buffer);
+		bool recorded = false;
+		graph.addPass("Stream compaction", [state, &compaction, &recorded, count](VkCommandBuffer cb)
+		{
+			const VkDescriptorBufferInfo lookBack = { state->LookBack.Buffer, 0, VK_WHOLE_SIZE };
+			const VkDescriptorBufferInfo filteredCount = { state->Counts.Buffer, 0, sizeof(uint32_t) };
+			const VkDescriptorBufferInfo oddCount = { state->Counts.Buffer, ArgumentSlot, sizeof(uint32_t) };
+			recorded = compaction.recordCompact(cb, CompactPredicate::Less, 128, CompactOutput::Values, { state->Values.Buffer, 0, VK_WHOLE_SIZE },
+				{ state->Filtered.Buffer, 0, VK_WHOLE_SIZE }, filteredCount, lookBack, count);
+			recordComputeToComputeBarrier(cb);
+			recorded = recorded && compaction.recordDispatchArgs(cb, filteredCount, { state->Arguments.Buffer, 0, ArgumentSlot }, StreamCompaction::PartitionSize);
+			recordComputeToComputeBarrier(cb);
+			recorded = recorded && compaction.recordCompactIndirect(cb, CompactPredicate::AnyBitsSet, 1, CompactOutput::Indices, { state->Filtered.Buffer, 0, VK_WHOLE_SIZE },
+				{ state->OddIndices.Buffer, 0, VK_WHOLE_SIZE }, oddCount, lookBack, filteredCount, state->Arguments.Buffer, 0, count);
+			recordComputeToComputeBarrier(cb);
+			recorded = recorded && compaction.recordDispatchArgs(cb, oddCount, { state->Arguments.Buffer, ArgumentSlot, ArgumentSlot }, DispatchWorkgroupSize) &&
+				compaction.recordDrawIndexedArgs(cb, oddCount, { state->Arguments.Buffer, 2 * ArgumentSlot, ArgumentSlot }, MeshIndexCount, 6, -3, 1);
+		}).read(values, ResourceUsage::ComputeShaderRead).write(filtered, ResourceUsage::ComputeShaderWrite).write(oddIndices, ResourceUsage::ComputeShaderWrite)
+			.write(counts, ResourceUsage::ComputeShaderWrite).write(arguments, ResourceUsage::ComputeShaderWrite);
+		graph.markOutput(filtered, ResourceUsage::HostRead);
+		graph.markOutput(oddIndices, ResourceUsage::HostRead);
+		graph.markOutput(counts, ResourceUsage::HostRead);
+		graph.markOutput(arguments, ResourceUsage::HostRead);
+		if (!graph.compile()) { return false; }
+		graph.execute(commandBuffer);
+		return recorded;
+	};
+	workload.Verify = [state, count, value]()
+	{
+		const uint32_t* filtered = static_cast<const uint32_t*>(state->Filtered.Mapped);
+		const uint32_t* oddIndices = static_cast<const uint32_t*>(state->OddIndices.Mapped);
+		const uint8_t* counts = static_cast<const uint8_t*>(state->Counts.Mapped);
+		const uint8_t* arguments = static_cast<const uint8_t*>(state->Arguments.Mapped);
+
+		uint32_t filteredCount = 0;
+		uint32_t oddCount = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (value(i) >= 128) { continue; }
+			if (filtered[filteredCount] != value(i)) { return false; }
+			if ((value(i) & 1) != 0 && oddIndices[oddCount++] != filteredCount) { return false; }
+			++filteredCount;
+		}
+		if (*reinterpret_cast<const uint32_t*>(counts) != filteredCount || *reinterpret_cast<const uint32_t*>(counts + ArgumentSlot) != oddCount) { return false; }
+
+		VkDispatchIndirectCommand dispatch;
+		std::memcpy(&dispatch, arguments + ArgumentSlot, sizeof(dispatch));
+		VkDrawIndexedIndirectCommand draw;
+		std::memcpy(&draw, arguments + 2 * ArgumentSlot, sizeof(draw));
+		return dispatch.x == (oddCount + DispatchWorkgroupSize - 1) / DispatchWorkgroupSize && dispatch.y == 1 && dispatch.z == 1 &&
+			draw.indexCount == MeshIndexCount && draw.instanceCount == oddCount && draw.firstIndex == 6 && draw.vertexOffset == -3 && draw.firstInstance == 1;
+	};
+	return workload;
+}
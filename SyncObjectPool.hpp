@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "TraceRecorder.hpp"
+
+// What a `SyncObjectPool` has made and handed out
+struct SyncPoolStats
+{
+	uint32_t Live = 0;         // Objects that exist right now (in use, or waiting in a free list)
+	uint32_t InUse = 0;        // Objects acquired and not yet released
+	uint64_t Created = 0;      // Objects ever created - once a pool has warmed up this should stop going up
+	uint64_t Acquired = 0;
+	uint64_t ResetCalls = 0;   // Driver calls made to reset released objects (fences get reset many at a time)
+};
+
+// How a `SyncObjectPool` makes, resets & destroys each kind of object
+struct FencePoolTraits
+{
+	using Handle = VkFence;
+	static constexpr const char* Name = "fence";
+	static VkResult createObject(VkDevice device, VkFence& fence)
+	{
+		VkFenceCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		createInfo.pNext = nullptr;
+		createInfo.flags = 0;
+		return VulkanFunctionLoaders::vkCreateFence(device, &createInfo, nullptr, &fence);
+	}
+	static void destroyObject(VkDevice device, VkFence fence) { VulkanFunctionLoaders::vkDestroyFence(device, fence, nullptr); }
+
+	// Note: `vkResetFences` takes any number of fences, so a whole batch costs one call. Returns how many calls it took.
+	static uint32_t resetObjects(VkDevice device, const VkFence* fences, uint32_t count)
+	{
+		VulkanFunctionLoaders::vkResetFences(device, count, fences);
+		return 1;
+	}
+};
+
+// Note: A binary semaphore un-signals itself when a wait on it completes, so there's nothing to reset
+struct SemaphorePoolTraits
+{
+	using Handle = VkSemaphore;
+	static constexpr const char* Name = "semaphore";
+	static VkResult createObject(VkDevice device, VkSemaphore& semaphore)
+	{
+		VkSemaphoreCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		createInfo.pNext = nullptr;
+		createInfo.flags = 0;
+		return VulkanFunctionLoaders::vkCreateSemaphore(device, &createInfo, nullptr, &semaphore);
+	}
+	static void destroyObject(VkDevice device, VkSemaphore semaphore) { VulkanFunctionLoaders::vkDestroySemaphore(device, semaphore, nullptr); }
+	static uint32_t resetObjects(VkDevice, const VkSemaphore*, uint32_t) { return 0; }
+};
+
+// Note: There's no batched `vkResetEvents`, so events get reset one call each - but still all at once, off the acquire path
+struct EventPoolTraits
+{
+	using Handle = VkEvent;
+	static constexpr const char* Name = "event";
+	static VkResult createObject(VkDevice device, VkEvent& event)
+	{
+		VkEventCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO;
+		createInfo.pNext = nullptr;
+		createInfo.flags = 0;
+		return VulkanFunctionLoaders::vkCreateEvent(device, &createInfo, nullptr, &event);
+	}
+	static void destroyObject(VkDevice device, VkEvent event) { VulkanFunctionLoaders::vkDestroyEvent(device, event, nullptr); }
+	static uint32_t resetObjects(VkDevice device, const VkEvent* events, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; ++i) { VulkanFunctionLoaders::vkResetEvent(device, events[i]); }
+		return count;
+	}
+};
+
+// Class to recycle fences, binary semaphores or events rather than creating & destroying them every frame.
+//
+// `acquire` hands out an unsignalled object and `release` takes it back once the GPU is done with it. Released objects wait in a list
+// until there are enough of them to reset as a batch (one `vkResetFences` for the lot, in the case of fences), and then go back on the
+// free list. Note: That means each thread may have up to a batch's worth of objects more than it strictly needs - a one-off cost, as
+// once the pool has warmed up it stops creating anything.
+// Each thread keeps its own released & free lists, so a thread that acquires & releases its own objects (the usual case: a submit
+// thread with its per-frame fences) never takes a lock. Only when a thread's free list runs dry does it take a batch from the shared
+// list, and when it gets too long it hands half back.
+// CAREFUL: Only release an object once nothing will touch it again: a fence once it has signalled (and been waited on) or was never
+// submitted; a semaphore once the submission that WAITS on it has finished (or it was never signalled - releasing a semaphore that's
+// been signalled but not waited on leaves it signalled for the next user); an event once the GPU is done setting & waiting on it.
+template <typename Traits>
+class SyncObjectPool
+{
+public:
+	using Handle = typename Traits::Handle;
+
+	bool create(VkDevice logicalDevice, uint32_t initialCount = 0)
+	{
+		device = logicalDevice;
+		poolId = nextPoolId().fetch_add(1, std::memory_order_relaxed);
+		{
+			std::lock_guard<std::mutex> registryLock(livePoolsMutex());
+			livePools()[poolId] = this;
+		}
+		for (uint32_t i = 0; i < initialCount; ++i)
+		{
+			Handle object = VK_NULL_HANDLE;
+			if (!createObject(object)) { return false; }
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			sharedFree.push_back(object);
+		}
+		return true;
+	}
+
+	// Method to get an unsignalled object. Returns `VK_NULL_HANDLE` only if we had to create one and couldn't.
+	Handle acquire()
+	{
+		LocalLists& local = getLocalLists();
+		if (local.Free.empty())
+		{
+			// Take a batch from the shared list so the next few acquires on this thread are lock-free too
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			const size_t take = std::min<size_t>(sharedFree.size(), TransferBatchSize);
+			local.Free.insert(local.Free.end(), sharedFree.end() - take, sharedFree.end());
+			sharedFree.resize(sharedFree.size() - take);
+		}
+
+		Handle object = VK_NULL_HANDLE;
+		if (!local.Free.empty())
+		{
+			object = local.Free.back();
+			local.Free.pop_back();
+		}
+		else if (!createObject(object)) { return VK_NULL_HANDLE; }
+		acquiredCount.fetch_add(1, std::memory_order_relaxed);
+		inUseCount.fetch_add(1, std::memory_order_relaxed);
+		return object;
+	}
+
+	// Method to hand an object back (see the CAREFUL above for when that's allowed)
+	void release(Handle object)
+	{
+		if (object == VK_NULL_HANDLE) { return; }
+		inUseCount.fetch_sub(1, std::memory_order_relaxed);
+		LocalLists& local = getLocalLists();
+		local.Released.push_back(object);
+		if (local.Released.size() >= ResetBatchSize) { resetReleased(local); }
+		if (local.Free.size() > MaxLocalFree)
+		{
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			const size_t give = local.Free.size() / 2;
+			sharedFree.insert(sharedFree.end(), local.Free.end() - give, local.Free.end());
+			local.Free.resize(local.Free.size() - give);
+		}
+	}
+
+	// Method to reset everything the calling thread has released and give all its free objects back to the shared list - e.g., before a
+	// worker thread goes away, or stops using this pool for a while
+	void trimThreadCache()
+	{
+		LocalLists& local = getLocalLists();
+		resetReleased(local);
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		sharedFree.insert(sharedFree.end(), local.Free.begin(), local.Free.end());
+		local.Free.clear();
+	}
+
+	SyncPoolStats getStats() const
+	{
+		SyncPoolStats stats;
+		stats.Live = liveCount.load(std::memory_order_relaxed);
+		stats.InUse = inUseCount.load(std::memory_order_relaxed);
+		stats.Created = createdCount.load(std::memory_order_relaxed);
+		stats.Acquired = acquiredCount.load(std::memory_order_relaxed);
+		stats.ResetCalls = resetCallCount.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	// Method to add our live & in-use counts to the trace (if we're tracing), as counters named `liveName` & `inUseName`
+	// CAREFUL: The names must stay alive until the trace is exported - string literals are ideal.
+	void recordTraceCounters(const char* liveName, const char* inUseName) const
+	{
+		if (!TraceRecorder::isEnabled()) { return; }
+		const uint64_t now = TraceRecorder::nowNanoseconds();
+		TraceRecorder::recordCounter(liveName, now, liveCount.load(std::memory_order_relaxed));
+		TraceRecorder::recordCounter(inUseName, now, inUseCount.load(std::memory_order_relaxed));
+	}
+
+	// Method to destroy every object the pool has made.
+	// CAREFUL: Nothing on the GPU may still be using any of them, and no other thread may be using the pool.
+	void destroy()
+	{
+		const uint32_t inUse = inUseCount.load(std::memory_order_relaxed);
+		if (inUse > 0) { LOG_WARNING("[WARNING] {} pool destroyed with {} object(s) still in use.", Traits::Name, inUse); }
+
+		// Once we're off the list no thread can hand its cached objects back to us
+		{
+			std::lock_guard<std::mutex> registryLock(livePoolsMutex());
+			livePools().erase(poolId);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			for (Handle object : allObjects) { Traits::destroyObject(device, object); }
+			allObjects.clear();
+			sharedFree.clear();
+			liveCount.store(0, std::memory_order_relaxed);
+			inUseCount.store(0, std::memory_order_relaxed);
+		}
+
+		// Other threads' lists still name our (now destroyed) objects - but they're keyed by our id, which no pool will use again
+		// Note: Only look for the lists this thread already has - claiming a set could hand another pool's lists back to it
+		if (LocalLists* local = findLocalLists())
+		{
+			local->Free.clear();
+			local->Released.clear();
+			local->PoolId = 0;
+		}
+	}
+
+private:
+	static constexpr size_t ResetBatchSize = 16;    // Released objects a thread collects before resetting them in one go
+	static constexpr size_t TransferBatchSize = 16; // Free objects a thread takes from the shared list at once
+	static constexpr size_t MaxLocalFree = 64;      // Free objects a thread keeps before handing half back
+
+	struct LocalLists
+	{
+		uint64_t PoolId = 0;
+		std::vector<Handle> Free;
+		std::vector<Handle> Released;
+	};
+
+	// Every pool of one kind gets a different id, so a thread's lists can tell which pool they belong to
+	static std::atomic<uint64_t>& nextPoolId() { static std::atomic<uint64_t> id{ 1 }; return id; }
+
+	// Every pool of one kind that's been created and not yet destroyed, by id - so a thread that has to drop its lists for one of them
+	// can find it to hand them back
+	// Note: Lock this before any pool's `sharedMutex`, never after
+	static std::mutex& livePoolsMutex() { static std::mutex mutex; return mutex; }
+	static std::unordered_map<uint64_t, SyncObjectPool*>& livePools() { static std::unordered_map<uint64_t, SyncObjectPool*> pools; return pools; }
+
+	// The lists each thread keeps for a few pools of each kind at once - which covers how they're used (one or two pools per kind)
+	struct ThreadLists
+	{
+		std::array<LocalLists, 4> Lists;
+		uint32_t NextToReplace = 0;
+	};
+	static ThreadLists& getThreadLists() { static thread_local ThreadLists threadLists; return threadLists; }
+
+	// Method to find the calling thread's lists for this pool, without claiming any. Returns nullptr if the thread doesn't have any.
+	LocalLists* findLocalLists()
+	{
+		for (LocalLists& lists : getThreadLists().Lists)
+		{
+			if (lists.PoolId == poolId) { return &lists; }
+		}
+		return nullptr;
+	}
+
+	// Method to get the calling thread's lists for this pool. If the thread doesn't have any yet and is already juggling lists for as
+	// many pools as it keeps, the least recently claimed set gets handed back to its pool (if that pool's still around, see `takeBack`)
+	// and re-used.
+	// Note: Can take `livePoolsMutex` (to hand a set back), so mustn't be called with any pool's `sharedMutex` held
+	LocalLists& getLocalLists()
+	{
+		if (LocalLists* lists = findLocalLists()) { return *lists; }
+
+		ThreadLists& threadLists = getThreadLists();
+		LocalLists& claimed = threadLists.Lists[threadLists.NextToReplace];
+		threadLists.NextToReplace = (threadLists.NextToReplace + 1) % static_cast<uint32_t>(threadLists.Lists.size());
+		if (claimed.PoolId != 0 && (!claimed.Free.empty() || !claimed.Released.empty()))
+		{
+			// If the pool has been destroyed its objects went with it, so there's nothing to give back
+			std::lock_guard<std::mutex> registryLock(livePoolsMutex());
+			const auto owner = livePools().find(claimed.PoolId);
+			if (owner != livePools().end()) { owner->second->takeBack(claimed); }
+		}
+		claimed.PoolId = poolId;
+		claimed.Free.clear();
+		claimed.Released.clear();
+		return claimed;
+	}
+
+	// Method to take back a list set another thread is giving up - the released objects get reset (as usual) & everything goes on our
+	// shared list
+	// Note: Called with `livePoolsMutex` held, which is what stops us being destroyed meanwhile
+	void takeBack(LocalLists& lists)
+	{
+		resetReleased(lists);
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		sharedFree.insert(sharedFree.end(), lists.Free.begin(), lists.Free.end());
+		lists.Free.clear();
+	}
+
+	void resetReleased(LocalLists& local)
+	{
+		if (local.Released.empty()) { return; }
+		const uint32_t calls = Traits::resetObjects(device, local.Released.data(), static_cast<uint32_t>(local.Released.size()));
+		resetCallCount.fetch_add(calls, std::memory_order_relaxed);
+		local.Free.insert(local.Free.end(), local.Released.begin(), local.Released.end());
+		local.Released.clear();
+	}
+
+	// Note: Takes the shared lock (to remember the object), so mustn't be called with it held
+	bool createObject(Handle& object)
+	{
+		const VkResult result = Traits::createObject(device, object);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create pooled {}. VkResult is: {}", Traits::Name, VulkanHelpers::getFriendlyResultString(result));
+			object = VK_NULL_HANDLE;
+			return false;
+		}
+		createdCount.fetch_add(1, std::memory_order_relaxed);
+		liveCount.fetch_add(1, std::memory_order_relaxed);
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		allObjects.push_back(object);
+		return true;
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	uint64_t poolId = 0;
+	std::mutex sharedMutex;
+	std::vector<Handle> sharedFree;
+	std::vector<Handle> allObjects; // Everything we've made, so `destroy` can find objects sitting in other threads' lists
+
+	std::atomic<uint32_t> liveCount{ 0 };
+	std::atomic<uint32_t> inUseCount{ 0 };
+	std::atomic<uint64_t> createdCount{ 0 };
+	std::atomic<uint64_t> acquiredCount{ 0 };
+	std::atomic<uint64_t> resetCallCount{ 0 };
+};
+
+using FencePool = SyncObjectPool<FencePoolTraits>;
+using SemaphorePool = SyncObjectPool<SemaphorePoolTraits>;
+using EventPool = SyncObjectPool<EventPoolTraits>;
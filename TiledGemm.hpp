@@ -0,0 +1,496 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "ObjectCache.hpp"
+#include "GpuBuffer.hpp"
+#include "ComputePipeline.hpp"
+#include "ComputeKernels.hpp"
+#include "ComputeBatch.hpp"
+#include "TraceRecorder.hpp"
+
+// Where we keep tuned GEMM tile shapes between runs, unless told otherwise (see `GemmTuningCache`)
+const char* const DefaultGemmTuningCachePath = "gemm_tuning_cache.txt";
+
+// How a tiled GEMM splits up the work - these become `gemm_tiled.comp`'s specialization constants. Each workgroup computes a `TileM` x
+// `TileN` tile of C, stepping through K `TileK` at a time, and each of its invocations computes a `ThreadM` x `ThreadN` block of that tile.
+struct GemmTileConfig
+{
+	uint32_t TileM   = 32;
+	uint32_t TileN   = 32;
+	uint32_t TileK   = 16;
+	uint32_t ThreadM = 4;
+	uint32_t ThreadN = 4;
+
+	uint32_t getWorkgroupSizeX() const { return TileN / ThreadN; }
+	uint32_t getWorkgroupSizeY() const { return TileM / ThreadM; }
+
+	// Shared memory for one A tile & one B tile (always float, whatever the precision of the matrices)
+	uint32_t getSharedMemorySize() const { return (TileM * TileK + TileK * TileN) * static_cast<uint32_t>(sizeof(float)); }
+
+	// Method to check whether a workgroup of this shape can run on a device with the given limits
+	bool fits(const VkPhysicalDeviceLimits& limits) const
+	{
+		if (ThreadM == 0 || ThreadN == 0 || TileK == 0 || TileM % ThreadM != 0 || TileN % ThreadN != 0) { return false; }
+		return getWorkgroupSizeX() <= limits.maxComputeWorkGroupSize[0] && getWorkgroupSizeY() <= limits.maxComputeWorkGroupSize[1] &&
+			getWorkgroupSizeX() * getWorkgroupSizeY() <= limits.maxComputeWorkGroupInvocations && getSharedMemorySize() <= limits.maxComputeSharedMemorySize;
+	}
+
+	bool operator==(const GemmTileConfig& other) const
+	{
+		return TileM == other.TileM && TileN == other.TileN && TileK == other.TileK && ThreadM == other.ThreadM && ThreadN == other.ThreadN;
+	}
+};
+
+// Method to list the tile shapes worth trying on a device: square tiles of 16 to 128, each invocation computing a 1x1 to 8x8 block, with
+// workgroups of 64 to 256 invocations (smaller ones leave too few invocations to hide memory latency; bigger ones rarely help) - minus
+// any that don't fit the device's `maxComputeWorkGroupSize`, `maxComputeWorkGroupInvocations` or `maxComputeSharedMemorySize`.
+// Note: The default `GemmTileConfig` (64 invocations, 4 KiB of shared memory) fits within the minimums every device must support, so
+// this never comes back empty.
+inline std::vector<GemmTileConfig> getGemmTileCandidates(const VkPhysicalDeviceLimits& limits)
+{
+	std::vector<GemmTileConfig> candidates;
+	for (uint32_t tile : { 16u, 32u, 64u, 128u })
+	{
+		for (uint32_t thread : { 1u, 2u, 4u, 8u })
+		{
+			const uint32_t invocations = (tile / thread) * (tile / thread);
+			if (thread > tile || invocations < 64 || invocations > 256) { continue; }
+			for (uint32_t tileK : { 8u, 16u, 32u })
+			{
+				const GemmTileConfig config = { tile, tile, tileK, thread, thread };
+				if (config.fits(limits)) { candidates.push_back(config); }
+			}
+		}
+	}
+	return candidates;
+}
+
+// Class to remember the fastest `GemmTileConfig` for each device and precision, so we only have to tune once. Entries are keyed by
+// vendor, device AND driver version - a new driver can easily change which shape wins. The file is plain text, one entry per line:
+//     <vendorID> <deviceID> <driverVersion> <precision> <TileM> <TileN> <TileK> <ThreadM> <ThreadN>
+class GemmTuningCache
+{
+public:
+
+	// Method to read the cache from `path`. A missing file just means we've not tuned anything yet - so that isn't a failure, but a
+	// malformed one is (and we keep nothing from it).
+	bool load(const string& path)
+	{
+		entries.clear();
+		std::ifstream file(path);
+		if (!file) { return true; }
+
+		Entry entry;
+		while (file >> entry.VendorId >> entry.DeviceId >> entry.DriverVersion >> entry.Precision >> entry.Config.TileM >> entry.Config.TileN
+			>> entry.Config.TileK >> entry.Config.ThreadM >> entry.Config.ThreadN)
+		{
+			entries.push_back(entry);
+		}
+		if (!file.eof())
+		{
+			LOG_WARNING("[WARNING] GEMM tuning cache {} is malformed - ignoring it.", path);
+			entries.clear();
+			return false;
+		}
+		return true;
+	}
+
+	// Method to write the cache out to `path`. Returns false if we couldn't.
+	bool save(const string& path) const
+	{
+		std::ofstream file(path, std::ios::trunc);
+		for (auto& entry : entries)
+		{
+			file << entry.VendorId << ' ' << entry.DeviceId << ' ' << entry.DriverVersion << ' ' << entry.Precision << ' ' << entry.Config.TileM << ' '
+				<< entry.Config.TileN << ' ' << entry.Config.TileK << ' ' << entry.Config.ThreadM << ' ' << entry.Config.ThreadN << '\n';
+		}
+		if (!file)
+		{
+			LOG_WARNING("[WARNING] Could not write GEMM tuning cache: {}", path);
+			return false;
+		}
+		return true;
+	}
+
+	// Method to look up the tuned config for a device & precision. Returns false if we don't have one - or if the one we have no longer
+	// fits the device's limits (which would mean the cache is stale or has been edited).
+	bool find(const VkPhysicalDeviceProperties& properties, ComputePrecision precision, GemmTileConfig& config) const
+	{
+		for (auto& entry : entries)
+		{
+			if (entry.matches(properties, precision))
+			{
+				if (!entry.Config.fits(properties.limits)) { return false; }
+				config = entry.Config;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void store(const VkPhysicalDeviceProperties& properties, ComputePrecision precision, const GemmTileConfig& config)
+	{
+		for (auto& entry : entries)
+		{
+			if (entry.matches(properties, precision))
+			{
+				entry.Config = config;
+				return;
+			}
+		}
+		entries.push_back({ properties.vendorID, properties.deviceID, properties.driverVersion, getComputePrecisionName(precision), config });
+	}
+
+private:
+	struct Entry
+	{
+		uint32_t VendorId = 0;
+		uint32_t DeviceId = 0;
+		uint32_t DriverVersion = 0;
+		string Precision;
+		GemmTileConfig Config;
+
+		bool matches(const VkPhysicalDeviceProperties& properties, ComputePrecision precision) const
+		{
+			return VendorId == properties.vendorID && DeviceId == properties.deviceID && DriverVersion == properties.driverVersion && Precision == getComputePrecisionName(precision);
+		}
+	};
+	std::vector<Entry> entries;
+};
+
+// Class to record a shared-memory tiled matrix multiply with a given tile shape - see `gemm_tiled.comp` for how it works, and
+// `getTunedGemmTiles` for how to pick the shape. It reads & writes matrices of one `ComputePrecision` (fp32, or fp16 storage) and
+// always accumulates in float, just like `ComputeKernelLibrary::recordGemm` - so the two are interchangeable, and this one is faster
+// on anything bigger than a toy.
+// Note: Like `ComputeKernelLibrary`, every dispatch gets its own descriptor set - call `resetDescriptors` to hand them all back.
+class TiledGemm
+{
+public:
+
+	// Method to load `gemm_tiled_<fp32|fp16>.spv` from `shaderDirectory` and build its pipeline with the given tile shape. Returns false
+	// (having cleaned up after itself) if the shape doesn't suit the shader, or anything's missing or fails.
+	bool create(VkDevice logicalDevice, ComputePrecision gemmPrecision, const GemmTileConfig& tileConfig, const string& shaderDirectory = "shaders/spv",
+		uint32_t maxDispatchesPerReset = 256, ObjectCache* objectCache = nullptr)
+	{
+		device = logicalDevice;
+		precision = gemmPrecision;
+		config = tileConfig;
+
+		if (config.ThreadM == 0 || config.ThreadN == 0 || config.TileK == 0 || config.TileM % config.ThreadM != 0 || config.TileN % config.ThreadN != 0)
+		{
+			LOG_ERROR("[FAIL] GEMM tiles of {}x{} can't be split into {}x{} blocks per invocation.", config.TileM, config.TileN, config.ThreadM, config.ThreadN);
+			return false;
+		}
+
+		// Note: Constants 5 & 6 are the workgroup size (`local_size_x_id` / `local_size_y_id`), which has to agree with the tile shape
+		const string shaderPath = shaderDirectory + (precision == ComputePrecision::Fp32 ? "/gemm_tiled_fp32.spv" : "/gemm_tiled_fp16.spv");
+		if (!setTemplate.create(device, objectCache) ||
+			!pipeline.createFromFile(device, shaderPath, setTemplate.SetLayout, sizeof(PushConstants),
+				{ config.TileM, config.TileN, config.TileK, config.ThreadM, config.ThreadN, config.getWorkgroupSizeX(), config.getWorkgroupSizeY() }, objectCache))
+		{
+			destroy();
+			return false;
+		}
+
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		DescriptorSetTemplate<GemmDescriptors>::addPoolSizes(poolSizes, maxDispatchesPerReset);
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.pNext = nullptr;
+		poolCreateInfo.flags = 0;
+		poolCreateInfo.maxSets = maxDispatchesPerReset;
+		poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolCreateInfo.pPoolSizes = poolSizes.data();
+		const VkResult result = VulkanFunctionLoaders::vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &descriptorPool);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create tiled GEMM descriptor pool. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			descriptorPool = VK_NULL_HANDLE;
+			destroy();
+			return false;
+		}
+		return true;
+	}
+
+	const GemmTileConfig& getConfig() const { return config; }
+	ComputePrecision getPrecision() const { return precision; }
+
+	// Method to hand back every descriptor set our dispatches have used since the last reset.
+	// CAREFUL: The GPU must be finished with everything recorded since then!
+	void resetDescriptors()
+	{
+		if (descriptorPool != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkResetDescriptorPool(device, descriptorPool, 0); }
+	}
+
+	// Method to record `c = a * b`, where `a` is `m` x `k`, `b` is `k` x `n` and `c` is `m` x `n` - all row-major & tightly packed.
+	// Returns false if the matrices need more workgroups than every device supports, or we've run out of descriptor sets.
+	bool record(VkCommandBuffer commandBuffer, const VkDescriptorBufferInfo& a, const VkDescriptorBufferInfo& b, const VkDescriptorBufferInfo& c,
+		uint32_t m, uint32_t n, uint32_t k)
+	{
+		const uint32_t groupCountX = (n + config.TileN - 1) / config.TileN;
+		const uint32_t groupCountY = (m + config.TileM - 1) / config.TileM;
+		if (groupCountX > MaxWorkgroupCount || groupCountY > MaxWorkgroupCount)
+		{
+			LOG_ERROR("[FAIL] A {}x{} GEMM needs more than {} workgroups in a dimension.", m, n, MaxWorkgroupCount);
+			return false;
+		}
+
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.descriptorPool = descriptorPool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &setTemplate.SetLayout;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		const VkResult result = VulkanFunctionLoaders::vkAllocateDescriptorSets(device, &allocateInfo, &set);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not allocate a descriptor set for a tiled GEMM - call `resetDescriptors` more often? VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		setTemplate.update(set, { a, b, c });
+
+		pipeline.bind(commandBuffer, set);
+		pipeline.pushConstants(commandBuffer, PushConstants{ m, n, k });
+		pipeline.dispatch(commandBuffer, groupCountX, groupCountY);
+		return true;
+	}
+
+	// CAREFUL: The GPU must be finished with everything we've recorded before we call this!
+	void destroy()
+	{
+		if (descriptorPool != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+			descriptorPool = VK_NULL_HANDLE;
+		}
+		pipeline.destroy();
+		setTemplate.destroy();
+	}
+
+private:
+
+	// Must match the `push_constant` block in `gemm_tiled.comp`
+	struct PushConstants { uint32_t M; uint32_t N; uint32_t K; };
+
+	// Note: 65535 is the least `maxComputeWorkGroupCount` every device has to support
+	static constexpr uint32_t MaxWorkgroupCount = 65535;
+
+	VkDevice device = VK_NULL_HANDLE;
+	ComputePrecision precision = ComputePrecision::Fp32;
+	GemmTileConfig config;
+	DescriptorSetTemplate<GemmDescriptors> setTemplate;
+	ComputePipeline pipeline;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+};
+
+// Method to find the fastest of `getGemmTileCandidates` for this device & precision by timing each one on a `problemSize` cubed GEMM.
+// Every candidate gets a warm-up batch and then `timedBatches` more, each of `gemmsPerBatch` back-to-back GEMMs, and scores its
+// fastest batch - timed from the CPU, as every queue can do that (the submit & wait overhead is the same for every candidate, and
+// `gemmsPerBatch` keeps it small next to the work). Returns false if no candidate could be built & run (e.g., the shaders are missing).
+// Note: This brings up its own batch runner on the given queue, and blocks until it's done - expect it to take a few seconds.
+inline bool tuneGemmTiles(VkDevice device, const VkPhysicalDeviceProperties& properties, const VkPhysicalDeviceMemoryProperties& memoryProperties,
+	uint32_t queueFamilyIndex, VkQueue queue, ComputePrecision precision, GemmTileConfig& bestConfig, const string& shaderDirectory = "shaders/spv",
+	uint32_t problemSize = 512, uint32_t gemmsPerBatch = 4, uint32_t timedBatches = 3)
+{
+	TraceScope tuneZone("Tune GEMM tiles");
+
+	// The matrices are all ones - what's in them doesn't matter for timing, so long as it's not garbage that might be NaNs or denormals
+	const VkDeviceSize matrixSize = static_cast<VkDeviceSize>(problemSize) * problemSize * getComputePrecisionElementSize(precision);
+	const uint32_t onesPattern = precision == ComputePrecision::Fp32 ? 0x3F800000u : 0x3C003C00u; // 1.0f, or a pair of 1.0 halves
+	GpuBuffer a, b, c;
+	ComputeBatchRunner runner;
+	bool ready = a.create(device, memoryProperties, matrixSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) &&
+		b.create(device, memoryProperties, matrixSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) &&
+		c.create(device, memoryProperties, matrixSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) &&
+		runner.create(device, queueFamilyIndex, queue);
+	if (ready)
+	{
+		BatchWorkload fill;
+		fill.Name = "gemm-tuning-fill";
+		fill.Record = [&a, &b, onesPattern](VkCommandBuffer commandBuffer)
+		{
+			VulkanFunctionLoaders::vkCmdFillBuffer(commandBuffer, a.Buffer, 0, VK_WHOLE_SIZE, onesPattern);
+			VulkanFunctionLoaders::vkCmdFillBuffer(commandBuffer, b.Buffer, 0, VK_WHOLE_SIZE, onesPattern);
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.pNext = nullptr;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			return true;
+		};
+		std::vector<BatchWorkload> fillBatch = { fill };
+		ready = runner.run(fillBatch);
+	}
+
+	uint64_t bestNanoseconds = std::numeric_limits<uint64_t>::max();
+	if (ready)
+	{
+		const VkDescriptorBufferInfo aInfo = { a.Buffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo bInfo = { b.Buffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo cInfo = { c.Buffer, 0, VK_WHOLE_SIZE };
+		for (const GemmTileConfig& candidate : getGemmTileCandidates(properties.limits))
+		{
+			TiledGemm gemm;
+			if (!gemm.create(device, precision, candidate, shaderDirectory, gemmsPerBatch)) { continue; }
+
+			BatchWorkload workload;
+			workload.Name = "gemm-tuning";
+			workload.Record = [&gemm, aInfo, bInfo, cInfo, problemSize, gemmsPerBatch](VkCommandBuffer commandBuffer)
+			{
+				gemm.resetDescriptors(); // Safe - the runner waited for the last batch to finish before recording this one
+				for (uint32_t i = 0; i < gemmsPerBatch; ++i)
+				{
+					if (i > 0) { recordComputeToComputeBarrier(commandBuffer); } // Every GEMM writes the same C
+					if (!gemm.record(commandBuffer, aInfo, bInfo, cInfo, problemSize, problemSize, problemSize)) { return false; }
+				}
+				return true;
+			};
+			std::vector<BatchWorkload> batch = { workload };
+
+			uint64_t candidateNanoseconds = std::numeric_limits<uint64_t>::max();
+			bool ran = runner.run(batch); // Warm-up
+			for (uint32_t i = 0; ran && i < timedBatches; ++i)
+			{
+				const uint64_t start = TraceRecorder::nowNanoseconds();
+				ran = runner.run(batch);
+				candidateNanoseconds = std::min(candidateNanoseconds, TraceRecorder::nowNanoseconds() - start);
+			}
+			gemm.destroy();
+			if (!ran) { continue; }
+
+			LOG_VERBOSE("[OK] GEMM tiles {}x{}x{} with {}x{} per invocation: {} GFLOP/s", candidate.TileM, candidate.TileN, candidate.TileK, candidate.ThreadM,
+				candidate.ThreadN, 2.0 * problemSize * problemSize * problemSize * gemmsPerBatch / static_cast<double>(candidateNanoseconds));
+			if (candidateNanoseconds < bestNanoseconds)
+			{
+				bestNanoseconds = candidateNanoseconds;
+				bestConfig = candidate;
+			}
+		}
+	}
+
+	runner.destroy();
+	a.destroy(device);
+	b.destroy(device);
+	c.destroy(device);
+	if (bestNanoseconds == std::numeric_limits<uint64_t>::max())
+	{
+		LOG_WARNING("[WARNING] Could not tune {} GEMM tiles - none of the candidates could be run.", getComputePrecisionName(precision));
+		return false;
+	}
+	LOG_INFO("[OK] Tuned {} GEMM tiles: {}x{}x{} with {}x{} per invocation.", getComputePrecisionName(precision), bestConfig.TileM, bestConfig.TileN, bestConfig.TileK,
+		bestConfig.ThreadM, bestConfig.ThreadN);
+	return true;
+}
+
+// Method to get the tile shape to use for this device & precision: the one in the cache at `cachePath` if there is one, otherwise the
+// winner of `tuneGemmTiles` (which we add to the cache). If tuning fails too, we fall back on the default `GemmTileConfig`.
+inline GemmTileConfig getTunedGemmTiles(const VkPhysicalDeviceProperties& properties, VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties,
+	uint32_t queueFamilyIndex, VkQueue queue, ComputePrecision precision, const string& cachePath = DefaultGemmTuningCachePath, const string& shaderDirectory = "shaders/spv")
+{
+	GemmTuningCache cache;
+	cache.load(cachePath);
+
+	GemmTileConfig config;
+	if (cache.find(properties, precision, config))
+	{
+		LOG_VERBOSE("[OK] Using cached {} GEMM tiles: {}x{}x{} with {}x{} per invocation.", getComputePrecisionName(precision), config.TileM, config.TileN, config.TileK,
+			config.ThreadM, config.ThreadN);
+		return config;
+	}
+	if (tuneGemmTiles(device, properties, memoryProperties, queueFamilyIndex, queue, precision, config, shaderDirectory))
+	{
+		cache.store(properties, precision, config);
+		cache.save(cachePath);
+		return config;
+	}
+	return GemmTileConfig();
+}
+
+// A self-checking workload for `TiledGemm`: multiplies an `m` x `k` matrix by a `k` x `n` one and checks every element of the result.
+// The inputs are small multiples of 1/4, so with modest sizes every product & partial sum is exact in float - and the results are
+// exact in fp16 too - so we can insist on an exact match in any precision. Pick sizes that aren't multiples of the tile shape to check
+// the edges get handled. The GEMM must outlive the batch.
+inline BatchWorkload makeTiledGemmWorkload(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, TiledGemm& gemm, uint32_t m, uint32_t n, uint32_t k)
+{
+	struct GemmState
+	{
+		VkDevice Device = VK_NULL_HANDLE;
+		GpuBuffer A;
+		GpuBuffer B;
+		GpuBuffer C;
+		~GemmState() { A.destroy(Device); B.destroy(Device); C.destroy(Device); }
+	};
+	auto state = std::make_shared<GemmState>();
+	state->Device = device;
+
+	auto aValue = [](uint32_t i) { return static_cast<float>(static_cast<int32_t>(i % 7) - 3) / 4.0f; };
+	auto bValue = [](uint32_t i) { return static_cast<float>(static_cast<int32_t>(i % 5) - 2) / 4.0f; };
+	const bool fp32 = gemm.getPrecision() == ComputePrecision::Fp32;
+
+	BatchWorkload workload;
+	workload.Name = string("tiled-gemm-") + getComputePrecisionName(gemm.getPrecision());
+	workload.Record = [state, memoryProperties, &gemm, m, n, k, aValue, bValue, fp32](VkCommandBuffer commandBuffer)
+	{
+		const VkDeviceSize elementSize = fp32 ? sizeof(float) : sizeof(uint16_t);
+		if (state->A.Buffer == VK_NULL_HANDLE)
+		{
+			const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			if (!state->A.create(state->Device, memoryProperties, m * k * elementSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->B.create(state->Device, memoryProperties, k * n * elementSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true) ||
+				!state->C.create(state->Device, memoryProperties, m * n * elementSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, true))
+			{
+				return false;
+			}
+			for (uint32_t i = 0; i < m * k; ++i)
+			{
+				if (fp32) { static_cast<float*>(state->A.Mapped)[i] = aValue(i); }
+				else      { static_cast<uint16_t*>(state->A.Mapped)[i] = floatToHalf(aValue(i)); }
+			}
+			for (uint32_t i = 0; i < k * n; ++i)
+			{
+				if (fp32) { static_cast<float*>(state->B.Mapped)[i] = bValue(i); }
+				else      { static_cast<uint16_t*>(state->B.Mapped)[i] = floatToHalf(bValue(i)); }
+			}
+		}
+
+		RenderGraph graph;
+		const RenderGraphResource a = graph.importBuffer("A", state->A.Buffer);
+		const RenderGraphResource b = graph.importBuffer("B", state->B.Buffer);
+		const RenderGraphResource c = graph.importBuffer("C", state->C.Buffer);
+		bool recorded = false;
+		graph.addPass("Tiled GEMM", [state, &gemm, &recorded, m, n, k](VkCommandBuffer cb)
+		{
+			recorded = gemm.record(cb, { state->A.Buffer, 0, VK_WHOLE_SIZE }, { state->B.Buffer, 0, VK_WHOLE_SIZE }, { state->C.Buffer, 0, VK_WHOLE_SIZE }, m, n, k);
+		}).read(a, ResourceUsage::ComputeShaderRead).read(b, ResourceUsage::ComputeShaderRead).write(c, ResourceUsage::ComputeShaderWrite);
+		graph.markOutput(c, ResourceUsage::HostRead);
+		if (!graph.compile()) { return false; }
+		graph.execute(commandBuffer);
+		return recorded;
+	};
+	workload.Verify = [state, m, n, k, aValue, bValue, fp32]()
+	{
+		for (uint32_t row = 0; row < m; ++row)
+		{
+			for (uint32_t column = 0; column < n; ++column)
+			{
+				float expected = 0.0f;
+				for (uint32_t i = 0; i < k; ++i) { expected += aValue(row * k + i) * bValue(i * n + column); }
+				const uint32_t index = row * n + column;
+				const float actual = fp32 ? static_cast<const float*>(state->C.Mapped)[index] : halfToFloat(static_cast<const uint16_t*>(state->C.Mapped)[index]);
+				if (actual != expected) { return false; }
+			}
+		}
+		return true;
+	};
+	return workload;
+}
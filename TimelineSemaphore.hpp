@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+
+// A timeline semaphore: a semaphore with a 64-bit counter that only ever goes up. Submissions signal it to a value when they complete and
+// the CPU can poll it or wait for it to reach a value - so one of these can stand in for a whole ring of fences, and "has frame N
+// finished yet?" is just `getValue(device) >= N`, with nothing to reset.
+// CAREFUL: The device must have been created with `VK_KHR_timeline_semaphore` enabled AND its `timelineSemaphore` feature turned on (via
+// `VkPhysicalDeviceTimelineSemaphoreFeaturesKHR` in the `VkDeviceCreateInfo` pNext chain) - otherwise the functions below won't be loaded.
+// Note: We use the KHR extension rather than the Vulkan 1.2 core functions as our instance still asks for API version 1.0 - the two are
+// otherwise identical.
+// See: https://www.khronos.org/blog/vulkan-timeline-semaphores
+struct TimelineSemaphore
+{
+	VkSemaphore Semaphore = VK_NULL_HANDLE;
+
+	bool create(VkDevice device, uint64_t initialValue = 0)
+	{
+		VkSemaphoreTypeCreateInfoKHR typeCreateInfo = {};
+		typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		typeCreateInfo.pNext = nullptr;
+		typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		typeCreateInfo.initialValue = initialValue;
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreCreateInfo.pNext = &typeCreateInfo;
+		semaphoreCreateInfo.flags = 0;
+
+		const VkResult result = VulkanFunctionLoaders::vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &Semaphore);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create timeline semaphore. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		return true;
+	}
+
+	// Method to get the current value of the counter without blocking. Returns 0 if we couldn't read it (e.g., the device was lost).
+	uint64_t getValue(VkDevice device) const
+	{
+		uint64_t value = 0;
+		const VkResult result = VulkanFunctionLoaders::vkGetSemaphoreCounterValueKHR(device, Semaphore, &value);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not read timeline semaphore value. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return 0;
+		}
+		return value;
+	}
+
+	// Method to block until the counter reaches (at least) `value`. Returns false on timeout or error.
+	bool wait(VkDevice device, uint64_t value, uint64_t timeoutNanoseconds = UINT64_MAX) const
+	{
+		VkSemaphoreWaitInfoKHR waitInfo = {};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		waitInfo.pNext = nullptr;
+		waitInfo.flags = 0;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &Semaphore;
+		waitInfo.pValues = &value;
+
+		const VkResult result = VulkanFunctionLoaders::vkWaitSemaphoresKHR(device, &waitInfo, timeoutNanoseconds);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Waiting for timeline semaphore to reach {} failed. VkResult is: {}", value, VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		return true;
+	}
+
+	// CAREFUL: Nothing pending on the GPU may still signal or wait on the semaphore when we call this!
+	void destroy(VkDevice device)
+	{
+		if (Semaphore != VK_NULL_HANDLE)
+		{
+			VulkanFunctionLoaders::vkDestroySemaphore(device, Semaphore, nullptr);
+			Semaphore = VK_NULL_HANDLE;
+		}
+	}
+};
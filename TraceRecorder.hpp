@@ -0,0 +1,422 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "GpuProfiler.hpp"
+
+struct GpuClockCalibration;
+
+// A single completed zone on a CPU thread or on the GPU. Times are in nanoseconds on `TraceRecorder::nowNanoseconds`'s clock.
+struct TraceEvent
+{
+	const char* Name;     // CAREFUL: Must stay alive until the trace is exported - string literals are ideal
+	const char* Category;
+	uint64_t StartNanoseconds;
+	uint64_t DurationNanoseconds; // Or, for a counter (see `TraceRecorder::recordCounter`), the counter's value
+};
+
+// Class to record CPU & GPU zones and export them as Chrome trace-event JSON (which Perfetto & chrome://tracing can both open).
+//
+// Recording is designed to be cheap enough to leave in hot code: every thread writes into its own chain of fixed-size chunks, so
+// recording a zone is two clock reads, a few stores and a release-store of the chunk's count - no locks, no allocation (except when a
+// chunk fills up) and no contention between threads. The only lock is taken the first time a thread records anything, to register its
+// buffer so that we can find it again at export time. Buffers are never freed, so events from threads that have exited still get exported.
+//
+// Note: We use `std::chrono::steady_clock` for CPU time. That is `CLOCK_MONOTONIC` on Linux and `QueryPerformanceCounter` on Windows,
+// which are exactly the host time domains `VK_EXT_calibrated_timestamps` can correlate GPU timestamps against (see `GpuClockCalibrator`).
+class TraceRecorder
+{
+public:
+
+	static void setEnabled(bool enabled) { enabledFlag().store(enabled, std::memory_order_relaxed); }
+	static bool isEnabled() { return enabledFlag().load(std::memory_order_relaxed); }
+
+	static uint64_t nowNanoseconds()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// Method to record a completed CPU zone on the calling thread
+	static void recordCpuZone(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds, const char* category = "cpu")
+	{
+		threadBuffer().append({ name, category, startNanoseconds, endNanoseconds - startNanoseconds });
+	}
+
+	// Method to record the value of a counter (e.g., how many objects a pool has live) at a point in time. Each counter gets its own
+	// graph in the exported trace.
+	static void recordCounter(const char* name, uint64_t nanoseconds, uint64_t value)
+	{
+		threadBuffer().append({ name, CounterCategory, nanoseconds, value });
+	}
+
+	// Method to give the calling thread a name in the exported trace (e.g., "Main", "Encoder 3")
+	static void setThreadName(const string& name)
+	{
+		ThreadBuffer& buffer = threadBuffer();
+		std::lock_guard<std::mutex> lock(registryMutex());
+		buffer.Name = name;
+	}
+
+	// Method to add resolved GPU zones to the trace, converting their ticks to CPU time with the given calibration.
+	// GPU zones are exported on their own track (named after `queueName`) so they sit alongside the CPU threads that submitted them.
+	static void recordGpuZones(const std::vector<GpuZoneResult>& zones, const GpuClockCalibration& calibration, const char* queueName = "GPU queue");
+
+	// Method to write everything recorded so far to a Chrome trace-event JSON file. Call this once the threads being traced have
+	// gone quiet - we read each thread's chunks with acquire loads, so anything recorded mid-export may or may not make it in.
+	// See: https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+	static bool writeChromeTraceJson(const string& path)
+	{
+		std::ofstream out(path, std::ios::binary);
+		if (!out)
+		{
+			LOG_ERROR("[FAIL] Could not open trace file for writing: {}", path);
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(registryMutex());
+
+		// Chrome traces are in microseconds - so rebase everything on the earliest event to keep the numbers (and the file) small
+		uint64_t earliest = UINT64_MAX;
+		for (auto& buffer : registry())
+		{
+			buffer->forEachEvent([&](const TraceEvent& event) { earliest = event.StartNanoseconds < earliest ? event.StartNanoseconds : earliest; });
+		}
+		if (earliest == UINT64_MAX) { earliest = 0; }
+
+		out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		bool first = true;
+		uint64_t numEvents = 0;
+		uint64_t numDropped = 0;
+		for (auto& buffer : registry())
+		{
+			out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->ThreadId << ",\"args\":{\"name\":\"";
+			writeEscaped(out, buffer->Name);
+			out << "\"}}";
+			first = false;
+
+			buffer->forEachEvent([&](const TraceEvent& event)
+			{
+				if (event.Category == CounterCategory)
+				{
+					out << ",\n{\"name\":\"";
+					writeEscaped(out, event.Name);
+					out << "\",\"ph\":\"C\",\"pid\":1,\"ts\":" << microseconds(event.StartNanoseconds - earliest)
+						<< ",\"args\":{\"value\":" << event.DurationNanoseconds << "}}";
+					++numEvents;
+					return;
+				}
+				out << ",\n{\"name\":\"";
+				writeEscaped(out, event.Name);
+				out << "\",\"cat\":\"";
+				writeEscaped(out, event.Category);
+				out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->ThreadId
+					<< ",\"ts\":" << microseconds(event.StartNanoseconds - earliest)
+					<< ",\"dur\":" << microseconds(event.DurationNanoseconds) << "}";
+				++numEvents;
+			});
+			numDropped += buffer->Dropped.load(std::memory_order_relaxed);
+		}
+		out << "\n]}\n";
+
+		LOG_INFO("[OK] Wrote {} trace events to: {}", numEvents, path);
+		if (numDropped > 0) { LOG_WARNING("[WARNING] {} trace events were dropped (out of memory for trace chunks).", numDropped); }
+		return static_cast<bool>(out);
+	}
+
+private:
+
+	static constexpr uint32_t EventsPerChunk = 4096;
+	static constexpr const char* CounterCategory = "counter"; // Note: Counters are told apart by this exact pointer, not the text
+
+	struct Chunk
+	{
+		TraceEvent Events[EventsPerChunk];
+		std::atomic<uint32_t> Count{ 0 };
+		std::atomic<Chunk*> Next{ nullptr };
+	};
+
+	struct ThreadBuffer
+	{
+		uint32_t ThreadId = 0;
+		string Name;
+		std::unique_ptr<Chunk> Head;
+		Chunk* Tail = nullptr; // Only ever touched by the owning thread
+		std::atomic<uint64_t> Dropped{ 0 };
+		std::vector<std::unique_ptr<Chunk>> ExtraChunks; // Owns every chunk after `Head`
+
+		void append(const TraceEvent& event)
+		{
+			uint32_t count = Tail->Count.load(std::memory_order_relaxed);
+			if (count == EventsPerChunk)
+			{
+				// Rare path: start a new chunk. Only this thread ever appends to `ExtraChunks`, and the exporter only walks `Next`
+				// pointers, so publishing the new chunk with a release-store is all the synchronisation we need.
+				auto newChunk = std::unique_ptr<Chunk>(new (std::nothrow) Chunk());
+				if (!newChunk)
+				{
+					Dropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				Chunk* chunk = newChunk.get();
+				ExtraChunks.push_back(std::move(newChunk));
+				Tail->Next.store(chunk, std::memory_order_release);
+				Tail = chunk;
+				count = 0;
+			}
+			Tail->Events[count] = event;
+			Tail->Count.store(count + 1, std::memory_order_release);
+		}
+
+		template <typename Visitor>
+		void forEachEvent(Visitor&& visit) const
+		{
+			for (const Chunk* chunk = Head.get(); chunk != nullptr; chunk = chunk->Next.load(std::memory_order_acquire))
+			{
+				const uint32_t count = chunk->Count.load(std::memory_order_acquire);
+				for (uint32_t i = 0; i < count; ++i) { visit(chunk->Events[i]); }
+			}
+		}
+	};
+
+	static std::atomic<bool>& enabledFlag() { static std::atomic<bool> enabled{ false }; return enabled; }
+	static std::mutex& registryMutex() { static std::mutex mutex; return mutex; }
+	static std::vector<std::unique_ptr<ThreadBuffer>>& registry() { static std::vector<std::unique_ptr<ThreadBuffer>> buffers; return buffers; }
+
+	// Method to get the calling thread's buffer, creating & registering it the first time a thread asks
+	static ThreadBuffer& threadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr) { buffer = registerBuffer("Thread"); }
+		return *buffer;
+	}
+
+	static ThreadBuffer* registerBuffer(const string& baseName)
+	{
+		auto newBuffer = std::make_unique<ThreadBuffer>();
+		newBuffer->Head = std::make_unique<Chunk>();
+		newBuffer->Tail = newBuffer->Head.get();
+
+		std::lock_guard<std::mutex> lock(registryMutex());
+		newBuffer->ThreadId = static_cast<uint32_t>(registry().size() + 1);
+		newBuffer->Name = baseName + " " + std::to_string(newBuffer->ThreadId);
+		registry().push_back(std::move(newBuffer));
+		return registry().back().get();
+	}
+
+	// GPU tracks get their own buffers, keyed by name. Only called from `recordGpuZones`.
+	static ThreadBuffer& gpuTrackBuffer(const char* queueName)
+	{
+		static std::mutex gpuTracksMutex;
+		static std::vector<std::pair<string, ThreadBuffer*>> gpuTracks;
+
+		std::lock_guard<std::mutex> lock(gpuTracksMutex);
+		for (auto& [name, buffer] : gpuTracks)
+		{
+			if (name == queueName) { return *buffer; }
+		}
+		ThreadBuffer* buffer = registerBuffer(queueName);
+		{
+			std::lock_guard<std::mutex> registryLock(registryMutex());
+			buffer->Name = queueName;
+		}
+		gpuTracks.push_back({ queueName, buffer });
+		return *buffer;
+	}
+
+	static double microseconds(uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1000.0; }
+
+	static void writeEscaped(std::ostream& out, const string& text)
+	{
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\') { out << '\\' << c; }
+			else if (static_cast<unsigned char>(c) < 0x20) { out << ' '; }
+			else { out << c; }
+		}
+	}
+};
+
+// RAII helper to record a CPU zone covering its own lifetime. Costs a single relaxed load when tracing is disabled.
+class TraceScope
+{
+public:
+	explicit TraceScope(const char* zoneName, const char* zoneCategory = "cpu")
+		: name(zoneName), category(zoneCategory), start(TraceRecorder::isEnabled() ? TraceRecorder::nowNanoseconds() : 0) {}
+
+	~TraceScope() { end(); }
+
+	// Method to close the zone early (e.g., at the end of one of `main`'s steps, which aren't scoped blocks)
+	void end()
+	{
+		if (start == 0) { return; }
+		TraceRecorder::recordCpuZone(name, start, TraceRecorder::nowNanoseconds(), category);
+		start = 0;
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	const char* name;
+	const char* category;
+	uint64_t start;
+};
+
+#define TRACE_CONCATENATE_INNER(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCATENATE(traceScope_, __LINE__)(name)
+
+// A matching pair of GPU & CPU timestamps, taken (as near as possible) at the same instant. Used to map GPU ticks onto the CPU timeline.
+struct GpuClockCalibration
+{
+	uint64_t GpuTicks = 0;
+	uint64_t CpuNanoseconds = 0;
+	float TimestampPeriod = 1.0f;        // Nanoseconds per GPU tick
+	uint64_t ValidBitsMask = UINT64_MAX;  // Mask of the GPU timestamp's valid bits (see `timestampValidBits`)
+	bool Calibrated = false;              // False if this is only an estimate (i.e., `VK_EXT_calibrated_timestamps` was not available)
+
+	uint64_t toCpuNanoseconds(uint64_t gpuTicks) const
+	{
+		// The GPU timestamp may be before OR after our calibration point, and may have wrapped - so treat the masked difference as signed
+		uint64_t delta = (gpuTicks - GpuTicks) & ValidBitsMask;
+		const bool before = delta > (ValidBitsMask >> 1);
+		if (before) { delta = (GpuTicks - gpuTicks) & ValidBitsMask; }
+		const auto deltaNanoseconds = static_cast<uint64_t>(static_cast<double>(delta) * TimestampPeriod);
+		return before ? CpuNanoseconds - deltaNanoseconds : CpuNanoseconds + deltaNanoseconds;
+	}
+};
+
+inline void TraceRecorder::recordGpuZones(const std::vector<GpuZoneResult>& zones, const GpuClockCalibration& calibration, const char* queueName)
+{
+	if (!isEnabled() || zones.empty()) { return; }
+
+	ThreadBuffer& buffer = gpuTrackBuffer(queueName);
+
+	// Note: GPU tracks can be fed from any thread (unlike the per-thread CPU buffers) so appending to them is serialised. And as GPU zone
+	// names come from `std::string`s that won't outlive the trace, we intern them for the lifetime of the program.
+	static std::mutex gpuAppendMutex;
+	static std::vector<std::unique_ptr<string>> internedNames;
+	std::lock_guard<std::mutex> lock(gpuAppendMutex);
+	for (auto& zone : zones)
+	{
+		const uint64_t start = calibration.toCpuNanoseconds(zone.StartTicks);
+		const uint64_t end = calibration.toCpuNanoseconds(zone.EndTicks);
+
+		const char* name = nullptr;
+		for (auto& interned : internedNames)
+		{
+			if (*interned == zone.Name) { name = interned->c_str(); break; }
+		}
+		if (name == nullptr)
+		{
+			internedNames.push_back(std::make_unique<string>(zone.Name));
+			name = internedNames.back()->c_str();
+		}
+		buffer.append({ name, "gpu", start, end > start ? end - start : 0 });
+	}
+}
+
+// Class to correlate GPU timestamps with CPU time using `VK_EXT_calibrated_timestamps`.
+// See: https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VK_EXT_calibrated_timestamps.html
+class GpuClockCalibrator
+{
+public:
+
+	// Method to set up the calibrator. `extensionEnabled` should be true only if `VK_EXT_calibrated_timestamps` was enabled on the device.
+	// Returns false if we can't calibrate (in which case `calibrate` falls back to an estimate).
+	bool create(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice logicalDevice, bool extensionEnabled, float timestampPeriodNs, uint32_t timestampValidBits)
+	{
+		device = logicalDevice;
+		timestampPeriod = timestampPeriodNs;
+		validBitsMask = timestampValidBits >= 64 ? UINT64_MAX : ((uint64_t(1) << timestampValidBits) - 1);
+		if (!extensionEnabled || VulkanFunctionLoaders::vkGetCalibratedTimestampsEXT == nullptr) { return false; }
+
+		// Note: This is an instance-level function provided by a DEVICE extension, so it doesn't fit either of the `..._FROM_EXTENSION`
+		// loaders in "ListOfVulkanFunctions.inl" (which only check the extensions enabled at their own level) - so we load it by hand.
+		auto getTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(
+			VulkanFunctionLoaders::vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+		if (getTimeDomains == nullptr) { return false; }
+
+		uint32_t domainCount = 0;
+		getTimeDomains(physicalDevice, &domainCount, nullptr);
+		std::vector<VkTimeDomainEXT> domains(domainCount);
+		getTimeDomains(physicalDevice, &domainCount, domains.data());
+
+		bool hasDevice = false;
+		bool hasHost = false;
+		for (auto domain : domains)
+		{
+			hasDevice = hasDevice || domain == VK_TIME_DOMAIN_DEVICE_EXT;
+			hasHost = hasHost || domain == HostTimeDomain;
+		}
+		available = hasDevice && hasHost;
+		if (!available) { LOG_WARNING("[WARNING] Device cannot calibrate its timestamps against the host clock - GPU trace zones will be approximate."); }
+		return available;
+	}
+
+	// Method to take a matching pair of GPU & CPU timestamps. If calibration isn't available we use `fallbackGpuTicks` (e.g., the
+	// first GPU timestamp of a batch) and `fallbackCpuNanoseconds` (e.g., the CPU time just before it was submitted) as the pairing instead.
+	GpuClockCalibration calibrate(uint64_t fallbackGpuTicks = 0, uint64_t fallbackCpuNanoseconds = 0) const
+	{
+		GpuClockCalibration calibration;
+		calibration.TimestampPeriod = timestampPeriod;
+		calibration.ValidBitsMask = validBitsMask;
+		calibration.GpuTicks = fallbackGpuTicks & validBitsMask;
+		calibration.CpuNanoseconds = fallbackCpuNanoseconds;
+		if (!available) { return calibration; }
+
+		VkCalibratedTimestampInfoEXT infos[2] = {};
+		infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+		infos[0].pNext = nullptr;
+		infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+		infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+		infos[1].pNext = nullptr;
+		infos[1].timeDomain = HostTimeDomain;
+
+		uint64_t timestamps[2] = {};
+		uint64_t maxDeviation = 0;
+		const VkResult result = VulkanFunctionLoaders::vkGetCalibratedTimestampsEXT(device, 2, infos, timestamps, &maxDeviation);
+		if (result != VK_SUCCESS) { return calibration; }
+
+		calibration.GpuTicks = timestamps[0] & validBitsMask;
+		calibration.CpuNanoseconds = hostTicksToNanoseconds(timestamps[1]);
+		calibration.Calibrated = true;
+		return calibration;
+	}
+
+	bool isCalibrated() const { return available; }
+
+private:
+
+#if defined _WIN32
+	static constexpr VkTimeDomainEXT HostTimeDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+
+	// `steady_clock` on Windows is the performance counter scaled to nanoseconds, so we scale the same way (splitting to avoid overflow)
+	static uint64_t hostTicksToNanoseconds(uint64_t ticks)
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		const auto ticksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+		return (ticks / ticksPerSecond) * 1000000000ull + ((ticks % ticksPerSecond) * 1000000000ull) / ticksPerSecond;
+	}
+#else
+	static constexpr VkTimeDomainEXT HostTimeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+
+	// `CLOCK_MONOTONIC` is already in nanoseconds
+	static uint64_t hostTicksToNanoseconds(uint64_t ticks) { return ticks; }
+#endif
+
+	VkDevice device = VK_NULL_HANDLE;
+	float timestampPeriod = 1.0f;
+	uint64_t validBitsMask = UINT64_MAX;
+	bool available = false;
+};
@@ -0,0 +1,402 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "GpuBuffer.hpp"
+#include "GpuCulling.hpp"
+#include "JobSystem.hpp"
+
+// SSE is always there on x64 (and on 32-bit x86 when MSVC or GCC were told they could use it), as is NEON on 64-bit ARM
+#if defined _M_X64 || defined __x86_64__ || (defined _M_IX86_FP && _M_IX86_FP >= 1) || defined __SSE__
+	#define TRANSFORM_SSE 1
+	#include <xmmintrin.h>
+#elif defined __ARM_NEON || defined _M_ARM64
+	#define TRANSFORM_NEON 1
+	#include <arm_neon.h>
+#endif
+
+// A node's transform relative to its parent: translate * rotate * scale
+struct Transform
+{
+	std::array<float, 3> Position = { 0.0f, 0.0f, 0.0f };
+	std::array<float, 4> Rotation = { 0.0f, 0.0f, 0.0f, 1.0f }; // A unit quaternion: (x, y, z, w)
+	std::array<float, 3> Scale = { 1.0f, 1.0f, 1.0f };
+};
+
+// Method to turn a position, rotation (unit quaternion) & scale into a column-major matrix
+inline Matrix4 makeTransformMatrix(float px, float py, float pz, float qx, float qy, float qz, float qw, float sx, float sy, float sz)
+{
+	const float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+	const float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+	const float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+	return Matrix4{
+		(1.0f - 2.0f * (yy + zz)) * sx, 2.0f * (xy + wz) * sx, 2.0f * (xz - wy) * sx, 0.0f,
+		2.0f * (xy - wz) * sy, (1.0f - 2.0f * (xx + zz)) * sy, 2.0f * (yz + wx) * sy, 0.0f,
+		2.0f * (xz + wy) * sz, 2.0f * (yz - wx) * sz, (1.0f - 2.0f * (xx + yy)) * sz, 0.0f,
+		px, py, pz, 1.0f };
+}
+
+inline Matrix4 makeTransformMatrix(const Transform& transform)
+{
+	return makeTransformMatrix(transform.Position[0], transform.Position[1], transform.Position[2], transform.Rotation[0], transform.Rotation[1], transform.Rotation[2],
+		transform.Rotation[3], transform.Scale[0], transform.Scale[1], transform.Scale[2]);
+}
+
+// Method to multiply two column-major 4x4 matrices four floats at a time: each column of the result is the columns of `a` weighted by that
+// column of `b`. The sums are done in the same order as `multiplyMatrices`, so (without fused multiply-adds) the two agree exactly.
+// Note: `result` may not be `a` or `b`.
+inline void multiplyMatricesSimd(const float* a, const float* b, float* result)
+{
+#if defined TRANSFORM_SSE
+	const __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+	for (uint32_t column = 0; column < 4; ++column)
+	{
+		const float* weights = b + column * 4;
+		__m128 sum = _mm_mul_ps(a0, _mm_set1_ps(weights[0]));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(weights[1])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(weights[2])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(weights[3])));
+		_mm_storeu_ps(result + column * 4, sum);
+	}
+#elif defined TRANSFORM_NEON
+	const float32x4_t a0 = vld1q_f32(a), a1 = vld1q_f32(a + 4), a2 = vld1q_f32(a + 8), a3 = vld1q_f32(a + 12);
+	for (uint32_t column = 0; column < 4; ++column)
+	{
+		const float* weights = b + column * 4;
+		float32x4_t sum = vmulq_n_f32(a0, weights[0]); // Note: Not vmlaq/vfmaq, which may fuse
+		sum = vaddq_f32(sum, vmulq_n_f32(a1, weights[1]));
+		sum = vaddq_f32(sum, vmulq_n_f32(a2, weights[2]));
+		sum = vaddq_f32(sum, vmulq_n_f32(a3, weights[3]));
+		vst1q_f32(result + column * 4, sum);
+	}
+#else
+	Matrix4 left, right;
+	std::memcpy(left.data(), a, sizeof(left));
+	std::memcpy(right.data(), b, sizeof(right));
+	const Matrix4 product = multiplyMatrices(left, right);
+	std::memcpy(result, product.data(), sizeof(product));
+#endif
+}
+
+// Class to work out the world matrices of a hierarchy of transforms every frame, without chasing pointers around a scene graph.
+//
+// Nodes are laid out breadth first - every level of the hierarchy after the one above it, and each node's children together - and their
+// local transforms kept as a structure of arrays in that order. So `update` walks each level front to back (in parallel, given a job
+// system), reading parents from the level it's just done, and the world matrices come out in one sweep through memory. Only nodes whose
+// local transform changed - and everything below them - get recomputed.
+//
+// World matrices go straight into `Instances`, a persistently mapped buffer with one copy per frame in flight, so the GPU can read them
+// as a storage or per-instance vertex buffer with no copies in between. A node's matrix lives at `getSlot(node)` within a frame's copy,
+// which is written front to back too - the memory may well be write-combined, which only ever wants to be written in order, never read.
+//
+// Note: Node numbers are whatever the parents given to `create` used - slots are purely how we store things.
+class TransformHierarchy
+{
+public:
+	static constexpr uint32_t NoParent = UINT32_MAX;
+	static constexpr uint32_t ChunkSize = 4096; // Nodes per job within a level - small levels get done on the calling thread
+
+	GpuBuffer Instances; // `framesInFlight` copies of every world matrix, one after the other
+
+	// Method to lay out the hierarchy described by `parents` (each node's parent node, or -1 for a root) and make its instance buffer.
+	// Every node starts at the identity. Returns false (and cleans up after itself) if `parents` isn't a forest or the buffer can't be made.
+	bool create(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, const std::vector<int32_t>& parents, uint32_t framesInFlight = 2)
+	{
+		this->device = device;
+		const uint32_t nodeCount = static_cast<uint32_t>(parents.size());
+		if (nodeCount == 0 || framesInFlight == 0)
+		{
+			LOG_ERROR("[FAIL] A transform hierarchy needs at least one node and one frame in flight. Asked for {} node(s) and {} frame(s).", nodeCount, framesInFlight);
+			return false;
+		}
+
+		// Breadth first from the roots, so each level follows the last & siblings sit together. Anything we never reach is in a cycle.
+		std::vector<uint32_t> childStarts(nodeCount + 1, 0);
+		for (uint32_t node = 0; node < nodeCount; ++node)
+		{
+			if (parents[node] >= static_cast<int32_t>(nodeCount))
+			{
+				LOG_ERROR("[FAIL] Transform node {} has a parent ({}) that doesn't exist.", node, parents[node]);
+				return false;
+			}
+			if (parents[node] >= 0) { ++childStarts[parents[node] + 1]; }
+		}
+		for (uint32_t node = 0; node < nodeCount; ++node) { childStarts[node + 1] += childStarts[node]; }
+		std::vector<uint32_t> children(childStarts[nodeCount]);
+		std::vector<uint32_t> nextChild(childStarts.begin(), childStarts.end() - 1);
+		for (uint32_t node = 0; node < nodeCount; ++node)
+		{
+			if (parents[node] >= 0) { children[nextChild[parents[node]]++] = node; }
+		}
+
+		slotNodes.clear();
+		slotNodes.reserve(nodeCount);
+		for (uint32_t node = 0; node < nodeCount; ++node)
+		{
+			if (parents[node] < 0) { slotNodes.push_back(node); }
+		}
+		levelStarts = { 0 };
+		for (uint32_t levelStart = 0; levelStart < slotNodes.size();)
+		{
+			const uint32_t levelEnd = static_cast<uint32_t>(slotNodes.size());
+			for (uint32_t slot = levelStart; slot < levelEnd; ++slot)
+			{
+				const uint32_t node = slotNodes[slot];
+				slotNodes.insert(slotNodes.end(), children.begin() + childStarts[node], children.begin() + childStarts[node + 1]);
+			}
+			levelStarts.push_back(levelEnd);
+			levelStart = levelEnd;
+		}
+		if (slotNodes.size() != nodeCount)
+		{
+			LOG_ERROR("[FAIL] {} of the {} transform nodes are in a cycle, so have no root.", nodeCount - slotNodes.size(), nodeCount);
+			destroy();
+			return false;
+		}
+
+		nodeSlots.assign(nodeCount, 0);
+		for (uint32_t slot = 0; slot < nodeCount; ++slot) { nodeSlots[slotNodes[slot]] = slot; }
+		parentSlots.resize(nodeCount);
+		for (uint32_t slot = 0; slot < nodeCount; ++slot)
+		{
+			const int32_t parent = parents[slotNodes[slot]];
+			parentSlots[slot] = parent < 0 ? NoParent : nodeSlots[parent];
+		}
+
+		for (std::vector<float>* array : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ }) { array->assign(nodeCount, 0.0f); }
+		for (std::vector<float>* array : { &rotationW, &scaleX, &scaleY, &scaleZ }) { array->assign(nodeCount, 1.0f); }
+		localDirty.assign(nodeCount, 1);
+		worldMatrices.assign(nodeCount, Matrix4{});
+		changedAt.assign(nodeCount, 0);
+		frameWrittenAt.assign(framesInFlight, 0);
+		updateNumber = 0;
+		anyLocalDirty = true;
+
+		frameSize = static_cast<VkDeviceSize>(nodeCount) * sizeof(Matrix4);
+		if (!Instances.create(device, memoryProperties, frameSize * framesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true))
+		{
+			destroy();
+			return false;
+		}
+
+		LOG_VERBOSE("[OK] Created transform hierarchy of {} node(s) in {} level(s), with {} frame(s) in flight.", nodeCount, getLevelCount(), framesInFlight);
+		return true;
+	}
+
+	uint32_t getNodeCount() const { return static_cast<uint32_t>(slotNodes.size()); }
+	uint32_t getLevelCount() const { return levelStarts.empty() ? 0 : static_cast<uint32_t>(levelStarts.size() - 1); }
+
+	// Method to get where `node`'s world matrix lives within each frame's copy of `Instances` - i.e. its instance index
+	uint32_t getSlot(uint32_t node) const { return nodeSlots[node]; }
+
+	// Method to get where frame `frameIndex`'s copy of the world matrices starts within `Instances`
+	VkDeviceSize getInstanceOffset(uint32_t frameIndex) const { return frameSize * frameIndex; }
+
+	void setLocalTransform(uint32_t node, const Transform& transform)
+	{
+		const uint32_t slot = nodeSlots[node];
+		positionX[slot] = transform.Position[0];
+		positionY[slot] = transform.Position[1];
+		positionZ[slot] = transform.Position[2];
+		rotationX[slot] = transform.Rotation[0];
+		rotationY[slot] = transform.Rotation[1];
+		rotationZ[slot] = transform.Rotation[2];
+		rotationW[slot] = transform.Rotation[3];
+		scaleX[slot] = transform.Scale[0];
+		scaleY[slot] = transform.Scale[1];
+		scaleZ[slot] = transform.Scale[2];
+		localDirty[slot] = 1;
+		anyLocalDirty = true;
+	}
+
+	Transform getLocalTransform(uint32_t node) const
+	{
+		const uint32_t slot = nodeSlots[node];
+		Transform transform;
+		transform.Position = { positionX[slot], positionY[slot], positionZ[slot] };
+		transform.Rotation = { rotationX[slot], rotationY[slot], rotationZ[slot], rotationW[slot] };
+		transform.Scale = { scaleX[slot], scaleY[slot], scaleZ[slot] };
+		return transform;
+	}
+
+	// Method to get `node`'s world matrix as of the last `update`
+	const Matrix4& getWorldMatrix(uint32_t node) const { return worldMatrices[nodeSlots[node]]; }
+
+	// Method to bring the world matrices up to date & write them into frame `frameIndex`'s copy of `Instances`. A node is only recomputed
+	// if its local transform was set since the last update or its parent was recomputed - and only matrices that changed since this frame's
+	// copy was last written get written again. Returns how many world matrices were recomputed.
+	// CAREFUL: The GPU must be finished reading frame `frameIndex`'s copy - and, like `JobSystem::parallelFor`, don't call this from inside a job.
+	uint32_t update(uint32_t frameIndex, JobSystem* jobs = nullptr)
+	{
+		if (anyLocalDirty) { ++updateNumber; }
+		else if (frameWrittenAt[frameIndex] == updateNumber) { return 0; } // Nothing's changed since this copy was last written
+		// Note: If nothing's been set since the last update the world matrices are already right, and this copy just has to catch up
+		// with the updates it missed - so there's nothing to recompute (even though the last update's `changedAt`s still match)
+		const bool recompute = anyLocalDirty;
+		const uint64_t writtenAt = frameWrittenAt[frameIndex];
+		float* frameMatrices = reinterpret_cast<float*>(static_cast<uint8_t*>(Instances.Mapped) + getInstanceOffset(frameIndex));
+
+		std::atomic<uint32_t> recomputed = 0;
+		auto updateSlots = [this, recompute, writtenAt, frameMatrices, &recomputed](uint32_t begin, uint32_t end)
+		{
+			uint32_t chunkRecomputed = 0;
+			for (uint32_t slot = begin; slot < end; ++slot)
+			{
+				const uint32_t parent = parentSlots[slot];
+				if (recompute && (localDirty[slot] != 0 || (parent != NoParent && changedAt[parent] == updateNumber)))
+				{
+					const Matrix4 local = makeTransformMatrix(positionX[slot], positionY[slot], positionZ[slot], rotationX[slot], rotationY[slot], rotationZ[slot],
+						rotationW[slot], scaleX[slot], scaleY[slot], scaleZ[slot]);
+					if (parent == NoParent) { worldMatrices[slot] = local; }
+					else { multiplyMatricesSimd(worldMatrices[parent].data(), local.data(), worldMatrices[slot].data()); }
+					localDirty[slot] = 0;
+					changedAt[slot] = updateNumber;
+					++chunkRecomputed;
+				}
+				if (changedAt[slot] > writtenAt) { std::memcpy(frameMatrices + slot * 16, worldMatrices[slot].data(), sizeof(Matrix4)); }
+			}
+			recomputed += chunkRecomputed;
+		};
+
+		// Note: A level only needs the one above it finished, so each level is one parallel-for - unless we're only copying, when the
+		// levels don't depend on each other at all
+		if (!recompute)
+		{
+			if (jobs == nullptr) { updateSlots(0, getNodeCount()); }
+			else { jobs->parallelFor(getNodeCount(), ChunkSize, updateSlots); }
+		}
+		else
+		{
+			for (uint32_t level = 0; level < getLevelCount(); ++level)
+			{
+				const uint32_t levelStart = levelStarts[level], levelSize = levelStarts[level + 1] - levelStart;
+				if (jobs == nullptr) { updateSlots(levelStart, levelStart + levelSize); }
+				else { jobs->parallelFor(levelSize, ChunkSize, [&updateSlots, levelStart](uint32_t begin, uint32_t end) { updateSlots(levelStart + begin, levelStart + end); }); }
+			}
+		}
+
+		anyLocalDirty = false;
+		frameWrittenAt[frameIndex] = updateNumber;
+		return recomputed.load();
+	}
+
+	// Method to destroy the instance buffer & forget the hierarchy. Safe to call on a partially-created (or never-created) hierarchy.
+	// CAREFUL: The GPU must be finished with `Instances` before we call this!
+	void destroy()
+	{
+		Instances.destroy(device);
+		for (std::vector<float>* array : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW, &scaleX, &scaleY, &scaleZ }) { array->clear(); }
+		slotNodes.clear();
+		nodeSlots.clear();
+		parentSlots.clear();
+		levelStarts.clear();
+		localDirty.clear();
+		worldMatrices.clear();
+		changedAt.clear();
+		frameWrittenAt.clear();
+		frameSize = 0;
+		device = VK_NULL_HANDLE;
+	}
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkDeviceSize frameSize = 0;
+
+	// ----- Layout (all by slot, apart from `nodeSlots`) -----
+	std::vector<uint32_t> slotNodes;
+	std::vector<uint32_t> nodeSlots;
+	std::vector<uint32_t> parentSlots; // Always in an earlier level, or `NoParent`
+	std::vector<uint32_t> levelStarts; // Each level's first slot, plus one past the last slot
+
+	// ----- Local transforms -----
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+
+	// ----- World matrices & what changed when -----
+	std::vector<uint8_t> localDirty;
+	std::vector<Matrix4> worldMatrices; // Kept here too, as children need their parent's - and reading back from `Instances` could be very slow
+	std::vector<uint64_t> changedAt;    // The update that last recomputed each world matrix
+	std::vector<uint64_t> frameWrittenAt; // The update each frame's copy of `Instances` was last written by (0 for never)
+	uint64_t updateNumber = 0;
+	bool anyLocalDirty = false;
+};
+
+// A hierarchy to test & benchmark with: each node's parent is some earlier node (with the odd extra root), numbered in a shuffled order so
+// the parents come in no particular order - as they would from a scene loaded off disk. Same `seed`, same hierarchy.
+struct TransformScene
+{
+	std::vector<int32_t> Parents;
+	std::vector<Transform> Locals;
+};
+
+inline TransformScene generateTransformScene(uint32_t nodeCount, uint32_t seed = 1)
+{
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return static_cast<float>(seed >> 8) * (1.0f / 16777216.0f);
+	};
+
+	std::vector<uint32_t> order(nodeCount);
+	for (uint32_t i = 0; i < nodeCount; ++i) { order[i] = i; }
+	for (uint32_t i = nodeCount; i > 1; --i) { std::swap(order[i - 1], order[std::min(static_cast<uint32_t>(random() * i), i - 1)]); }
+
+	TransformScene scene;
+	scene.Parents.assign(nodeCount, -1);
+	scene.Locals.resize(nodeCount);
+	for (uint32_t i = 0; i < nodeCount; ++i)
+	{
+		if (i > 0 && random() >= 0.01f)
+		{
+			const uint32_t parent = std::min(static_cast<uint32_t>(random() * i), i - 1);
+			scene.Parents[order[i]] = static_cast<int32_t>(order[parent]);
+		}
+
+		// Note: Small offsets, rotations & scales near 1, so matrices many levels down are still well-behaved
+		Transform& local = scene.Locals[order[i]];
+		local.Position = { random() * 2.0f - 1.0f, random() * 2.0f - 1.0f, random() * 2.0f - 1.0f };
+		const float angle = (random() * 2.0f - 1.0f) * 0.5f;
+		local.Rotation = { 0.0f, std::sin(angle), 0.0f, std::cos(angle) };
+		const float scale = 0.9f + 0.2f * random();
+		local.Scale = { scale, scale, scale };
+	}
+	return scene;
+}
+
+// Method to work out every node's world matrix the obvious way, one node at a time with `multiplyMatrices` - to check a
+// `TransformHierarchy` against
+inline std::vector<Matrix4> computeWorldMatricesOnCpu(const std::vector<int32_t>& parents, const std::vector<Transform>& locals)
+{
+	std::vector<Matrix4> world(parents.size());
+	std::vector<uint8_t> done(parents.size(), 0);
+	std::vector<uint32_t> pending;
+	for (uint32_t node = 0; node < parents.size(); ++node)
+	{
+		// Walk up to the nearest ancestor that's done (or a root), then back down
+		for (uint32_t ancestor = node; done[ancestor] == 0;)
+		{
+			pending.push_back(ancestor);
+			if (parents[ancestor] < 0) { break; }
+			ancestor = static_cast<uint32_t>(parents[ancestor]);
+		}
+		while (!pending.empty())
+		{
+			const uint32_t next = pending.back();
+			pending.pop_back();
+			const Matrix4 local = makeTransformMatrix(locals[next]);
+			world[next] = parents[next] < 0 ? local : multiplyMatrices(world[parents[next]], local);
+			done[next] = 1;
+		}
+	}
+	return world;
+}
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+
+// Description of a buffer or image that only lives for part of one frame (e.g., a post-processing intermediate or a scratch buffer).
+// Two transients with equal descriptions are interchangeable, which is what lets the pool hand back the same object frame after frame.
+struct TransientDesc
+{
+	bool IsImage = false;
+	VkDeviceSize Size = 0;                                      // Buffers only
+	VkBufferUsageFlags BufferUsage = 0;                         // Buffers only
+	VkFormat Format = VK_FORMAT_UNDEFINED;                      // Images only...
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	VkImageUsageFlags ImageUsage = 0;
+	VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT;
+	VkImageAspectFlags AspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+
+	bool operator<(const TransientDesc& other) const
+	{
+		return std::tie(IsImage, Size, BufferUsage, Format, Width, Height, ImageUsage, Samples, AspectMask) <
+			std::tie(other.IsImage, other.Size, other.BufferUsage, other.Format, other.Width, other.Height, other.ImageUsage, other.Samples, other.AspectMask);
+	}
+
+	static TransientDesc buffer(VkDeviceSize size, VkBufferUsageFlags usage)
+	{
+		TransientDesc desc;
+		desc.Size = size;
+		desc.BufferUsage = usage;
+		return desc;
+	}
+
+	static TransientDesc image(VkFormat format, uint32_t width, uint32_t height, VkImageUsageFlags usage, VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT)
+	{
+		TransientDesc desc;
+		desc.IsImage = true;
+		desc.Format = format;
+		desc.Width = width;
+		desc.Height = height;
+		desc.ImageUsage = usage;
+		desc.AspectMask = aspectMask;
+		return desc;
+	}
+};
+
+// Class that owns the device memory (and the buffer / image objects bound into it) behind a `RenderGraph`'s transient resources.
+// The graph works out which transients are alive at the same time and packs them into one block of memory per memory type, so ones
+// that never overlap share memory - the pool just makes sure the blocks are big enough and hands out objects bound at the right offsets.
+// Objects are cached by (description, memory block, offset), so a graph that's the same shape as last frame creates nothing at all.
+//
+// CAREFUL: Growing a block (or dropping objects the last graph didn't use) destroys things the GPU might still be using - so a pool must
+// only be used by one frame in flight at a time. Give each frame-in-flight slot its own pool, and only compile a graph against a slot's
+// pool once that slot's previous frame has finished on the GPU.
+class TransientResourcePool
+{
+public:
+
+	// Note: `bufferImageGranularity` comes from `VkPhysicalDeviceLimits` - we pad every placement to it so buffers (linear) and optimally
+	// tiled images can share a block without ever landing on the same "page".
+	bool create(VkDevice logicalDevice, const VkPhysicalDeviceMemoryProperties& memoryProperties, VkDeviceSize bufferImageGranularity)
+	{
+		device = logicalDevice;
+		memProperties = memoryProperties;
+		granularity = bufferImageGranularity > 0 ? bufferImageGranularity : 1;
+		return true;
+	}
+
+	// Method to get the memory requirements of a transient (and the memory type we'd put it in), creating a throwaway object to ask
+	// Vulkan the first time we see a description. Returns false if the object can't be created or no memory type will take it.
+	bool getRequirements(const TransientDesc& desc, VkMemoryRequirements& requirements, uint32_t& memoryTypeIndex)
+	{
+		auto cached = requirementsCache.find(desc);
+		if (cached == requirementsCache.end())
+		{
+			CachedRequirements entry;
+			if (desc.IsImage)
+			{
+				VkImage image = VK_NULL_HANDLE;
+				if (!createImage(desc, image)) { return false; }
+				VulkanFunctionLoaders::vkGetImageMemoryRequirements(device, image, &entry.Requirements);
+				VulkanFunctionLoaders::vkDestroyImage(device, image, nullptr);
+			}
+			else
+			{
+				VkBuffer buffer = VK_NULL_HANDLE;
+				if (!createBuffer(desc, buffer)) { return false; }
+				VulkanFunctionLoaders::vkGetBufferMemoryRequirements(device, buffer, &entry.Requirements);
+				VulkanFunctionLoaders::vkDestroyBuffer(device, buffer, nullptr);
+			}
+			entry.MemoryTypeIndex = VulkanHelpers::findMemoryTypeIndex(memProperties, entry.Requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			if (entry.MemoryTypeIndex == UINT32_MAX)
+			{
+				LOG_ERROR("[FAIL] No device-local memory type can hold a transient {}.", desc.IsImage ? "image" : "buffer");
+				return false;
+			}
+			cached = requirementsCache.emplace(desc, entry).first;
+		}
+		requirements = cached->second.Requirements;
+		memoryTypeIndex = cached->second.MemoryTypeIndex;
+		return true;
+	}
+
+	// What every placement's offset & size get rounded up to, for a transient with the given requirements
+	VkDeviceSize getPlacementAlignment(const VkMemoryRequirements& requirements) const { return std::max(requirements.alignment, granularity); }
+
+	// Method to start a new frame: objects that weren't handed out since the last call are destroyed (their placement has changed, or the
+	// graph no longer has them), and blocks are made at least `bytesPerMemoryType[type]` big - which may mean replacing them.
+	bool beginFrame(const std::map<uint32_t, VkDeviceSize>& bytesPerMemoryType)
+	{
+		for (auto it = objects.begin(); it != objects.end();)
+		{
+			if (!it->second.UsedThisFrame)
+			{
+				destroyObject(it->second);
+				it = objects.erase(it);
+			}
+			else
+			{
+				it->second.UsedThisFrame = false;
+				++it;
+			}
+		}
+
+		for (const auto& [memoryTypeIndex, bytes] : bytesPerMemoryType)
+		{
+			Block& block = blocks[memoryTypeIndex];
+			if (block.Size >= bytes) { continue; }
+
+			// Everything bound into the old block has to go with it
+			for (auto it = objects.begin(); it != objects.end();)
+			{
+				if (std::get<1>(it->first) == memoryTypeIndex)
+				{
+					destroyObject(it->second);
+					it = objects.erase(it);
+				}
+				else { ++it; }
+			}
+			if (block.Memory != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkFreeMemory(device, block.Memory, nullptr); }
+			block = Block();
+
+			VkMemoryAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocateInfo.pNext = nullptr;
+			allocateInfo.allocationSize = bytes;
+			allocateInfo.memoryTypeIndex = memoryTypeIndex;
+			const VkResult result = VulkanFunctionLoaders::vkAllocateMemory(device, &allocateInfo, nullptr, &block.Memory);
+			if (result != VK_SUCCESS)
+			{
+				LOG_ERROR("[FAIL] Could not allocate {} bytes of transient memory. VkResult is: {}", bytes, VulkanHelpers::getFriendlyResultString(result));
+				return false;
+			}
+			block.Size = bytes;
+			LOG_VERY_VERBOSE("[OK] Transient memory block for memory type {} is now {} bytes.", memoryTypeIndex, bytes);
+		}
+		return true;
+	}
+
+	// Method to get a buffer / image for `desc` bound at `offset` in the block for `memoryTypeIndex` (reusing one from an earlier frame
+	// if we can). Only one of `buffer` / `image` is set, depending on `desc.IsImage`.
+	bool acquire(const TransientDesc& desc, uint32_t memoryTypeIndex, VkDeviceSize offset, VkBuffer& buffer, VkImage& image)
+	{
+		const ObjectKey key(desc, memoryTypeIndex, offset);
+		auto found = objects.find(key);
+		if (found == objects.end())
+		{
+			Object object;
+			const VkDeviceMemory memory = blocks[memoryTypeIndex].Memory;
+			VkResult result = VK_ERROR_UNKNOWN;
+			if (desc.IsImage)
+			{
+				if (!createImage(desc, object.Image)) { return false; }
+				result = VulkanFunctionLoaders::vkBindImageMemory(device, object.Image, memory, offset);
+			}
+			else
+			{
+				if (!createBuffer(desc, object.Buffer)) { return false; }
+				result = VulkanFunctionLoaders::vkBindBufferMemory(device, object.Buffer, memory, offset);
+			}
+			if (result != VK_SUCCESS)
+			{
+				LOG_ERROR("[FAIL] Could not bind transient {} at offset {}. VkResult is: {}", desc.IsImage ? "image" : "buffer", offset, VulkanHelpers::getFriendlyResultString(result));
+				destroyObject(object);
+				return false;
+			}
+			found = objects.emplace(key, object).first;
+		}
+		found->second.UsedThisFrame = true;
+		buffer = found->second.Buffer;
+		image = found->second.Image;
+		return true;
+	}
+
+	// Total size of the blocks we're holding on to
+	VkDeviceSize getAllocatedBytes() const
+	{
+		VkDeviceSize total = 0;
+		for (const auto& [memoryTypeIndex, block] : blocks) { total += block.Size; }
+		return total;
+	}
+
+	// CAREFUL: Nothing on the GPU may still be using any of the pool's objects when we call this!
+	void destroy()
+	{
+		for (auto& [key, object] : objects) { destroyObject(object); }
+		objects.clear();
+		for (auto& [memoryTypeIndex, block] : blocks)
+		{
+			if (block.Memory != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkFreeMemory(device, block.Memory, nullptr); }
+		}
+		blocks.clear();
+		requirementsCache.clear();
+	}
+
+private:
+
+	struct CachedRequirements
+	{
+		VkMemoryRequirements Requirements = {};
+		uint32_t MemoryTypeIndex = UINT32_MAX;
+	};
+
+	struct Block
+	{
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+		VkDeviceSize Size = 0;
+	};
+
+	struct Object
+	{
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		VkImage Image = VK_NULL_HANDLE;
+		bool UsedThisFrame = false;
+	};
+
+	using ObjectKey = std::tuple<TransientDesc, uint32_t, VkDeviceSize>;
+
+	bool createBuffer(const TransientDesc& desc, VkBuffer& buffer) const
+	{
+		VkBufferCreateInfo bufferCreateInfo = {};
+		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferCreateInfo.pNext = nullptr;
+		bufferCreateInfo.flags = 0;
+		bufferCreateInfo.size = desc.Size;
+		bufferCreateInfo.usage = desc.BufferUsage;
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		bufferCreateInfo.queueFamilyIndexCount = 0;
+		bufferCreateInfo.pQueueFamilyIndices = nullptr;
+
+		const VkResult result = VulkanFunctionLoaders::vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create transient buffer. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		return true;
+	}
+
+	bool createImage(const TransientDesc& desc, VkImage& image) const
+	{
+		VkImageCreateInfo imageCreateInfo = {};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.pNext = nullptr;
+		imageCreateInfo.flags = 0;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = desc.Format;
+		imageCreateInfo.extent = { desc.Width, desc.Height, 1 };
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.samples = desc.Samples;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage = desc.ImageUsage;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.queueFamilyIndexCount = 0;
+		imageCreateInfo.pQueueFamilyIndices = nullptr;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		const VkResult result = VulkanFunctionLoaders::vkCreateImage(device, &imageCreateInfo, nullptr, &image);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Could not create transient {}x{} image. VkResult is: {}", desc.Width, desc.Height, VulkanHelpers::getFriendlyResultString(result));
+			return false;
+		}
+		return true;
+	}
+
+	void destroyObject(Object& object) const
+	{
+		if (object.Buffer != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkDestroyBuffer(device, object.Buffer, nullptr); }
+		if (object.Image != VK_NULL_HANDLE)  { VulkanFunctionLoaders::vkDestroyImage(device, object.Image, nullptr); }
+		object = Object();
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memProperties = {};
+	VkDeviceSize granularity = 1;
+	std::map<TransientDesc, CachedRequirements> requirementsCache;
+	std::map<uint32_t, Block> blocks; // One per memory type
+	std::map<ObjectKey, Object> objects;
+};
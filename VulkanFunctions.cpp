@@ -1,4 +1,13 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined __linux
+	#include <dlfcn.h> // For `dlopen`, `dlsym` and `dlclose`
+#endif
+
 #include "VulkanFunctions.h"
+#include "Logger.hpp"
 
 namespace VulkanFunctionLoaders
 {
@@ -16,4 +25,143 @@ namespace VulkanFunctionLoaders
 
 #include "ListOfVulkanFunctions.inl"
 
-} // End of namespace VulkanFunctionLoaders
\ No newline at end of file
+} // End of namespace VulkanFunctionLoaders
+
+// Method to connect to the Vulkan loader library
+bool ConnectWithVulkanLoaderLibrary(LIBRARY_TYPE& vulkan_library)
+{
+#if defined _WIN32
+	// IMPORTANT: Do not try to connect to the Vulkan DLL with: `LPCWSTR("vulkan-1.dll")` - this won't work! Instead have the type cast as `TEXT` as per below!
+	// Source: https://github.com/KhronosGroup/Vulkan-Hpp/issues/452	
+	vulkan_library = LoadLibrary(TEXT("vulkan-1.dll"));
+#elif defined __linux
+	vulkan_library = dlopen("libvulkan.so.1", RTLD_NOW);
+#endif
+
+	return vulkan_library != nullptr; // Returns false if the vulkan_library is null, true (i.e., success) otherwise
+}
+
+// Method to disconnect from the Vulkan loader library once we're finished with Vulkan entirely
+void DisconnectFromVulkanLoaderLibrary(LIBRARY_TYPE& vulkan_library)
+{
+	if (vulkan_library == nullptr) { return; }
+#if defined _WIN32
+	FreeLibrary(vulkan_library);
+#elif defined __linux
+	dlclose(vulkan_library);
+#endif
+	vulkan_library = nullptr;
+}
+
+// TODO: If we look at the Vulkan SDK `Templates` folder they use Vulkan.hpp rather than this, and I believe that will allow us to load functions without all the templating craziness. Check it out.
+
+// TODO: I fixed this templating stuff via the commend from `bodyaka` at:
+// https://stackoverflow.com/questions/63587107/undeclared-identifier-when-defining-macro-to-load-vulkan-function-pointers
+// Be sure to thank him & maybe link to this repo at some point.
+namespace VulkanFunctionLoaders
+{
+	bool LoadFunctionExportedFromVulkanLoaderLibrary(LIBRARY_TYPE const& vulkan_library)
+	{
+
+#define EXPORTED_VULKAN_FUNCTION( name )                                         \
+VulkanFunctionLoaders::name = (PFN_##name)LoadFunction( vulkan_library, #name ); \
+if( VulkanFunctionLoaders::name == nullptr ) {                                   \
+  LOG_ERROR("Could not load exported Vulkan function named: {}", #name);         \
+  return false;                                                                  \
+}
+
+#include "ListOfVulkanFunctions.inl"
+
+		return true;
+	}
+
+	bool LoadVulkanGlobalFunctions()
+	{
+#define GLOBAL_LEVEL_VULKAN_FUNCTION( name )                \
+name = (PFN_##name)vkGetInstanceProcAddr( nullptr, #name ); \
+if (name == nullptr) {                                      \
+LOG_ERROR("Could not load global-level function named: {}", #name); \
+return false; \
+}
+#include "ListOfVulkanFunctions.inl"
+		return true;
+	}
+
+	bool IsExtensionSupported(std::vector<VkExtensionProperties> const& available_extensions, char const* const extension)
+	{
+		for (auto & available_extension : available_extensions)
+		{
+			if (strstr(available_extension.extensionName, extension)) {	return true; }
+		}
+		return false;
+	}
+
+	uint32_t GetInstanceApiVersion()
+	{
+		const auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+		uint32_t apiVersion = VK_API_VERSION_1_0;
+		if (enumerateInstanceVersion != nullptr && enumerateInstanceVersion(&apiVersion) != VK_SUCCESS) { apiVersion = VK_API_VERSION_1_0; }
+		return apiVersion;
+	}
+
+	// Method to load Vulkan instance-level functions for the provided instance
+	bool LoadInstanceLevelFunctions(VkInstance &vulkanInstance)
+	{
+#define INSTANCE_LEVEL_VULKAN_FUNCTION( name )                      \
+name = (PFN_##name)vkGetInstanceProcAddr( vulkanInstance, #name );  \
+if( name == nullptr ) {                                             \
+LOG_ERROR("Could not load instance-level Vulkan function named: {} for instance: {}", #name, vulkanInstance); \
+return false;                                                       \
+}
+#include "ListOfVulkanFunctions.inl"
+
+		return true;
+	}
+
+	// Method to load an instance-level function from a specific extension (which must be available and loaded)
+	bool LoadInstanceLevelFunctionFromExtension(VkInstance& vulkanInstance, std::vector<char const*> enabledExtensions)
+	{
+#define INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( name, extension )  \
+for (auto &enabledExtension : enabledExtensions) {                        \
+if (std::string(enabledExtension) == std::string(extension)) {            \
+name = (PFN_##name)vkGetInstanceProcAddr(vulkanInstance, #name);          \
+if (name == nullptr) {                                                    \
+LOG_ERROR("Could not load instance-level Vulkan function from EXTENSION named: {}", #name); \
+return false;                                                             \
+}                                                                         \
+}                                                                         \
+}
+#include "ListOfVulkanFunctions.inl"
+		return true;
+	}
+
+	// Method to load a device level function
+	bool LoadDeviceLevelFunction(VkDevice vulkanDevice, char const* name)
+	{
+#define DEVICE_LEVEL_VULKAN_FUNCTION( name )                                              \
+name = (PFN_##name)vkGetDeviceProcAddr( vulkanDevice, #name );                            \
+if( name == nullptr ) {                                                                   \
+LOG_ERROR("Could not load device-level Vulkan function named: {}", #name);                \
+			return false;                                                                 \
+}
+#include "ListOfVulkanFunctions.inl"
+	return true;
+	}
+
+	bool LoadDeviceLevelFunctionFromExtension(VkDevice logicalDevice, char const* name, std::vector<char const*> enabledExtensions)
+	{
+#define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( name,	extension)                                                    \
+		for (auto &enabledExtension : enabledExtensions) {			                                                      \
+				if (std::string(enabledExtension) == std::string(extension)) {		                                      \
+						name = (PFN_##name)vkGetDeviceProcAddr(logicalDevice, #name);                                     \
+						if (name == nullptr) {							                                                  \
+								LOG_ERROR("Could not load device-level Vulkan function named: {}", #name);                \
+								return false;                                                                             \
+						}                                                                                                 \
+				}                                                                                                         \
+		}
+#include "ListOfVulkanFunctions.inl"
+		return true;
+	}
+
+} // End of namespace VulkanFunctionLoaders
@@ -1,6 +1,21 @@
 #ifndef VULKAN_FUNCTIONS_H
 #define VULKAN_FUNCTIONS_H
 
+// Note: The platform surface define MUST be set before we include "vulkan.h" - and it must be the same in every translation unit
+// that includes this header, otherwise the platform-specific entries in `ListOfVulkanFunctions.inl` get declared in one place and
+// not defined in another (which shows up as a link error on Linux).
+#if defined _WIN32
+	#ifndef VK_USE_PLATFORM_WIN32_KHR
+		#define VK_USE_PLATFORM_WIN32_KHR 1
+	#endif
+#elif defined __linux
+	#ifndef VK_USE_PLATFORM_XCB_KHR
+		#define VK_USE_PLATFORM_XCB_KHR 1 // Don't use XLIB on Linux - it's legacy!
+	#endif
+#endif
+
+#include <vector>
+
 #include "vulkan.h"
 
 // Note: Always put declarations & definitions to Vulkan functions inside a namespace, as if they are global they can cause issues on some OSs.
@@ -28,4 +43,44 @@ namespace VulkanFunctionLoaders
 
 } // End of namespace VulkanFunctionLoaders
 
+// ----- Platform-specific Defines ------
+// Note: These are shared by everything that loads Vulkan itself - i.e., both `cpp_vulkan_basecode` and the benchmarks.
+
+// Vulkan library type
+#ifdef _WIN32
+	#define LIBRARY_TYPE HMODULE
+#elif defined __linux
+	#define LIBRARY_TYPE void*
+#endif
+
+// Vulkan function loader command
+#ifdef _WIN32
+	#define LoadFunction GetProcAddress
+#elif defined __linux
+	#define LoadFunction dlsym
+#endif
+
+// Methods to connect to / disconnect from the Vulkan loader library (i.e., `vulkan-1.dll` or `libvulkan.so.1`)
+bool ConnectWithVulkanLoaderLibrary(LIBRARY_TYPE& vulkan_library);
+void DisconnectFromVulkanLoaderLibrary(LIBRARY_TYPE& vulkan_library);
+
+namespace VulkanFunctionLoaders
+{
+	// Methods to load the functions listed in `ListOfVulkanFunctions.inl` - in this order, as each level is loaded through the level before it
+	bool LoadFunctionExportedFromVulkanLoaderLibrary(LIBRARY_TYPE const& vulkan_library);
+	bool LoadVulkanGlobalFunctions();
+	bool LoadInstanceLevelFunctions(VkInstance& vulkanInstance);
+	bool LoadInstanceLevelFunctionFromExtension(VkInstance& vulkanInstance, std::vector<char const*> enabledExtensions);
+	bool LoadDeviceLevelFunction(VkDevice vulkanDevice, char const* name);
+	bool LoadDeviceLevelFunctionFromExtension(VkDevice logicalDevice, char const* name, std::vector<char const*> enabledExtensions);
+
+	// Method to check whether `extension` is in a list of available extensions
+	bool IsExtensionSupported(std::vector<VkExtensionProperties> const& available_extensions, char const* const extension);
+
+	// Method to get the highest Vulkan version the loader can create an instance with (needs the global functions to be loaded first).
+	// Note: `vkEnumerateInstanceVersion` only exists from Vulkan 1.1 on - so a loader without it can only do 1.0.
+	uint32_t GetInstanceApiVersion();
+
+} // End of namespace VulkanFunctionLoaders
+
 #endif
\ No newline at end of file
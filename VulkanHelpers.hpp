@@ -7,15 +7,17 @@ using std::cout, std::endl, std::string;
 
 #include <vulkan_core.h>
 
+#include "Logger.hpp"
+
 class VulkanHelpers
 {
 public:
 
-	// Method to return a human-readable error message from a VkResult
+	// Method to return a human-readable error message from a VkResult. Returns a string literal, so logging it costs nothing but a pointer copy.
 	// See: https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkResult.html
-	static string getFriendlyResultString(VkResult result)
+	static const char* getFriendlyResultString(VkResult result)
 	{
-		string msg;
+		const char* msg;
 		switch (result)
 		{
 			// ----- Non-Errors -----
@@ -73,7 +75,7 @@ public:
 			// ----- Non-Errors with Duplicate Enums -----
 		case VK_PIPELINE_COMPILE_REQUIRED:            msg = "VK_PIPELINE_COMPILE_REQUIRED or (..._EXT) - same enum value."; break;
 
-		default: msg = "Unknown VkResult enum value - code is: " + result;
+		default: msg = "Unknown VkResult enum value";
 		}
 
 		return msg;
@@ -83,61 +85,61 @@ public:
 	// See: https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkPhysicalDeviceFeatures.html
 	static void printPhysicalDeviceFeatures(const VkPhysicalDeviceFeatures& features)
 	{
-		cout << "----- Physical Device Features (1 = available, 0 = unavailable) -----" << endl;
-		cout << "alphaToOne:                              " << features.alphaToOne << endl;
-		cout << "depthBiasClamp:                          " << features.depthBiasClamp << endl;
-		cout << "depthBounds:                             " << features.depthBounds << endl;
-		cout << "depthClamp:                              " << features.depthClamp << endl;
-		cout << "drawIndirectFirstInstance:               " << features.drawIndirectFirstInstance << endl;
-		cout << "dualSrcBlend:                            " << features.dualSrcBlend << endl;
-		cout << "fillModeNonSolid:                        " << features.fillModeNonSolid << endl;
-		cout << "fragmentStoresAndAtomics:                " << features.fragmentStoresAndAtomics << endl;
-		cout << "fullDrawIndexUint32:                     " << features.fullDrawIndexUint32 << endl;
-		cout << "geometryShader:                          " << features.geometryShader << endl;
-		cout << "imageCubeArray:                          " << features.imageCubeArray << endl;
-		cout << "independentBlend:                        " << features.independentBlend << endl;
-		cout << "inheritedQueries:                        " << features.inheritedQueries << endl;
-		cout << "largePoints:                             " << features.largePoints << endl;
-		cout << "logicOp:                                 " << features.logicOp << endl;
-		cout << "multiDrawIndirect:                       " << features.multiDrawIndirect << endl;
-		cout << "multiViewport:                           " << features.multiViewport << endl;
-		cout << "occlusionQueryPrecise:                   " << features.occlusionQueryPrecise << endl;
-		cout << "pipelineStatisticsQuery:                 " << features.pipelineStatisticsQuery << endl;
-		cout << "robustBufferAccess:                      " << features.robustBufferAccess << endl;
-		cout << "samplerAnisotropy:                       " << features.samplerAnisotropy << endl;
-		cout << "sampleRateShading:                       " << features.sampleRateShading << endl;
-		cout << "shaderClipDistance:                      " << features.shaderClipDistance << endl;
-		cout << "shaderCullDistance:                      " << features.shaderCullDistance << endl;
-		cout << "shaderFloat64:                           " << features.shaderFloat64 << endl;
-		cout << "shaderImageGatherExtended:               " << features.shaderImageGatherExtended << endl;
-		cout << "shaderInt16:                             " << features.shaderInt16 << endl;
-		cout << "shaderInt64:                             " << features.shaderInt64 << endl;
-		cout << "shaderResourceMinLod:                    " << features.shaderResourceMinLod << endl;
-		cout << "shaderResourceResidency:                 " << features.shaderResourceResidency << endl;
-		cout << "shaderSampledImageArrayDynamicIndexing:  " << features.shaderSampledImageArrayDynamicIndexing << endl;
-		cout << "shaderStorageBufferArrayDynamicIndexing: " << features.shaderStorageBufferArrayDynamicIndexing << endl;
-		cout << "shaderStorageImageExtendedFormats:       " << features.shaderStorageImageExtendedFormats << endl;
-		cout << "shaderStorageImageMultisample:           " << features.shaderStorageImageMultisample << endl;
-		cout << "shaderStorageImageReadWithoutFormat:     " << features.shaderStorageImageReadWithoutFormat << endl;
-		cout << "shaderStorageImageWriteWithoutFormat:    " << features.shaderStorageImageWriteWithoutFormat << endl;
-		cout << "shaderTessellationAndGeometryPointSize:  " << features.shaderTessellationAndGeometryPointSize << endl;
-		cout << "shaderUniformBufferArrayDynamicIndexing: " << features.shaderUniformBufferArrayDynamicIndexing << endl;
-		cout << "sparseBinding:                           " << features.sparseBinding << endl;
-		cout << "sparseResidency16Samples:                " << features.sparseResidency16Samples << endl;
-		cout << "sparseResidency2Samples:                 " << features.sparseResidency2Samples << endl;
-		cout << "sparseResidency4Samples:                 " << features.sparseResidency4Samples << endl;
-		cout << "sparseResidency8Samples:                 " << features.sparseResidency8Samples << endl;
-		cout << "sparseResidencyAliased:                  " << features.sparseResidencyAliased << endl;
-		cout << "sparseResidencyBuffer:                   " << features.sparseResidencyBuffer << endl;
-		cout << "sparseResidencyImage2D:                  " << features.sparseResidencyImage2D << endl;
-		cout << "sparseResidencyImage3D:                  " << features.sparseResidencyImage3D << endl;
-		cout << "tessellationShader:                      " << features.tessellationShader << endl;
-		cout << "textureCompressionASTC_LDR:              " << features.textureCompressionASTC_LDR << endl;
-		cout << "textureCompressionBC:                    " << features.textureCompressionBC << endl;
-		cout << "textureCompressionETC2:                  " << features.textureCompressionETC2 << endl;
-		cout << "variableMultisampleRate:                 " << features.variableMultisampleRate << endl;
-		cout << "vertexPipelineStoresAndAtomics:          " << features.vertexPipelineStoresAndAtomics << endl;
-		cout << "wideLines:                               " << features.wideLines << endl;
+		LOG_INFO("----- Physical Device Features (1 = available, 0 = unavailable) -----");
+		LOG_INFO("alphaToOne:                              {}", features.alphaToOne);
+		LOG_INFO("depthBiasClamp:                          {}", features.depthBiasClamp);
+		LOG_INFO("depthBounds:                             {}", features.depthBounds);
+		LOG_INFO("depthClamp:                              {}", features.depthClamp);
+		LOG_INFO("drawIndirectFirstInstance:               {}", features.drawIndirectFirstInstance);
+		LOG_INFO("dualSrcBlend:                            {}", features.dualSrcBlend);
+		LOG_INFO("fillModeNonSolid:                        {}", features.fillModeNonSolid);
+		LOG_INFO("fragmentStoresAndAtomics:                {}", features.fragmentStoresAndAtomics);
+		LOG_INFO("fullDrawIndexUint32:                     {}", features.fullDrawIndexUint32);
+		LOG_INFO("geometryShader:                          {}", features.geometryShader);
+		LOG_INFO("imageCubeArray:                          {}", features.imageCubeArray);
+		LOG_INFO("independentBlend:                        {}", features.independentBlend);
+		LOG_INFO("inheritedQueries:                        {}", features.inheritedQueries);
+		LOG_INFO("largePoints:                             {}", features.largePoints);
+		LOG_INFO("logicOp:                                 {}", features.logicOp);
+		LOG_INFO("multiDrawIndirect:                       {}", features.multiDrawIndirect);
+		LOG_INFO("multiViewport:                           {}", features.multiViewport);
+		LOG_INFO("occlusionQueryPrecise:                   {}", features.occlusionQueryPrecise);
+		LOG_INFO("pipelineStatisticsQuery:                 {}", features.pipelineStatisticsQuery);
+		LOG_INFO("robustBufferAccess:                      {}", features.robustBufferAccess);
+		LOG_INFO("samplerAnisotropy:                       {}", features.samplerAnisotropy);
+		LOG_INFO("sampleRateShading:                       {}", features.sampleRateShading);
+		LOG_INFO("shaderClipDistance:                      {}", features.shaderClipDistance);
+		LOG_INFO("shaderCullDistance:                      {}", features.shaderCullDistance);
+		LOG_INFO("shaderFloat64:                           {}", features.shaderFloat64);
+		LOG_INFO("shaderImageGatherExtended:               {}", features.shaderImageGatherExtended);
+		LOG_INFO("shaderInt16:                             {}", features.shaderInt16);
+		LOG_INFO("shaderInt64:                             {}", features.shaderInt64);
+		LOG_INFO("shaderResourceMinLod:                    {}", features.shaderResourceMinLod);
+		LOG_INFO("shaderResourceResidency:                 {}", features.shaderResourceResidency);
+		LOG_INFO("shaderSampledImageArrayDynamicIndexing:  {}", features.shaderSampledImageArrayDynamicIndexing);
+		LOG_INFO("shaderStorageBufferArrayDynamicIndexing: {}", features.shaderStorageBufferArrayDynamicIndexing);
+		LOG_INFO("shaderStorageImageExtendedFormats:       {}", features.shaderStorageImageExtendedFormats);
+		LOG_INFO("shaderStorageImageMultisample:           {}", features.shaderStorageImageMultisample);
+		LOG_INFO("shaderStorageImageReadWithoutFormat:     {}", features.shaderStorageImageReadWithoutFormat);
+		LOG_INFO("shaderStorageImageWriteWithoutFormat:    {}", features.shaderStorageImageWriteWithoutFormat);
+		LOG_INFO("shaderTessellationAndGeometryPointSize:  {}", features.shaderTessellationAndGeometryPointSize);
+		LOG_INFO("shaderUniformBufferArrayDynamicIndexing: {}", features.shaderUniformBufferArrayDynamicIndexing);
+		LOG_INFO("sparseBinding:                           {}", features.sparseBinding);
+		LOG_INFO("sparseResidency16Samples:                {}", features.sparseResidency16Samples);
+		LOG_INFO("sparseResidency2Samples:                 {}", features.sparseResidency2Samples);
+		LOG_INFO("sparseResidency4Samples:                 {}", features.sparseResidency4Samples);
+		LOG_INFO("sparseResidency8Samples:                 {}", features.sparseResidency8Samples);
+		LOG_INFO("sparseResidencyAliased:                  {}", features.sparseResidencyAliased);
+		LOG_INFO("sparseResidencyBuffer:                   {}", features.sparseResidencyBuffer);
+		LOG_INFO("sparseResidencyImage2D:                  {}", features.sparseResidencyImage2D);
+		LOG_INFO("sparseResidencyImage3D:                  {}", features.sparseResidencyImage3D);
+		LOG_INFO("tessellationShader:                      {}", features.tessellationShader);
+		LOG_INFO("textureCompressionASTC_LDR:              {}", features.textureCompressionASTC_LDR);
+		LOG_INFO("textureCompressionBC:                    {}", features.textureCompressionBC);
+		LOG_INFO("textureCompressionETC2:                  {}", features.textureCompressionETC2);
+		LOG_INFO("variableMultisampleRate:                 {}", features.variableMultisampleRate);
+		LOG_INFO("vertexPipelineStoresAndAtomics:          {}", features.vertexPipelineStoresAndAtomics);
+		LOG_INFO("wideLines:                               {}", features.wideLines);
 	}
 
 	// Method to print out Vulkan physical device features.
@@ -149,153 +151,142 @@ public:
 	{
 		// Create a human-readable device-type string from the device-type enum
 		const VkPhysicalDeviceType deviceType = properties.deviceType;
-		std::string deviceTypeString;
+		const char* deviceTypeString;
 		switch (deviceType)
 		{
-		case 0:
-			deviceTypeString = "VK_PHYSICAL_DEVICE_TYPE_OTHER";
-			break;
-		case 1:
-			deviceTypeString = "VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU";
-			break;
-		case 2:
-			deviceTypeString = "VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU";
-			break;
-		case 3:
-			deviceTypeString = "VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU";
-			break;
-		case 4:
-			deviceTypeString = "VK_PHYSICAL_DEVICE_TYPE_CPU";
-			break;
-		default:
-			deviceTypeString = "Unknown VkPhysicalDeviceType enum: " + deviceType;
+		case VK_PHYSICAL_DEVICE_TYPE_OTHER:          deviceTypeString = "VK_PHYSICAL_DEVICE_TYPE_OTHER";          break;
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: deviceTypeString = "VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU"; break;
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   deviceTypeString = "VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU";   break;
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    deviceTypeString = "VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU";    break;
+		case VK_PHYSICAL_DEVICE_TYPE_CPU:            deviceTypeString = "VK_PHYSICAL_DEVICE_TYPE_CPU";            break;
+		default:                                     deviceTypeString = "Unknown VkPhysicalDeviceType enum";
 		}
 
-		cout << "----- Physical Device Properties -----" << endl;
-		cout << "apiVersion:        " << properties.apiVersion << endl;
-		cout << "driverVersion:     " << properties.driverVersion << endl;
-		cout << "vendorID:          " << properties.vendorID << endl;
-		cout << "deviceID:          " << properties.deviceID << endl;
-		cout << "deviceType:        " << deviceTypeString << endl;
-		cout << "deviceName:        " << properties.deviceName << endl;
-		cout << "pipelineCacheUUID: Non-print-friendly uint8_t[VK_UUID_SIZE] - use directly" << endl;
+		LOG_INFO("----- Physical Device Properties -----");
+		LOG_INFO("apiVersion:        {}", properties.apiVersion);
+		LOG_INFO("driverVersion:     {}", properties.driverVersion);
+		LOG_INFO("vendorID:          {}", properties.vendorID);
+		LOG_INFO("deviceID:          {}", properties.deviceID);
+		LOG_INFO("deviceType:        {} ({})", deviceTypeString, deviceType);
+		LOG_INFO("deviceName:        {}", properties.deviceName);
+		LOG_INFO("pipelineCacheUUID: Non-print-friendly uint8_t[VK_UUID_SIZE] - use directly");
 
 		const VkPhysicalDeviceSparseProperties sparseProperties = properties.sparseProperties;
-		cout << "--- Sparse Properties ---" << endl;
-		cout << "residencyStandard2DBlockShape:            " << sparseProperties.residencyStandard2DBlockShape << endl;
-		cout << "residencyStandard2DMultisampleBlockShape: " << sparseProperties.residencyStandard2DMultisampleBlockShape << endl;
-		cout << "residencyStandard3DBlockShape             " << sparseProperties.residencyStandard3DBlockShape << endl;
-		cout << "residencyAlignedMipSize                   " << sparseProperties.residencyAlignedMipSize << endl;
-		cout << "residencyNonResidentStrict                " << sparseProperties.residencyNonResidentStrict << endl;
+		LOG_INFO("--- Sparse Properties ---");
+		LOG_INFO("residencyStandard2DBlockShape:            {}", sparseProperties.residencyStandard2DBlockShape);
+		LOG_INFO("residencyStandard2DMultisampleBlockShape: {}", sparseProperties.residencyStandard2DMultisampleBlockShape);
+		LOG_INFO("residencyStandard3DBlockShape             {}", sparseProperties.residencyStandard3DBlockShape);
+		LOG_INFO("residencyAlignedMipSize                   {}", sparseProperties.residencyAlignedMipSize);
+		LOG_INFO("residencyNonResidentStrict                {}", sparseProperties.residencyNonResidentStrict);
 
 		const VkPhysicalDeviceLimits limits = properties.limits;
-		cout << "--- Limits ---" << endl;
-		cout << "bufferImageGranularity:                          " << limits.bufferImageGranularity << endl;
-		cout << "discreteQueuePriorities:                         " << limits.discreteQueuePriorities << endl;
-		cout << "framebufferColorSampleCounts:                    " << limits.framebufferColorSampleCounts << endl;
-		cout << "framebufferDepthSampleCounts:                    " << limits.framebufferDepthSampleCounts << endl;
-		cout << "framebufferNoAttachmentsSampleCounts:            " << limits.framebufferNoAttachmentsSampleCounts << endl;
-		cout << "framebufferStencilSampleCounts:                  " << limits.framebufferStencilSampleCounts << endl;
-		cout << "lineWidthGranularity:                            " << limits.lineWidthGranularity << endl;
-		cout << "lineWidthRange - Min:                            " << limits.lineWidthRange[0] << ", Max: " << limits.lineWidthRange[1] << endl;
-		cout << "maxBoundDescriptorSets:                          " << limits.maxBoundDescriptorSets << endl;
-		cout << "maxClipDistances:                                " << limits.maxClipDistances << endl;
-		cout << "maxColorAttachments:                             " << limits.maxColorAttachments << endl;
-		cout << "maxCombinedClipAndCullDistances:                 " << limits.maxCombinedClipAndCullDistances << endl;
-		cout << "maxComputeSharedMemorySize:                      " << limits.maxComputeSharedMemorySize << endl;
-		cout << "maxComputeWorkGroupCount                      X: " << limits.maxComputeWorkGroupCount[0] << ", Y: " << limits.maxComputeWorkGroupCount[1] << ", Z: " << limits.maxComputeWorkGroupCount[2] << endl;
-		cout << "maxComputeWorkGroupInvocations:                  " << limits.maxComputeWorkGroupInvocations << endl;
-		cout << "maxComputeWorkGroupSize                       X: " << limits.maxComputeWorkGroupSize[0] << ", Y: " << limits.maxComputeWorkGroupSize[1] << ", Z: " << limits.maxComputeWorkGroupSize[2] << endl;
-		cout << "maxCullDistances:                                " << limits.maxCullDistances << endl;
-		cout << "maxDescriptorSetInputAttachments:                " << limits.maxDescriptorSetInputAttachments << endl;
-		cout << "maxDescriptorSetSampledImages:                   " << limits.maxDescriptorSetSampledImages << endl;
-		cout << "maxDescriptorSetSamplers:                        " << limits.maxDescriptorSetSamplers << endl;
-		cout << "maxDescriptorSetStorageBuffers:                  " << limits.maxDescriptorSetStorageBuffers << endl;
-		cout << "maxDescriptorSetStorageBuffersDynamic:           " << limits.maxDescriptorSetStorageBuffersDynamic << endl;
-		cout << "maxDescriptorSetStorageImages:                   " << limits.maxDescriptorSetStorageImages << endl;
-		cout << "maxDescriptorSetUniformBuffers:                  " << limits.maxDescriptorSetUniformBuffers << endl;
-		cout << "maxDescriptorSetUniformBuffersDynamic:           " << limits.maxDescriptorSetUniformBuffersDynamic << endl;
-		cout << "maxDrawIndexedIndexValue:                        " << limits.maxDrawIndexedIndexValue << endl;
-		cout << "maxDrawIndirectCount:                            " << limits.maxDrawIndirectCount << endl;
-		cout << "maxFragmentCombinedOutputResources:              " << limits.maxFragmentCombinedOutputResources << endl;
-		cout << "maxFragmentDualSrcAttachments:                   " << limits.maxFragmentDualSrcAttachments << endl;
-		cout << "maxFragmentInputComponents:                      " << limits.maxFragmentInputComponents << endl;
-		cout << "maxFragmentOutputAttachments:                    " << limits.maxFragmentOutputAttachments << endl;
-		cout << "maxFramebufferHeight:                            " << limits.maxFramebufferHeight << endl;
-		cout << "maxFramebufferLayers:                            " << limits.maxFramebufferLayers << endl;
-		cout << "maxFramebufferWidth:                             " << limits.maxFramebufferWidth << endl;
-		cout << "maxGeometryInputComponents:                      " << limits.maxGeometryInputComponents << endl;
-		cout << "maxGeometryOutputComponents:                     " << limits.maxGeometryOutputComponents << endl;
-		cout << "maxGeometryOutputVertices:                       " << limits.maxGeometryOutputVertices << endl;
-		cout << "maxGeometryShaderInvocations:                    " << limits.maxGeometryShaderInvocations << endl;
-		cout << "maxGeometryTotalOutputComponents:                " << limits.maxGeometryTotalOutputComponents << endl;
-		cout << "maxImageArrayLayers:                             " << limits.maxImageArrayLayers << endl;
-		cout << "maxImageDimension1D:                             " << limits.maxImageDimension1D << endl;
-		cout << "maxImageDimension2D:                             " << limits.maxImageDimension2D << endl;
-		cout << "maxImageDimension3D:                             " << limits.maxImageDimension3D << endl;
-		cout << "maxImageDimensionCube:                           " << limits.maxImageDimensionCube << endl;
-		cout << "maxInterpolationOffset:                          " << limits.maxInterpolationOffset << endl;
-		cout << "maxMemoryAllocationCount:                        " << limits.maxMemoryAllocationCount << endl;
-		cout << "maxPerStageDescriptorInputAttachments:           " << limits.maxPerStageDescriptorInputAttachments << endl;
-		cout << "maxPerStageDescriptorSampledImages:              " << limits.maxPerStageDescriptorSampledImages << endl;
-		cout << "maxPerStageDescriptorSamplers:                   " << limits.maxPerStageDescriptorSamplers << endl;
-		cout << "maxPerStageDescriptorStorageBuffers:             " << limits.maxPerStageDescriptorStorageBuffers << endl;
-		cout << "maxPerStageDescriptorStorageImages:              " << limits.maxPerStageDescriptorStorageImages << endl;
-		cout << "maxPerStageDescriptorUniformBuffers:             " << limits.maxPerStageDescriptorUniformBuffers << endl;
-		cout << "maxPerStageResources:                            " << limits.maxPerStageResources << endl;
-		cout << "maxPushConstantsSize:                            " << limits.maxPushConstantsSize << endl;
-		cout << "maxSampleMaskWords:                              " << limits.maxSampleMaskWords << endl;
-		cout << "maxSamplerAllocationCount:                       " << limits.maxSamplerAllocationCount << endl;
-		cout << "maxSamplerAnisotropy:                            " << limits.maxSamplerAnisotropy << endl;
-		cout << "maxSamplerLodBias:                               " << limits.maxSamplerLodBias << endl;
-		cout << "maxStorageBufferRange:                           " << limits.maxStorageBufferRange << endl;
-		cout << "maxTessellationControlPerPatchOutputComponents:  " << limits.maxTessellationControlPerPatchOutputComponents << endl;
-		cout << "maxTessellationControlPerVertexInputComponents:  " << limits.maxTessellationControlPerVertexInputComponents << endl;
-		cout << "maxTessellationControlPerVertexOutputComponents: " << limits.maxTessellationControlPerVertexOutputComponents << endl;
-		cout << "maxTessellationControlTotalOutputComponents:     " << limits.maxTessellationControlTotalOutputComponents << endl;
-		cout << "maxTessellationEvaluationInputComponents:        " << limits.maxTessellationEvaluationInputComponents << endl;
-		cout << "maxTessellationEvaluationOutputComponents:       " << limits.maxTessellationEvaluationOutputComponents << endl;
-		cout << "maxTessellationGenerationLevel:                  " << limits.maxTessellationGenerationLevel << endl;
-		cout << "maxTessellationPatchSize:                        " << limits.maxTessellationPatchSize << endl;
-		cout << "maxTexelBufferElements:                          " << limits.maxTexelBufferElements << endl;
-		cout << "maxTexelGatherOffset:                            " << limits.maxTexelGatherOffset << endl;
-		cout << "maxTexelOffset:                                  " << limits.maxTexelOffset << endl;
-		cout << "maxUniformBufferRange:                           " << limits.maxUniformBufferRange << endl;
-		cout << "maxVertexInputAttributeOffset:                   " << limits.maxVertexInputAttributeOffset << endl;
-		cout << "maxVertexInputAttributes:                        " << limits.maxVertexInputAttributes << endl;
-		cout << "maxVertexInputBindings:                          " << limits.maxVertexInputBindings << endl;
-		cout << "maxVertexInputBindingStride:                     " << limits.maxVertexInputBindingStride << endl;
-		cout << "maxVertexOutputComponents:                       " << limits.maxVertexOutputComponents << endl;
-		cout << "maxViewportDimensions                         X: " << limits.maxViewportDimensions[0] << ", Y: " << limits.maxViewportDimensions[1] << endl;
-		cout << "maxViewports:                                    " << limits.maxViewports << endl;
-		cout << "minInterpolationOffset:                          " << limits.minInterpolationOffset << endl;
-		cout << "minMemoryMapAlignment:                           " << limits.minMemoryMapAlignment << endl;
-		cout << "minStorageBufferOffsetAlignment:                 " << limits.minStorageBufferOffsetAlignment << endl;
-		cout << "minTexelBufferOffsetAlignment:                   " << limits.minTexelBufferOffsetAlignment << endl;
-		cout << "minTexelGatherOffset:                            " << limits.minTexelGatherOffset << endl;
-		cout << "minTexelOffset:                                  " << limits.minTexelOffset << endl;
-		cout << "minUniformBufferOffsetAlignment:                 " << limits.minUniformBufferOffsetAlignment << endl;
-		cout << "mipmapPrecisionBits:                             " << limits.mipmapPrecisionBits << endl;
-		cout << "nonCoherentAtomSize:                             " << limits.nonCoherentAtomSize << endl;
-		cout << "optimalBufferCopyOffsetAlignment:                " << limits.optimalBufferCopyOffsetAlignment << endl;
-		cout << "optimalBufferCopyRowPitchAlignment:              " << limits.optimalBufferCopyRowPitchAlignment << endl;
-		cout << "pointSizeGranularity:                            " << limits.pointSizeGranularity << endl;
-		cout << "pointSizeRange                              Min: " << limits.pointSizeRange[0] << ", Max: " << limits.pointSizeRange[1] << endl;
-		cout << "sampledImageColorSampleCounts:                   " << limits.sampledImageColorSampleCounts << endl;
-		cout << "sampledImageDepthSampleCounts:                   " << limits.sampledImageDepthSampleCounts << endl;
-		cout << "sampledImageIntegerSampleCounts:                 " << limits.sampledImageIntegerSampleCounts << endl;
-		cout << "sampledImageStencilSampleCounts:                 " << limits.sampledImageStencilSampleCounts << endl;
-		cout << "sparseAddressSpaceSize:                          " << limits.sparseAddressSpaceSize << endl;
-		cout << "standardSampleLocations:                         " << limits.standardSampleLocations << endl;
-		cout << "storageImageSampleCounts:                        " << limits.storageImageSampleCounts << endl;
-		cout << "strictLines:                                     " << limits.strictLines << endl;
-		cout << "subPixelInterpolationOffsetBits:                 " << limits.subPixelInterpolationOffsetBits << endl;
-		cout << "subPixelPrecisionBits:                           " << limits.subPixelPrecisionBits << endl;
-		cout << "subTexelPrecisionBits:                           " << limits.subTexelPrecisionBits << endl;
-		cout << "timestampComputeAndGraphics:                     " << limits.timestampComputeAndGraphics << endl;
-		cout << "timestampPeriod:                                 " << limits.timestampPeriod << endl;
-		cout << "viewportBoundsRange                         Min: " << limits.viewportBoundsRange[0] << ", Max: " << limits.viewportBoundsRange[1] << endl;
-		cout << "viewportSubPixelBits:                            " << limits.viewportSubPixelBits << endl;
+		LOG_INFO("--- Limits ---");
+		LOG_INFO("bufferImageGranularity:                          {}", limits.bufferImageGranularity);
+		LOG_INFO("discreteQueuePriorities:                         {}", limits.discreteQueuePriorities);
+		LOG_INFO("framebufferColorSampleCounts:                    {}", limits.framebufferColorSampleCounts);
+		LOG_INFO("framebufferDepthSampleCounts:                    {}", limits.framebufferDepthSampleCounts);
+		LOG_INFO("framebufferNoAttachmentsSampleCounts:            {}", limits.framebufferNoAttachmentsSampleCounts);
+		LOG_INFO("framebufferStencilSampleCounts:                  {}", limits.framebufferStencilSampleCounts);
+		LOG_INFO("lineWidthGranularity:                            {}", limits.lineWidthGranularity);
+		LOG_INFO("lineWidthRange - Min:                            {}, Max: {}", limits.lineWidthRange[0], limits.lineWidthRange[1]);
+		LOG_INFO("maxBoundDescriptorSets:                          {}", limits.maxBoundDescriptorSets);
+		LOG_INFO("maxClipDistances:                                {}", limits.maxClipDistances);
+		LOG_INFO("maxColorAttachments:                             {}", limits.maxColorAttachments);
+		LOG_INFO("maxCombinedClipAndCullDistances:                 {}", limits.maxCombinedClipAndCullDistances);
+		LOG_INFO("maxComputeSharedMemorySize:                      {}", limits.maxComputeSharedMemorySize);
+		LOG_INFO("maxComputeWorkGroupCount                      X: {}, Y: {}, Z: {}", limits.maxComputeWorkGroupCount[0], limits.maxComputeWorkGroupCount[1], limits.maxComputeWorkGroupCount[2]);
+		LOG_INFO("maxComputeWorkGroupInvocations:                  {}", limits.maxComputeWorkGroupInvocations);
+		LOG_INFO("maxComputeWorkGroupSize                       X: {}, Y: {}, Z: {}", limits.maxComputeWorkGroupSize[0], limits.maxComputeWorkGroupSize[1], limits.maxComputeWorkGroupSize[2]);
+		LOG_INFO("maxCullDistances:                                {}", limits.maxCullDistances);
+		LOG_INFO("maxDescriptorSetInputAttachments:                {}", limits.maxDescriptorSetInputAttachments);
+		LOG_INFO("maxDescriptorSetSampledImages:                   {}", limits.maxDescriptorSetSampledImages);
+		LOG_INFO("maxDescriptorSetSamplers:                        {}", limits.maxDescriptorSetSamplers);
+		LOG_INFO("maxDescriptorSetStorageBuffers:                  {}", limits.maxDescriptorSetStorageBuffers);
+		LOG_INFO("maxDescriptorSetStorageBuffersDynamic:           {}", limits.maxDescriptorSetStorageBuffersDynamic);
+		LOG_INFO("maxDescriptorSetStorageImages:                   {}", limits.maxDescriptorSetStorageImages);
+		LOG_INFO("maxDescriptorSetUniformBuffers:                  {}", limits.maxDescriptorSetUniformBuffers);
+		LOG_INFO("maxDescriptorSetUniformBuffersDynamic:           {}", limits.maxDescriptorSetUniformBuffersDynamic);
+		LOG_INFO("maxDrawIndexedIndexValue:                        {}", limits.maxDrawIndexedIndexValue);
+		LOG_INFO("maxDrawIndirectCount:                            {}", limits.maxDrawIndirectCount);
+		LOG_INFO("maxFragmentCombinedOutputResources:              {}", limits.maxFragmentCombinedOutputResources);
+		LOG_INFO("maxFragmentDualSrcAttachments:                   {}", limits.maxFragmentDualSrcAttachments);
+		LOG_INFO("maxFragmentInputComponents:                      {}", limits.maxFragmentInputComponents);
+		LOG_INFO("maxFragmentOutputAttachments:                    {}", limits.maxFragmentOutputAttachments);
+		LOG_INFO("maxFramebufferHeight:                            {}", limits.maxFramebufferHeight);
+		LOG_INFO("maxFramebufferLayers:                            {}", limits.maxFramebufferLayers);
+		LOG_INFO("maxFramebufferWidth:                             {}", limits.maxFramebufferWidth);
+		LOG_INFO("maxGeometryInputComponents:                      {}", limits.maxGeometryInputComponents);
+		LOG_INFO("maxGeometryOutputComponents:                     {}", limits.maxGeometryOutputComponents);
+		LOG_INFO("maxGeometryOutputVertices:                       {}", limits.maxGeometryOutputVertices);
+		LOG_INFO("maxGeometryShaderInvocations:                    {}", limits.maxGeometryShaderInvocations);
+		LOG_INFO("maxGeometryTotalOutputComponents:                {}", limits.maxGeometryTotalOutputComponents);
+		LOG_INFO("maxImageArrayLayers:                             {}", limits.maxImageArrayLayers);
+		LOG_INFO("maxImageDimension1D:                             {}", limits.maxImageDimension1D);
+		LOG_INFO("maxImageDimension2D:                             {}", limits.maxImageDimension2D);
+		LOG_INFO("maxImageDimension3D:                             {}", limits.maxImageDimension3D);
+		LOG_INFO("maxImageDimensionCube:                           {}", limits.maxImageDimensionCube);
+		LOG_INFO("maxInterpolationOffset:                          {}", limits.maxInterpolationOffset);
+		LOG_INFO("maxMemoryAllocationCount:                        {}", limits.maxMemoryAllocationCount);
+		LOG_INFO("maxPerStageDescriptorInputAttachments:           {}", limits.maxPerStageDescriptorInputAttachments);
+		LOG_INFO("maxPerStageDescriptorSampledImages:              {}", limits.maxPerStageDescriptorSampledImages);
+		LOG_INFO("maxPerStageDescriptorSamplers:                   {}", limits.maxPerStageDescriptorSamplers);
+		LOG_INFO("maxPerStageDescriptorStorageBuffers:             {}", limits.maxPerStageDescriptorStorageBuffers);
+		LOG_INFO("maxPerStageDescriptorStorageImages:              {}", limits.maxPerStageDescriptorStorageImages);
+		LOG_INFO("maxPerStageDescriptorUniformBuffers:             {}", limits.maxPerStageDescriptorUniformBuffers);
+		LOG_INFO("maxPerStageResources:                            {}", limits.maxPerStageResources);
+		LOG_INFO("maxPushConstantsSize:                            {}", limits.maxPushConstantsSize);
+		LOG_INFO("maxSampleMaskWords:                              {}", limits.maxSampleMaskWords);
+		LOG_INFO("maxSamplerAllocationCount:                       {}", limits.maxSamplerAllocationCount);
+		LOG_INFO("maxSamplerAnisotropy:                            {}", limits.maxSamplerAnisotropy);
+		LOG_INFO("maxSamplerLodBias:                               {}", limits.maxSamplerLodBias);
+		LOG_INFO("maxStorageBufferRange:                           {}", limits.maxStorageBufferRange);
+		LOG_INFO("maxTessellationControlPerPatchOutputComponents:  {}", limits.maxTessellationControlPerPatchOutputComponents);
+		LOG_INFO("maxTessellationControlPerVertexInputComponents:  {}", limits.maxTessellationControlPerVertexInputComponents);
+		LOG_INFO("maxTessellationControlPerVertexOutputComponents: {}", limits.maxTessellationControlPerVertexOutputComponents);
+		LOG_INFO("maxTessellationControlTotalOutputComponents:     {}", limits.maxTessellationControlTotalOutputComponents);
+		LOG_INFO("maxTessellationEvaluationInputComponents:        {}", limits.maxTessellationEvaluationInputComponents);
+		LOG_INFO("maxTessellationEvaluationOutputComponents:       {}", limits.maxTessellationEvaluationOutputComponents);
+		LOG_INFO("maxTessellationGenerationLevel:                  {}", limits.maxTessellationGenerationLevel);
+		LOG_INFO("maxTessellationPatchSize:                        {}", limits.maxTessellationPatchSize);
+		LOG_INFO("maxTexelBufferElements:                          {}", limits.maxTexelBufferElements);
+		LOG_INFO("maxTexelGatherOffset:                            {}", limits.maxTexelGatherOffset);
+		LOG_INFO("maxTexelOffset:                                  {}", limits.maxTexelOffset);
+		LOG_INFO("maxUniformBufferRange:                           {}", limits.maxUniformBufferRange);
+		LOG_INFO("maxVertexInputAttributeOffset:                   {}", limits.maxVertexInputAttributeOffset);
+		LOG_INFO("maxVertexInputAttributes:                        {}", limits.maxVertexInputAttributes);
+		LOG_INFO("maxVertexInputBindings:                          {}", limits.maxVertexInputBindings);
+		LOG_INFO("maxVertexInputBindingStride:                     {}", limits.maxVertexInputBindingStride);
+		LOG_INFO("maxVertexOutputComponents:                       {}", limits.maxVertexOutputComponents);
+		LOG_INFO("maxViewportDimensions                         X: {}, Y: {}", limits.maxViewportDimensions[0], limits.maxViewportDimensions[1]);
+		LOG_INFO("maxViewports:                                    {}", limits.maxViewports);
+		LOG_INFO("minInterpolationOffset:                          {}", limits.minInterpolationOffset);
+		LOG_INFO("minMemoryMapAlignment:                           {}", limits.minMemoryMapAlignment);
+		LOG_INFO("minStorageBufferOffsetAlignment:                 {}", limits.minStorageBufferOffsetAlignment);
+		LOG_INFO("minTexelBufferOffsetAlignment:                   {}", limits.minTexelBufferOffsetAlignment);
+		LOG_INFO("minTexelGatherOffset:                            {}", limits.minTexelGatherOffset);
+		LOG_INFO("minTexelOffset:                                  {}", limits.minTexelOffset);
+		LOG_INFO("minUniformBufferOffsetAlignment:                 {}", limits.minUniformBufferOffsetAlignment);
+		LOG_INFO("mipmapPrecisionBits:                             {}", limits.mipmapPrecisionBits);
+		LOG_INFO("nonCoherentAtomSize:                             {}", limits.nonCoherentAtomSize);
+		LOG_INFO("optimalBufferCopyOffsetAlignment:                {}", limits.optimalBufferCopyOffsetAlignment);
+		LOG_INFO("optimalBufferCopyRowPitchAlignment:              {}", limits.optimalBufferCopyRowPitchAlignment);
+		LOG_INFO("pointSizeGranularity:                            {}", limits.pointSizeGranularity);
+		LOG_INFO("pointSizeRange                              Min: {}, Max: {}", limits.pointSizeRange[0], limits.pointSizeRange[1]);
+		LOG_INFO("sampledImageColorSampleCounts:                   {}", limits.sampledImageColorSampleCounts);
+		LOG_INFO("sampledImageDepthSampleCounts:                   {}", limits.sampledImageDepthSampleCounts);
+		LOG_INFO("sampledImageIntegerSampleCounts:                 {}", limits.sampledImageIntegerSampleCounts);
+		LOG_INFO("sampledImageStencilSampleCounts:                 {}", limits.sampledImageStencilSampleCounts);
+		LOG_INFO("sparseAddressSpaceSize:                          {}", limits.sparseAddressSpaceSize);
+		LOG_INFO("standardSampleLocations:                         {}", limits.standardSampleLocations);
+		LOG_INFO("storageImageSampleCounts:                        {}", limits.storageImageSampleCounts);
+		LOG_INFO("strictLines:                                     {}", limits.strictLines);
+		LOG_INFO("subPixelInterpolationOffsetBits:                 {}", limits.subPixelInterpolationOffsetBits);
+		LOG_INFO("subPixelPrecisionBits:                           {}", limits.subPixelPrecisionBits);
+		LOG_INFO("subTexelPrecisionBits:                           {}", limits.subTexelPrecisionBits);
+		LOG_INFO("timestampComputeAndGraphics:                     {}", limits.timestampComputeAndGraphics);
+		LOG_INFO("timestampPeriod:                                 {}", limits.timestampPeriod);
+		LOG_INFO("viewportBoundsRange                         Min: {}, Max: {}", limits.viewportBoundsRange[0], limits.viewportBoundsRange[1]);
+		LOG_INFO("viewportSubPixelBits:                            {}", limits.viewportSubPixelBits);
 	}
 
 	// Method to return a human-readable string of what Vulkan queue flags are set in a given VkQueueFlags mask.
@@ -318,5 +309,46 @@ public:
 
 		return msg;
 	}
-	
+
+	// Method to find the index of a memory type that is allowed by a resource's `memoryTypeBits` AND has all the property flags we want.
+	// Returns UINT32_MAX if there is no such memory type.
+	// See: https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkPhysicalDeviceMemoryProperties.html
+	static uint32_t findMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t memoryTypeBits, VkMemoryPropertyFlags desiredFlags)
+	{
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+		{
+			const bool allowedByResource = (memoryTypeBits & (1u << i)) != 0;
+			const bool hasDesiredFlags = (memoryProperties.memoryTypes[i].propertyFlags & desiredFlags) == desiredFlags;
+			if (allowedByResource && hasDesiredFlags) { return i; }
+		}
+		return UINT32_MAX;
+	}
+
+	// Method to pick the memory type for a render target. Attachments that are only ever used within a render pass (created with
+	// `VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT` - e.g., MSAA colour that gets resolved, or depth nobody reads afterwards) prefer lazily
+	// allocated memory: on tile-based GPUs that may never be backed by real memory at all, as the data lives in on-chip tile memory.
+	// Everything else (and transients on devices with no lazily allocated memory type, which is most desktop GPUs) gets plain device-local
+	// memory. Sets `lazilyAllocated` to say which we got. Returns UINT32_MAX if nothing suitable is allowed by `memoryTypeBits`.
+	static uint32_t findAttachmentMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t memoryTypeBits, bool transient, bool& lazilyAllocated)
+	{
+		lazilyAllocated = false;
+		if (transient)
+		{
+			const uint32_t lazyIndex = findMemoryTypeIndex(memoryProperties, memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+			if (lazyIndex != UINT32_MAX)
+			{
+				lazilyAllocated = true;
+				return lazyIndex;
+			}
+		}
+
+		// Note: Lazily allocated types can only back transient attachments, so make sure we don't hand one out for anything else
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+		{
+			const VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+			if ((memoryTypeBits & (1u << i)) != 0 && (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0 && (flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) == 0) { return i; }
+		}
+		return findMemoryTypeIndex(memoryProperties, memoryTypeBits, 0);
+	}
+
 };
@@ -2,7 +2,12 @@
 //
 
 #include <iostream>
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
 #include <vector>
 
 // Our `VulkanHelpers` are just some static utility functions to do things like print out details or human-friendly strings of things
@@ -45,21 +50,28 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 //#include "include/vulkan/vk_platform.h"
 //#define VK_NO_PROTOTYPES   // In this example we'll load the functions that we need only, rather than pull in all the prototypes from vulkan.h
 
-#define VK_USE_PLATFORM_WIN32_KHR
-
+// Note: The `VK_USE_PLATFORM_WIN32_KHR` / `VK_USE_PLATFORM_XCB_KHR` defines live in "VulkanFunctions.h" so that every file agrees on them.
+#include "VulkanFunctions.h"
+#include "vulkan/vulkan.h" // Note: "vulkan.h" includes "vk_platform.h" amongst other things
 
-// Vulkan function loader command
-#ifdef _WIN32
+// Our `ComputeBatchRunner` runs lists of GPU workloads to completion - which is all we do in headless mode
+#include "ComputeBatch.hpp"
+#include "TiledGemm.hpp"
+#include "ScanPrimitives.hpp"
+#include "RadixSort.hpp"
+#include "StreamCompaction.hpp"
+#include "GpuCulling.hpp"
+#include "CpuCulling.hpp"
+#include "HiZPyramid.hpp"
 
-	//#define VK_USE_PLATFORM_WIN32_KHR 1
-	//#include "vulkan_win32.h"
-#elif defined __linux
-	#define VK_USE_PLATFORM_XCB_KHR 1
-//#define VK_USE_PLATFORM_XLIB_KHR // Don't use XLIB on Linux - it's legacy!
-#endif
+// Records CPU & GPU zones and exports them as Chrome trace JSON for Perfetto
+#include "TraceRecorder.hpp"
 
+// Renders frames into images with no window and reads them back to the CPU - which is what we do in offscreen mode
+#include "OffscreenRenderer.hpp"
 
-#include "vulkan/vulkan.h" // Note: "vulkan.h" includes "vk_platform.h" amongst other things
+// Encodes & writes those frames to disk (as raw frames, Y4M video or PNGs) on a pool of worker threads
+#include "FrameSink.hpp"
 
 // Custom struct for queue details
 struct QueueInfo
@@ -82,155 +94,100 @@ struct WindowParameters {
 #endif
 };
 
-constexpr bool VERBOSE      = true;  // Prints out verbose details of what we're doing if true
-constexpr bool VERY_VERBOSE = false; // Prints out additional details of what we're doing if true (e.g., prints all physical device properties, extensions etc.)
-
-// ----- Platform-specific Defines ------
-
-// Vulkan library type
-#ifdef _WIN32
-	#define LIBRARY_TYPE HMODULE
-#elif defined __linux
-	#define LIBRARY_TYPE void*
-#endif
-
-// Vulkan function loader command
-#ifdef _WIN32
-	#define LoadFunction GetProcAddress
-#elif defined __linux
-	#define LoadFunction dlsym
-#endif
-
-
-
-
-// Method to connect to the Vulkan loader library
-bool ConnectWithVulkanLoaderLibrary(LIBRARY_TYPE& vulkan_library)
+// Options that can be set from the command line
+struct RunOptions
 {
-#if defined _WIN32
-	// IMPORTANT: Do not try to connect to the Vulkan DLL with: `LPCWSTR("vulkan-1.dll")` - this won't work! Instead have the type cast as `TEXT` as per below!
-	// Source: https://github.com/KhronosGroup/Vulkan-Hpp/issues/452	
-	vulkan_library = LoadLibrary(TEXT("vulkan-1.dll"));
-#elif defined __linux
-	vulkan_library = dlopen("libvulkan.so.1", RTLD_NOW);
-#endif
-
-	return vulkan_library != nullptr; // Returns false if the vulkan_library is null, true (i.e., success) otherwise
-}
-
-// TODO: If we look at the Vulkan SDK `Templates` folder they use Vulkan.hpp rather than this, and I believe that will allow us to load functions without all the templating craziness. Check it out.
-#include "VulkanFunctions.h"
+	bool Headless = false; // `--headless`: Don't create a window or surface - just pick a compute-capable queue, run our batch workloads & exit
+	bool Profile  = false; // `--profile`: Time our GPU work with timestamp queries and print a per-zone summary (plus per-workload pipeline statistics)
+	string TracePath;      // `--trace <file.json>`: Record CPU & GPU zones and write them out as a Chrome trace (open it in Perfetto)
+	uint32_t OffscreenFrames = 0;     // `--offscreen <frames>`: Don't create a window - render this many frames into offscreen images & read them back
+	uint32_t OffscreenWidth  = 1280;  // `--resolution <width>x<height>`: Size of the offscreen frames
+	uint32_t OffscreenHeight = 720;
+	uint32_t FramesInFlight  = 3;     // `--frames-in-flight <n>`: How many offscreen frames may be rendering / reading back at once
+	uint32_t MsaaSamples     = 1;     // `--msaa <samples>`: Render the offscreen frames multisampled (1, 2, 4, 8...) & resolve them in the render pass
+	string OutputPath;                // `--output <path>`: Write the offscreen frames to disk (for PNGs this is the start of each file name)
+	FrameSinkFormat OutputFormat = FrameSinkFormat::Raw; // `--output-format <raw|y4m|png>`: What to write the offscreen frames out as
+	LogLevel Level = LogLevel::Verbose; // `--log-level <error|warning|info|verbose|very-verbose>`: How much detail to print about what we're doing
+};
 
-// TODO: I fixed this templating stuff via the commend from `bodyaka` at:
-// https://stackoverflow.com/questions/63587107/undeclared-identifier-when-defining-macro-to-load-vulkan-function-pointers
-// Be sure to thank him & maybe link to this repo at some point.
-namespace VulkanFunctionLoaders
+// Method to parse our command line arguments into a `RunOptions` struct. Unknown arguments are reported and ignored.
+RunOptions ParseRunOptions(int argc, char* argv[])
 {
-	bool LoadFunctionExportedFromVulkanLoaderLibrary(LIBRARY_TYPE const& vulkan_library)
+	RunOptions options;
+	for (int i = 1; i < argc; ++i)
 	{
-
-#define EXPORTED_VULKAN_FUNCTION( name )                                         \
-VulkanFunctionLoaders::name = (PFN_##name)LoadFunction( vulkan_library, #name ); \
-if( VulkanFunctionLoaders::name == nullptr ) {                                   \
-  std::cout << "Could not load exported Vulkan function named: "                 \
-    #name << std::endl;                                                          \
-  return false;                                                                  \
-}
-
-#include "ListOfVulkanFunctions.inl"
-
-		return true;
-	}
-
-	bool LoadVulkanGlobalFunctions()
-	{
-#define GLOBAL_LEVEL_VULKAN_FUNCTION( name )                \
-name = (PFN_##name)vkGetInstanceProcAddr( nullptr, #name ); \
-if (name == nullptr) {                                      \
-std::cout << "Could not load global-level function named: " \
-#name << std::endl; \
-return false; \
-}
-#include "ListOfVulkanFunctions.inl"
-		return true;
-	}
-
-	bool IsExtensionSupported(std::vector<VkExtensionProperties> const& available_extensions, char const* const extension)
-	{
-		for (auto & available_extension : available_extensions)
+		const string arg = argv[i];
+		if (arg == "--headless") { options.Headless = true; }
+		else if (arg == "--profile") { options.Profile = true; }
+		else if (arg == "--trace" && i + 1 < argc) { options.TracePath = argv[++i]; }
+		else if (arg == "--offscreen" && i + 1 < argc) { options.OffscreenFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); }
+		else if (arg == "--frames-in-flight" && i + 1 < argc) { options.FramesInFlight = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); }
+		else if (arg == "--msaa" && i + 1 < argc)
+		{
+			const string samplesName = argv[++i];
+			const uint32_t samples = static_cast<uint32_t>(std::strtoul(samplesName.c_str(), nullptr, 10));
+			if (samples >= 1 && samples <= 64 && (samples & (samples - 1)) == 0) { options.MsaaSamples = samples; }
+			else { LOG_WARNING("[WARNING] Invalid MSAA sample count: {} - expected a power of two between 1 and 64.", samplesName); }
+		}
+		else if (arg == "--output" && i + 1 < argc) { options.OutputPath = argv[++i]; }
+		else if (arg == "--output-format" && i + 1 < argc)
 		{
-			if (strstr(available_extension.extensionName, extension)) {	return true; }
+			const string formatName = argv[++i];
+			if (!FrameSink::parseFormat(formatName, options.OutputFormat))
+			{
+				LOG_WARNING("[WARNING] Unknown output format: {} - expected one of: raw, y4m, png.", formatName);
+			}
+		}
+		else if (arg == "--resolution" && i + 1 < argc)
+		{
+			const string resolution = argv[++i];
+			unsigned int width = 0;
+			unsigned int height = 0;
+			if (std::sscanf(resolution.c_str(), "%ux%u", &width, &height) == 2 && width > 0 && height > 0)
+			{
+				options.OffscreenWidth = width;
+				options.OffscreenHeight = height;
+			}
+			else
+			{
+				LOG_WARNING("[WARNING] Could not parse resolution: {} - expected <width>x<height>, e.g., 1920x1080.", resolution);
+			}
+		}
+		else if (arg == "--log-level" && i + 1 < argc)
+		{
+			const string levelName = argv[++i];
+			if (!Logger::parseLevel(levelName, options.Level))
+			{
+				LOG_WARNING("[WARNING] Unknown log level: {} - expected one of: error, warning, info, verbose, very-verbose.", levelName);
+			}
+		}
+		else
+		{
+			LOG_WARNING("[WARNING] Ignoring unknown command line argument: {}", arg);
 		}
-		return false;
 	}
-
-	// Method to load Vulkan instance-level functions for the provided instance
-	bool LoadInstanceLevelFunctions(VkInstance &vulkanInstance)
-	{
-#define INSTANCE_LEVEL_VULKAN_FUNCTION( name )                      \
-name = (PFN_##name)vkGetInstanceProcAddr( vulkanInstance, #name );  \
-if( name == nullptr ) {                                             \
-std::cout << "Could not load instance-level Vulkan function named: "\
-#name << " for instance: " << vulkanInstance << std::endl;          \
-return false;                                                       \
+	return options;
 }
-#include "ListOfVulkanFunctions.inl"
 
-		return true;
-	}
 
-	// Method to load an instance-level function from a specific extension (which must be available and loaded)
-	bool LoadInstanceLevelFunctionFromExtension(VkInstance& vulkanInstance, std::vector<char const*> enabledExtensions)
-	{
-#define INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( name, extension )  \
-for (auto &enabledExtension : enabledExtensions) {                        \
-if (std::string(enabledExtension) == std::string(extension)) {            \
-name = (PFN_##name)vkGetInstanceProcAddr(vulkanInstance, #name);          \
-if (name == nullptr) {                                                    \
-std::cout << "Could not load instance-level Vulkan function from EXTENSION named: "      \
-#name << std::endl;                                                       \
-return false;                                                             \
-}                                                                         \
-}                                                                         \
-}
-#include "ListOfVulkanFunctions.inl"
-		return true;
-	}
 
-	// Method to load a device level function
-	bool LoadDeviceLevelFunction(VkDevice vulkanDevice, char const* name)
-	{
-#define DEVICE_LEVEL_VULKAN_FUNCTION( name )                                              \
-name = (PFN_##name)vkGetDeviceProcAddr( vulkanDevice, #name );                            \
-if( name == nullptr ) {                                                                   \
-std::cout << "Could not load device-level Vulkan function named: " << #name << std::endl; \
-			return false;                                                                 \
-}
-#include "ListOfVulkanFunctions.inl"
-	return true;
-	}
+int main(int argc, char* argv[])
+{
+	const RunOptions options = ParseRunOptions(argc, argv);
+	Logger::setLevel(options.Level);
+	if (options.Headless) { LOG_VERBOSE("[OK] Running headless - no window or surface will be created."); }
+	if (options.OffscreenFrames > 0) { LOG_VERBOSE("[OK] Rendering {} offscreen frame(s) - no window or surface will be created.", options.OffscreenFrames); }
 
-	bool LoadDeviceLevelFunctionFromExtension(VkDevice logicalDevice, char const* name, std::vector<char const*> enabledExtensions)
+	// Headless batches & offscreen rendering both get by without a window (and so without any surface or presentation extensions)
+	const bool windowless = options.Headless || options.OffscreenFrames > 0;
+
+	const bool tracing = !options.TracePath.empty();
+	if (tracing)
 	{
-#define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( name,	extension)                                                    \
-		for (auto &enabledExtension : enabledExtensions) {			                                                      \
-				if (std::string(enabledExtension) == std::string(extension)) {		                                      \
-						name = (PFN_##name)vkGetDeviceProcAddr(logicalDevice, #name);                                     \
-						if (name == nullptr) {							                                                  \
-								std::cout << "Could not load device-level Vulkan function named: " << #name << std::endl; \
-								return false;                                                                             \
-						}                                                                                                 \
-				}                                                                                                         \
-		}
-#include "ListOfVulkanFunctions.inl"
-		return true;
+		TraceRecorder::setEnabled(true);
+		TraceRecorder::setThreadName("Main thread");
 	}
 
-} // End of namespace VulkanFunctionLoaders
-
-
-int main()
-{
 	// Set a flag & use validation layers if this is a debug build.
 	// Note: Although we have `_DEBUG` defined in debug builds, we may want to output code-debugging details (as
 	// opposed to vulkan debugging details) separately, e.g., even in release builds!
@@ -241,42 +198,44 @@ int main()
 	vulkanLayers.push_back("VK_LAYER_KHRONOS_validation");
 	//DEBUGGING = true;
 #else
-	// If not debugging we assign nullptr to our vulkanLayers - this way we can always pass it to vulkan functions and it's always the right thing
-	const char* vulkanLayers = nullptr;
+	// If not debugging we leave `vulkanLayers` empty - and anywhere we pass it to vulkan we pass nullptr instead if it has no layers in it
 #endif
 
 	// ----- Step 1 -----
+	TraceScope loadLibraryZone("Load Vulkan loader & global functions");
 	// Connect to the Vulkan loader library. Note: `LIBRARY_TYPE` is a macro that makes the result a `HMODULE` on Windows and a `void*` on Linux.
 	LIBRARY_TYPE vulkanLibrary;
 	const bool connectedToVulkanLoader = ConnectWithVulkanLoaderLibrary(vulkanLibrary);
 	if (!connectedToVulkanLoader)
 	{
-		cout << "[FAIL] Could not connect to Vulkan loader library." << endl;
+		LOG_ERROR("[FAIL] Could not connect to Vulkan loader library.");
 		return -1;
 	}
-	if (VERBOSE) { cout << "[OK] Connected to Vulkan loader library." << endl; }
+	LOG_VERBOSE("[OK] Connected to Vulkan loader library.");
 
 	// ----- Step 2 -----
 	// Load all functions we've specified in `ListOfVulkanFunctions.inl` automatically
 	const bool loadFunctionSuccess = VulkanFunctionLoaders::LoadFunctionExportedFromVulkanLoaderLibrary(vulkanLibrary);
 	if (!loadFunctionSuccess)
 	{
-		cout << "[FAIL] Failed to load Vulkan loader function." << endl;
+		LOG_ERROR("[FAIL] Failed to load Vulkan loader function.");
 		return -1;		
 	}
-	if (VERBOSE) { cout << "[OK] Successfully loaded Vulkan loader function." << endl; }
+	LOG_VERBOSE("[OK] Successfully loaded Vulkan loader function.");
 
 	// ----- Step 3 -----
 	// Load all the global functions
 	const bool loadGlobalFunctionsSuccess = VulkanFunctionLoaders::LoadVulkanGlobalFunctions();
 	if (!loadGlobalFunctionsSuccess)
 	{
-		cout << "[FAIL] Failed to load Vulkan global functions." << endl;
+		LOG_ERROR("[FAIL] Failed to load Vulkan global functions.");
 		return -2;
 	}
-	if (VERBOSE) { cout << "[OK] Successfully loaded Vulkan global functions." << endl; }
+	LOG_VERBOSE("[OK] Successfully loaded Vulkan global functions.");
+	loadLibraryZone.end();
 
 	// ----- Step 4 -----
+	TraceScope createInstanceZone("Create instance");
 	// Get a count of all the Vulkan instance extensions available..
 	uint32_t instanceExtensionsCount = 0;
 	VkResult result = VK_SUCCESS;
@@ -289,29 +248,26 @@ int main()
 	
 	if (result != VK_SUCCESS ||	instanceExtensionsCount == 0)
 	{
-		cout << "[FAIL] Could not get the number of Vulkan Instance extensions." << endl;
+		LOG_ERROR("[FAIL] Could not get the number of Vulkan Instance extensions.");
 		return -3;
 	}
 	else
 	{
-		if (VERBOSE) { cout << "[OK] Found " << instanceExtensionsCount << " Vulkan instance extensions." << endl; }
+		LOG_VERBOSE("[OK] Found {} Vulkan instance extensions.", instanceExtensionsCount);
 	}
 	// ..then obtain the details of all available Vulkan instance extensions.
 	std::vector<VkExtensionProperties> availableExtensions(instanceExtensionsCount);	
 	result = VulkanFunctionLoaders::vkEnumerateInstanceExtensionProperties(nullptr, &instanceExtensionsCount, availableExtensions.data());
 	if (result != VK_SUCCESS || instanceExtensionsCount == 0)
 	{
-		std::cout << "[FAIL] Could not enumerate Instance extension details." << std::endl;
+		LOG_ERROR("[FAIL] Could not enumerate Instance extension details.");
 		return -4;
 	}
-	else
+	else if (Logger::isEnabled(LogLevel::VeryVerbose))
 	{
-		if (VERY_VERBOSE)
+		for (unsigned int i = 0; i < instanceExtensionsCount; ++i)
 		{
-			for (unsigned int i = 0; i < instanceExtensionsCount; ++i)
-			{
-				cout << "\t" << availableExtensions[i].extensionName << " - version: " << availableExtensions[i].specVersion << endl;
-			}
+			LOG_VERY_VERBOSE("\t{} - version: {}", availableExtensions[i].extensionName, availableExtensions[i].specVersion);
 		}
 	}
 
@@ -327,39 +283,53 @@ int main()
 	desiredInstanceExtensions.push_back("VK_KHR_external_memory_capabilities");      // 3
 	desiredInstanceExtensions.push_back("VK_KHR_external_semaphore_capabilities");   // 4	
 	desiredInstanceExtensions.push_back("VK_KHR_get_physical_device_properties2");   // 5
-	desiredInstanceExtensions.push_back("VK_KHR_get_surface_capabilities2");         // 6
-	desiredInstanceExtensions.push_back("VK_KHR_surface");                           // 7
-	//desiredInstanceExtensions.push_back("VK_KHR_surface_protected_capabilities");       // 8 - THIS IS THE ONE THAT'S CAUSING ISSUES! NOT USING FOR NOW!
-	//desiredInstanceExtensions.push_back("VK_KHR_win32_surface");                     // 9 - THIS IS SPECIFIC TO WINDOWS! If I try to run this on Linux it won't work!
-	desiredInstanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
-
-	desiredInstanceExtensions.push_back("VK_EXT_debug_report");                      // 10
-	desiredInstanceExtensions.push_back("VK_EXT_debug_utils");                       // 11
-	desiredInstanceExtensions.push_back("VK_EXT_swapchain_colorspace");              // 12
-	desiredInstanceExtensions.push_back("VK_NV_external_memory_capabilities");       // 13
-	desiredInstanceExtensions.push_back("VK_KHR_portability_enumeration");           // 14
-	desiredInstanceExtensions.push_back("VK_LUNARG_direct_driver_loading");          // 15
-
-// Note: NONE OF THESE RUN as none of them are defined at present! That's odd! But we're loading `VK_KHR_win32_surface` so let's just continue..
+
+	// Note: Headless machines (render farm nodes, CI runners using lavapipe etc.) typically have no display server, and their drivers
+	// may not expose ANY surface extensions - so we only ask for the surface & presentation related ones when we're going to draw to a window.
+	if (!windowless)
+	{
+		desiredInstanceExtensions.push_back("VK_KHR_get_surface_capabilities2");     // 6
+		desiredInstanceExtensions.push_back("VK_KHR_surface");                       // 7
+		//desiredInstanceExtensions.push_back("VK_KHR_surface_protected_capabilities");   // 8 - THIS IS THE ONE THAT'S CAUSING ISSUES! NOT USING FOR NOW!
+#if defined VK_USE_PLATFORM_WIN32_KHR
+		desiredInstanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);    // 9 - Windows
+#elif defined VK_USE_PLATFORM_XCB_KHR
+		desiredInstanceExtensions.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);      // 9 - Linux (XCB)
+#endif
+		desiredInstanceExtensions.push_back("VK_EXT_swapchain_colorspace");          // 12
+	}
+
+
+	// These are nice-to-haves that plenty of drivers don't expose (e.g., lavapipe on a headless CI box has no NV or LUNARG extensions),
+	// so rather than fail we only ask for them if they're available.
+	std::vector<char const*> optionalInstanceExtensions;
+	optionalInstanceExtensions.push_back("VK_EXT_debug_report");                     // 10
+	optionalInstanceExtensions.push_back("VK_EXT_debug_utils");                      // 11
+	optionalInstanceExtensions.push_back("VK_NV_external_memory_capabilities");      // 13
+	optionalInstanceExtensions.push_back("VK_KHR_portability_enumeration");          // 14
+	optionalInstanceExtensions.push_back("VK_LUNARG_direct_driver_loading");         // 15
+	for (auto optionalExtension : optionalInstanceExtensions)
+	{
+		if (VulkanFunctionLoaders::IsExtensionSupported(availableExtensions, optionalExtension)) { desiredInstanceExtensions.push_back(optionalExtension); }
+		else { LOG_WARNING("[WARNING] Optional instance extension: {} is not available - continuing without it.", optionalExtension); }
+	}
+
 #ifdef VK_USE_PLATFORM_WIN32_KHR
-	cout << "Windows surface extension name: " << VK_KHR_WIN32_SURFACE_EXTENSION_NAME << endl;
+	if (!windowless) { LOG_VERBOSE("Windows surface extension name: {}", VK_KHR_WIN32_SURFACE_EXTENSION_NAME); }
 #elif defined VK_USE_PLATFORM_XCB_KHR
-	cout << "Linux XCB surface extension name: " << VK_KHR_XCB_SURFACE_EXTENSION_NAME << endl;
+	if (!windowless) { LOG_VERBOSE("Linux XCB surface extension name: {}", VK_KHR_XCB_SURFACE_EXTENSION_NAME); }
 #elif defined VK_USE_PLATFORM_XLIB_KHR
-	cout << "Linux XLIB surface extension name: " << VK_KHR_XLIB_SURFACE_EXTENSION_NAME << endl;
+	if (!windowless) { LOG_VERBOSE("Linux XLIB surface extension name: {}", VK_KHR_XLIB_SURFACE_EXTENSION_NAME); }
 #endif
 
 
 	uint32_t numDesiredInstanceExtensions = desiredInstanceExtensions.size();
-	if (VERBOSE)
+	LOG_VERBOSE("[OK] Requesting {} of the available instance-level extensions.", numDesiredInstanceExtensions);
+	if (Logger::isEnabled(LogLevel::VeryVerbose))
 	{
-		cout << "[OK] Requesting " << numDesiredInstanceExtensions << " of the available instance-level extensions." << endl;
-		if (VERY_VERBOSE)
+		for (unsigned int i = 0; i < numDesiredInstanceExtensions; ++i)
 		{
-			for (unsigned int i = 0; i < numDesiredInstanceExtensions; ++i)
-			{
-				cout << "\t" << desiredInstanceExtensions.at(i) << endl;
-			}
+			LOG_VERY_VERBOSE("\t{}", desiredInstanceExtensions.at(i));
 		}
 	}
 
@@ -381,25 +351,28 @@ int main()
 	{
 		for (unsigned int desiredExtensionIndex = 0; desiredExtensionIndex < numDesiredInstanceExtensions; ++desiredExtensionIndex)
 		{
-			//cout << "Checking if the following extension is supported: " << pDesiredExtensions->at(i) << endl;
+			//LOG_VERY_VERBOSE("Checking if the following extension is supported: {}", pDesiredExtensions->at(i));
 			const bool supported = VulkanFunctionLoaders::IsExtensionSupported(availableExtensions, desiredInstanceExtensions.at(desiredExtensionIndex));// *pDesiredExtensions)[i]);
 			if (!supported)
 			{
-				cout << "[FAIL]: Vulkan extension: " << desiredInstanceExtensions.at(desiredExtensionIndex) << " is not available." << endl;
+				LOG_ERROR("[FAIL]: Vulkan extension: {} is not available.", desiredInstanceExtensions.at(desiredExtensionIndex));
 				return -5;
 			}
 		}
-		if (VERBOSE) { cout << "[OK] All " << numDesiredInstanceExtensions << " desired instance extensions are available." << endl; }
+		LOG_VERBOSE("[OK] All {} desired instance extensions are available.", numDesiredInstanceExtensions);
 	}
 	else
 	{
-		cout << "[WARNING]: No desired instance extensions requested!" << endl;
+		LOG_WARNING("[WARNING]: No desired instance extensions requested!");
 	}
 
 	// ----- Step 6 -----
 	// Construct the application info required to initialise Vulkan.
 	// Note: The application name and engine name properties are used by graphics drivers to twiddle internal driver
 	// settings, typically for specific AAA games.
+	// Note: We ask for Vulkan 1.1 where the loader has it, as that's what lets our compute shaders use subgroup operations (see
+	// `ScanPrimitives`) - everything else we use is 1.0 plus extensions, so an older loader gets 1.0 and we do without.
+	const uint32_t instanceApiVersion = std::min(VulkanFunctionLoaders::GetInstanceApiVersion(), VK_API_VERSION_1_1);
 	VkApplicationInfo applicationInfo = {
 		VK_STRUCTURE_TYPE_APPLICATION_INFO,
 		nullptr,
@@ -407,13 +380,13 @@ int main()
 		VK_MAKE_VERSION(1, 0, 0),
 		EngineName.c_str(),
 		VK_MAKE_VERSION(1, 0, 0),
-		VK_MAKE_VERSION(1, 0, 0)
+		instanceApiVersion
 	};
 
 	// ----- Step 7 -----
 	// Construct the instance creation info using the above application info.
 	auto numVulkanLayers = static_cast<uint32_t>(vulkanLayers.size());
-	if (VERBOSE) { cout << "[OK] About to create `InstanceCreateInfo` with: " << numVulkanLayers << " vulkan layer(s)." << endl; }
+	LOG_VERBOSE("[OK] About to create `InstanceCreateInfo` with: {} vulkan layer(s).", numVulkanLayers);
 	VkInstanceCreateInfo instanceCreateInfo = {};
 	instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	instanceCreateInfo.pNext = nullptr;
@@ -431,32 +404,34 @@ int main()
 	const VkResult instanceCreationResult = VulkanFunctionLoaders::vkCreateInstance(&instanceCreateInfo, nullptr, &vulkanInstance);
 	if (instanceCreationResult != VK_SUCCESS || vulkanInstance == VK_NULL_HANDLE)
 	{
-		cout << "[FAIL] Could not create Vulkan instance." << endl;
+		LOG_ERROR("[FAIL] Could not create Vulkan instance.");
 		return -6;
 	}
-	if (VERBOSE) { cout << "[OK] Vulkan instance created." << endl; }
+	LOG_VERBOSE("[OK] Vulkan instance created.");
 
 	// ----- Step 9 -----
 	// Load our instance-level functions.
 	const bool instanceLevelFunctionsLoaded = VulkanFunctionLoaders::LoadInstanceLevelFunctions(vulkanInstance);
 	if (!instanceLevelFunctionsLoaded)
 	{
-		cout << "[FAIL]: Vulkan instance level functions could not be loaded." << endl;
+		LOG_ERROR("[FAIL]: Vulkan instance level functions could not be loaded.");
 		return -7;
 	}
-	if (VERBOSE) { cout << "[OK] Vulkan instance-level functions loaded." << endl; }
+	LOG_VERBOSE("[OK] Vulkan instance-level functions loaded.");
 
 	// ----- Step 10 -----
 	// Now load the instance-level functions that are provided by our extensions.
 	const bool instanceLevelExtensionFunctionsLoaded = VulkanFunctionLoaders::LoadInstanceLevelFunctionFromExtension(vulkanInstance, desiredInstanceExtensions);
 	if (!instanceLevelExtensionFunctionsLoaded)
 	{
-		cout << "[FAIL]: Vulkan instance level functions could not be loaded from extensions." << endl;
+		LOG_ERROR("[FAIL]: Vulkan instance level functions could not be loaded from extensions.");
 		return -8;
 	}
-	if (VERBOSE) { cout << "[OK] Vulkan instance-level functions loaded from extensions." << endl; }
+	LOG_VERBOSE("[OK] Vulkan instance-level functions loaded from extensions.");
+	createInstanceZone.end();
 
 	// ----- Step 11 -----
+	TraceScope selectDeviceZone("Select physical device & queue family");
 	// Enumerate available physical devices (from which we will access LOGICAL devices that will perform our work!).
 	// Note: Like our VkInstance, VkPhysicalDevice is an opaque handle.
 	// See: https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkPhysicalDevice.html
@@ -468,25 +443,25 @@ int main()
 	result = VulkanFunctionLoaders::vkEnumeratePhysicalDevices(vulkanInstance, &physicalDeviceCount, nullptr);
 	if (result != VK_SUCCESS || physicalDeviceCount == 0)
 	{
-		cout << "[FAIL] Could not enumerate physical devices. Physical devices found: " << physicalDeviceCount << endl;
+		LOG_ERROR("[FAIL] Could not enumerate physical devices. Physical devices found: {}", physicalDeviceCount);
 		return -9;
 	}
-	if (VERBOSE) { cout << "[OK] Found " << physicalDeviceCount << " physical device(s)." << endl; }
+	LOG_VERBOSE("[OK] Found {} physical device(s).", physicalDeviceCount);
 
 	std::vector<VkPhysicalDevice> availablePhysicalDevices(physicalDeviceCount);
 	result = VK_SUCCESS;
 	result = VulkanFunctionLoaders::vkEnumeratePhysicalDevices(vulkanInstance, &physicalDeviceCount, availablePhysicalDevices.data());
 	if (result != VK_SUCCESS || physicalDeviceCount == 0)
 	{
-		cout << "[FAIL] Could not populate details of physical devices. Physical devices found: " << physicalDeviceCount << endl;
+		LOG_ERROR("[FAIL] Could not populate details of physical devices. Physical devices found: {}", physicalDeviceCount);
 		return -10;
 	}
-	if (VERBOSE) { cout << "[OK] Populated details of " << physicalDeviceCount << " physical device(s)." << endl; }
+	LOG_VERBOSE("[OK] Populated details of {} physical device(s).", physicalDeviceCount);
 	
 	// For now we'll only work with the first physical device found so let's keep an easy reference to it
 	if (physicalDeviceCount > 1)
 	{
-		cout << "[WARNING] Found multiple physical devices - using physical device 0 for now to keep the code manageable." << endl;
+		LOG_WARNING("[WARNING] Found multiple physical devices - using physical device 0 for now to keep the code manageable.");
 	}
 	VkPhysicalDevice activePhysicalDevice = availablePhysicalDevices[0];
 
@@ -498,25 +473,25 @@ int main()
 	result = VulkanFunctionLoaders::vkEnumerateDeviceExtensionProperties(activePhysicalDevice, nullptr, &physicalDeviceExtensionCount, nullptr);
 	if (result != VK_SUCCESS || physicalDeviceExtensionCount == 0)
 	{
-		cout << "[FAIL] Could not enumerate physical device extensions. Physical devices extension count: " << physicalDeviceExtensionCount << endl;
+		LOG_ERROR("[FAIL] Could not enumerate physical device extensions. Physical devices extension count: {}", physicalDeviceExtensionCount);
 		return -11;
 	}
-	if (VERBOSE) { cout << "[OK] Found " << physicalDeviceExtensionCount << " extensions for physical device 0." << endl; }
+	LOG_VERBOSE("[OK] Found {} extensions for physical device 0.", physicalDeviceExtensionCount);
 
 	std::vector<VkExtensionProperties> physicalDeviceExtensions(physicalDeviceExtensionCount);
 	result = VK_SUCCESS;
 	result = VulkanFunctionLoaders::vkEnumerateDeviceExtensionProperties(availablePhysicalDevices[0], nullptr, &physicalDeviceExtensionCount, physicalDeviceExtensions.data());
 	if (result != VK_SUCCESS || physicalDeviceExtensionCount == 0)
 	{
-		cout << "[FAIL] Could populate physical device 0 extension properties. Physical device 0 extensions found: " << physicalDeviceExtensionCount << endl;
+		LOG_ERROR("[FAIL] Could populate physical device 0 extension properties. Physical device 0 extensions found: {}", physicalDeviceExtensionCount);
 		return -12;
 	}
-	if (VERBOSE) { cout << "[OK] Populated " << physicalDeviceExtensionCount << " extension properties for physical device 0." << endl; }
-	if (VERY_VERBOSE)
+	LOG_VERBOSE("[OK] Populated {} extension properties for physical device 0.", physicalDeviceExtensionCount);
+	if (Logger::isEnabled(LogLevel::VeryVerbose))
 	{
 		for (auto &pdeProperty : physicalDeviceExtensions)
 		{
-			cout << "\t" << pdeProperty.extensionName << " - version: " << pdeProperty.specVersion << endl;
+			LOG_VERY_VERBOSE("\t{} - version: {}", pdeProperty.extensionName, pdeProperty.specVersion);
 		}
 	}		
 
@@ -526,7 +501,7 @@ int main()
 	VkPhysicalDeviceProperties activePhysicalDeviceProperties;
 	VulkanFunctionLoaders::vkGetPhysicalDeviceFeatures(activePhysicalDevice, &activePhysicalDeviceFeatures);
 	VulkanFunctionLoaders::vkGetPhysicalDeviceProperties(activePhysicalDevice, &activePhysicalDeviceProperties);
-	if (VERY_VERBOSE)
+	if (Logger::isEnabled(LogLevel::VeryVerbose))
 	{
 		VulkanHelpers::printPhysicalDeviceFeatures(activePhysicalDeviceFeatures);
 		VulkanHelpers::printPhysicalDeviceProperties(activePhysicalDeviceProperties);
@@ -539,41 +514,38 @@ int main()
 	VulkanFunctionLoaders::vkGetPhysicalDeviceQueueFamilyProperties(activePhysicalDevice, &queueFamiliesCount, nullptr);
 	if (queueFamiliesCount == 0)
 	{
-		std::cout << "Could not get the number of queue families." << std::endl;
+		LOG_ERROR("[FAIL] Could not get the number of queue families.");
 		return -13;
 	}
 	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamiliesCount);
 	VulkanFunctionLoaders::vkGetPhysicalDeviceQueueFamilyProperties(activePhysicalDevice, &queueFamiliesCount,queueFamilies.data());
 	if (queueFamiliesCount == 0)
 	{
-		cout << "Could not acquire properties of queue families." << endl;
+		LOG_ERROR("[FAIL] Could not acquire properties of queue families.");
 		return -14;
 	}
-	if (VERBOSE)
+	LOG_VERBOSE("[OK] Queue families found: {}", queueFamiliesCount);
+	if (Logger::isEnabled(LogLevel::VeryVerbose))
 	{
-		cout << "[OK] Queue families found: " << queueFamiliesCount << endl;
-		if (VERY_VERBOSE)
+		for (int i = 0; i < queueFamiliesCount; ++i)
 		{
-			for (int i = 0; i < queueFamiliesCount; ++i)
-			{
-				auto granularity = queueFamilies[i].minImageTransferGranularity;
+			auto granularity = queueFamilies[i].minImageTransferGranularity;
 
-				cout << "Queue family index: " << i << endl;
-				cout << "\tminImageTransferGranularity - Width: " << granularity.width << ", Height: " << granularity.height << ", Depth: " << granularity.depth << endl;
-				cout << "\ttimestampValidBits:                  " << queueFamilies[i].timestampValidBits << endl;
-				cout << "\tqueueCount:                          " << queueFamilies[i].queueCount << endl;
-				cout << "\tqueueFlags:                          " << VulkanHelpers::getFriendlyQueueFlags(queueFamilies[i].queueFlags) << endl;
-			}
+			LOG_VERY_VERBOSE("Queue family index: {}", i);
+			LOG_VERY_VERBOSE("\tminImageTransferGranularity - Width: {}, Height: {}, Depth: {}", granularity.width, granularity.height, granularity.depth);
+			LOG_VERY_VERBOSE("\ttimestampValidBits:                  {}", queueFamilies[i].timestampValidBits);
+			LOG_VERY_VERBOSE("\tqueueCount:                          {}", queueFamilies[i].queueCount);
+			LOG_VERY_VERBOSE("\tqueueFlags:                          {}", VulkanHelpers::getFriendlyQueueFlags(queueFamilies[i].queueFlags));
 		}
 	}
 
 	// ----- Step 15 -----
 	// Now that we have details of the available queue families, we need to choose one that has our desired capabilities - which in this
-	// case will simply be that we want to draw something.	
+	// case will simply be that we want to draw something (or, when running headless, that we want to run compute work).
 	int numSuitableFamiliesFound = 0;
 	VkQueueFamilyProperties activeQueueFamily;
 	uint32_t activeQueueFamilyIndex = 0xffffffff; // Set to max possible value initially to avoid "may be uninitialised" moaning
-	VkQueueFlags desiredCapabilities = VK_QUEUE_GRAPHICS_BIT;
+	VkQueueFlags desiredCapabilities = options.Headless ? VK_QUEUE_COMPUTE_BIT : VK_QUEUE_GRAPHICS_BIT;
 	string desiredCapabilitiesString = VulkanHelpers::getFriendlyQueueFlags(desiredCapabilities);
 
 	// From a given queue family we may ask for a subset of all available queues (like if it can provide 16 queues, we may only ask for 3 for example)
@@ -590,8 +562,10 @@ int main()
 
 	for (int i = 0; i < queueFamiliesCount; ++i)
 	{
-		// If the queue we're looking at has the flag for desired capabilities AND it has a queue available..
-		if ((queueFamilies[i].queueFlags & desiredCapabilities) != 0 && queueFamilies[i].queueCount > 0 && queueFamilies[i].queueCount >= numDesiredQueues)
+		// If the queue we're looking at has the flag for desired capabilities AND it has enough queues available..
+		// Note: When we're requesting all available queues, any family with at least one queue will do (e.g., lavapipe only exposes a single queue).
+		const bool hasEnoughQueues = requestAllAvailableQueues ? queueFamilies[i].queueCount > 0 : queueFamilies[i].queueCount >= numDesiredQueues;
+		if ((queueFamilies[i].queueFlags & desiredCapabilities) != 0 && hasEnoughQueues)
 		{
 			// ..then if we haven't already found a suitable queue family we have now! Set it! 
 			if (numSuitableFamiliesFound == 0)
@@ -600,37 +574,45 @@ int main()
 				activeQueueFamilyIndex = i;
 				++numSuitableFamiliesFound;
 			}
+			// When headless we prefer a dedicated compute family (i.e., one without graphics) as those queues usually run alongside any graphics work
+			else if (options.Headless && (activeQueueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0 && (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0)
+			{
+				++numSuitableFamiliesFound;
+				activeQueueFamily = queueFamilies[i];
+				activeQueueFamilyIndex = i;
+				LOG_VERBOSE("[OK] Found a dedicated compute queue family at index: {} - preferring it for headless work.", i);
+			}
 			// Warn if we found another potential queue family that meets our needs - but to keep things simple for now we'll stick w/ the first one found
 			else if (numSuitableFamiliesFound >= 1)
 			{
 				++numSuitableFamiliesFound;
-				cout << "[WARNING] Found another queue family w/ req'd capabilities, but sticking w/ 1st found. Potential queue families avail now: " << numSuitableFamiliesFound << endl;
+				LOG_WARNING("[WARNING] Found another queue family w/ req'd capabilities, but sticking w/ 1st found. Potential queue families avail now: {}", numSuitableFamiliesFound);
 			}
 		}
 	}
 	if (numSuitableFamiliesFound == 0)
 	{
-		cout << "[FAIL] Could not find a suitable queue family with desired capabilities: " << desiredCapabilitiesString << endl;
+		LOG_ERROR("[FAIL] Could not find a suitable queue family with desired capabilities: {}", desiredCapabilitiesString);
 		return -15;
 	}
-	if (VERBOSE)
-	{
-		cout << "[OK] Found queue family with desired capabilities: " << desiredCapabilitiesString << endl;
-		cout << "[OK] Using queue family at index: " << activeQueueFamilyIndex << endl;
-		cout << "[OK] Active queue family queue count is: " << activeQueueFamily.queueCount << endl;
-	}
+	LOG_VERBOSE("[OK] Found queue family with desired capabilities: {}", desiredCapabilitiesString);
+	LOG_VERBOSE("[OK] Using queue family at index: {}", activeQueueFamilyIndex);
+	LOG_VERBOSE("[OK] Active queue family queue count is: {}", activeQueueFamily.queueCount);
 
 	if (requestAllAvailableQueues)
 	{
 		numDesiredQueues = activeQueueFamily.queueCount;
-		cout << "[OK] Requesting access to all available queues. Count: " << numDesiredQueues << endl;
+		LOG_VERBOSE("[OK] Requesting access to all available queues. Count: {}", numDesiredQueues);
 	}
 	else
 	{
-		cout << "[OK] Although we can request up to " << activeQueueFamily.queueCount << " we are only requesting to use: " << numDesiredQueues << " queues." << endl;
+		LOG_VERBOSE("[OK] Although we can request up to {} we are only requesting to use: {} queues.", activeQueueFamily.queueCount, numDesiredQueues);
 	}
 	
+	selectDeviceZone.end();
+
 	// ----- Step 15 -----
+	TraceScope createDeviceZone("Create logical device");
 	// Create our `QueueInfo` struct with the details of the queue we'll use
 	QueueInfo activeQueueInfo;
 	activeQueueInfo.FamilyIndex = activeQueueFamilyIndex;
@@ -656,22 +638,155 @@ int main()
 	requestedPhysicalDeviceExtensionNames.push_back("VK_KHR_16bit_storage");                // 1
 	requestedPhysicalDeviceExtensionNames.push_back("VK_KHR_storage_buffer_storage_class"); // 2 - Required by `VK_KHR_16bit_storage` (1)
 
-	if (VERBOSE)
+	// When tracing we'd like to line GPU timestamps up with CPU time exactly - which is what `VK_EXT_calibrated_timestamps` is for
+	bool calibratedTimestampsEnabled = false;
+	if (tracing && VulkanFunctionLoaders::IsExtensionSupported(physicalDeviceExtensions, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME))
 	{
-		cout << "[OK] Requesting to load: " << requestedPhysicalDeviceExtensionNames.size() << " physical device extensions." << endl;
-		if (VERY_VERBOSE)
-		{			
-			for (unsigned int i = 0; i < numDesiredInstanceExtensions; ++i)
-			{
-				cout << "\t" << requestedPhysicalDeviceExtensionNames.at(i) << endl;
-			}
+		requestedPhysicalDeviceExtensionNames.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME); // 3 - Optional
+		calibratedTimestampsEnabled = true;
+	}
+
+	// Timeline semaphores let us track lots of in-flight submissions with a single semaphore (rather than a fence each) - offscreen mode
+	// needs them. Note: `VK_KHR_timeline_semaphore` needs `VK_KHR_get_physical_device_properties2`, which we always ask for at instance level.
+	// Also: Enabling the extension isn't enough on its own - we also have to turn the `timelineSemaphore` feature on (see below).
+	const bool timelineSemaphoresEnabled = VulkanFunctionLoaders::IsExtensionSupported(physicalDeviceExtensions, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+	if (timelineSemaphoresEnabled)
+	{
+		requestedPhysicalDeviceExtensionNames.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME); // 4 - Optional (required for offscreen mode)
+	}
+	else if (options.OffscreenFrames > 0)
+	{
+		LOG_ERROR("[FAIL] Offscreen mode needs {} but physical device 0 doesn't support it.", VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		return -21;
+	}
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures = {};
+	timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineSemaphoreFeatures.pNext = nullptr;
+	timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE; // Note: Every device that supports the extension must support this feature
+
+	// `VK_KHR_synchronization2` gives us `vkCmdPipelineBarrier2`, which the render graph uses when it can (it falls back to plain
+	// `vkCmdPipelineBarrier` otherwise). Like timeline semaphores, it needs its feature turning on as well as the extension.
+	const bool synchronization2Enabled = VulkanFunctionLoaders::IsExtensionSupported(physicalDeviceExtensions, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+	if (synchronization2Enabled)
+	{
+		requestedPhysicalDeviceExtensionNames.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME); // 5 - Optional
+	}
+	VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features = {};
+	synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+	synchronization2Features.pNext = nullptr;
+	synchronization2Features.synchronization2 = VK_TRUE;
+
+	// `VK_EXT_host_query_reset` lets the query manager reset a frame's queries from the CPU rather than recording resets into a command
+	// buffer. Again, it has a feature to turn on too.
+	const bool hostQueryResetEnabled = VulkanFunctionLoaders::IsExtensionSupported(physicalDeviceExtensions, VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME);
+	if (hostQueryResetEnabled)
+	{
+		requestedPhysicalDeviceExtensionNames.push_back(VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME); // 6 - Optional
+	}
+	VkPhysicalDeviceHostQueryResetFeaturesEXT hostQueryResetFeatures = {};
+	hostQueryResetFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES_EXT;
+	hostQueryResetFeatures.pNext = nullptr;
+	hostQueryResetFeatures.hostQueryReset = VK_TRUE;
+
+	// We always ask for `VK_KHR_16bit_storage` (1) so our compute kernels can keep their data in fp16 - but the extension on its own doesn't
+	// let shaders do that: its `storageBuffer16BitAccess` feature has to be turned on too. Likewise, `VK_KHR_shader_float16_int8` and its
+	// `shaderFloat16` feature let them do their maths in fp16. Asking what the device supports needs `vkGetPhysicalDeviceFeatures2KHR`
+	// (from `VK_KHR_get_physical_device_properties2`, at instance level) - and then we enable whatever it said by chaining on the same structs.
+	const bool float16Int8Supported = VulkanFunctionLoaders::IsExtensionSupported(physicalDeviceExtensions, VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME);
+	VkPhysicalDevice16BitStorageFeaturesKHR storage16BitFeatures = {};
+	storage16BitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES_KHR;
+	storage16BitFeatures.pNext = nullptr;
+	VkPhysicalDeviceShaderFloat16Int8FeaturesKHR float16Int8Features = {};
+	float16Int8Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES_KHR;
+	float16Int8Features.pNext = nullptr;
+	if (VulkanFunctionLoaders::vkGetPhysicalDeviceFeatures2KHR != nullptr)
+	{
+		VkPhysicalDeviceFeatures2KHR features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+		features2.pNext = &storage16BitFeatures;
+		storage16BitFeatures.pNext = float16Int8Supported ? &float16Int8Features : nullptr;
+		VulkanFunctionLoaders::vkGetPhysicalDeviceFeatures2KHR(activePhysicalDevice, &features2);
+		storage16BitFeatures.pNext = nullptr;
+	}
+	const bool storageBuffer16BitAccessEnabled = storage16BitFeatures.storageBuffer16BitAccess == VK_TRUE;
+	const bool shaderFloat16Enabled = float16Int8Supported && float16Int8Features.shaderFloat16 == VK_TRUE;
+	if (shaderFloat16Enabled)
+	{
+		requestedPhysicalDeviceExtensionNames.push_back(VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME); // 7 - Optional
+	}
+	LOG_VERBOSE("[OK] fp16 compute support - storageBuffer16BitAccess: {}, shaderFloat16: {}", storageBuffer16BitAccessEnabled, shaderFloat16Enabled);
+
+	// `VK_KHR_draw_indirect_count` lets GPU culling (see `GpuCulling`) draw however many commands it wrote with a single call, taking the
+	// count from a buffer. Unlike the ones above it has no feature to turn on - and without it we fall back on `vkCmdDrawIndexedIndirect`.
+	if (VulkanFunctionLoaders::IsExtensionSupported(physicalDeviceExtensions, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+	{
+		requestedPhysicalDeviceExtensionNames.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME); // 8 - Optional
+	}
+
+	// `VK_KHR_descriptor_update_template` lets `DescriptorSetTemplate` write a whole set with one call. It's core in 1.1, but we may only have
+	// asked for 1.0 - so we go through the extension, and without it `DescriptorSetTemplate` falls back on `vkUpdateDescriptorSets`.
+	const bool descriptorUpdateTemplatesEnabled = VulkanFunctionLoaders::IsExtensionSupported(physicalDeviceExtensions, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+	if (descriptorUpdateTemplatesEnabled)
+	{
+		requestedPhysicalDeviceExtensionNames.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME); // 9 - Optional
+	}
+	LOG_VERBOSE("[OK] Descriptor update template support: {}", descriptorUpdateTemplatesEnabled);
+
+	// Occlusion culling samples the depth buffer (to build a Hi-Z pyramid, see `HiZPyramid`), so the depth has to be in a format that can be
+	// sampled, and the pyramid gets written as `rg32f` storage images - which needs `shaderStorageImageExtendedFormats`, on with every
+	// other feature the device has.
+	LOG_VERBOSE("[OK] Hi-Z support - sampled depth format: {}, shaderStorageImageExtendedFormats: {}",
+		findSampledDepthFormat(activePhysicalDevice) == VK_FORMAT_D32_SFLOAT ? "D32_SFLOAT" : "D16_UNORM", activePhysicalDeviceFeatures.shaderStorageImageExtendedFormats == VK_TRUE);
+
+	// Subgroup arithmetic is what makes our reductions & scans fast (see `ScanPrimitives`). It's core in Vulkan 1.1, so there's no extension to
+	// enable - but the instance & the device both have to be at 1.1 or better for us to use it.
+	const uint32_t deviceApiVersion = std::min(instanceApiVersion, VK_MAKE_API_VERSION(0, VK_API_VERSION_MAJOR(activePhysicalDeviceProperties.apiVersion),
+		VK_API_VERSION_MINOR(activePhysicalDeviceProperties.apiVersion), 0));
+	const SubgroupSupport subgroupSupport = querySubgroupSupport(activePhysicalDevice, deviceApiVersion);
+	LOG_VERBOSE("[OK] Subgroup support at Vulkan {}.{} - size: {}, compute arithmetic: {}", VK_API_VERSION_MAJOR(deviceApiVersion), VK_API_VERSION_MINOR(deviceApiVersion),
+		subgroupSupport.SubgroupSize, subgroupSupport.Arithmetic);
+
+	// Chain on the features for whichever of the optional extensions we're enabling
+	void* featureChain = nullptr;
+	if (timelineSemaphoresEnabled)
+	{
+		timelineSemaphoreFeatures.pNext = featureChain;
+		featureChain = &timelineSemaphoreFeatures;
+	}
+	if (synchronization2Enabled)
+	{
+		synchronization2Features.pNext = featureChain;
+		featureChain = &synchronization2Features;
+	}
+	if (hostQueryResetEnabled)
+	{
+		hostQueryResetFeatures.pNext = featureChain;
+		featureChain = &hostQueryResetFeatures;
+	}
+	if (storageBuffer16BitAccessEnabled)
+	{
+		storage16BitFeatures.pNext = featureChain;
+		featureChain = &storage16BitFeatures;
+	}
+	if (shaderFloat16Enabled)
+	{
+		float16Int8Features.pNext = featureChain;
+		featureChain = &float16Int8Features;
+	}
+
+	LOG_VERBOSE("[OK] Requesting to load: {} physical device extensions.", requestedPhysicalDeviceExtensionNames.size());
+	if (Logger::isEnabled(LogLevel::VeryVerbose))
+	{
+		for (auto requestedExtensionName : requestedPhysicalDeviceExtensionNames)
+		{
+			LOG_VERY_VERBOSE("\t{}", requestedExtensionName);
 		}
 	}
 	
 	// Create a `DeviceCreateInfo` object which we use to construct our logical device
 	VkDeviceCreateInfo deviceCreateInfo = {};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO; // Be careful here - we have to use `DEVICE_CREATE_INFO` not `DEVICE_QUEUE_CREATE_INFO`!
-	deviceCreateInfo.pNext = nullptr;
+	deviceCreateInfo.pNext = featureChain; // Extra features to enable get chained on here
 	deviceCreateInfo.flags = 0;
 	deviceCreateInfo.queueCreateInfoCount = 1; // Providing `1` as we're just using a single physical device for the time being!
 	deviceCreateInfo.pQueueCreateInfos = &deviceQueueCreateInfo; // This would normally be a pointer to the start of a vector of `QueueCreateInfo`s!
@@ -687,10 +802,10 @@ int main()
 	result = VulkanFunctionLoaders::vkCreateDevice(activePhysicalDevice, &deviceCreateInfo, nullptr, &logicalDevice);
 	if (result != VK_SUCCESS)
 	{
-		cout << "[FAIL] Failed to create logical device. VkResult is: " << VulkanHelpers::getFriendlyResultString(result) << endl;
+		LOG_ERROR("[FAIL] Failed to create logical device. VkResult is: {}", VulkanHelpers::getFriendlyResultString(result));
 		return -16;
 	}
-	if (VERBOSE) { cout << "[OK] Successfully created logical device." << endl; }
+	LOG_VERBOSE("[OK] Successfully created logical device.");
 
 	// Bad function names we can attempt to load to mke sure we handle stuff properly
 	std::vector<char const*> badExtensionNames;
@@ -698,10 +813,12 @@ int main()
 	requestedPhysicalDeviceExtensionNames.push_back("VK_KHR_storage_buffer_storage_class_DOES_NOT_EXIST");
 
 	bool boolResult = VulkanFunctionLoaders::LoadDeviceLevelFunction(logicalDevice, requestedPhysicalDeviceExtensionNames[0]);
-	if (!boolResult) cout << "Could not load device level function!" << endl;
+	if (!boolResult) LOG_WARNING("Could not load device level function!");
 
 	boolResult = VulkanFunctionLoaders::LoadDeviceLevelFunctionFromExtension(logicalDevice, requestedPhysicalDeviceExtensionNames[0], requestedPhysicalDeviceExtensionNames);
-	if (!boolResult) cout << "Could not load device level function from extension!" << endl;
+	if (!boolResult) LOG_WARNING("Could not load device level function from extension!");
+
+	createDeviceZone.end();
 
 	// NEXT: Getting a device queue
 
@@ -729,12 +846,12 @@ int main()
 		activeQueueNumber = requestedQueueIndices.at(i);
 		if (activeQueueNumber > activeQueueFamily.queueCount)
 		{
-			cout << "[FAIL] Requested to use active queue at index: " << requestedQueueIndices.at(i) << " but active queue family's available queue count is only: " + activeQueueFamily.queueCount << endl;
+			LOG_ERROR("[FAIL] Requested to use active queue at index: {} but active queue family's available queue count is only: {}", requestedQueueIndices.at(i), activeQueueFamily.queueCount);
 			return -17;
 
 		}
-		vkGetDeviceQueue(logicalDevice, activeQueueFamilyIndex, activeQueueNumber, &queues.at(i));
-		cout << "[OK] Created queue: " << requestedQueueIndices.at(i) << " at queues index: " << i << endl;
+		VulkanFunctionLoaders::vkGetDeviceQueue(logicalDevice, activeQueueFamilyIndex, activeQueueNumber, &queues.at(i));
+		LOG_VERBOSE("[OK] Created queue: {} at queues index: {}", requestedQueueIndices.at(i), i);
 	}
 
 	// NOTE: I skipped "Creating a logical device with geometry	shaders, graphics, and compute queues" on p62 for the time being as I just want to draw
@@ -743,112 +860,405 @@ int main()
 
 	// I'm now to page 7
 
-	
-#ifdef _WIN32
-	
+	// ----- Step 20 -----
+	// When headless there's nothing to present to - so rather than create a window & surface we run our batch of workloads on the
+	// compute-capable queue we picked, wait for it all to complete, and then clean up & exit.
+	bool batchSucceeded = true;
+	if (options.Headless)
+	{
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		VulkanFunctionLoaders::vkGetPhysicalDeviceMemoryProperties(activePhysicalDevice, &memoryProperties);
+
+		std::vector<BatchWorkload> batch;
+		batch.push_back(makeBufferFillWorkload(logicalDevice, memoryProperties, 16 * 1024 * 1024, 0xC0FFEE42u));
+		batch.push_back(makeTransientChainWorkload(logicalDevice, memoryProperties, activePhysicalDeviceProperties.limits.bufferImageGranularity, 4 * 1024 * 1024, 8, 0x5EEDF00Du));
+
+		// Our compute kernels, in the cheapest precision the device can do - as long as they've been compiled (see `shaders/compile_shaders`)
+		// - plus a tiled GEMM, with its tile shape tuned for this device (or remembered from last time, see `GemmTuningCache`). The GEMM's
+		// sizes aren't multiples of any tile shape, so its edges get checked too.
+		ComputeKernelLibrary computeKernels;
+		TiledGemm tiledGemm;
+		if (computeKernels.create(logicalDevice, selectComputePrecision(storageBuffer16BitAccessEnabled, shaderFloat16Enabled)))
+		{
+			batch.push_back(makeAxpyWorkload(logicalDevice, memoryProperties, computeKernels, 1024 * 1024));
 
-	WindowParameters windowParams;
-	windowParams.HInstance = GetModuleHandle(nullptr);
+			const GemmTileConfig gemmTiles = getTunedGemmTiles(activePhysicalDeviceProperties, logicalDevice, memoryProperties, activeQueueFamilyIndex, queues.at(0),
+				computeKernels.getPrecision());
+			if (tiledGemm.create(logicalDevice, computeKernels.getPrecision(), gemmTiles))
+			{
+				batch.push_back(makeTiledGemmWorkload(logicalDevice, memoryProperties, tiledGemm, 100, 72, 40));
+			}
+		}
+		else
+		{
+			LOG_WARNING("[WARNING] Skipping the compute kernel workload - its shaders could not be loaded.");
+		}
 
-	cout << "INSTAAAAAAAAAAAAAAANNNCE: " << windowParams.HInstance << endl;
+		// Our scan primitives, with subgroup arithmetic where the device has it. A million-odd elements is a few hundred partitions, so the
+		// look-back gets a proper workout.
+		ScanPrimitives scanPrimitives;
+		if (scanPrimitives.create(logicalDevice, subgroupSupport))
+		{
+			batch.push_back(makeScanWorkload(logicalDevice, memoryProperties, scanPrimitives, 1000003));
+		}
+		else
+		{
+			LOG_WARNING("[WARNING] Skipping the scan primitives workload - its shaders could not be loaded.");
+		}
 
-	const wchar_t CLASS_NAME[] = L"Sample Window Class";
+		// And the radix sort: 32-bit keys, 64-bit keys with a count over what the sort was recorded for (so it gets clamped), and keys of only
+		// 6 bits - where nearly every key has hundreds of equals, so it's the stability that gets checked.
+		GpuRadixSort radixSort;
+		if (radixSort.create(logicalDevice, subgroupSupport))
+		{
+			batch.push_back(makeRadixSortWorkload(logicalDevice, memoryProperties, radixSort, RadixKeySize::Bits32, 100003, 100003, 32));
+			batch.push_back(makeRadixSortWorkload(logicalDevice, memoryProperties, radixSort, RadixKeySize::Bits64, 70001, 65537, 64));
+			batch.push_back(makeRadixSortWorkload(logicalDevice, memoryProperties, radixSort, RadixKeySize::Bits32, 30011, 30011, 6));
+		}
+		else
+		{
+			LOG_WARNING("[WARNING] Skipping the radix sort workloads - their shaders could not be loaded.");
+		}
 
+		// Stream compaction chained into a second, indirectly-dispatched compaction & indirect arguments - all sized on the GPU, on this queue
+		StreamCompaction streamCompaction;
+		if (streamCompaction.create(logicalDevice, subgroupSupport))
+		{
+			batch.push_back(makeStreamCompactionWorkload(logicalDevice, memoryProperties, streamCompaction, 500009));
+		}
+		else
+		{
+			LOG_WARNING("[WARNING] Skipping the stream compaction workload - its shaders could not be loaded.");
+		}
 
-	// We MUST register the window class before we try to create a window of that class!
-	// Thanks for not mentioning that at all Vulkan Cookbook. I've put the WindowProc near the top btw.
-	WNDCLASS wc = { };
+		// GPU-driven culling of a couple of hundred thousand instances into indirect draw commands - and, if this queue can do graphics,
+		// drawing them depth-only with the count straight from the cull
+		GpuCulling gpuCulling;
+		CulledDepthRenderer culledDepthRenderer;
+		HiZPyramid hiZPyramid;
+		bool cpuCullingSucceeded = true;
+		if (gpuCulling.create(logicalDevice, activePhysicalDeviceProperties.limits.maxDrawIndirectCount))
+		{
+			const bool drawing = (activeQueueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0 &&
+				culledDepthRenderer.create(logicalDevice, activePhysicalDevice, memoryProperties, activePhysicalDeviceFeatures, 640, 360);
+			batch.push_back(makeGpuCullingWorkload(logicalDevice, memoryProperties, gpuCulling, drawing ? &culledDepthRenderer : nullptr, 250000));
 
-	wc.lpfnWndProc = WindowProc;
-	wc.hInstance = windowParams.HInstance;
-	wc.lpszClassName = CLASS_NAME;
+			// With something drawn we can build a Hi-Z pyramid of it in one dispatch, and occlusion cull the same scene against that
+			if (drawing && hiZPyramid.create(logicalDevice, activePhysicalDevice, memoryProperties, activePhysicalDeviceFeatures, culledDepthRenderer.Width, culledDepthRenderer.Height))
+			{
+				batch.push_back(makeHiZOcclusionWorkload(logicalDevice, memoryProperties, gpuCulling, culledDepthRenderer, hiZPyramid, 250000));
+			}
+		}
+		else
+		{
+			// Note: Which is when a renderer has to cull on the CPU instead - so we do that (checked just like the GPU's would have been)
+			LOG_WARNING("[WARNING] Skipping the GPU culling workload - its shaders could not be loaded. Culling on the CPU instead.");
+			JobSystem cullJobs;
+			cullJobs.create();
+			const CullingScene scene = generateCullingScene(250000);
+			const CullInstancesSoA instances = makeCullInstancesSoA(scene);
+			const CullView view = makeCullView(scene.ViewProjection);
+			std::vector<uint32_t> visible;
+			const uint64_t start = TraceRecorder::nowNanoseconds();
+			const uint32_t visibleCount = cullInstancesSoA(view, instances, CpuCullShape::Sphere, visible, getBestCpuCullKernel(), &cullJobs);
+			const double milliseconds = static_cast<double>(TraceRecorder::nowNanoseconds() - start) * 1.0e-6;
+			cpuCullingSucceeded = checkCpuCulling(view, instances, CpuCullShape::Sphere, visible.data(), visibleCount);
+			if (cpuCullingSucceeded)
+			{
+				LOG_INFO("[OK] Culled {} instances on the CPU in {} ms ({} kernel, {} worker thread(s)): {} visible", instances.getCount(), milliseconds,
+					getCpuCullKernelName(getBestCpuCullKernel()), cullJobs.getThreadCount(), visibleCount);
+			}
+			else
+			{
+				LOG_ERROR("[FAIL] CPU culling got the wrong answer!");
+			}
+			cullJobs.destroy();
+		}
 
-	RegisterClass(&wc);
+		// Note: Timestamps are only supported on queue families with a non-zero `timestampValidBits` - `create` warns & returns false otherwise
+		TraceScope batchZone("Headless batch");
+
+		GpuProfiler gpuProfiler;
+		const bool profiling = (options.Profile || tracing) && gpuProfiler.create(logicalDevice, activePhysicalDeviceProperties.limits.timestampPeriod, activeQueueFamily.timestampValidBits);
+
+		// With `--profile` we also want to know how much work each workload actually did (shader invocations etc.)
+		QueryManager queryManager;
+		const bool collectingQueries = options.Profile && queryManager.create(logicalDevice, activeQueueFamily.queueFlags, activePhysicalDeviceFeatures.pipelineStatisticsQuery == VK_TRUE,
+			activePhysicalDeviceProperties.limits.timestampPeriod, activeQueueFamily.timestampValidBits, 1);
+
+		ComputeBatchRunner batchRunner;
+		if (profiling) { batchRunner.setProfiler(&gpuProfiler); }
+		if (collectingQueries) { batchRunner.setQueryManager(&queryManager); }
+		batchSucceeded = cpuCullingSucceeded && batchRunner.create(logicalDevice, activeQueueFamilyIndex, queues.at(0)) && batchRunner.run(batch);
+		batchRunner.destroy();
+		batch.clear(); // Releases the resources our workloads were holding on to - safe because `run` waits for the GPU to finish
+		hiZPyramid.destroy();
+		culledDepthRenderer.destroy();
+		gpuCulling.destroy();
+		streamCompaction.destroy();
+		radixSort.destroy();
+		scanPrimitives.destroy();
+		tiledGemm.destroy();
+		computeKernels.destroy();
+		batchZone.end();
+
+		if (profiling && tracing && !gpuProfiler.getLatestResults().empty())
+		{
+			// Without calibrated timestamps the best we can do is assume the batch's first GPU zone started when we submitted it
+			GpuClockCalibrator calibrator;
+			calibrator.create(vulkanInstance, activePhysicalDevice, logicalDevice, calibratedTimestampsEnabled, activePhysicalDeviceProperties.limits.timestampPeriod, activeQueueFamily.timestampValidBits);
+			const GpuClockCalibration calibration = calibrator.calibrate(gpuProfiler.getLatestResults().front().StartTicks, batchRunner.getLastSubmitNanoseconds());
+			TraceRecorder::recordGpuZones(gpuProfiler.getLatestResults(), calibration, "Compute queue");
+		}
+		if (profiling)
+		{
+			if (options.Profile)
+			{
+				// Note: One message per line, as the whole table won't fit in a single log message
+				std::stringstream summary;
+				gpuProfiler.printSummary(summary);
+				for (string line; std::getline(summary, line); ) { LOG_INFO("{}", line); }
+			}
+			gpuProfiler.destroy();
+		}
+		if (collectingQueries)
+		{
+			std::stringstream summary;
+			queryManager.printSummary(summary);
+			for (string line; std::getline(summary, line); ) { LOG_INFO("{}", line); }
+			queryManager.destroy();
+		}
 
+		if (batchSucceeded) { LOG_INFO("[OK] Headless batch of workloads ran to completion."); }
+		else                { LOG_ERROR("[FAIL] Headless batch of workloads did not complete successfully."); }
+	}
 
+	// ----- Step 21 -----
+	// In offscreen mode we render into images rather than a swapchain and read every frame back to the CPU. The readbacks are pipelined:
+	// up to `FramesInFlight` frames can be rendering / copying at once, and each finished frame gets handed to our consumer as soon as we
+	// notice its timeline value has been reached - so the GPU never waits for us to deal with the previous frame.
+	bool offscreenSucceeded = true;
+	if (options.OffscreenFrames > 0)
+	{
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		VulkanFunctionLoaders::vkGetPhysicalDeviceMemoryProperties(activePhysicalDevice, &memoryProperties);
+
+		// If we've been asked to, frames get written to disk by a `FrameSink` - which encodes & writes them on worker threads, straight from
+		// the readback memory. So the renderer has to hold each frame's slot until the sink tells it (via `releaseFrame`) it's done with it.
+		const bool writingFrames = !options.OutputPath.empty();
+		JobSystem frameJobs;
+		FrameSink frameSink;
+		OffscreenRenderer offscreenRenderer;
+		if (writingFrames)
+		{
+			frameJobs.create();
+			offscreenSucceeded = frameSink.create(options.OutputPath, options.OutputFormat, options.OffscreenWidth, options.OffscreenHeight, VK_FORMAT_R8G8B8A8_UNORM, frameJobs);
+		}
 
-	/*
-	windowParams.HWnd = CreateWindowEx(0,                              // Optional window styles.
-		CLASS_NAME,                     // Window class
-		L"Learn to Program Windows",    // Window text
-		WS_OVERLAPPEDWINDOW,            // Window style
-
-		// Size and position
-		CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT,
-
-		NULL,       // Parent window    
-		NULL,       // Menu
-		windowParams.HInstance,  // Instance handle
-		NULL        // Additional application data
-	);
-	*/
-	windowParams.HWnd = CreateWindow(CLASS_NAME, L"Testing!", WS_OVERLAPPEDWINDOW, 100, 100, 400, 200, nullptr, nullptr, windowParams.HInstance, nullptr);
-		
-	cout << "HWND IZZZZZZZZ: " << windowParams.HWnd << endl;
+		// Our consumer checks each frame came back as the colour we cleared it to (and in the right order), then passes it on to the sink
+		uint64_t framesReceived = 0;
+		uint64_t framesMismatched = 0;
+		offscreenRenderer.setConsumer([&framesReceived, &framesMismatched, &frameSink, &offscreenRenderer, writingFrames](const ReadbackFrame& frame)
+		{
+			uint8_t expected[4];
+			getTestPatternColor(frame.FrameNumber, expected);
+			const uint8_t* lastPixel = frame.Pixels + static_cast<size_t>(frame.Height - 1) * frame.RowPitch + (frame.RowPitch - 4);
+			if (frame.FrameNumber != framesReceived + 1 || std::memcmp(frame.Pixels, expected, 4) != 0 || std::memcmp(lastPixel, expected, 4) != 0)
+			{
+				++framesMismatched;
+			}
+			++framesReceived;
+			LOG_VERY_VERBOSE("[OK] Offscreen frame {} read back.", frame.FrameNumber);
 
-	
+			if (writingFrames) { frameSink.submit(frame, [&offscreenRenderer, frameNumber = frame.FrameNumber]() { offscreenRenderer.releaseFrame(frameNumber); }); }
+		}, writingFrames);
 
-	//VkWin32SurfaceCreateInfoKHR foo;
+		// MSAA needs a render pass, so a graphics queue - and the sample count has to be one the device supports for both colour & depth
+		// attachments. If not, we step down to the next supported count rather than failing.
+		VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+		if (options.MsaaSamples > 1)
+		{
+			const VkSampleCountFlags supportedSamples = activePhysicalDeviceProperties.limits.framebufferColorSampleCounts & activePhysicalDeviceProperties.limits.framebufferDepthSampleCounts;
+			if ((activeQueueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0)
+			{
+				LOG_WARNING("[WARNING] MSAA needs a graphics queue, but we're using a compute-only one - rendering without MSAA.");
+			}
+			else
+			{
+				uint32_t samples = options.MsaaSamples;
+				while (samples > 1 && (supportedSamples & samples) == 0) { samples >>= 1; }
+				if (samples != options.MsaaSamples) { LOG_WARNING("[WARNING] {}x MSAA isn't supported - using {}x instead.", options.MsaaSamples, samples); }
+				msaaSamples = static_cast<VkSampleCountFlagBits>(samples);
+			}
+		}
 
-	VkWin32SurfaceCreateInfoKHR surfaceCreateInfo = {};
-	surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
-	surfaceCreateInfo.pNext = nullptr;
-	surfaceCreateInfo.flags = 0;
-	surfaceCreateInfo.hinstance = windowParams.HInstance;
-	surfaceCreateInfo.hwnd = windowParams.HWnd;
-	
+		TraceScope offscreenZone("Offscreen frames");
+		const uint64_t offscreenStart = TraceRecorder::nowNanoseconds();
+		offscreenSucceeded = offscreenSucceeded && offscreenRenderer.create(logicalDevice, memoryProperties, activeQueueFamilyIndex, queues.at(0),
+			options.OffscreenWidth, options.OffscreenHeight, options.FramesInFlight, VK_FORMAT_R8G8B8A8_UNORM, msaaSamples);
 
-	VkSurfaceKHR presentationSurface = VK_NULL_HANDLE;
+		const FrameRecorder recordFrame = makeTestPatternRecorder();
+		const RenderPassRecorder recordMultisampledFrame = makeTestPatternRenderPassRecorder();
+		for (uint32_t frame = 0; offscreenSucceeded && frame < options.OffscreenFrames; ++frame)
+		{
+			if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) { offscreenSucceeded = offscreenRenderer.renderMultisampledFrame(recordMultisampledFrame); }
+			else                                      { offscreenSucceeded = offscreenRenderer.renderFrame(recordFrame); }
+		}
+		offscreenSucceeded = offscreenSucceeded && offscreenRenderer.finish();
 
-	result = vkCreateWin32SurfaceKHR(vulkanInstance, &surfaceCreateInfo, nullptr, &presentationSurface);
-	if (result != VK_SUCCESS)
-	{
-		cout << "[FAIL] Error creating Win32 surface: " << VulkanHelpers::getFriendlyResultString(result) << endl;
-		return -18;
+		// CAREFUL: If anything failed part way there may still be frames on the GPU - so wait for it before tearing everything down. And the
+		// sink's workers may still be reading from the renderer's memory, so the sink has to finish before the renderer goes.
+		if (!offscreenSucceeded) { VulkanFunctionLoaders::vkDeviceWaitIdle(logicalDevice); }
+		if (writingFrames)
+		{
+			offscreenSucceeded = frameSink.finish() && offscreenSucceeded;
+			frameSink.destroy();
+			frameJobs.destroy();
+		}
+		const double offscreenSeconds = (TraceRecorder::nowNanoseconds() - offscreenStart) / 1.0e9;
+		const uint64_t stallCount = offscreenRenderer.getStallCount();
+		offscreenRenderer.destroy();
+		offscreenZone.end();
+
+		offscreenSucceeded = offscreenSucceeded && framesReceived == options.OffscreenFrames && framesMismatched == 0;
+		if (offscreenSucceeded)
+		{
+			LOG_INFO("[OK] Rendered & read back {} offscreen frame(s) at {}x{} in {} seconds ({} frames/second). Stalled waiting for a free slot {} time(s).",
+				framesReceived, options.OffscreenWidth, options.OffscreenHeight, offscreenSeconds, framesReceived / offscreenSeconds, stallCount);
+			if (writingFrames)
+			{
+				const double mebibytesWritten = frameSink.getBytesWritten() / (1024.0 * 1024.0);
+				LOG_INFO("[OK] Wrote {} frame(s) ({} MiB, {} MiB of it with direct I/O) to: {} - {} MiB/second.", frameSink.getFramesWritten(), mebibytesWritten,
+					frameSink.getDirectBytesWritten() / (1024.0 * 1024.0), options.OutputPath, mebibytesWritten / offscreenSeconds);
+			}
+		}
+		else
+		{
+			LOG_ERROR("[FAIL] Offscreen rendering did not complete successfully. Frames read back: {} of {}, with {} mismatched.", framesReceived, options.OffscreenFrames, framesMismatched);
+		}
 	}
-	cout << "[OK] Successfully created surface." << endl;
+
+	if (!windowless)
+	{
+
+
+		WindowParameters windowParams;
+#ifdef _WIN32
+		windowParams.HInstance = GetModuleHandle(nullptr);
+
+		LOG_VERBOSE("INSTAAAAAAAAAAAAAAANNNCE: {}", windowParams.HInstance);
+
+		const wchar_t CLASS_NAME[] = L"Sample Window Class";
+
+
+		// We MUST register the window class before we try to create a window of that class!
+		// Thanks for not mentioning that at all Vulkan Cookbook. I've put the WindowProc near the top btw.
+		WNDCLASS wc = { };
+
+		wc.lpfnWndProc = WindowProc;
+		wc.hInstance = windowParams.HInstance;
+		wc.lpszClassName = CLASS_NAME;
+
+		RegisterClass(&wc);
+
+
+
+		/*
+		windowParams.HWnd = CreateWindowEx(0,                              // Optional window styles.
+			CLASS_NAME,                     // Window class
+			L"Learn to Program Windows",    // Window text
+			WS_OVERLAPPEDWINDOW,            // Window style
+
+			// Size and position
+			CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT,
+
+			NULL,       // Parent window    
+			NULL,       // Menu
+			windowParams.HInstance,  // Instance handle
+			NULL        // Additional application data
+		);
+		*/
+		windowParams.HWnd = CreateWindow(CLASS_NAME, L"Testing!", WS_OVERLAPPEDWINDOW, 100, 100, 400, 200, nullptr, nullptr, windowParams.HInstance, nullptr);
+
+		LOG_VERBOSE("HWND IZZZZZZZZ: {}", windowParams.HWnd);
+
+
+
+		//VkWin32SurfaceCreateInfoKHR foo;
+
+		VkWin32SurfaceCreateInfoKHR surfaceCreateInfo = {};
+		surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+		surfaceCreateInfo.pNext = nullptr;
+		surfaceCreateInfo.flags = 0;
+		surfaceCreateInfo.hinstance = windowParams.HInstance;
+		surfaceCreateInfo.hwnd = windowParams.HWnd;
+
+
+		VkSurfaceKHR presentationSurface = VK_NULL_HANDLE;
+
+		result = vkCreateWin32SurfaceKHR(vulkanInstance, &surfaceCreateInfo, nullptr, &presentationSurface);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR("[FAIL] Error creating Win32 surface: {}", VulkanHelpers::getFriendlyResultString(result));
+			return -18;
+		}
+		LOG_VERBOSE("[OK] Successfully created surface.");
 
 
 
 #elif  __linux
-	windowParams.Connection = xcb_connect();
-	windowParams.Window = xcb_generate_id();
+		// Note: `xcb_connect` never returns null - if there's no X server (e.g., `DISPLAY` isn't set) we get a connection object in an error state instead
+		windowParams.Connection = xcb_connect(nullptr, nullptr);
+		if (xcb_connection_has_error(windowParams.Connection))
+		{
+			LOG_ERROR("[FAIL] Could not connect to an X server. Run with `--headless` on machines without a display.");
+			xcb_disconnect(windowParams.Connection);
+			return -19;
+		}
+		windowParams.Window = xcb_generate_id(windowParams.Connection);
 #endif
 
 
 
-	// UP TO HERE! p81
-	// Farrrrrr out - we need to check that our physical device and presentation surface suports drawing now. FFS, didn't we already do that
-	// when we asked for a queue family on a physical device that supports VK_QUEUE_GRAPHICS_BIT?!?!?!?!
+		// UP TO HERE! p81
+		// Farrrrrr out - we need to check that our physical device and presentation surface suports drawing now. FFS, didn't we already do that
+		// when we asked for a queue family on a physical device that supports VK_QUEUE_GRAPHICS_BIT?!?!?!?!
+
 
 
 
+		Logger::flush(); // Make sure everything we've logged is on screen before we sit waiting for input
+		int x;
+		std::cin >> x;
 
-	int x;
-	std::cin >> x;
+#ifdef __linux
+		xcb_disconnect(windowParams.Connection);
+#endif
+	}
 
 
 	// ----- Clean up -----
 	// Destroy the logical device
+	// Note: This is the one place we wait for the device to go idle - everything that frees objects while the GPU is running hands them to
+	// a `DeferredDeletionQueue` instead. But whatever's left has to be finished before the device goes.
 	if (logicalDevice)
 	{
-		vkDestroyDevice(logicalDevice, nullptr);
+		VulkanFunctionLoaders::vkDeviceWaitIdle(logicalDevice);
+		VulkanFunctionLoaders::vkDestroyDevice(logicalDevice, nullptr);
 	}
 
 	// Destroy the vulkan instance
 	if (vulkanInstance)
 	{
-		vkDestroyInstance(vulkanInstance, nullptr);
+		VulkanFunctionLoaders::vkDestroyInstance(vulkanInstance, nullptr);
 		vulkanInstance = nullptr;
 	}
 
 	// Unload the vulkan library
-#if defined _WIN32
-	FreeLibrary(vulkanLibrary);
-#elif defined __linux
-	dlclose(vulkan_library);
-#endif
-	vulkanLibrary = nullptr;
-	
-	
+	DisconnectFromVulkanLoaderLibrary(vulkanLibrary);
+
+	if (tracing) { TraceRecorder::writeChromeTraceJson(options.TracePath); }
+
+	if (!batchSucceeded) { return -20; }
+	return offscreenSucceeded ? 0 : -22;
 }
\ No newline at end of file
@@ -0,0 +1,1892 @@
+// cpp_vulkan_basecode_benchmarks.cpp : Micro & macro benchmarks of the basecode - startup phases, allocation, submission, compute work
+// and offscreen rendering with readback.
+// Results go to JSON and can be compared against a baseline file from an earlier run to catch regressions.
+//
+// Note: Everything here runs headless on a compute queue, so it works on software implementations like lavapipe (e.g., in CI with no GPU).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "VulkanFunctions.h"
+#include "VulkanHelpers.hpp"
+#include "HeadlessContext.hpp"
+#include "GpuBuffer.hpp"
+#include "GpuProfiler.hpp"
+#include "ComputeBatch.hpp"
+#include "TiledGemm.hpp"
+#include "ScanPrimitives.hpp"
+#include "StreamCompaction.hpp"
+#include "RadixSort.hpp"
+#include "GpuCulling.hpp"
+#include "CpuCulling.hpp"
+#include "HiZPyramid.hpp"
+#include "TransformHierarchy.hpp"
+#include "DrawPackets.hpp"
+#include "OffscreenRenderer.hpp"
+#include "RenderGraph.hpp"
+#include "ObjectCache.hpp"
+#include "DescriptorTemplate.hpp"
+#include "SyncObjectPool.hpp"
+#include "Benchmark.hpp"
+#include "JobSystem.hpp"
+
+const char* const ApplicationName = "cpp_vulkan_basecode_benchmarks";
+
+// Options that can be set from the command line
+struct BenchmarkOptions
+{
+	string OutputPath = "benchmark_results.json"; // `--out <file.json>`: Where to write our results
+	string BaselinePath;                          // `--baseline <file.json>`: Results from an earlier run to compare against
+	RegressionThresholds Thresholds;              // `--threshold <percent>` or `--threshold <name>=<percent>`: Allowed slowdown vs the baseline
+	BenchmarkSettings Settings;                   // `--warmup <n>`, `--repetitions <n>`, `--filter <text>`
+	LogLevel Level = LogLevel::Info;              // `--log-level <level>`: As per the main executable
+};
+
+// Method to parse our command line arguments into a `BenchmarkOptions` struct. Returns false if an argument is malformed.
+bool ParseBenchmarkOptions(int argc, char* argv[], BenchmarkOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--out" && hasValue) { options.OutputPath = argv[++i]; }
+		else if (arg == "--baseline" && hasValue) { options.BaselinePath = argv[++i]; }
+		else if (arg == "--warmup" && hasValue) { options.Settings.WarmupRepetitions = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); }
+		else if (arg == "--repetitions" && hasValue) { options.Settings.Repetitions = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); }
+		else if (arg == "--filter" && hasValue) { options.Settings.Filter = argv[++i]; }
+		else if (arg == "--threshold" && hasValue)
+		{
+			// Either a default for everything ("15") or an override for one benchmark ("startup/create_device=50")
+			const string value = argv[++i];
+			const size_t equals = value.rfind('=');
+			if (equals == string::npos) { options.Thresholds.DefaultPercent = std::strtod(value.c_str(), nullptr); }
+			else { options.Thresholds.PerBenchmarkPercent[value.substr(0, equals)] = std::strtod(value.c_str() + equals + 1, nullptr); }
+		}
+		else if (arg == "--log-level" && hasValue)
+		{
+			if (!Logger::parseLevel(argv[++i], options.Level))
+			{
+				LOG_ERROR("[FAIL] Unknown log level: {} - expected one of: error, warning, info, verbose, very-verbose.", argv[i]);
+				return false;
+			}
+		}
+		else
+		{
+			LOG_ERROR("[FAIL] Unknown (or incomplete) command line argument: {}", arg);
+			return false;
+		}
+	}
+	if (options.Settings.Repetitions == 0)
+	{
+		LOG_ERROR("[FAIL] `--repetitions` must be at least 1.");
+		return false;
+	}
+	return true;
+}
+
+// A command pool, one empty pre-recorded command buffer per submission & a fence - i.e., the least we can submit to a queue
+struct SubmissionFixture
+{
+	VkDevice Device = VK_NULL_HANDLE;
+	VkCommandPool CommandPool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> CommandBuffers;
+	VkFence Fence = VK_NULL_HANDLE;
+
+	bool create(VkDevice device, uint32_t queueFamilyIndex, uint32_t numCommandBuffers)
+	{
+		Device = device;
+
+		VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+		commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		commandPoolCreateInfo.pNext = nullptr;
+		commandPoolCreateInfo.flags = 0;
+		commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+		if (VulkanFunctionLoaders::vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &CommandPool) != VK_SUCCESS) { return false; }
+
+		VkCommandBufferAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.commandPool = CommandPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = numCommandBuffers;
+		CommandBuffers.resize(numCommandBuffers);
+		if (VulkanFunctionLoaders::vkAllocateCommandBuffers(device, &allocateInfo, CommandBuffers.data()) != VK_SUCCESS) { return false; }
+
+		// Note: No ONE_TIME_SUBMIT flag - we submit these same (empty) command buffers over and over
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.pNext = nullptr;
+		beginInfo.flags = 0;
+		beginInfo.pInheritanceInfo = nullptr;
+		for (auto commandBuffer : CommandBuffers)
+		{
+			if (VulkanFunctionLoaders::vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) { return false; }
+			if (VulkanFunctionLoaders::vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) { return false; }
+		}
+
+		VkFenceCreateInfo fenceCreateInfo = {};
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceCreateInfo.pNext = nullptr;
+		fenceCreateInfo.flags = 0;
+		return VulkanFunctionLoaders::vkCreateFence(device, &fenceCreateInfo, nullptr, &Fence) == VK_SUCCESS;
+	}
+
+	// Method to submit every command buffer in one `vkQueueSubmit` and block until the GPU is done with them
+	bool submitAndWait(VkQueue queue)
+	{
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = nullptr;
+		submitInfo.waitSemaphoreCount = 0;
+		submitInfo.pWaitSemaphores = nullptr;
+		submitInfo.pWaitDstStageMask = nullptr;
+		submitInfo.commandBufferCount = static_cast<uint32_t>(CommandBuffers.size());
+		submitInfo.pCommandBuffers = CommandBuffers.data();
+		submitInfo.signalSemaphoreCount = 0;
+		submitInfo.pSignalSemaphores = nullptr;
+
+		if (VulkanFunctionLoaders::vkQueueSubmit(queue, 1, &submitInfo, Fence) != VK_SUCCESS) { return false; }
+		if (VulkanFunctionLoaders::vkWaitForFences(Device, 1, &Fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) { return false; }
+		return VulkanFunctionLoaders::vkResetFences(Device, 1, &Fence) == VK_SUCCESS;
+	}
+
+	void destroy()
+	{
+		if (Fence != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkDestroyFence(Device, Fence, nullptr); Fence = VK_NULL_HANDLE; }
+		if (CommandPool != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkDestroyCommandPool(Device, CommandPool, nullptr); CommandPool = VK_NULL_HANDLE; }
+		CommandBuffers.clear();
+	}
+};
+
+// What a typical draw might bind: some globals, its instance data, a handful of material buffers and somewhere to write to
+struct DrawDescriptors
+{
+	VkDescriptorBufferInfo Globals;
+	VkDescriptorBufferInfo Instances;
+	VkDescriptorBufferInfo Materials[4];
+	VkDescriptorBufferInfo Output;
+};
+template <> struct DescriptorLayout<DrawDescriptors>
+{
+	static constexpr std::array<DescriptorBinding, 4> Bindings = {
+		DESCRIPTOR_BINDING(DrawDescriptors, Globals,   0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(DrawDescriptors, Instances, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(DrawDescriptors, Materials, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		DESCRIPTOR_BINDING(DrawDescriptors, Output,    3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) };
+};
+
+// A descriptor set with the `DrawDescriptors` layout, plus a buffer for its descriptors to point into
+struct DescriptorFixture
+{
+	DescriptorSetTemplate<DrawDescriptors> Template;
+	VkDescriptorPool Pool = VK_NULL_HANDLE;
+	VkDescriptorSet Set = VK_NULL_HANDLE;
+	GpuBuffer Buffer;
+	DrawDescriptors Descriptors = {};
+
+	bool create(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, VkDeviceSize offsetAlignment)
+	{
+		if (!Template.create(device)) { return false; }
+
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		DescriptorSetTemplate<DrawDescriptors>::addPoolSizes(poolSizes, 1);
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.pNext = nullptr;
+		poolCreateInfo.flags = 0;
+		poolCreateInfo.maxSets = 1;
+		poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolCreateInfo.pPoolSizes = poolSizes.data();
+		if (VulkanFunctionLoaders::vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &Pool) != VK_SUCCESS) { return false; }
+
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.descriptorPool = Pool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &Template.SetLayout;
+		if (VulkanFunctionLoaders::vkAllocateDescriptorSets(device, &allocateInfo, &Set) != VK_SUCCESS) { return false; }
+
+		// Every descriptor gets its own (suitably aligned) range of the one buffer
+		const VkDeviceSize rangeSize = std::max<VkDeviceSize>(offsetAlignment, 256);
+		if (!Buffer.create(device, memoryProperties, rangeSize * 7, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) { return false; }
+		VkDescriptorBufferInfo* infos[7] = { &Descriptors.Globals, &Descriptors.Instances, &Descriptors.Materials[0], &Descriptors.Materials[1],
+			&Descriptors.Materials[2], &Descriptors.Materials[3], &Descriptors.Output };
+		for (uint32_t i = 0; i < 7; ++i) { *infos[i] = { Buffer.Buffer, rangeSize * i, rangeSize }; }
+		return true;
+	}
+
+	void destroy(VkDevice device)
+	{
+		Buffer.destroy(device);
+		if (Pool != VK_NULL_HANDLE) { VulkanFunctionLoaders::vkDestroyDescriptorPool(device, Pool, nullptr); Pool = VK_NULL_HANDLE; }
+		Set = VK_NULL_HANDLE;
+		Template.destroy();
+	}
+};
+
+// The scaffolding every GPU benchmark fixture shares: the device its buffers live on, the device-local buffers it made with `createBuffer`
+// (which `destroyBuffers` destroys), and a persistently mapped staging buffer that inputs go up to the GPU & outputs come back through.
+struct GpuFixture
+{
+	static constexpr VkBufferUsageFlags StorageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkPhysicalDeviceMemoryProperties* MemoryProperties = nullptr;
+	GpuBuffer Staging;
+
+	bool createStaging(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, VkDeviceSize stagingSize)
+	{
+		Device = device;
+		MemoryProperties = &memoryProperties;
+		return Staging.create(device, memoryProperties, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+	}
+
+	// Method to create one of our device-local buffers
+	// Note: Call `createStaging` first
+	bool createBuffer(GpuBuffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage = StorageUsage)
+	{
+		if (std::find(buffers.begin(), buffers.end(), &buffer) == buffers.end()) { buffers.push_back(&buffer); }
+		return buffer.create(Device, *MemoryProperties, size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	// Method to copy the staging buffer into each of `destinations` in turn - the first gets its whole size from the start, the next
+	// from right after that, and so on - and make the copies visible to shaders
+	bool uploadFromStaging(ComputeBatchRunner& runner, const string& name, const std::vector<const GpuBuffer*>& destinations) const
+	{
+		return runOnce(runner, name, [this, &destinations](VkCommandBuffer commandBuffer)
+		{
+			VkDeviceSize offset = 0;
+			for (const GpuBuffer* destination : destinations)
+			{
+				const VkBufferCopy region = { offset, 0, destination->Size };
+				VulkanFunctionLoaders::vkCmdCopyBuffer(commandBuffer, Staging.Buffer, destination->Buffer, 1, &region);
+				offset += destination->Size;
+			}
+
+			// Note: Later batches are ordered after this one by the runner's fence, but the copies still have to be made visible to them
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.pNext = nullptr;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+			VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			return true;
+		});
+	}
+
+	// Method to make a workload that copies the first `sizeInBytes` of what a compute shader wrote to `source` into the staging buffer
+	// (at `stagingOffset`), where the host can read it
+	BatchWorkload makeReadbackWorkload(const GpuBuffer& source, VkDeviceSize sizeInBytes, VkDeviceSize stagingOffset = 0) const
+	{
+		BatchWorkload workload;
+		workload.Name = "readback";
+		workload.Record = [this, &source, sizeInBytes, stagingOffset](VkCommandBuffer commandBuffer)
+		{
+			recordComputeToComputeBarrier(commandBuffer);
+			const VkBufferCopy region = { 0, stagingOffset, sizeInBytes };
+			VulkanFunctionLoaders::vkCmdCopyBuffer(commandBuffer, source.Buffer, Staging.Buffer, 1, &region);
+
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.pNext = nullptr;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			return true;
+		};
+		return workload;
+	}
+
+	// Method to record `record` into a batch of its own, and submit & wait for it
+	static bool runOnce(ComputeBatchRunner& runner, const string& name, const std::function<bool(VkCommandBuffer)>& record)
+	{
+		std::vector<BatchWorkload> batch = { { name, record, nullptr } };
+		return runner.run(batch);
+	}
+
+	// CAREFUL: The GPU must be finished with all of our buffers before we call this!
+	void destroyBuffers()
+	{
+		for (GpuBuffer* buffer : buffers) { buffer->destroy(Device); }
+		buffers.clear();
+		Staging.destroy(Device);
+	}
+
+private:
+	std::vector<GpuBuffer*> buffers;
+};
+
+// What every GPU benchmark has: the workloads that get timed (its own comes last - the one whose GPU time we report), and how to check
+// it. Checking is kept out of the timing loop: once the suite has run, `verifyGpuBenchmark` runs the workloads once more followed by
+// `Readback`, then hands over to `Verify` to look at what came back.
+struct GpuBenchmark
+{
+	string Name;
+	std::function<void()> ResetDescriptors; // Called before every run (the runner has always waited for the last one to finish)
+	std::vector<BatchWorkload> Workloads;
+	std::vector<BatchWorkload> Readback;    // Copies the output somewhere the host can see it - usually the fixture's staging buffer
+	std::function<bool(ComputeBatchRunner&)> Verify; // Whether the output is right. Optional - benchmarks without one aren't checked.
+};
+
+// Method to run `benchmark` once more and check what it wrote (see `GpuBenchmark`). Returns true if it was right, or has no check.
+bool verifyGpuBenchmark(ComputeBatchRunner& runner, GpuBenchmark& benchmark)
+{
+	if (!benchmark.Verify) { return true; }
+	if (benchmark.ResetDescriptors) { benchmark.ResetDescriptors(); }
+	std::vector<BatchWorkload> batch = benchmark.Workloads;
+	batch.insert(batch.end(), benchmark.Readback.begin(), benchmark.Readback.end());
+	if (!runner.run(batch))
+	{
+		LOG_ERROR("[FAIL] Could not read back the output of: {}", benchmark.Name);
+		return false;
+	}
+	if (!benchmark.Verify(runner))
+	{
+		LOG_ERROR("[FAIL] {} got the wrong answer!", benchmark.Name);
+		return false;
+	}
+	return true;
+}
+
+// Everything needed to benchmark our compute kernels in one precision: a kernel library, and device-local inputs & outputs.
+// Every precision is given the same random floats in [-1, 1] - the fp16 variants get them rounded to halves - and we check the outputs
+// against a double precision reference made from those ORIGINAL floats. So the errors we report include what rounding the inputs to
+// fp16 costs, which is the honest answer to "what do we lose by switching".
+struct KernelFixture : GpuFixture
+{
+	static constexpr uint32_t ElementCount = 4 * 1024 * 1024;
+	static constexpr uint32_t MatrixSize = 512;
+
+	ComputeKernelLibrary Kernels;
+	TiledGemm Tiled; // Only created if we could tune (or find) a tile shape for it
+	GpuBuffer X, Y, Result, ReduceScratch, ReduceResult, A, B, C;
+
+	bool create(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, ComputePrecision precision)
+	{
+		if (!Kernels.create(device, precision)) { return false; }
+
+		const VkDeviceSize elementSize = Kernels.getElementSize();
+		const VkDeviceSize vectorSize = ElementCount * elementSize;
+		const VkDeviceSize matrixSize = MatrixSize * MatrixSize * elementSize;
+		return createStaging(device, memoryProperties, 2 * vectorSize + 2 * matrixSize) &&
+			createBuffer(X, vectorSize) && createBuffer(Y, vectorSize) && createBuffer(Result, vectorSize) &&
+			createBuffer(ReduceScratch, std::max<VkDeviceSize>(ComputeKernelLibrary::getReduceScratchSize(ElementCount), 256)) && createBuffer(ReduceResult, 256) &&
+			createBuffer(A, matrixSize) && createBuffer(B, matrixSize) && createBuffer(C, matrixSize);
+	}
+
+	// Method to upload the inputs (x & y, then a & b), converted to our precision
+	bool upload(ComputeBatchRunner& runner, const std::vector<float>& xs, const std::vector<float>& ys, const std::vector<float>& as, const std::vector<float>& bs)
+	{
+		uint8_t* staging = static_cast<uint8_t*>(Staging.Mapped);
+		writeElements(staging, xs);
+		writeElements(staging + X.Size, ys);
+		writeElements(staging + X.Size + Y.Size, as);
+		writeElements(staging + X.Size + Y.Size + A.Size, bs);
+		return uploadFromStaging(runner, string("upload-") + getComputePrecisionName(Kernels.getPrecision()), { &X, &Y, &A, &B });
+	}
+
+	// Method to hand back the descriptor sets of every kernel we've recorded.
+	// CAREFUL: The GPU must be finished with all of them!
+	void resetDescriptors()
+	{
+		Kernels.resetDescriptors();
+		Tiled.resetDescriptors();
+	}
+
+	// The `i`th element of what we last read back, in our precision
+	double readElement(size_t i) const
+	{
+		if (Kernels.getPrecision() == ComputePrecision::Fp32) { return static_cast<const float*>(Staging.Mapped)[i]; }
+		return halfToFloat(static_cast<const uint16_t*>(Staging.Mapped)[i]);
+	}
+
+	// CAREFUL: The GPU must be finished with everything recorded from our kernels before we call this!
+	void destroy()
+	{
+		Kernels.destroy();
+		Tiled.destroy();
+		destroyBuffers();
+	}
+
+private:
+	void writeElements(uint8_t* destination, const std::vector<float>& values) const
+	{
+		if (Kernels.getPrecision() == ComputePrecision::Fp32)
+		{
+			std::memcpy(destination, values.data(), values.size() * sizeof(float));
+			return;
+		}
+		auto* halves = reinterpret_cast<uint16_t*>(destination);
+		for (size_t i = 0; i < values.size(); ++i) { halves[i] = floatToHalf(values[i]); }
+	}
+};
+
+// One compute kernel benchmark: how much work it does, and (once it's been checked) how far off its output was
+struct KernelBenchmark : GpuBenchmark
+{
+	double BytesAccessed = 0.0;            // What the kernel has to read & write, for its GB/s
+	double FloatingPointOperations = 0.0;  // For its GFLOP/s - only worth reporting for GEMM
+	double Tolerance = 0.0;                // Of its error, relative to the largest reference value
+	double MaxRelativeError = 0.0;         // Set by its `Verify`
+};
+
+// Everything needed to benchmark our scan primitives & stream compaction in one variant (subgroup arithmetic, or shared memory): the
+// primitives, and device-local inputs & outputs.
+struct PrimitivesFixture : GpuFixture
+{
+	static constexpr uint32_t ElementCount = 16 * 1024 * 1024;
+
+	ScanPrimitives Primitives;
+	StreamCompaction Compaction;
+	GpuBuffer Values, Heads, Output, LookBack, Sum;
+
+	bool create(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, const SubgroupSupport& subgroups)
+	{
+		if (!Primitives.create(device, subgroups) || !Compaction.create(device, subgroups)) { return false; }
+
+		const VkDeviceSize arraySize = ElementCount * sizeof(uint32_t);
+		return createStaging(device, memoryProperties, 2 * arraySize) &&
+			createBuffer(Values, arraySize) && createBuffer(Heads, arraySize) && createBuffer(Output, arraySize) &&
+			createBuffer(LookBack, ScanPrimitives::getLookBackSize(ElementCount)) && createBuffer(Sum, sizeof(uint32_t));
+	}
+
+	// Method to upload the values & head flags
+	bool upload(ComputeBatchRunner& runner, const std::vector<uint32_t>& values, const std::vector<uint32_t>& heads)
+	{
+		std::memcpy(Staging.Mapped, values.data(), static_cast<size_t>(Values.Size));
+		std::memcpy(static_cast<uint8_t*>(Staging.Mapped) + Values.Size, heads.data(), static_cast<size_t>(Heads.Size));
+		return uploadFromStaging(runner, string("upload-primitives-") + (Primitives.usesSubgroups() ? "subgroup" : "shared"), { &Values, &Heads });
+	}
+
+	// What we last read back
+	const uint32_t* getReadback() const { return static_cast<const uint32_t*>(Staging.Mapped); }
+
+	// CAREFUL: The GPU must be finished with everything recorded since the last reset!
+	void resetDescriptors()
+	{
+		Primitives.resetDescriptors();
+		Compaction.resetDescriptors();
+	}
+
+	// CAREFUL: The GPU must be finished with everything recorded from our primitives before we call this!
+	void destroy()
+	{
+		Primitives.destroy();
+		Compaction.destroy();
+		destroyBuffers();
+	}
+};
+
+// One scan primitive (or stream compaction) benchmark: how much memory it reads & writes
+struct PrimitiveBenchmark : GpuBenchmark
+{
+	double BytesAccessed = 0.0;
+};
+
+// Everything needed to benchmark the radix sort at every size: pairs sized for the biggest sort the device can hold (see `create`), the
+// sort's ping-pong copies & state, and pristine keys & values to restore before every sort. Everything goes to & from the GPU through
+// the staging buffer, a chunk at a time. The keys are `getRadixSortTestKeyWord` of their word's index, and the values their indices.
+struct SortFixture : GpuFixture
+{
+	static constexpr uint32_t MaxElementCount = 100000000;
+	static constexpr VkDeviceSize StagingSize = 64 * 1024 * 1024;
+
+	GpuRadixSort Sort;
+	uint32_t CapacityWords = 0; // 32-bit words each buffer of keys or values holds: that many 32-bit keys, or half as many 64-bit ones
+	GpuBuffer Keys, Values, TempKeys, TempValues, PristineKeys, PristineValues, Count, State;
+
+	// Method to create the sort & its buffers, and upload the pristine pairs. We start at `MaxElementCount` pairs (or as many as a storage
+	// buffer binding can reach) and try a tenth as many each time the memory runs out, down to a million.
+	bool create(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, const VkPhysicalDeviceLimits& limits, const SubgroupSupport& subgroups,
+		ComputeBatchRunner& runner)
+	{
+		if (!Sort.create(device, subgroups) || !createStaging(device, memoryProperties, StagingSize) ||
+			!createBuffer(Count, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT))
+		{
+			return false;
+		}
+
+		for (uint32_t capacity = std::min<uint32_t>(MaxElementCount, limits.maxStorageBufferRange / sizeof(uint32_t)); capacity >= 1000000; capacity /= 10)
+		{
+			const VkDeviceSize size = static_cast<VkDeviceSize>(capacity) * sizeof(uint32_t);
+			if (createBuffer(Keys, size) && createBuffer(Values, size) && createBuffer(TempKeys, size) && createBuffer(TempValues, size) &&
+				createBuffer(PristineKeys, size) && createBuffer(PristineValues, size) &&
+				createBuffer(State, GpuRadixSort::getStateSize(capacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT))
+			{
+				CapacityWords = capacity;
+				break;
+			}
+			destroyPairs();
+			LOG_WARNING("[WARNING] Not enough memory to sort {} pairs - trying a tenth as many.", capacity);
+		}
+		if (CapacityWords == 0) { return false; }
+
+		for (VkDeviceSize offset = 0; offset < Keys.Size; offset += StagingSize)
+		{
+			const VkDeviceSize chunkSize = std::min(StagingSize, Keys.Size - offset);
+			const uint32_t firstWord = static_cast<uint32_t>(offset / sizeof(uint32_t));
+			uint32_t* words = static_cast<uint32_t*>(Staging.Mapped);
+			for (uint32_t i = 0; i < chunkSize / sizeof(uint32_t); ++i) { words[i] = getRadixSortTestKeyWord(firstWord + i); }
+			if (!copyChunk(runner, Staging, 0, PristineKeys, offset, chunkSize)) { return false; }
+			for (uint32_t i = 0; i < chunkSize / sizeof(uint32_t); ++i) { words[i] = firstWord + i; }
+			if (!copyChunk(runner, Staging, 0, PristineValues, offset, chunkSize)) { return false; }
+		}
+		return true;
+	}
+
+	// Method to make a workload that puts the first `count` pristine pairs back (sorting sorted keys would flatter us) and sets the count
+	BatchWorkload makeRestoreWorkload(RadixKeySize keySize, uint32_t count)
+	{
+		BatchWorkload workload;
+		workload.Name = "restore";
+		workload.Record = [this, keySize, count](VkCommandBuffer commandBuffer)
+		{
+			const VkDeviceSize keysSize = static_cast<VkDeviceSize>(count) * (keySize == RadixKeySize::Bits32 ? 1 : 2) * sizeof(uint32_t);
+			const VkBufferCopy keysRegion = { 0, 0, keysSize };
+			const VkBufferCopy valuesRegion = { 0, 0, static_cast<VkDeviceSize>(count) * sizeof(uint32_t) };
+			VulkanFunctionLoaders::vkCmdCopyBuffer(commandBuffer, PristineKeys.Buffer, Keys.Buffer, 1, &keysRegion);
+			VulkanFunctionLoaders::vkCmdCopyBuffer(commandBuffer, PristineValues.Buffer, Values.Buffer, 1, &valuesRegion);
+			VulkanFunctionLoaders::vkCmdFillBuffer(commandBuffer, Count.Buffer, 0, sizeof(uint32_t), count);
+
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.pNext = nullptr;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			return true;
+		};
+		return workload;
+	}
+
+	// Method to record sorting the first `count` pairs (with the count coming from our count buffer, as `makeRestoreWorkload` set it)
+	bool recordSort(VkCommandBuffer commandBuffer, RadixKeySize keySize, uint32_t count)
+	{
+		return Sort.recordSort(commandBuffer, keySize, { Keys.Buffer, 0, VK_WHOLE_SIZE }, { Values.Buffer, 0, VK_WHOLE_SIZE }, { TempKeys.Buffer, 0, VK_WHOLE_SIZE },
+			{ TempValues.Buffer, 0, VK_WHOLE_SIZE }, { Count.Buffer, 0, sizeof(uint32_t) }, { State.Buffer, 0, VK_WHOLE_SIZE }, count);
+	}
+
+	// Method to read back the first `sizeInBytes` of `source`, a staging buffer's worth at a time
+	bool readBack(ComputeBatchRunner& runner, const GpuBuffer& source, VkDeviceSize sizeInBytes, std::vector<uint32_t>& words)
+	{
+		words.resize(static_cast<size_t>(sizeInBytes / sizeof(uint32_t)));
+		for (VkDeviceSize offset = 0; offset < sizeInBytes; offset += StagingSize)
+		{
+			const VkDeviceSize chunkSize = std::min(StagingSize, sizeInBytes - offset);
+			if (!copyChunk(runner, source, offset, Staging, 0, chunkSize)) { return false; }
+			std::memcpy(words.data() + offset / sizeof(uint32_t), Staging.Mapped, static_cast<size_t>(chunkSize));
+		}
+		return true;
+	}
+
+	// CAREFUL: The GPU must be finished with every sort we've recorded before we call this!
+	void destroy()
+	{
+		Sort.destroy();
+		destroyBuffers();
+	}
+
+private:
+	void destroyPairs()
+	{
+		GpuBuffer* buffers[7] = { &Keys, &Values, &TempKeys, &TempValues, &PristineKeys, &PristineValues, &State };
+		for (GpuBuffer* buffer : buffers) { buffer->destroy(Device); }
+	}
+
+	// Method to copy `size` bytes between buffers in a batch of its own, with everything before it (GPU or host) made visible first
+	static bool copyChunk(ComputeBatchRunner& runner, const GpuBuffer& source, VkDeviceSize sourceOffset, const GpuBuffer& destination, VkDeviceSize destinationOffset,
+		VkDeviceSize size)
+	{
+		return runOnce(runner, "copy-chunk", [&source, sourceOffset, &destination, destinationOffset, size](VkCommandBuffer commandBuffer)
+		{
+			recordComputeToComputeBarrier(commandBuffer);
+			const VkBufferCopy region = { sourceOffset, destinationOffset, size };
+			VulkanFunctionLoaders::vkCmdCopyBuffer(commandBuffer, source.Buffer, destination.Buffer, 1, &region);
+
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.pNext = nullptr;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+			VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			return true;
+		});
+	}
+};
+
+// One radix sort benchmark: how many pairs of which key size
+struct SortBenchmark : GpuBenchmark
+{
+	RadixKeySize KeySize = RadixKeySize::Bits32;
+	uint32_t Count = 0;
+};
+
+// Everything needed to benchmark GPU culling: a `generateCullingScene` of `MaxInstanceCount` instances in device-local memory (smaller
+// benchmarks cull the first however many, which are spread over the same box), and room for a command per instance. The draw count &
+// commands get read back into the staging buffer, to check them against the CPU.
+struct CullFixture : GpuFixture
+{
+	static constexpr uint32_t MaxInstanceCount = 1000000;
+	static constexpr VkDeviceSize CommandsOffset = 256; // Of the commands in the staging buffer when they're read back - the count comes first
+
+	GpuCulling Culling;
+	CullingScene Scene;
+	CullView View = {};
+	GpuBuffer Instances, Meshes, ViewBuffer, Commands, DrawCount;
+
+	bool create(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, const VkPhysicalDeviceLimits& limits, ComputeBatchRunner& runner)
+	{
+		if (!Culling.create(device, limits.maxDrawIndirectCount)) { return false; }
+		Scene = generateCullingScene(MaxInstanceCount);
+		View = makeCullView(Scene.ViewProjection);
+
+		const VkDeviceSize instancesSize = Scene.Instances.size() * sizeof(CullInstance);
+		const VkDeviceSize meshesSize = Scene.Meshes.size() * sizeof(CullMesh);
+		const VkDeviceSize commandsSize = static_cast<VkDeviceSize>(MaxInstanceCount) * sizeof(VkDrawIndexedIndirectCommand);
+		const VkBufferUsageFlags indirect = StorageUsage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+		if (!createStaging(device, memoryProperties, std::max(instancesSize + meshesSize + sizeof(CullView), CommandsOffset + commandsSize)) ||
+			!createBuffer(Instances, instancesSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT) ||
+			!createBuffer(Meshes, meshesSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT) ||
+			!createBuffer(ViewBuffer, sizeof(CullView), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT) ||
+			!createBuffer(Commands, commandsSize, indirect) || !createBuffer(DrawCount, sizeof(uint32_t), indirect))
+		{
+			return false;
+		}
+
+		uint8_t* staging = static_cast<uint8_t*>(Staging.Mapped);
+		std::memcpy(staging, Scene.Instances.data(), static_cast<size_t>(instancesSize));
+		std::memcpy(staging + instancesSize, Scene.Meshes.data(), static_cast<size_t>(meshesSize));
+		std::memcpy(staging + instancesSize + meshesSize, &View, sizeof(CullView));
+		return uploadFromStaging(runner, "upload-culling-scene", { &Instances, &Meshes, &ViewBuffer });
+	}
+
+	bool recordCull(VkCommandBuffer commandBuffer, uint32_t instanceCount)
+	{
+		const CullDescriptors buffers = { { Instances.Buffer, 0, VK_WHOLE_SIZE }, { Meshes.Buffer, 0, VK_WHOLE_SIZE }, { ViewBuffer.Buffer, 0, VK_WHOLE_SIZE },
+			{ Commands.Buffer, 0, VK_WHOLE_SIZE }, { DrawCount.Buffer, 0, VK_WHOLE_SIZE } };
+		return Culling.recordCull(commandBuffer, buffers, instanceCount, instanceCount);
+	}
+
+	// The draw count & commands we last read back
+	uint32_t getDrawCount() const { return *static_cast<const uint32_t*>(Staging.Mapped); }
+	const VkDrawIndexedIndirectCommand* getCommands() const
+	{
+		return reinterpret_cast<const VkDrawIndexedIndirectCommand*>(static_cast<const uint8_t*>(Staging.Mapped) + CommandsOffset);
+	}
+
+	// CAREFUL: The GPU must be finished with every cull we've recorded before we call this!
+	void destroy()
+	{
+		Culling.destroy();
+		destroyBuffers();
+	}
+};
+
+// One GPU culling benchmark: how many instances (the same cull on the CPU is timed alongside it), and how many it found visible
+struct CullBenchmark : GpuBenchmark
+{
+	string CpuName;
+	uint32_t Count = 0;
+	uint32_t DrawCount = 0; // Set by its `Verify`
+};
+
+// Everything needed to benchmark `HiZPyramid`: a `Width` x `Height` image of random depths to build a pyramid from, uploaded once through the
+// staging buffer the pyramid then gets read back into. The source is a plain `VK_FORMAT_R32_SFLOAT` image rather than a depth buffer -
+// the pyramid only samples its R channel, and this way nothing needs a graphics queue to fill it in.
+struct HiZFixture : GpuFixture
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<float> Depths;
+	RenderTarget Source;
+	HiZPyramid Pyramid;
+
+	bool create(VkDevice device, VkPhysicalDevice physicalDevice, const VkPhysicalDeviceMemoryProperties& memoryProperties, const VkPhysicalDeviceFeatures& enabledFeatures,
+		uint32_t width, uint32_t height, ComputeBatchRunner& runner)
+	{
+		Width = width;
+		Height = height;
+		if (!Pyramid.create(device, physicalDevice, memoryProperties, enabledFeatures, width, height) ||
+			!createStaging(device, memoryProperties, std::max<VkDeviceSize>(static_cast<VkDeviceSize>(width) * height * sizeof(float), Pyramid.getReadbackSize())) ||
+			!Source.create(device, memoryProperties, VK_FORMAT_R32_SFLOAT, width, height, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_SAMPLE_COUNT_1_BIT,
+				VK_IMAGE_ASPECT_COLOR_BIT, false))
+		{
+			return false;
+		}
+
+		uint32_t seed = 1;
+		Depths.resize(static_cast<size_t>(width) * height);
+		for (float& depth : Depths)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			depth = static_cast<float>(seed >> 8) * (1.0f / 16777216.0f);
+		}
+		std::memcpy(Staging.Mapped, Depths.data(), Depths.size() * sizeof(float));
+
+		// The source goes to `VK_IMAGE_LAYOUT_GENERAL` once it's filled in, and the pyramid starts there (which is where it stays)
+		return runOnce(runner, "upload-hiz-depths", [this](VkCommandBuffer commandBuffer)
+		{
+			VkImageMemoryBarrier imageBarriers[2] = {};
+			for (VkImageMemoryBarrier& barrier : imageBarriers)
+			{
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.pNext = nullptr;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1 };
+			}
+			imageBarriers[0].srcAccessMask = 0;
+			imageBarriers[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			imageBarriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageBarriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			imageBarriers[0].image = Source.Image;
+			VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, imageBarriers);
+
+			VkBufferImageCopy region = {};
+			region.bufferOffset = 0;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			region.imageOffset = { 0, 0, 0 };
+			region.imageExtent = { Width, Height, 1 };
+			VulkanFunctionLoaders::vkCmdCopyBufferToImage(commandBuffer, Staging.Buffer, Source.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+			imageBarriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			imageBarriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			imageBarriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			imageBarriers[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+			imageBarriers[1].srcAccessMask = 0;
+			imageBarriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			imageBarriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageBarriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+			imageBarriers[1].image = Pyramid.Image;
+			VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 2, imageBarriers);
+			return true;
+		});
+	}
+
+	// Method to make a workload that reads every level of the pyramid back into the staging buffer
+	BatchWorkload makeReadbackWorkload()
+	{
+		BatchWorkload workload;
+		workload.Name = "readback-hiz-pyramid";
+		workload.Record = [this](VkCommandBuffer commandBuffer)
+		{
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.pNext = nullptr;
+			memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			Pyramid.recordReadback(commandBuffer, Staging.Buffer, VK_IMAGE_LAYOUT_GENERAL);
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			VulkanFunctionLoaders::vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			return true;
+		};
+		return workload;
+	}
+
+	// CAREFUL: The GPU must be finished with every build we've recorded before we call this!
+	void destroy()
+	{
+		Pyramid.destroy();
+		if (Device != VK_NULL_HANDLE) { Source.destroy(Device); }
+		destroyBuffers();
+	}
+};
+
+// Everything needed to benchmark `TransformHierarchy`: a `generateTransformScene` laid out as one, and the same scene as the kind of scene
+// graph it replaces - nodes allocated one at a time, each holding pointers to its children, updated by recursing from the roots - to
+// compare against. A hundredth of the nodes (scattered across the hierarchy) are the ones that move when only some do.
+struct TransformFixture
+{
+	struct SceneGraphNode
+	{
+		Transform Local;
+		Matrix4 World = {};
+		std::vector<SceneGraphNode*> Children;
+	};
+
+	TransformScene Scene;
+	TransformHierarchy Hierarchy;
+	std::vector<std::unique_ptr<SceneGraphNode>> SceneGraph; // By node
+	std::vector<SceneGraphNode*> SceneGraphRoots;
+	std::vector<uint32_t> MovingNodes;
+	uint32_t FrameIndex = 0;
+
+	bool create(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t nodeCount)
+	{
+		Scene = generateTransformScene(nodeCount);
+		if (!Hierarchy.create(device, memoryProperties, Scene.Parents)) { return false; }
+		for (uint32_t node = 0; node < nodeCount; ++node) { Hierarchy.setLocalTransform(node, Scene.Locals[node]); }
+
+		SceneGraph.resize(nodeCount);
+		for (uint32_t node = 0; node < nodeCount; ++node)
+		{
+			SceneGraph[node] = std::make_unique<SceneGraphNode>();
+			SceneGraph[node]->Local = Scene.Locals[node];
+		}
+		for (uint32_t node = 0; node < nodeCount; ++node)
+		{
+			if (Scene.Parents[node] < 0) { SceneGraphRoots.push_back(SceneGraph[node].get()); }
+			else { SceneGraph[Scene.Parents[node]]->Children.push_back(SceneGraph[node].get()); }
+		}
+		for (uint32_t node = 0; node < nodeCount; node += 100) { MovingNodes.push_back(node); }
+		return true;
+	}
+
+	void updateSceneGraph(SceneGraphNode& node, const Matrix4* parentWorld)
+	{
+		const Matrix4 local = makeTransformMatrix(node.Local);
+		node.World = parentWorld == nullptr ? local : multiplyMatrices(*parentWorld, local);
+		for (SceneGraphNode* child : node.Children) { updateSceneGraph(*child, &node.World); }
+	}
+
+	// Method to update the hierarchy for the next frame, having first set the local transforms of every node or just the moving ones
+	// (to what they already were, so every frame is the same work). Returns how many world matrices were recomputed.
+	uint32_t updateHierarchy(bool everyNode, JobSystem* jobs, BenchmarkTimings& timings)
+	{
+		if (everyNode)
+		{
+			for (uint32_t node = 0; node < Scene.Locals.size(); ++node) { Hierarchy.setLocalTransform(node, Scene.Locals[node]); }
+		}
+		else
+		{
+			for (uint32_t node : MovingNodes) { Hierarchy.setLocalTransform(node, Scene.Locals[node]); }
+		}
+		FrameIndex = (FrameIndex + 1) % 2;
+		const uint64_t start = TraceRecorder::nowNanoseconds();
+		const uint32_t recomputed = Hierarchy.update(FrameIndex, jobs);
+		timings.add("cpu", static_cast<double>(TraceRecorder::nowNanoseconds() - start));
+		return recomputed;
+	}
+
+	void destroy()
+	{
+		Hierarchy.destroy();
+		SceneGraphRoots.clear();
+		SceneGraph.clear();
+		MovingNodes.clear();
+	}
+};
+
+// A frame's worth of draws for benchmarking `DrawPacketQueue`, submitted in no particular order: 4 passes, 32 pipelines (over 8 layouts),
+// 1024 materials (each with its own descriptor set, and used with one pipeline) and 256 meshes (each with its own vertex & index
+// buffers), at random depths. Nothing is ever drawn, so the handles are made up - they only need to be different from each other.
+struct DrawPacketFixture
+{
+	static constexpr uint32_t PassCount = 4;
+	static constexpr uint32_t PipelineCount = 32;
+	static constexpr uint32_t MaterialCount = 1024;
+	static constexpr uint32_t MeshCount = 256;
+
+	DrawPacketQueue Unsorted;
+	DrawPacketQueue Sorted;
+	std::vector<std::pair<uint64_t, uint32_t>> StdSorted; // (key, index) - to time `std::sort` against, and check the radix sort with
+
+	template <typename Handle> static Handle makeHandle(uint64_t value)
+	{
+		if constexpr (std::is_pointer_v<Handle>) { return reinterpret_cast<Handle>(static_cast<uintptr_t>(value)); }
+		else { return static_cast<Handle>(value); }
+	}
+
+	void create(uint32_t drawCount)
+	{
+		uint32_t seed = 1;
+		auto random = [&seed](uint32_t range)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return static_cast<uint32_t>((static_cast<uint64_t>(seed >> 8) * range) >> 24);
+		};
+		for (uint32_t i = 0; i < drawCount; ++i)
+		{
+			const uint32_t pass = random(PassCount), material = random(MaterialCount), mesh = random(MeshCount);
+			const uint32_t pipeline = material % PipelineCount;
+			DrawPacket packet;
+			packet.Pipeline = makeHandle<VkPipeline>(1 + pipeline);
+			packet.Layout = makeHandle<VkPipelineLayout>(1 + pipeline % 8);
+			packet.DescriptorSets[0] = makeHandle<VkDescriptorSet>(1 + pass);
+			packet.DescriptorSets[1] = makeHandle<VkDescriptorSet>(1 + PassCount + material);
+			packet.VertexBuffers[0] = makeHandle<VkBuffer>(1 + mesh);
+			packet.IndexBuffer = makeHandle<VkBuffer>(1 + MeshCount + mesh);
+			packet.IndexCount = 36;
+			const uint64_t key = makeDrawSortKey(pass, pipeline, material, static_cast<float>(random(1u << 24)) / 16777216.0f, pass == PassCount - 1);
+			Unsorted.add(key, packet);
+			Sorted.add(key, packet);
+		}
+		Sorted.sort();
+	}
+
+	void sortWithStd()
+	{
+		StdSorted.resize(Unsorted.getCount());
+		for (uint32_t i = 0; i < Unsorted.getCount(); ++i) { StdSorted[i] = { Unsorted.getSortKey(i), i }; }
+		std::sort(StdSorted.begin(), StdSorted.end());
+	}
+
+	void destroy()
+	{
+		Unsorted.clear();
+		Sorted.clear();
+		StdSorted.clear();
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	BenchmarkOptions options;
+	if (!ParseBenchmarkOptions(argc, argv, options)) { return -1; }
+	Logger::setLevel(options.Level);
+
+	BenchmarkEnvironment environment;
+	environment.pinCpu();
+
+	// ----- Startup -----
+	// Note: This brings up (and tears down) its own context every repetition - so it needs to run before we make the shared one below,
+	// and it gets fewer repetitions than everything else as each one takes tens of milliseconds.
+	BenchmarkSuite startupSuite;
+	startupSuite.addMacro("startup", [](BenchmarkTimings& timings)
+	{
+		HeadlessContext context;
+		const bool created = context.create(ApplicationName);
+		if (created)
+		{
+			timings.add("load_library", static_cast<double>(context.Timings.LoadLibraryNanoseconds));
+			timings.add("create_instance", static_cast<double>(context.Timings.CreateInstanceNanoseconds));
+			timings.add("select_physical_device", static_cast<double>(context.Timings.SelectPhysicalDeviceNanoseconds));
+			timings.add("create_device", static_cast<double>(context.Timings.CreateDeviceNanoseconds));
+		}
+		context.destroy();
+		return created;
+	}, std::min<uint32_t>(options.Settings.Repetitions, 10));
+
+	bool allSucceeded = startupSuite.run(options.Settings);
+
+	// ----- CPU culling checks -----
+	// Note: The fallback for when the GPU can't cull: 1M instances (as a structure of arrays) frustum culled as spheres & as boxes, with every
+	// kernel this CPU can run on one thread, then with the best of them across the job system's workers as well. None of that needs a
+	// device, so it's checked here - before we try to make one, so a machine without Vulkan still finds out if a kernel is wrong - in full,
+	// against what the scalar kernel makes of each instance: every kernel, threaded or not, must agree.
+	JobSystem cullJobs;
+	cullJobs.create();
+	const CullingScene cpuCullScene = generateCullingScene(1000000);
+	const CullInstancesSoA cpuCullInstances = makeCullInstancesSoA(cpuCullScene);
+	const CullView cpuCullView = makeCullView(cpuCullScene.ViewProjection);
+	struct CpuCullBenchmark
+	{
+		string Name;
+		CpuCullShape Shape;
+		CpuCullKernel Kernel;
+		JobSystem* Jobs;
+		uint32_t VisibleCount = 0; // As of the checks
+	};
+	std::vector<CpuCullBenchmark> cpuCullBenchmarks;
+	for (CpuCullShape shape : { CpuCullShape::Sphere, CpuCullShape::Aabb })
+	{
+		const string shapeName = shape == CpuCullShape::Sphere ? "sphere" : "aabb";
+		for (CpuCullKernel kernel : { CpuCullKernel::Scalar, CpuCullKernel::Neon, CpuCullKernel::Avx2, CpuCullKernel::Avx512 })
+		{
+			if (!isCpuCullKernelSupported(kernel)) { continue; }
+			cpuCullBenchmarks.push_back({ "culling/cpu_soa_" + shapeName + "_" + getCpuCullKernelName(kernel) + "_1M", shape, kernel, nullptr });
+		}
+		cpuCullBenchmarks.push_back({ "culling/cpu_soa_" + shapeName + "_parallel_1M", shape, getBestCpuCullKernel(), &cullJobs });
+	}
+	std::vector<uint32_t> cpuCullVisible;
+	for (auto& cpuCullBenchmark : cpuCullBenchmarks)
+	{
+		cpuCullBenchmark.VisibleCount = cullInstancesSoA(cpuCullView, cpuCullInstances, cpuCullBenchmark.Shape, cpuCullVisible, cpuCullBenchmark.Kernel, cpuCullBenchmark.Jobs);
+		if (!checkCpuCulling(cpuCullView, cpuCullInstances, cpuCullBenchmark.Shape, cpuCullVisible.data(), cpuCullBenchmark.VisibleCount))
+		{
+			LOG_ERROR("[FAIL] {} got the wrong answer!", cpuCullBenchmark.Name);
+			allSucceeded = false;
+		}
+	}
+	LOG_VERBOSE("[OK] Checked {} CPU culling kernel & shape combination(s).", cpuCullBenchmarks.size());
+
+	// Everything else shares one context
+	HeadlessContext context;
+	if (!context.create(ApplicationName, { VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME,
+		VK_KHR_16BIT_STORAGE_EXTENSION_NAME, VK_KHR_STORAGE_BUFFER_STORAGE_CLASS_EXTENSION_NAME, VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME }))
+	{
+		LOG_ERROR("[FAIL] Could not create a headless Vulkan context to benchmark with.");
+		return -2;
+	}
+	environment.DeviceName = context.Properties.deviceName;
+	environment.DriverVersion = context.Properties.driverVersion;
+	environment.ApiVersion = context.Properties.apiVersion;
+	LOG_INFO("[OK] Benchmarking on: {}", environment.DeviceName);
+
+	VkDevice device = context.Device;
+	const VkPhysicalDeviceMemoryProperties& memoryProperties = context.MemoryProperties;
+
+	BenchmarkSuite suite;
+	suite.addResults(startupSuite.getResults());
+
+	// ----- Allocation -----
+	const uint32_t deviceLocalTypeIndex = VulkanHelpers::findMemoryTypeIndex(memoryProperties, UINT32_MAX, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (deviceLocalTypeIndex == UINT32_MAX)
+	{
+		LOG_ERROR("[FAIL] Device has no device-local memory type.");
+		return -3;
+	}
+	suite.addMicro("allocation/allocate_free_64KiB_device_local", [device, deviceLocalTypeIndex]()
+	{
+		VkMemoryAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.allocationSize = 64 * 1024;
+		allocateInfo.memoryTypeIndex = deviceLocalTypeIndex;
+
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VulkanFunctionLoaders::vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+		VulkanFunctionLoaders::vkFreeMemory(device, memory, nullptr);
+	});
+	suite.addMicro("allocation/buffer_create_bind_destroy_1MiB", [device, &memoryProperties]()
+	{
+		GpuBuffer buffer;
+		buffer.create(device, memoryProperties, 1024 * 1024, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		buffer.destroy(device);
+	});
+
+	// ----- Submission -----
+	SubmissionFixture singleSubmission;
+	SubmissionFixture batchedSubmission;
+	if (!singleSubmission.create(device, context.QueueFamilyIndex, 1) || !batchedSubmission.create(device, context.QueueFamilyIndex, 16))
+	{
+		LOG_ERROR("[FAIL] Could not create submission benchmark fixtures.");
+		return -4;
+	}
+	VkQueue queue = context.Queue;
+	suite.addMicro("submission/submit_wait_1_empty_command_buffer", [&singleSubmission, queue]() { singleSubmission.submitAndWait(queue); });
+	suite.addMicro("submission/submit_wait_16_empty_command_buffers", [&batchedSubmission, queue]() { batchedSubmission.submitAndWait(queue); });
+
+	// ----- Sync objects -----
+	// Note: What a frame that makes a fence for its submission (and destroys it afterwards) pays, versus recycling one through a pool.
+	// Pooled fences get reset 16 at a time, so most iterations make no driver calls at all.
+	FencePool fencePool;
+	fencePool.create(device);
+	suite.addMicro("sync/create_destroy_fence", [device]()
+	{
+		VkFenceCreateInfo fenceCreateInfo = {};
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceCreateInfo.pNext = nullptr;
+		fenceCreateInfo.flags = 0;
+		VkFence fence = VK_NULL_HANDLE;
+		VulkanFunctionLoaders::vkCreateFence(device, &fenceCreateInfo, nullptr, &fence);
+		VulkanFunctionLoaders::vkDestroyFence(device, fence, nullptr);
+	});
+	suite.addMicro("sync/pool_acquire_release_fence", [&fencePool]() { fencePool.release(fencePool.acquire()); });
+
+	// ----- Compute -----
+	// Note: These time the whole batch from the CPU (record, submit, wait & verify) and, where the queue supports timestamps, each
+	// workload on the GPU itself.
+	GpuProfiler profiler;
+	const bool profiling = profiler.create(device, context.Properties.limits.timestampPeriod, context.TimestampValidBits, 1);
+	ComputeBatchRunner batchRunner;
+	if (!batchRunner.create(device, context.QueueFamilyIndex, queue))
+	{
+		LOG_ERROR("[FAIL] Could not create compute batch runner.");
+		return -5;
+	}
+	if (profiling) { batchRunner.setProfiler(&profiler); }
+
+	// CPU benchmarks just time `body`
+	auto addCpuBenchmark = [&suite](const string& name, const std::function<void()>& body)
+	{
+		suite.addMacro(name, [body](BenchmarkTimings& timings)
+		{
+			const uint64_t start = TraceRecorder::nowNanoseconds();
+			body();
+			timings.add("cpu", static_cast<double>(TraceRecorder::nowNanoseconds() - start));
+			return true;
+		});
+	};
+
+	// Every GPU benchmark below is timed the same way: the whole batch from the CPU, and its own workload (the last one) on the GPU where we
+	// have timestamps. Checking what they wrote is left until after the suite has run (see "Verification").
+	std::vector<GpuBenchmark*> gpuBenchmarks;
+	auto addGpuBenchmark = [&suite, &batchRunner, &profiler, profiling, &gpuBenchmarks](GpuBenchmark& benchmark)
+	{
+		gpuBenchmarks.push_back(&benchmark);
+		suite.addMacro(benchmark.Name, [&benchmark, &batchRunner, &profiler, profiling](BenchmarkTimings& timings)
+		{
+			if (benchmark.ResetDescriptors) { benchmark.ResetDescriptors(); } // Safe - the runner waited for the last repetition to finish
+			const uint64_t start = TraceRecorder::nowNanoseconds();
+			if (!batchRunner.run(benchmark.Workloads)) { return false; }
+			timings.add("batch_wall", static_cast<double>(TraceRecorder::nowNanoseconds() - start));
+			if (profiling)
+			{
+				for (auto& zone : profiler.getLatestResults())
+				{
+					if (zone.Name == benchmark.Name) { timings.add("gpu", zone.Milliseconds * 1.0e6); }
+				}
+			}
+			return true;
+		});
+	};
+
+	// Note: The fill workload makes its buffers the first time it's recorded, and reuses them after - so it's run once here, where that
+	// isn't timed (even with `--warmup 0`)
+	std::vector<BatchWorkload> fillWorkloads = { makeBufferFillWorkload(device, memoryProperties, 16 * 1024 * 1024, 0xC0FFEE42u) };
+	if (!batchRunner.run(fillWorkloads))
+	{
+		LOG_ERROR("[FAIL] Could not run the buffer fill workload.");
+		allSucceeded = false;
+	}
+	suite.addMacro("compute/fill_copy_verify_16MiB", [&batchRunner, &profiler, profiling, &fillWorkloads](BenchmarkTimings& timings)
+	{
+		const uint64_t start = TraceRecorder::nowNanoseconds();
+		if (!batchRunner.run(fillWorkloads)) { return false; }
+		timings.add("batch_wall", static_cast<double>(TraceRecorder::nowNanoseconds() - start));
+		if (profiling)
+		{
+			for (auto& zone : profiler.getLatestResults()) { timings.add("gpu", zone.Milliseconds * 1.0e6); }
+		}
+		return true;
+	});
+
+	// ----- Kernels -----
+	// Note: Our compute kernels in fp32 and in whichever fp16 variant the device can do (see `selectComputePrecision`), on the same
+	// inputs. Each repetition times one kernel from the CPU & (with timestamps) on the GPU - then once everything has run, we work out
+	// each kernel's throughput from its median time and check its accuracy against the CPU.
+	std::vector<float> kernelXs(KernelFixture::ElementCount);
+	std::vector<float> kernelYs(KernelFixture::ElementCount);
+	std::vector<float> kernelAs(KernelFixture::MatrixSize * KernelFixture::MatrixSize);
+	std::vector<float> kernelBs(KernelFixture::MatrixSize * KernelFixture::MatrixSize);
+	uint32_t kernelSeed = 0x600DF00Du;
+	auto nextKernelInput = [&kernelSeed]()
+	{
+		kernelSeed = kernelSeed * 1664525u + 1013904223u;  // Note: A plain LCG is plenty random enough for test data
+		return static_cast<float>(kernelSeed >> 8) / 8388608.0f - 1.0f; // Top 24 bits, mapped onto [-1, 1)
+	};
+	for (auto* values : { &kernelXs, &kernelYs, &kernelAs, &kernelBs })
+	{
+		for (float& value : *values) { value = nextKernelInput(); }
+	}
+
+	const ComputePrecision fp16Precision = selectComputePrecision(context.StorageBuffer16BitAccessEnabled, context.ShaderFloat16Enabled);
+	const ComputePrecision kernelPrecisions[2] = { ComputePrecision::Fp32, fp16Precision };
+	const uint32_t kernelPrecisionCount = fp16Precision == ComputePrecision::Fp32 ? 1 : 2;
+	if (fp16Precision == ComputePrecision::Fp32)
+	{
+		LOG_WARNING("[WARNING] Device doesn't support `storageBuffer16BitAccess` - only benchmarking the fp32 kernels.");
+	}
+
+	const float axpyAlpha = 0.5f;
+	KernelFixture kernelFixtures[2];
+	std::deque<KernelBenchmark> kernelBenchmarks; // Note: A deque, so each benchmark stays put for the `Verify` that points back at it
+	for (uint32_t i = 0; i < kernelPrecisionCount; ++i)
+	{
+		KernelFixture& fixture = kernelFixtures[i];
+		const string precisionName = getComputePrecisionName(kernelPrecisions[i]);
+		if (!fixture.create(device, memoryProperties, kernelPrecisions[i]) || !fixture.upload(batchRunner, kernelXs, kernelYs, kernelAs, kernelBs))
+		{
+			LOG_WARNING("[WARNING] Skipping {} kernel benchmarks - their shaders couldn't be loaded (see `shaders/compile_shaders`) or their inputs uploaded.", precisionName);
+			fixture.destroy();
+			continue;
+		}
+
+		const VkDeviceSize elementSize = fixture.Kernels.getElementSize();
+		const VkDescriptorBufferInfo x = { fixture.X.Buffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo y = { fixture.Y.Buffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo result = { fixture.Result.Buffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo reduceScratch = { fixture.ReduceScratch.Buffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo reduceResult = { fixture.ReduceResult.Buffer, 0, sizeof(float) };
+		const VkDescriptorBufferInfo a = { fixture.A.Buffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo b = { fixture.B.Buffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo c = { fixture.C.Buffer, 0, VK_WHOLE_SIZE };
+		const uint32_t n = KernelFixture::ElementCount;
+		const uint32_t size = KernelFixture::MatrixSize;
+
+		// Every kernel benchmark reads its output back the same way, and is checked by how far that is from the CPU's reference. Errors are
+		// relative to the largest reference value, and allowed to be a few units in the last place of the storage precision.
+		const double tolerance = kernelPrecisions[i] == ComputePrecision::Fp32 ? 1.0e-5 : 4.0e-3;
+		auto addKernelBenchmark = [&kernelBenchmarks, &fixture, tolerance](const string& name, const std::function<bool(VkCommandBuffer)>& record, const GpuBuffer& output,
+			VkDeviceSize outputSize, const std::function<double()>& measureError) -> KernelBenchmark&
+		{
+			KernelBenchmark& benchmark = kernelBenchmarks.emplace_back();
+			benchmark.Name = name;
+			benchmark.ResetDescriptors = [&fixture]() { fixture.resetDescriptors(); };
+			benchmark.Workloads.push_back({ name, record, nullptr });
+			benchmark.Readback.push_back(fixture.makeReadbackWorkload(output, outputSize));
+			benchmark.Tolerance = tolerance;
+			benchmark.Verify = [&benchmark, measureError](ComputeBatchRunner&)
+			{
+				benchmark.MaxRelativeError = measureError();
+				return benchmark.MaxRelativeError <= benchmark.Tolerance;
+			};
+			return benchmark;
+		};
+
+		KernelBenchmark& axpy = addKernelBenchmark("kernels/axpy_4M_" + precisionName,
+			[&fixture, x, y, result, n, axpyAlpha](VkCommandBuffer cb) { return fixture.Kernels.recordElementwise(cb, ElementwiseOperation::Axpy, x, y, result, n, axpyAlpha); },
+			fixture.Result, n * elementSize, [&fixture, &kernelXs, &kernelYs, axpyAlpha]()
+		{
+			double maxError = 0.0;
+			double maxReference = 0.0;
+			for (size_t j = 0; j < kernelXs.size(); ++j)
+			{
+				const double reference = static_cast<double>(axpyAlpha) * kernelXs[j] + kernelYs[j];
+				maxError = std::max(maxError, std::abs(fixture.readElement(j) - reference));
+				maxReference = std::max(maxReference, std::abs(reference));
+			}
+			return maxError / maxReference;
+		});
+		axpy.BytesAccessed = 3.0 * n * elementSize;
+
+		KernelBenchmark& reduce = addKernelBenchmark("kernels/reduce_sum_4M_" + precisionName,
+			[&fixture, x, reduceScratch, reduceResult, n](VkCommandBuffer cb) { return fixture.Kernels.recordReduceSum(cb, x, reduceScratch, reduceResult, n); },
+			fixture.ReduceResult, sizeof(float), [&fixture, &kernelXs]()
+		{
+			// Note: Relative to the sum of the MAGNITUDES - the sum itself could be anywhere near zero
+			double reference = 0.0;
+			double magnitude = 0.0;
+			for (float value : kernelXs) { reference += value; magnitude += std::abs(value); }
+			const double sum = static_cast<const float*>(fixture.Staging.Mapped)[0]; // Always float, whatever the precision
+			return std::abs(sum - reference) / magnitude;
+		});
+		reduce.BytesAccessed = static_cast<double>(n) * elementSize;
+
+		auto measureGemmError = [&fixture, &kernelAs, &kernelBs, size]()
+		{
+			double maxError = 0.0;
+			double maxReference = 0.0;
+			std::vector<double> row(size);
+			for (uint32_t r = 0; r < size; ++r)
+			{
+				std::fill(row.begin(), row.end(), 0.0);
+				for (uint32_t k = 0; k < size; ++k)
+				{
+					const double aValue = kernelAs[r * size + k];
+					for (uint32_t col = 0; col < size; ++col) { row[col] += aValue * kernelBs[k * size + col]; }
+				}
+				for (uint32_t col = 0; col < size; ++col)
+				{
+					maxError = std::max(maxError, std::abs(fixture.readElement(r * size + col) - row[col]));
+					maxReference = std::max(maxReference, std::abs(row[col]));
+				}
+			}
+			return maxError / maxReference;
+		};
+		const VkDeviceSize gemmOutputSize = static_cast<VkDeviceSize>(size) * size * elementSize;
+		KernelBenchmark& gemm = addKernelBenchmark("kernels/gemm_" + std::to_string(size) + "_" + precisionName,
+			[&fixture, a, b, c, size](VkCommandBuffer cb) { return fixture.Kernels.recordGemm(cb, a, b, c, size, size, size); }, fixture.C, gemmOutputSize, measureGemmError);
+		gemm.BytesAccessed = 3.0 * size * size * elementSize;
+		gemm.FloatingPointOperations = 2.0 * size * size * size;
+
+		// The tiled GEMM does exactly the same work as the naive one, so only its workload differs
+		const GemmTileConfig gemmTiles = getTunedGemmTiles(context.Properties, device, memoryProperties, context.QueueFamilyIndex, queue, kernelPrecisions[i]);
+		if (fixture.Tiled.create(device, kernelPrecisions[i], gemmTiles))
+		{
+			KernelBenchmark& tiledGemm = addKernelBenchmark("kernels/gemm_tiled_" + std::to_string(size) + "_" + precisionName,
+				[&fixture, a, b, c, size](VkCommandBuffer cb) { return fixture.Tiled.record(cb, a, b, c, size, size, size); }, fixture.C, gemmOutputSize, measureGemmError);
+			tiledGemm.BytesAccessed = gemm.BytesAccessed;
+			tiledGemm.FloatingPointOperations = gemm.FloatingPointOperations;
+		}
+		else
+		{
+			LOG_WARNING("[WARNING] Skipping the {} tiled GEMM benchmark - its shader couldn't be loaded.", precisionName);
+		}
+	}
+	for (auto& kernelBenchmark : kernelBenchmarks) { addGpuBenchmark(kernelBenchmark); }
+
+	// ----- Scan primitives & stream compaction -----
+	// Note: Both variants where the device has subgroup arithmetic (so we can see what it buys us), otherwise just shared memory. Values are
+	// random bytes, so sums stay exact; heads are 1 in 1024 or so, which makes segments about half a partition long.
+	std::vector<uint32_t> primitiveValues(PrimitivesFixture::ElementCount);
+	std::vector<uint32_t> primitiveHeads(PrimitivesFixture::ElementCount);
+	uint32_t primitiveSeed = 0x5CA2F00Du;
+	for (uint32_t i = 0; i < PrimitivesFixture::ElementCount; ++i)
+	{
+		primitiveSeed = primitiveSeed * 1664525u + 1013904223u;
+		primitiveValues[i] = primitiveSeed >> 24;
+		primitiveHeads[i] = (primitiveSeed >> 8) % 1024 == 0 ? 1 : 0;
+	}
+
+	const SubgroupSupport subgroupSupport = querySubgroupSupport(context.PhysicalDevice, context.ApiVersion);
+	LOG_INFO("[OK] Subgroup size: {}, compute arithmetic: {}", subgroupSupport.SubgroupSize, subgroupSupport.Arithmetic);
+	const SubgroupSupport primitiveVariants[2] = { SubgroupSupport{ subgroupSupport.SubgroupSize, false }, subgroupSupport };
+	const uint32_t primitiveVariantCount = subgroupSupport.Arithmetic ? 2 : 1;
+
+	PrimitivesFixture primitivesFixtures[2];
+	std::deque<PrimitiveBenchmark> primitiveBenchmarks;
+	for (uint32_t i = 0; i < primitiveVariantCount; ++i)
+	{
+		PrimitivesFixture& fixture = primitivesFixtures[i];
+		const string variantName = primitiveVariants[i].Arithmetic ? "subgroup" : "shared";
+		if (!fixture.create(device, memoryProperties, primitiveVariants[i]) || !fixture.upload(batchRunner, primitiveValues, primitiveHeads))
+		{
+			LOG_WARNING("[WARNING] Skipping {} scan primitive & stream compaction benchmarks - their shaders couldn't be loaded (see `shaders/compile_shaders`) or their inputs uploaded.", variantName);
+			fixture.destroy();
+			continue;
+		}
+
+		const VkDescriptorBufferInfo values = { fixture.Values.Buffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo heads = { fixture.Heads.Buffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo output = { fixture.Output.Buffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo lookBack = { fixture.LookBack.Buffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo sum = { fixture.Sum.Buffer, 0, sizeof(uint32_t) };
+		const uint32_t n = PrimitivesFixture::ElementCount;
+		const VkDeviceSize arraySize = static_cast<VkDeviceSize>(n) * sizeof(uint32_t);
+
+		// Every primitive benchmark reads its output back the same way, and has to get it exactly right
+		auto addPrimitiveBenchmark = [&primitiveBenchmarks, &fixture](const string& name, const std::function<bool(VkCommandBuffer)>& record, double bytesAccessed,
+			const GpuBuffer& output, VkDeviceSize outputSize, const std::function<bool(const uint32_t*)>& check)
+		{
+			PrimitiveBenchmark& benchmark = primitiveBenchmarks.emplace_back();
+			benchmark.Name = name;
+			benchmark.ResetDescriptors = [&fixture]() { fixture.resetDescriptors(); };
+			benchmark.Workloads.push_back({ name, record, nullptr });
+			benchmark.Readback.push_back(fixture.makeReadbackWorkload(output, outputSize));
+			benchmark.Verify = [&fixture, check](ComputeBatchRunner&) { return check(fixture.getReadback()); };
+			benchmark.BytesAccessed = bytesAccessed;
+		};
+
+		addPrimitiveBenchmark("primitives/reduce_u32_16M_" + variantName, [&fixture, values, sum, n](VkCommandBuffer cb) { return fixture.Primitives.recordReduce(cb, values, sum, n); },
+			static_cast<double>(arraySize), fixture.Sum, sizeof(uint32_t), [&primitiveValues](const uint32_t* readback)
+		{
+			uint32_t expected = 0;
+			for (uint32_t value : primitiveValues) { expected += value; }
+			return readback[0] == expected;
+		});
+
+		// Note: Every scan reads the values & writes the output once (segmented scans read the heads too) - the look-back state is tiny next to those
+		for (uint32_t scan = 0; scan < 3; ++scan)
+		{
+			const bool exclusive = scan == 1;
+			const bool segmented = scan == 2;
+			addPrimitiveBenchmark(string("primitives/") + (segmented ? "segmented_scan" : exclusive ? "exclusive_scan" : "inclusive_scan") + "_16M_" + variantName,
+				[&fixture, values, heads, output, lookBack, n, exclusive, segmented](VkCommandBuffer cb)
+			{
+				if (segmented) { return fixture.Primitives.recordSegmentedScan(cb, values, heads, output, lookBack, n); }
+				if (exclusive) { return fixture.Primitives.recordExclusiveScan(cb, values, output, lookBack, n); }
+				return fixture.Primitives.recordInclusiveScan(cb, values, output, lookBack, n);
+			}, (segmented ? 3.0 : 2.0) * arraySize, fixture.Output, arraySize, [&primitiveValues, &primitiveHeads, exclusive, segmented](const uint32_t* readback)
+			{
+				uint32_t running = 0;
+				for (size_t j = 0; j < primitiveValues.size(); ++j)
+				{
+					if (segmented && primitiveHeads[j] != 0) { running = 0; }
+					if (exclusive && readback[j] != running) { return false; }
+					running += primitiveValues[j];
+					if (!exclusive && readback[j] != running) { return false; }
+				}
+				return true;
+			});
+		}
+
+		// Compactions keeping about 1%, 50% & 99% of the values (which are uniform over 0-255). Each reads the values once & writes only what
+		// passes, so the fewer pass the less it has to do. The count goes into `Sum`.
+		// Note: Only the compacted values are checked here - the headless batch's `makeStreamCompactionWorkload` checks counts & arguments too
+		const uint32_t keepPercentages[3] = { 1, 50, 99 };
+		for (uint32_t keepPercentage : keepPercentages)
+		{
+			const uint32_t operand = (keepPercentage * 256 + 50) / 100;
+			const size_t keptCount = std::count_if(primitiveValues.begin(), primitiveValues.end(), [operand](uint32_t value) { return value < operand; });
+			addPrimitiveBenchmark("primitives/compact_16M_" + std::to_string(keepPercentage) + "pct_" + variantName, [&fixture, values, output, sum, lookBack, n, operand](VkCommandBuffer cb)
+			{
+				return fixture.Compaction.recordCompact(cb, CompactPredicate::Less, operand, CompactOutput::Values, values, output, sum, lookBack, n);
+			}, static_cast<double>(arraySize) + static_cast<double>(keptCount) * sizeof(uint32_t), fixture.Output, keptCount * sizeof(uint32_t), [&primitiveValues, operand](const uint32_t* readback)
+			{
+				size_t kept = 0;
+				for (uint32_t value : primitiveValues)
+				{
+					if (value < operand && readback[kept++] != value) { return false; }
+				}
+				return true;
+			});
+		}
+	}
+	for (auto& primitiveBenchmark : primitiveBenchmarks) { addGpuBenchmark(primitiveBenchmark); }
+
+	// ----- Radix sort -----
+	// Note: Sizes from 1K to 100M pairs of 32-bit keys, and a couple of 64-bit ones - in whichever variant the device's subgroups call for, as
+	// the primitives above already compare those. Sizes the device can't hold are skipped. The CPU times include restoring the unsorted
+	// pairs, but the GPU times are just the sort.
+	SortFixture sortFixture;
+	std::deque<SortBenchmark> sortBenchmarks;
+	if (sortFixture.create(device, memoryProperties, context.Properties.limits, subgroupSupport, batchRunner))
+	{
+		const std::pair<uint32_t, const char*> sortSizes[] = { { 1000, "1K" }, { 10000, "10K" }, { 100000, "100K" }, { 1000000, "1M" }, { 10000000, "10M" }, { 100000000, "100M" } };
+		for (const auto& [count, sizeName] : sortSizes)
+		{
+			for (RadixKeySize keySize : { RadixKeySize::Bits32, RadixKeySize::Bits64 })
+			{
+				const uint32_t keyWords = keySize == RadixKeySize::Bits32 ? 1 : 2;
+				if (keyWords == 2 && count != 1000000 && count != 10000000) { continue; }
+				if (static_cast<uint64_t>(count) * keyWords > sortFixture.CapacityWords)
+				{
+					LOG_WARNING("[WARNING] Skipping sorting {} {}-bit keys - the device can only hold {} words of them.", sizeName, 32 * keyWords, sortFixture.CapacityWords);
+					continue;
+				}
+				SortBenchmark& benchmark = sortBenchmarks.emplace_back();
+				benchmark.Name = string("sort/radix_") + (keyWords == 1 ? "u32_" : "u64_") + sizeName;
+				benchmark.KeySize = keySize;
+				benchmark.Count = count;
+				benchmark.ResetDescriptors = [&sortFixture]() { sortFixture.Sort.resetDescriptors(); };
+				benchmark.Workloads.push_back(sortFixture.makeRestoreWorkload(keySize, count));
+				benchmark.Workloads.push_back({ benchmark.Name, [&sortFixture, keySize, count](VkCommandBuffer cb) { return sortFixture.recordSort(cb, keySize, count); }, nullptr });
+
+				// Note: Sorts are checked in full (see `checkRadixSort`) up to 10M pairs - past that, reading them back takes longer than it's worth.
+				// They're read back a staging buffer's worth at a time, rather than with a `Readback` workload.
+				if (count > 10000000) { continue; }
+				benchmark.Verify = [&sortFixture, keySize, keyWords, count](ComputeBatchRunner& runner)
+				{
+					std::vector<uint32_t> sortedKeys, sortedValues;
+					if (!sortFixture.readBack(runner, sortFixture.Keys, static_cast<VkDeviceSize>(count) * keyWords * sizeof(uint32_t), sortedKeys) ||
+						!sortFixture.readBack(runner, sortFixture.Values, static_cast<VkDeviceSize>(count) * sizeof(uint32_t), sortedValues))
+					{
+						return false;
+					}
+					auto originalKey = [keyWords](uint32_t index, uint32_t* words)
+					{
+						words[0] = getRadixSortTestKeyWord(index * keyWords);
+						words[1] = keyWords == 2 ? getRadixSortTestKeyWord(index * keyWords + 1) : 0;
+					};
+					return checkRadixSort(sortedKeys.data(), sortedValues.data(), count, keySize, originalKey);
+				};
+			}
+		}
+	}
+	else
+	{
+		LOG_WARNING("[WARNING] Skipping radix sort benchmarks - their shaders couldn't be loaded (see `shaders/compile_shaders`) or their buffers made.");
+		sortFixture.destroy();
+	}
+	for (auto& sortBenchmark : sortBenchmarks) { addGpuBenchmark(sortBenchmark); }
+
+	// ----- GPU culling -----
+	// Note: Frustum culling 100K to 1M instances into indirect draw commands on the GPU, against doing the same on one CPU core - which is
+	// what a CPU-driven renderer does every frame before it even starts making draw calls. Nothing gets drawn here, as the benchmark
+	// queue may not do graphics (the headless batch in the main executable draws them when it can).
+	CullFixture cullFixture;
+	std::deque<CullBenchmark> cullBenchmarks;
+	if (cullFixture.create(device, memoryProperties, context.Properties.limits, batchRunner))
+	{
+		const std::pair<uint32_t, const char*> cullSizes[] = { { 100000, "100K" }, { 250000, "250K" }, { 1000000, "1M" } };
+		for (const auto& [count, sizeName] : cullSizes)
+		{
+			CullBenchmark& benchmark = cullBenchmarks.emplace_back();
+			benchmark.Name = string("culling/gpu_frustum_") + sizeName;
+			benchmark.CpuName = string("culling/cpu_frustum_") + sizeName;
+			benchmark.Count = count;
+			benchmark.ResetDescriptors = [&cullFixture]() { cullFixture.Culling.resetDescriptors(); };
+			benchmark.Workloads.push_back({ benchmark.Name, [&cullFixture, count](VkCommandBuffer cb) { return cullFixture.recordCull(cb, count); }, nullptr });
+			benchmark.Readback.push_back(cullFixture.makeReadbackWorkload(cullFixture.DrawCount, sizeof(uint32_t)));
+			benchmark.Readback.push_back(cullFixture.makeReadbackWorkload(cullFixture.Commands, static_cast<VkDeviceSize>(count) * sizeof(VkDrawIndexedIndirectCommand), CullFixture::CommandsOffset));
+
+			// Note: Culls are checked against the CPU in full - except for instances right on a frustum plane, which may go either way
+			benchmark.Verify = [&cullFixture, &benchmark](ComputeBatchRunner&)
+			{
+				benchmark.DrawCount = cullFixture.getDrawCount();
+				return checkGpuCulling(cullFixture.View, cullFixture.Scene.Instances.data(), benchmark.Count, cullFixture.Scene.Meshes, cullFixture.getCommands(), benchmark.DrawCount);
+			};
+		}
+	}
+	else
+	{
+		LOG_WARNING("[WARNING] Skipping GPU culling benchmarks - their shaders couldn't be loaded (see `shaders/compile_shaders`) or their buffers made.");
+		cullFixture.destroy();
+	}
+
+	std::vector<VkDrawIndexedIndirectCommand> cpuCullCommands;
+	for (auto& cullBenchmark : cullBenchmarks)
+	{
+		addGpuBenchmark(cullBenchmark);
+		addCpuBenchmark(cullBenchmark.CpuName, [&cullBenchmark, &cullFixture, &cpuCullCommands]()
+		{
+			cullInstancesOnCpu(cullFixture.View, cullFixture.Scene.Instances.data(), cullBenchmark.Count, cullFixture.Scene.Meshes, cpuCullCommands);
+		});
+	}
+
+	// ----- CPU culling -----
+	// Note: Set up & checked before the context was (see above)
+	for (auto& cpuCullBenchmark : cpuCullBenchmarks)
+	{
+		addCpuBenchmark(cpuCullBenchmark.Name, [&cpuCullBenchmark, &cpuCullView, &cpuCullInstances, &cpuCullVisible]()
+		{
+			cullInstancesSoA(cpuCullView, cpuCullInstances, cpuCullBenchmark.Shape, cpuCullVisible, cpuCullBenchmark.Kernel, cpuCullBenchmark.Jobs);
+		});
+	}
+
+	// ----- Transform hierarchy -----
+	// Note: World matrices for 100K nodes, from a pointer-chasing scene graph vs `TransformHierarchy` - with every node moving (on one
+	// thread, then on the job system too) and with a hundredth of them moving, where only their subtrees need recomputing
+	TransformFixture transformFixture;
+	const string transformNames[] = { "transforms/scene_graph_100K", "transforms/soa_all_dirty_100K", "transforms/soa_all_dirty_parallel_100K", "transforms/soa_1pct_dirty_parallel_100K" };
+	if (transformFixture.create(device, memoryProperties, 100000))
+	{
+		addCpuBenchmark(transformNames[0], [&transformFixture]()
+		{
+			for (auto* root : transformFixture.SceneGraphRoots) { transformFixture.updateSceneGraph(*root, nullptr); }
+		});
+		suite.addMacro(transformNames[1], [&transformFixture](BenchmarkTimings& timings) { transformFixture.updateHierarchy(true, nullptr, timings); return true; });
+		suite.addMacro(transformNames[2], [&transformFixture, &cullJobs](BenchmarkTimings& timings) { transformFixture.updateHierarchy(true, &cullJobs, timings); return true; });
+		suite.addMacro(transformNames[3], [&transformFixture, &cullJobs](BenchmarkTimings& timings) { transformFixture.updateHierarchy(false, &cullJobs, timings); return true; });
+	}
+	else
+	{
+		LOG_WARNING("[WARNING] Skipping transform hierarchy benchmarks - its instance buffer couldn't be made.");
+		transformFixture.destroy();
+	}
+
+	// ----- Draw packets -----
+	// Note: A frame of 100K draws: radix sorting their keys vs `std::sort`, then playing them back (counting binds, not recording them)
+	// in the order they came in vs sorted - the difference being the binds the sort saves on top of what the state tracker drops anyway
+	DrawPacketFixture drawFixture;
+	drawFixture.create(100000);
+	const string drawNames[] = { "draws/radix_sort_100K", "draws/std_sort_100K", "draws/playback_unsorted_100K", "draws/playback_sorted_100K" };
+	DrawStats drawStats[2];
+	addCpuBenchmark(drawNames[0], [&drawFixture]() { drawFixture.Sorted.sort(); });
+	addCpuBenchmark(drawNames[1], [&drawFixture]() { drawFixture.sortWithStd(); });
+	addCpuBenchmark(drawNames[2], [&drawFixture, &drawStats]() { drawStats[0] = drawFixture.Unsorted.record(VK_NULL_HANDLE); });
+	addCpuBenchmark(drawNames[3], [&drawFixture, &drawStats]() { drawStats[1] = drawFixture.Sorted.record(VK_NULL_HANDLE); });
+
+	// ----- Hi-Z pyramid -----
+	// Note: A whole min/max depth pyramid of a 1080p & a 4K depth buffer, each in a single dispatch. The depths are random, so nothing about
+	// the data makes one tile any quicker than another.
+	HiZFixture hiZFixtures[2];
+	GpuBenchmark hiZBenchmarks[2];
+	const std::pair<uint32_t, uint32_t> hiZSizes[2] = { { 1920, 1080 }, { 3840, 2160 } };
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		HiZFixture& fixture = hiZFixtures[i];
+		GpuBenchmark& benchmark = hiZBenchmarks[i];
+		benchmark.Name = i == 0 ? "hiz/pyramid_1080p" : "hiz/pyramid_4k";
+		if (!fixture.create(device, context.PhysicalDevice, memoryProperties, context.EnabledFeatures, hiZSizes[i].first, hiZSizes[i].second, batchRunner))
+		{
+			LOG_WARNING("[WARNING] Skipping {} - its shader couldn't be loaded (see `shaders/compile_shaders`), the device can't write `rg32f` images, or its images weren't made.", benchmark.Name);
+			fixture.destroy();
+			continue;
+		}
+		benchmark.ResetDescriptors = [&fixture]() { fixture.Pyramid.resetDescriptors(); };
+		benchmark.Workloads.push_back({ benchmark.Name, [&fixture](VkCommandBuffer cb) { return fixture.Pyramid.record(cb, fixture.Source.View); }, nullptr });
+		benchmark.Readback.push_back(fixture.makeReadbackWorkload());
+
+		// Note: Pyramids are checked against one built on the CPU in full - they're nothing but mins & maxes, so they must match exactly
+		benchmark.Verify = [&fixture](ComputeBatchRunner&)
+		{
+			const std::vector<float> expected = buildHiZPyramidOnCpu(fixture.Depths.data(), fixture.Width, fixture.Height);
+			return std::memcmp(fixture.Staging.Mapped, expected.data(), expected.size() * sizeof(float)) == 0;
+		};
+		addGpuBenchmark(benchmark);
+	}
+
+	// ----- Render graph -----
+	// Note: Frame graphs get rebuilt every frame, so this times building AND compiling one: a 32-step post-processing chain of
+	// full-screen images (each pass samples the last image & renders the next), plus a debug pass whose output nobody reads.
+	// CAREFUL: The image handles are made up - that's fine as compiling never hands them to Vulkan.
+	suite.addMicro("rendergraph/build_compile_32_pass_chain", []()
+	{
+		RenderGraph graph;
+		RenderGraphResource previous = graph.importImage("Scene", (VkImage)(uintptr_t)1, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		for (uint32_t i = 0; i < 32; ++i)
+		{
+			const RenderGraphResource next = graph.importImage("Post", (VkImage)(uintptr_t)(i + 2));
+			graph.addPass("Post", [](VkCommandBuffer) {})
+				.read(previous, ResourceUsage::FragmentShaderRead)
+				.write(next, ResourceUsage::ColorAttachmentWrite);
+			previous = next;
+		}
+		const RenderGraphResource debugView = graph.importImage("Debug view", (VkImage)(uintptr_t)64);
+		graph.addPass("Debug view", [](VkCommandBuffer) {}).read(previous, ResourceUsage::ComputeShaderRead).write(debugView, ResourceUsage::ComputeShaderWrite);
+		graph.markOutput(previous, ResourceUsage::TransferRead);
+		graph.compile();
+	});
+
+	// ----- Object cache -----
+	// Note: Compares making a sampler from scratch with getting it from the cache. The cache holds one reference of its own throughout,
+	// so every acquire in the timed loop is a hit (and every release just drops the count back down).
+	ObjectCache objectCache;
+	objectCache.create(device);
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.pNext = nullptr;
+	samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+	samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+	const VkSampler heldSampler = objectCache.acquireSampler(samplerCreateInfo);
+	suite.addMicro("objectcache/create_destroy_sampler", [device, &samplerCreateInfo]()
+	{
+		VkSampler sampler = VK_NULL_HANDLE;
+		VulkanFunctionLoaders::vkCreateSampler(device, &samplerCreateInfo, nullptr, &sampler);
+		VulkanFunctionLoaders::vkDestroySampler(device, sampler, nullptr);
+	});
+	suite.addMicro("objectcache/acquire_release_cached_sampler", [&objectCache, &samplerCreateInfo]()
+	{
+		objectCache.releaseSampler(objectCache.acquireSampler(samplerCreateInfo));
+	});
+
+	// ----- Descriptors -----
+	// Note: Both of these write the same 7 descriptors (over 4 bindings) to the same set - one with a `VkWriteDescriptorSet` per binding,
+	// the other with a single templated update from the packed struct. Without `VK_KHR_descriptor_update_template` the second one is
+	// skipped, as it'd just be the first one again.
+	DescriptorFixture descriptorFixture;
+	if (descriptorFixture.create(device, memoryProperties, std::max(context.Properties.limits.minUniformBufferOffsetAlignment, context.Properties.limits.minStorageBufferOffsetAlignment)))
+	{
+		suite.addMicro("descriptors/update_7_descriptors_write_descriptor_sets", [&descriptorFixture]()
+		{
+			descriptorFixture.Template.updateWithWrites(descriptorFixture.Set, descriptorFixture.Descriptors);
+		});
+		if (descriptorFixture.Template.usesTemplate())
+		{
+			suite.addMicro("descriptors/update_7_descriptors_update_template", [&descriptorFixture]()
+			{
+				descriptorFixture.Template.update(descriptorFixture.Set, descriptorFixture.Descriptors);
+			});
+		}
+		else
+		{
+			LOG_WARNING("[WARNING] Skipping descriptor update template benchmark - it needs {}.", VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+		}
+	}
+	else
+	{
+		LOG_ERROR("[FAIL] Could not create descriptor benchmark fixture.");
+		allSucceeded = false;
+	}
+
+	// ----- Offscreen -----
+	// Note: Each repetition renders & reads back a burst of frames through the readback ring, so `per_frame` measures throughput (with
+	// frames overlapping each other) rather than the latency of any one frame. The consumer copies every frame out, like a real one would.
+	const uint32_t offscreenBurstFrames = 30;
+	OffscreenRenderer offscreenRenderer;
+	std::vector<uint8_t> consumedFrame;
+	if (context.TimelineSemaphoresEnabled && offscreenRenderer.create(device, memoryProperties, context.QueueFamilyIndex, queue, 1280, 720, 3))
+	{
+		offscreenRenderer.setConsumer([&consumedFrame](const ReadbackFrame& frame)
+		{
+			const size_t frameBytes = static_cast<size_t>(frame.Height) * frame.RowPitch;
+			consumedFrame.resize(frameBytes);
+			std::memcpy(consumedFrame.data(), frame.Pixels, frameBytes);
+		});
+		suite.addMacro("offscreen/render_readback_1280x720_burst_30", [&offscreenRenderer, offscreenBurstFrames](BenchmarkTimings& timings)
+		{
+			static const FrameRecorder recordFrame = makeTestPatternRecorder();
+			const uint64_t start = TraceRecorder::nowNanoseconds();
+			for (uint32_t i = 0; i < offscreenBurstFrames; ++i)
+			{
+				if (!offscreenRenderer.renderFrame(recordFrame)) { return false; }
+			}
+			if (!offscreenRenderer.finish()) { return false; }
+			const auto burstNanoseconds = static_cast<double>(TraceRecorder::nowNanoseconds() - start);
+			timings.add("burst_wall", burstNanoseconds);
+			timings.add("per_frame", burstNanoseconds / offscreenBurstFrames);
+			return true;
+		});
+	}
+	else
+	{
+		LOG_WARNING("[WARNING] Skipping offscreen benchmarks - they need {} and an offscreen renderer.", VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+	}
+
+	allSucceeded = suite.run(options.Settings) && allSucceeded;
+
+	const SyncPoolStats fenceStats = fencePool.getStats();
+	LOG_VERBOSE("[OK] Fence pool: {} acquires served by {} fence(s) with {} reset call(s).", fenceStats.Acquired, fenceStats.Created, fenceStats.ResetCalls);
+
+	// ----- Verification -----
+	// Note: Every GPU benchmark that ran is run once more and what it wrote checked (see `verifyGpuBenchmark`) - out here, so none of the
+	// checking gets timed
+	auto findGpuTiming = [&suite](const string& name)
+	{
+		const BenchmarkResult* timing = nullptr;
+		for (auto& benchmarkResult : suite.getResults())
+		{
+			if (benchmarkResult.Name == name + "/gpu" || (timing == nullptr && benchmarkResult.Name == name + "/batch_wall")) { timing = &benchmarkResult; }
+		}
+		return timing;
+	};
+	for (GpuBenchmark* gpuBenchmark : gpuBenchmarks)
+	{
+		if (findGpuTiming(gpuBenchmark->Name) == nullptr) { continue; } // Filtered out
+		if (!verifyGpuBenchmark(batchRunner, *gpuBenchmark)) { allSucceeded = false; }
+	}
+
+	// ----- Throughput -----
+	// Note: GPU throughput comes from the median GPU time where we have one (the CPU's `batch_wall` includes submitting & waiting)
+	for (auto& kernelBenchmark : kernelBenchmarks)
+	{
+		const BenchmarkResult* timing = findGpuTiming(kernelBenchmark.Name);
+		if (timing == nullptr) { continue; } // Filtered out
+		const double nanoseconds = timing->Stats.Median;
+		LOG_INFO("[OK] {}: {} GB/s, {} GFLOP/s, max relative error {} (tolerance {})", kernelBenchmark.Name, kernelBenchmark.BytesAccessed / nanoseconds,
+			kernelBenchmark.FloatingPointOperations / nanoseconds, kernelBenchmark.MaxRelativeError, kernelBenchmark.Tolerance);
+	}
+	for (auto& primitiveBenchmark : primitiveBenchmarks)
+	{
+		const BenchmarkResult* timing = findGpuTiming(primitiveBenchmark.Name);
+		if (timing == nullptr) { continue; } // Filtered out
+		LOG_INFO("[OK] {}: {} GB/s", primitiveBenchmark.Name, primitiveBenchmark.BytesAccessed / timing->Stats.Median);
+	}
+	for (auto& sortBenchmark : sortBenchmarks)
+	{
+		const BenchmarkResult* timing = findGpuTiming(sortBenchmark.Name);
+		if (timing == nullptr) { continue; } // Filtered out
+		LOG_INFO("[OK] {}: {} million pairs/s", sortBenchmark.Name, sortBenchmark.Count / timing->Stats.Median * 1.0e3);
+	}
+	for (auto& cullBenchmark : cullBenchmarks)
+	{
+		const BenchmarkResult* timing = findGpuTiming(cullBenchmark.Name);
+		if (timing == nullptr) { continue; } // Filtered out
+		LOG_INFO("[OK] {}: {} million instances/s, {} of {} visible", cullBenchmark.Name, cullBenchmark.Count / timing->Stats.Median * 1.0e3, cullBenchmark.DrawCount, cullBenchmark.Count);
+	}
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		const BenchmarkResult* timing = findGpuTiming(hiZBenchmarks[i].Name);
+		if (timing == nullptr) { continue; } // Skipped or filtered out
+		const HiZFixture& fixture = hiZFixtures[i];
+		LOG_INFO("[OK] {}: {} Gtexels/s of depth, {} levels", hiZBenchmarks[i].Name, static_cast<double>(fixture.Width) * fixture.Height / timing->Stats.Median, fixture.Pyramid.Levels);
+	}
+
+	// Note: CPU culls were checked before the suite ran (see "CPU culling checks")
+	for (auto& cpuCullBenchmark : cpuCullBenchmarks)
+	{
+		const BenchmarkResult* timing = nullptr;
+		for (auto& benchmarkResult : suite.getResults())
+		{
+			if (benchmarkResult.Name == cpuCullBenchmark.Name + "/cpu") { timing = &benchmarkResult; }
+		}
+		if (timing == nullptr) { continue; } // Filtered out
+		LOG_INFO("[OK] {}: {} million instances/s ({} ms), {} of {} visible", cpuCullBenchmark.Name, cpuCullInstances.getCount() / timing->Stats.Median * 1.0e3,
+			timing->Stats.Median * 1.0e-6, cpuCullBenchmark.VisibleCount, cpuCullInstances.getCount());
+	}
+
+	// Note: Transforms are checked against the scene graph's - and both of the instance buffer's copies against what we kept, after they've
+	// caught up - exactly, as they all multiply the same matrices in the same order
+	for (const string& transformName : transformNames)
+	{
+		const BenchmarkResult* timing = nullptr;
+		for (auto& benchmarkResult : suite.getResults())
+		{
+			if (benchmarkResult.Name == transformName + "/cpu") { timing = &benchmarkResult; }
+		}
+		if (timing == nullptr) { continue; } // Skipped or filtered out
+		LOG_INFO("[OK] {}: {} million nodes/s, {} levels", transformName, transformFixture.Scene.Parents.size() / timing->Stats.Median * 1.0e3, transformFixture.Hierarchy.getLevelCount());
+	}
+	if (transformFixture.Hierarchy.getNodeCount() > 0)
+	{
+		for (auto* root : transformFixture.SceneGraphRoots) { transformFixture.updateSceneGraph(*root, nullptr); }
+		BenchmarkTimings unused;
+		transformFixture.updateHierarchy(true, &cullJobs, unused);
+		transformFixture.updateHierarchy(false, nullptr, unused);
+
+		// Note: With nothing set since, updates only have to catch each frame's copy up - so nothing should be recomputed, however often
+		// we switch between them
+		uint32_t idleRecomputed = 0;
+		for (uint32_t i = 0; i < 4; ++i) { idleRecomputed += transformFixture.Hierarchy.update(i % 2, (i & 2) != 0 ? &cullJobs : nullptr); }
+		if (idleRecomputed != 0)
+		{
+			LOG_ERROR("[FAIL] The transform hierarchy recomputed {} world matrices with no local transforms set!", idleRecomputed);
+			allSucceeded = false;
+		}
+
+		bool matching = true;
+		for (uint32_t node = 0; node < transformFixture.Hierarchy.getNodeCount() && matching; ++node)
+		{
+			const Matrix4& expected = transformFixture.SceneGraph[node]->World;
+			matching = transformFixture.Hierarchy.getWorldMatrix(node) == expected;
+			for (uint32_t frame = 0; frame < 2; ++frame)
+			{
+				const uint8_t* instances = static_cast<const uint8_t*>(transformFixture.Hierarchy.Instances.Mapped) + transformFixture.Hierarchy.getInstanceOffset(frame);
+				matching = matching && std::memcmp(instances + transformFixture.Hierarchy.getSlot(node) * sizeof(Matrix4), expected.data(), sizeof(Matrix4)) == 0;
+			}
+		}
+		if (!matching)
+		{
+			LOG_ERROR("[FAIL] The transform hierarchy's world matrices don't match the scene graph's!");
+			allSucceeded = false;
+		}
+	}
+
+	// Note: The radix sort must give exactly what `std::sort` does (it's stable, and no two draws share an index), and playback must make
+	// or avoid every bind of every draw - with fewer binds sorted than not
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		const BenchmarkResult* timing = nullptr;
+		for (auto& benchmarkResult : suite.getResults())
+		{
+			if (benchmarkResult.Name == drawNames[i] + "/cpu") { timing = &benchmarkResult; }
+		}
+		if (timing == nullptr) { continue; } // Filtered out
+		if (i < 2) { LOG_INFO("[OK] {}: {} million draws/s", drawNames[i], drawFixture.Unsorted.getCount() / timing->Stats.Median * 1.0e3); }
+		else
+		{
+			const DrawStats& stats = drawStats[i - 2];
+			LOG_INFO("[OK] {}: {} million draws/s, {} binds made & {} avoided", drawNames[i], drawFixture.Unsorted.getCount() / timing->Stats.Median * 1.0e3,
+				stats.getBinds(), stats.getBindsAvoided());
+			LOG_INFO("  Made / avoided: pipeline {} / {}, descriptor set {} / {}, vertex buffer {} / {}, index buffer {} / {}", stats.PipelineBinds, stats.PipelineBindsAvoided,
+				stats.DescriptorSetBinds, stats.DescriptorSetBindsAvoided, stats.VertexBufferBinds, stats.VertexBufferBindsAvoided, stats.IndexBufferBinds, stats.IndexBufferBindsAvoided);
+		}
+	}
+	{
+		drawFixture.Sorted.sort();
+		drawFixture.sortWithStd();
+		bool sortedCorrectly = true;
+		for (uint32_t i = 0; i < drawFixture.Sorted.getCount() && sortedCorrectly; ++i) { sortedCorrectly = drawFixture.Sorted.getDrawIndex(i) == drawFixture.StdSorted[i].second; }
+		const DrawStats unsortedStats = drawFixture.Unsorted.record(VK_NULL_HANDLE);
+		const DrawStats sortedStats = drawFixture.Sorted.record(VK_NULL_HANDLE);
+		const uint32_t drawCount = drawFixture.Unsorted.getCount();
+		auto isConsistent = [drawCount](const DrawStats& stats)
+		{
+			return stats.Draws == drawCount && stats.PipelineBinds + stats.PipelineBindsAvoided == drawCount && stats.DescriptorSetBinds + stats.DescriptorSetBindsAvoided == drawCount * 2 &&
+				stats.VertexBufferBinds + stats.VertexBufferBindsAvoided == drawCount && stats.IndexBufferBinds + stats.IndexBufferBindsAvoided == drawCount;
+		};
+		if (!sortedCorrectly || !isConsistent(unsortedStats) || !isConsistent(sortedStats) || sortedStats.getBinds() >= unsortedStats.getBinds())
+		{
+			LOG_ERROR("[FAIL] Draw packets were sorted or played back wrongly!");
+			allSucceeded = false;
+		}
+	}
+
+	// ----- Results -----
+	suite.logResults();
+	const bool written = suite.writeJson(options.OutputPath, environment, options.Settings);
+	const bool withinThresholds = options.BaselinePath.empty() || suite.compareWithBaseline(options.BaselinePath, environment, options.Thresholds);
+
+	// ----- Clean up -----
+	fillWorkloads.clear(); // Note: This is what frees the workload's buffers - so it must happen before we destroy the device
+	kernelBenchmarks.clear();
+	for (auto& fixture : kernelFixtures) { fixture.destroy(); }
+	primitiveBenchmarks.clear();
+	for (auto& fixture : primitivesFixtures) { fixture.destroy(); }
+	sortBenchmarks.clear();
+	sortFixture.destroy();
+	cullBenchmarks.clear();
+	cullFixture.destroy();
+	for (auto& fixture : hiZFixtures) { fixture.destroy(); }
+	transformFixture.destroy();
+	drawFixture.destroy();
+	cullJobs.destroy();
+	batchRunner.destroy();
+	offscreenRenderer.destroy();
+	descriptorFixture.destroy(device);
+	objectCache.releaseSampler(heldSampler);
+	objectCache.destroy();
+	fencePool.destroy();
+	if (profiling) { profiler.destroy(); }
+	batchedSubmission.destroy();
+	singleSubmission.destroy();
+	context.destroy();
+
+	if (!allSucceeded || !written) { return -6; }
+	return withinThresholds ? 0 : -7;
+}
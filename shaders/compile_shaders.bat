@@ -0,0 +1,46 @@
+@echo off
+rem Compiles our GLSL shaders to SPIR-V with glslangValidator (from the Vulkan SDK), once per variant. Output goes to shaders\spv
+rem (which is where everything looks by default) unless we're given another directory: compile_shaders.bat [output directory]
+setlocal
+set SHADER_DIR=%~dp0
+set OUT_DIR=%~1
+if "%OUT_DIR%"=="" set OUT_DIR=%SHADER_DIR%spv
+set GLSLANG="%VULKAN_SDK%\Bin\glslangValidator.exe"
+if not exist %GLSLANG% set GLSLANG=glslangValidator
+if not exist "%OUT_DIR%" mkdir "%OUT_DIR%"
+
+call :compile elementwise.comp elementwise_fp32.spv || exit /b 1
+call :compile elementwise.comp elementwise_fp16.spv -DFP16_STORAGE || exit /b 1
+call :compile elementwise.comp elementwise_fp16_arithmetic.spv -DFP16_STORAGE -DFP16_ARITHMETIC || exit /b 1
+call :compile reduce_sum.comp reduce_sum_fp32.spv || exit /b 1
+call :compile reduce_sum.comp reduce_sum_fp16.spv -DFP16_STORAGE || exit /b 1
+call :compile gemm.comp gemm_fp32.spv || exit /b 1
+call :compile gemm.comp gemm_fp16.spv -DFP16_STORAGE || exit /b 1
+call :compile gemm_tiled.comp gemm_tiled_fp32.spv || exit /b 1
+call :compile gemm_tiled.comp gemm_tiled_fp16.spv -DFP16_STORAGE || exit /b 1
+call :compile prefix_scan.comp prefix_scan.spv || exit /b 1
+call :compile_subgroup prefix_scan.comp prefix_scan_subgroup.spv || exit /b 1
+call :compile reduce_u32.comp reduce_u32.spv || exit /b 1
+call :compile_subgroup reduce_u32.comp reduce_u32_subgroup.spv || exit /b 1
+call :compile radix_sort_setup.comp radix_sort_setup.spv || exit /b 1
+call :compile radix_sort_histogram.comp radix_sort_histogram.spv || exit /b 1
+call :compile radix_sort_onesweep.comp radix_sort_onesweep.spv || exit /b 1
+call :compile_subgroup radix_sort_onesweep.comp radix_sort_onesweep_subgroup.spv || exit /b 1
+call :compile stream_compact.comp stream_compact.spv || exit /b 1
+call :compile_subgroup stream_compact.comp stream_compact_subgroup.spv || exit /b 1
+call :compile indirect_args.comp indirect_args.spv || exit /b 1
+call :compile gpu_cull.comp gpu_cull.spv || exit /b 1
+call :compile gpu_cull.comp gpu_cull_occlusion.spv -DOCCLUSION || exit /b 1
+call :compile cull_depth.vert cull_depth_vert.spv || exit /b 1
+call :compile hiz_pyramid.comp hiz_pyramid.spv || exit /b 1
+exit /b 0
+
+rem Usage: call :compile <source> <output> [defines...]
+:compile
+%GLSLANG% -V --target-env vulkan1.0 %3 %4 %5 %6 "%SHADER_DIR%%1" -o "%OUT_DIR%\%2" || exit /b 1
+exit /b 0
+
+rem Usage: call :compile_subgroup <source> <output> - the SUBGROUP_ARITHMETIC variant, which needs Vulkan 1.1 (SPIR-V 1.3)
+:compile_subgroup
+%GLSLANG% -V --target-env vulkan1.1 -DSUBGROUP_ARITHMETIC "%SHADER_DIR%%1" -o "%OUT_DIR%\%2" || exit /b 1
+exit /b 0
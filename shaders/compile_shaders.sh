@@ -0,0 +1,49 @@
+#!/bin/sh
+# Compiles our GLSL shaders to SPIR-V with glslangValidator (from the Vulkan SDK, or your distro's glslang package), once per
+# variant. Output goes to shaders/spv (which is where everything looks by default) unless we're given another directory:
+#     ./compile_shaders.sh [output directory]
+set -e
+SHADER_DIR=$(cd "$(dirname "$0")" && pwd)
+OUT_DIR=${1:-$SHADER_DIR/spv}
+GLSLANG=${VULKAN_SDK:+$VULKAN_SDK/bin/}glslangValidator
+mkdir -p "$OUT_DIR"
+
+# Usage: compile <source> <output> [defines...]
+compile()
+{
+	source=$1
+	output=$2
+	shift 2
+	"$GLSLANG" -V --target-env vulkan1.0 "$@" "$SHADER_DIR/$source" -o "$OUT_DIR/$output"
+}
+
+# Usage: compile_subgroup <source> <output> - the SUBGROUP_ARITHMETIC variant, which needs Vulkan 1.1 (SPIR-V 1.3)
+compile_subgroup()
+{
+	"$GLSLANG" -V --target-env vulkan1.1 -DSUBGROUP_ARITHMETIC "$SHADER_DIR/$1" -o "$OUT_DIR/$2"
+}
+
+compile elementwise.comp elementwise_fp32.spv
+compile elementwise.comp elementwise_fp16.spv -DFP16_STORAGE
+compile elementwise.comp elementwise_fp16_arithmetic.spv -DFP16_STORAGE -DFP16_ARITHMETIC
+compile reduce_sum.comp reduce_sum_fp32.spv
+compile reduce_sum.comp reduce_sum_fp16.spv -DFP16_STORAGE
+compile gemm.comp gemm_fp32.spv
+compile gemm.comp gemm_fp16.spv -DFP16_STORAGE
+compile gemm_tiled.comp gemm_tiled_fp32.spv
+compile gemm_tiled.comp gemm_tiled_fp16.spv -DFP16_STORAGE
+compile prefix_scan.comp prefix_scan.spv
+compile_subgroup prefix_scan.comp prefix_scan_subgroup.spv
+compile reduce_u32.comp reduce_u32.spv
+compile_subgroup reduce_u32.comp reduce_u32_subgroup.spv
+compile radix_sort_setup.comp radix_sort_setup.spv
+compile radix_sort_histogram.comp radix_sort_histogram.spv
+compile radix_sort_onesweep.comp radix_sort_onesweep.spv
+compile_subgroup radix_sort_onesweep.comp radix_sort_onesweep_subgroup.spv
+compile stream_compact.comp stream_compact.spv
+compile_subgroup stream_compact.comp stream_compact_subgroup.spv
+compile indirect_args.comp indirect_args.spv
+compile gpu_cull.comp gpu_cull.spv
+compile gpu_cull.comp gpu_cull_occlusion.spv -DOCCLUSION
+compile cull_depth.vert cull_depth_vert.spv
+compile hiz_pyramid.comp hiz_pyramid.spv
@@ -0,0 +1,18 @@
+#version 450
+
+// Draws culled instances depth-only (see `CulledDepthRenderer`): each vertex of a unit-sized mesh is scaled by its instance's bounding
+// sphere radius & moved to its centre. The sphere comes in as a per-instance vertex attribute straight from the culling instance buffer -
+// the draw commands from `gpu_cull.comp` set firstInstance to the instance's index, so attribute fetch picks the right one.
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 sphere; // Per instance: centre (xyz) & radius (w)
+
+layout(push_constant) uniform PushConstants
+{
+	mat4 ViewProjection;
+} pushConstants;
+
+void main()
+{
+	gl_Position = pushConstants.ViewProjection * vec4(sphere.xyz + position * sphere.w, 1.0);
+}